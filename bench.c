@@ -0,0 +1,840 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SVCX_IMPLEMENTATION
+#include "svcxtend.h"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// The svcx_sv_find implementation before the SIMD and Two-Way searches.
+static size_t naive_find(svcx_string_view haystack, svcx_string_view needle) {
+    if (needle.len == 0) {
+        return 0;
+    }
+    if (needle.len > haystack.len) {
+        return -1;
+    }
+
+    for (size_t i = 0; i <= haystack.len - needle.len; i++) {
+        if (memcmp(haystack.data + i, needle.data, needle.len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void bench_sv_find(void) {
+    enum { SIZE = 16 * 1024 * 1024, RUNS = 5 };
+    static const char *const lines[] = {
+        "2024-05-01T12:00:00Z INFO request handled path=/api/v1/items\n",
+        "2024-05-01T12:00:01Z WARN slow query took=1532ms table=orders\n",
+        "2024-05-01T12:00:02Z INFO request handled path=/api/v1/users\n",
+    };
+    static const char *const needles[] = {
+        "E",
+        "ERROR",
+        "table=customers",
+        "2024-05-01T12:00:03Z ERROR connection reset by peer",
+    };
+
+    char *hay = malloc(SIZE);
+    size_t len = 0;
+    for (size_t i = 0; len + 80 < SIZE; i++) {
+        size_t n = strlen(lines[i % SVCX_ARRAY_LEN(lines)]);
+        memcpy(hay + len, lines[i % SVCX_ARRAY_LEN(lines)], n);
+        len += n;
+    }
+    svcx_string_view h = svcx_sv_from_parts(hay, len);
+
+    printf("svcx_sv_find over %zu MB of log lines (needle absent)\n",
+        len >> 20);
+    for (size_t k = 0; k < SVCX_ARRAY_LEN(needles); k++) {
+        svcx_string_view n = svcx_sv_from_cstr(needles[k]);
+        double naive = 0.0, fast = 0.0;
+        for (int r = 0; r < RUNS; r++) {
+            double t0 = now_seconds();
+            volatile size_t a = naive_find(h, n);
+            double t1 = now_seconds();
+            volatile size_t b = svcx_sv_find(h, n);
+            double t2 = now_seconds();
+            SVCX_UNUSED(a);
+            SVCX_UNUSED(b);
+            naive += t1 - t0;
+            fast += t2 - t1;
+        }
+        double mb = (double)len * RUNS / (1024.0 * 1024.0);
+        printf("  needle len %2zu: naive %8.1f MB/s, svcx %8.1f MB/s\n",
+            n.len,
+            mb / naive,
+            mb / fast);
+    }
+    free(hay);
+}
+
+// FNV-1a, a common byte-at-a-time hash, as a reference point.
+static uint64_t fnv1a(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static void bench_hash(void) {
+    enum { BYTES = 64 * 1024 * 1024, KEYS = 1 << 20 };
+    static const size_t sizes[] = {8, 16, 64, 1024, 1 << 20};
+
+    char *buf = malloc(BYTES);
+    for (size_t i = 0; i < BYTES; i++) {
+        buf[i] = (char)(i * 131 + (i >> 9));
+    }
+
+    printf("svcx_hash_bytes throughput (%d MB per size)\n", BYTES >> 20);
+    for (size_t k = 0; k < SVCX_ARRAY_LEN(sizes); k++) {
+        size_t n = sizes[k];
+        volatile uint64_t sink = 0;
+
+        double t0 = now_seconds();
+        for (size_t off = 0; off + n <= BYTES; off += n) {
+            sink ^= fnv1a(buf + off, n);
+        }
+        double t1 = now_seconds();
+        for (size_t off = 0; off + n <= BYTES; off += n) {
+            sink ^= svcx_hash_bytes(buf + off, n, 0);
+        }
+        double t2 = now_seconds();
+
+        double gb = (double)BYTES / 1e9;
+        printf("  %7zu byte keys: fnv1a %6.2f GB/s, svcx %6.2f GB/s\n",
+            n,
+            gb / (t1 - t0),
+            gb / (t2 - t1));
+    }
+
+    svcx_string_view *keys = malloc(KEYS * sizeof(svcx_string_view));
+    uint64_t *out = malloc(KEYS * sizeof(uint64_t));
+    unsigned seed = 1;
+    for (size_t i = 0; i < KEYS; i++) {
+        seed = seed * 1103515245 + 12345;
+        keys[i] = svcx_sv_from_parts(
+            buf + (seed >> 4) % (BYTES - 24), 1 + (seed >> 20) % 24);
+    }
+
+    double t0 = now_seconds();
+    for (size_t i = 0; i < KEYS; i++) {
+        out[i] = svcx_hash_sv(keys[i], 0);
+    }
+    double t1 = now_seconds();
+    svcx_hash_sv_batch(keys, KEYS, 0, out);
+    double t2 = now_seconds();
+    printf("  %d scattered keys: one by one %.1f Mkeys/s, batch %.1f Mkeys/s\n",
+        KEYS,
+        KEYS / (t1 - t0) / 1e6,
+        KEYS / (t2 - t1) / 1e6);
+
+    free(out);
+    free(keys);
+    free(buf);
+}
+
+// The usual way to parse a number out of a view: copy it into a NUL
+// terminated buffer first.
+static double copy_strtod(svcx_string_view sv) {
+    char buf[64];
+    size_t n = sv.len < sizeof(buf) - 1 ? sv.len : sizeof(buf) - 1;
+    memcpy(buf, sv.data, n);
+    buf[n] = '\0';
+    return strtod(buf, NULL);
+}
+
+static long long copy_strtoll(svcx_string_view sv) {
+    char buf[32];
+    size_t n = sv.len < sizeof(buf) - 1 ? sv.len : sizeof(buf) - 1;
+    memcpy(buf, sv.data, n);
+    buf[n] = '\0';
+    return strtoll(buf, NULL, 10);
+}
+
+static void bench_parse(void) {
+    enum { COUNT = 1 << 20 };
+    char *text = malloc(COUNT * 32);
+    svcx_string_view *ints = malloc(COUNT * sizeof(svcx_string_view));
+    svcx_string_view *floats = malloc(COUNT * sizeof(svcx_string_view));
+    uint64_t rng = 1;
+    for (size_t i = 0; i < COUNT; i++) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        char *p = text + i * 32;
+        int n = snprintf(p, 16, "%lld", (long long)(rng >> 20) - (1LL << 43));
+        ints[i] = svcx_sv_from_parts(p, (size_t)n);
+        n = snprintf(p + 16, 16, "%.9g", (double)(rng >> 11) * 0x1p-40);
+        floats[i] = svcx_sv_from_parts(p + 16, (size_t)n);
+    }
+
+    volatile double sink = 0.0;
+    double t0 = now_seconds();
+    for (size_t i = 0; i < COUNT; i++) {
+        sink += (double)copy_strtoll(ints[i]);
+    }
+    double t1 = now_seconds();
+    for (size_t i = 0; i < COUNT; i++) {
+        int64_t v;
+        svcx_sv_parse_i64(ints[i], &v, NULL);
+        sink += (double)v;
+    }
+    double t2 = now_seconds();
+    printf("integer parsing: copy+strtoll %.1f M/s, svcx %.1f M/s\n",
+        COUNT / (t1 - t0) / 1e6,
+        COUNT / (t2 - t1) / 1e6);
+
+    t0 = now_seconds();
+    for (size_t i = 0; i < COUNT; i++) {
+        sink += copy_strtod(floats[i]);
+    }
+    t1 = now_seconds();
+    for (size_t i = 0; i < COUNT; i++) {
+        double v;
+        svcx_sv_parse_f64(floats[i], &v, NULL);
+        sink += v;
+    }
+    t2 = now_seconds();
+    printf("float parsing: copy+strtod %.1f M/s, svcx %.1f M/s\n",
+        COUNT / (t1 - t0) / 1e6,
+        COUNT / (t2 - t1) / 1e6);
+
+    free(floats);
+    free(ints);
+    free(text);
+}
+
+static void bench_format(void) {
+    enum { RECORDS = 1 << 19 };
+    int64_t *ids = malloc(RECORDS * sizeof(int64_t));
+    double *prices = malloc(RECORDS * sizeof(double));
+    uint64_t rng = 7;
+    for (size_t i = 0; i < RECORDS; i++) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        ids[i] = (int64_t)(rng >> 24) - (1LL << 39);
+        prices[i] = (double)(rng >> 40) / 100.0;
+    }
+
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, svcx_default_allocator());
+    svcx_vector_reserve(&sb.buf, RECORDS * 48);
+
+    double t0 = now_seconds();
+    for (size_t i = 0; i < RECORDS; i++) {
+        svcx_sb_append_fmt(&sb, "%lld,%.17g,%llx\n",
+            (long long)ids[i],
+            prices[i],
+            (unsigned long long)ids[i]);
+    }
+    double t1 = now_seconds();
+    size_t fmt_size = sb.buf.size;
+    svcx_sb_clear(&sb);
+    for (size_t i = 0; i < RECORDS; i++) {
+        svcx_sb_append_i64(&sb, ids[i]);
+        svcx_sb_push_char(&sb, ',');
+        svcx_sb_append_f64(&sb, prices[i]);
+        svcx_sb_push_char(&sb, ',');
+        svcx_sb_append_hex(&sb, (uint64_t)ids[i]);
+        svcx_sb_push_char(&sb, '\n');
+    }
+    double t2 = now_seconds();
+
+    printf("numeric records: append_fmt %.1f MB/s, append_i64/f64/hex "
+           "%.1f MB/s (%.1fx)\n",
+        fmt_size / (t1 - t0) / 1e6,
+        sb.buf.size / (t2 - t1) / 1e6,
+        (t1 - t0) / (t2 - t1));
+
+    svcx_sb_free(&sb);
+    free(prices);
+    free(ids);
+}
+
+// Log text with an escape every 85 bytes or so, escaped one byte at a
+// time with push_char and with the bulk escaper.
+static void bench_escape(void) {
+    enum { TEXT = 1 << 24 };
+    char *text = malloc(TEXT);
+    uint64_t rng = 11;
+    for (size_t i = 0; i < TEXT; i++) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        unsigned r = (unsigned)(rng >> 56);
+        text[i] = r < 3 ? "\"\\\n"[r] : (char)(' ' + (r >> 1) % 90);
+    }
+    svcx_string_view sv = svcx_sv_from_parts(text, TEXT);
+
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, svcx_default_allocator());
+    svcx_vector_reserve(&sb.buf, TEXT + TEXT / 8);
+
+    double t0 = now_seconds();
+    for (size_t i = 0; i < TEXT; i++) {
+        char c = text[i];
+        if (c == '"' || c == '\\') {
+            svcx_sb_push_char(&sb, '\\');
+            svcx_sb_push_char(&sb, c);
+        } else if (c == '\n') {
+            svcx_sb_push_char(&sb, '\\');
+            svcx_sb_push_char(&sb, 'n');
+        } else {
+            svcx_sb_push_char(&sb, c);
+        }
+    }
+    double t1 = now_seconds();
+    size_t naive_size = sb.buf.size;
+    svcx_sb_clear(&sb);
+    svcx_sb_append_json_escaped(&sb, sv);
+    double t2 = now_seconds();
+    if (sb.buf.size != naive_size) {
+        printf("json escaping mismatch\n");
+    }
+
+    printf("json escaping: push_char %.2f GB/s, append_json_escaped "
+           "%.2f GB/s (%.1fx)\n",
+        TEXT / (t1 - t0) / 1e9,
+        TEXT / (t2 - t1) / 1e9,
+        (t1 - t0) / (t2 - t1));
+
+    svcx_sb_free(&sb);
+    free(text);
+}
+
+// Throughput of the hex and base64 kernels, in GB/s of binary data, next to
+// a per-byte hex loop over push_char.
+static void bench_encoding(void) {
+    enum { BYTES = 1 << 24, ROUNDS = 8 };
+    uint8_t *data = malloc(BYTES);
+    uint8_t *back = malloc(BYTES);
+    uint64_t rng = 5;
+    for (size_t i = 0; i < BYTES; i++) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = (uint8_t)(rng >> 56);
+    }
+
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, svcx_default_allocator());
+    svcx_vector_reserve(&sb.buf, 2 * BYTES);
+    double gb = (double)BYTES * ROUNDS / 1e9;
+    size_t n;
+
+    double t0 = now_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        svcx_sb_clear(&sb);
+        for (size_t i = 0; i < BYTES; i++) {
+            svcx_sb_push_char(&sb, "0123456789abcdef"[data[i] >> 4]);
+            svcx_sb_push_char(&sb, "0123456789abcdef"[data[i] & 15]);
+        }
+    }
+    double t1 = now_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        svcx_sb_clear(&sb);
+        svcx_sb_append_hex_encoded(&sb, data, BYTES);
+    }
+    double t2 = now_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        svcx_hex_decode(svcx_sb_view(&sb), back, BYTES, &n);
+    }
+    double t3 = now_seconds();
+    printf("hex: push_char loop %.2f GB/s, encode %.2f GB/s, decode %.2f "
+           "GB/s\n",
+        gb / (t1 - t0),
+        gb / (t2 - t1),
+        gb / (t3 - t2));
+
+    for (int url = 0; url < 2; url++) {
+        svcx_base64_alphabet alphabet = url ? SVCX_BASE64_URL : SVCX_BASE64_STD;
+        t0 = now_seconds();
+        for (int r = 0; r < ROUNDS; r++) {
+            svcx_sb_clear(&sb);
+            svcx_sb_append_base64(&sb, data, BYTES, alphabet);
+        }
+        t1 = now_seconds();
+        for (int r = 0; r < ROUNDS; r++) {
+            svcx_base64_decode(svcx_sb_view(&sb), alphabet, back, BYTES, &n);
+        }
+        t2 = now_seconds();
+        printf("base64 %s: encode %.2f GB/s, decode %.2f GB/s\n",
+            url ? "url" : "std",
+            gb / (t1 - t0),
+            gb / (t2 - t1));
+    }
+    if (memcmp(back, data, BYTES) != 0) {
+        printf("encoding round trip mismatch\n");
+    }
+
+    svcx_sb_free(&sb);
+    free(back);
+    free(data);
+}
+
+// Case-insensitive search and header name matching, against lowercasing a
+// copy into a string builder first.
+static void bench_icase(void) {
+    enum { BYTES = 1 << 24, ROUNDS = 8, NAMES = 1 << 20 };
+    char *text = malloc(BYTES);
+    uint64_t rng = 13;
+    for (size_t i = 0; i < BYTES; i++) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        text[i] = (char)(' ' + (rng >> 33) % 95);
+    }
+    svcx_string_view hay = svcx_sv_from_parts(text, BYTES);
+    svcx_string_view needle = SVCX_SV("content-type");
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, svcx_default_allocator());
+    size_t found = 0;
+
+    double t0 = now_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        svcx_sb_clear(&sb);
+        for (size_t i = 0; i < BYTES; i++) {
+            svcx_sb_push_char(&sb, (char)tolower((unsigned char)text[i]));
+        }
+        found += svcx_sv_find(svcx_sb_view(&sb), needle);
+    }
+    double t1 = now_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        found += svcx_sv_find_icase(hay, needle);
+    }
+    double t2 = now_seconds();
+    double gb = (double)BYTES * ROUNDS / 1e9;
+    printf("find_icase: tolower copy + find %.2f GB/s, find_icase %.2f GB/s\n",
+        gb / (t1 - t0),
+        gb / (t2 - t1));
+
+    static const char *const names[] = {"Content-Type",
+        "content-length",
+        "ACCEPT-ENCODING",
+        "X-Request-Id",
+        "Cache-Control"};
+    t0 = now_seconds();
+    for (size_t i = 0; i < NAMES; i++) {
+        svcx_string_view name =
+            svcx_sv_from_cstr(names[i % SVCX_ARRAY_LEN(names)]);
+        svcx_sb_clear(&sb);
+        for (size_t k = 0; k < name.len; k++) {
+            svcx_sb_push_char(&sb, (char)tolower((unsigned char)name.data[k]));
+        }
+        svcx_string_view low = svcx_sb_view(&sb);
+        found += low.len == 14 && memcmp(low.data, "content-length", 14) == 0;
+    }
+    t1 = now_seconds();
+    for (size_t i = 0; i < NAMES; i++) {
+        svcx_string_view name =
+            svcx_sv_from_cstr(names[i % SVCX_ARRAY_LEN(names)]);
+        found += svcx_sv_eq_icase(name, SVCX_SV("content-length"));
+    }
+    t2 = now_seconds();
+    printf("header names: tolower copy %.1f ns, eq_icase %.1f ns\n",
+        (t1 - t0) / NAMES * 1e9,
+        (t2 - t1) / NAMES * 1e9);
+    if (found == 0) {
+        printf("icase matching failed\n");
+    }
+
+    svcx_sb_free(&sb);
+    free(text);
+}
+
+// A byte at a time UTF-8 validator, returning whether the text is valid.
+static bool ref_utf8_check(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        unsigned char c = p[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+        size_t n = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+        if (c < 0xC2 || c > 0xF4 || len - i < n) {
+            return false;
+        }
+        uint32_t cp = c & (0x7F >> n);
+        for (size_t k = 1; k < n; k++) {
+            if ((p[i + k] & 0xC0) != 0x80) {
+                return false;
+            }
+            cp = cp << 6 | (p[i + k] & 0x3F);
+        }
+        if ((n == 3 && cp < 0x800) || (n == 4 && cp < 0x10000) ||
+            cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            return false;
+        }
+        i += n;
+    }
+    return true;
+}
+
+// Throughput of UTF-8 validation, counting and transcoding on ASCII, on mixed
+// text and on text without 4-byte sequences, next to the scalar validator in
+// the bench below.
+static void bench_utf8(void) {
+    enum { BYTES = 1 << 24, ROUNDS = 8 };
+    char *texts[3];
+    size_t lens[3];
+    for (int m = 0; m < 3; m++) {
+        texts[m] = malloc(BYTES);
+    }
+    uint64_t rng = 11;
+    for (size_t i = 0; i < BYTES; i++) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        texts[0][i] = (char)(' ' + (rng >> 33) % 95);
+    }
+    lens[0] = BYTES;
+    // Latin, Cyrillic, CJK and emoji words separated by spaces, and the same
+    // without the emoji.
+    static const char *const words[] = {"caf\xc3\xa9",
+        "\xd0\xbc\xd0\xb8\xd1\x80",
+        "\xe6\x97\xa5\xe6\x9c\xac",
+        "plain",
+        "\xf0\x9f\x98\x80"};
+    for (int m = 1; m < 3; m++) {
+        size_t nwords = SVCX_ARRAY_LEN(words) - (m == 2);
+        size_t len = 0;
+        while (len + 16 < BYTES) {
+            rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+            const char *w = words[(rng >> 33) % nwords];
+            size_t n = strlen(w);
+            memcpy(texts[m] + len, w, n);
+            texts[m][len + n] = ' ';
+            len += n + 1;
+        }
+        lens[m] = len;
+    }
+    svcx_vector units;
+    svcx_vector_init(&units, sizeof(uint16_t), svcx_default_allocator());
+    svcx_vector_reserve(&units, BYTES + 8);
+    svcx_vector points;
+    svcx_vector_init(&points, sizeof(uint32_t), svcx_default_allocator());
+    svcx_vector_reserve(&points, BYTES + 8);
+    size_t count = 0;
+
+    static const char *const names[] = {"ascii", "mixed", "no 4-byte"};
+    for (int m = 0; m < 3; m++) {
+        svcx_string_view sv = svcx_sv_from_parts(texts[m], lens[m]);
+        double gb = (double)sv.len * ROUNDS / 1e9;
+        double t0 = now_seconds();
+        for (int r = 0; r < ROUNDS; r++) {
+            count += ref_utf8_check((const unsigned char *)sv.data, sv.len);
+        }
+        double t1 = now_seconds();
+        for (int r = 0; r < ROUNDS; r++) {
+            count += svcx_utf8_validate(sv, NULL);
+        }
+        double t2 = now_seconds();
+        for (int r = 0; r < ROUNDS; r++) {
+            count += svcx_utf8_count(sv);
+        }
+        double t3 = now_seconds();
+        for (int r = 0; r < ROUNDS; r++) {
+            svcx_vector_clear(&units);
+            svcx_utf8_to_utf16(sv, &units);
+        }
+        double t4 = now_seconds();
+        for (int r = 0; r < ROUNDS; r++) {
+            svcx_vector_clear(&points);
+            svcx_utf8_to_utf32(sv, &points);
+        }
+        double t5 = now_seconds();
+        printf("utf8 %s: scalar validate %.2f GB/s, validate %.2f GB/s, "
+               "count %.2f GB/s, to utf16 %.2f GB/s, to utf32 %.2f GB/s\n",
+            names[m],
+            gb / (t1 - t0),
+            gb / (t2 - t1),
+            gb / (t3 - t2),
+            gb / (t4 - t3),
+            gb / (t5 - t4));
+    }
+    if (count == 0) {
+        printf("utf8 validation failed\n");
+    }
+
+    svcx_vector_free(&points);
+    svcx_vector_free(&units);
+    for (int m = 0; m < 3; m++) {
+        free(texts[m]);
+    }
+}
+
+static size_t count_lines(svcx_string_view sv) {
+    size_t lines = 0;
+    const char *end = sv.data + sv.len;
+    for (const char *p = sv.data; (p = memchr(p, '\n', (size_t)(end - p)));
+        p++) {
+        lines++;
+    }
+    return lines;
+}
+
+// Loading a file and scanning it once, through fread into a growing string
+// builder and through svcx_file_map. The file is in the page cache for both.
+static void bench_file(void) {
+    enum { BYTES = 1 << 26, ROUNDS = 4 };
+    FILE *tmp = tmpfile();
+    char *chunk = malloc(1 << 16);
+    for (size_t i = 0; i < (1 << 16); i++) {
+        chunk[i] = i % 80 == 79 ? '\n' : (char)('a' + i % 26);
+    }
+    size_t expected = 0;
+    for (size_t done = 0; done < BYTES; done += 1 << 16) {
+        fwrite(chunk, 1, 1 << 16, tmp);
+        expected += count_lines(svcx_sv_from_parts(chunk, 1 << 16));
+    }
+    fflush(tmp);
+    size_t lines = 0;
+
+    double t0 = now_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        svcx_string_builder sb;
+        svcx_sb_init(&sb, svcx_default_allocator());
+        rewind(tmp);
+        size_t n;
+        while ((n = fread(chunk, 1, 1 << 16, tmp)) > 0) {
+            svcx_sb_append(&sb, chunk, n);
+        }
+        lines += count_lines(svcx_sb_view(&sb));
+        svcx_sb_free(&sb);
+    }
+    double t1 = now_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        svcx_mapped_file f;
+        svcx_file_map_fd(&f, fileno(tmp), svcx_default_allocator());
+        lines += count_lines(f.view);
+        svcx_file_unmap(&f);
+    }
+    double t2 = now_seconds();
+    double gb = (double)BYTES * ROUNDS / 1e9;
+    printf("file load and scan: fread into string builder %.2f GB/s, "
+           "file_map %.2f GB/s\n",
+        gb / (t1 - t0),
+        gb / (t2 - t1));
+    if (lines != 2 * ROUNDS * expected) {
+        printf("file line count mismatch\n");
+    }
+
+    free(chunk);
+    fclose(tmp);
+}
+
+// Streaming the lines of a file through fgets and through the line reader.
+static void bench_line_reader(void) {
+    enum { BYTES = 1 << 26, ROUNDS = 4 };
+    FILE *tmp = tmpfile();
+    char *chunk = malloc(1 << 16);
+    uint64_t rng = 21;
+    for (size_t i = 0; i < (1 << 16); i++) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        chunk[i] = (rng >> 33) % 100 == 0 ? '\n' : (char)('a' + i % 26);
+    }
+    chunk[(1 << 16) - 1] = '\n';
+    for (size_t done = 0; done < BYTES; done += 1 << 16) {
+        fwrite(chunk, 1, 1 << 16, tmp);
+    }
+    fflush(tmp);
+    size_t lines = 0;
+    size_t bytes = 0;
+
+    double t0 = now_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        rewind(tmp);
+        while (fgets(chunk, 1 << 16, tmp)) {
+            lines++;
+            bytes += strlen(chunk);
+        }
+    }
+    double t1 = now_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        rewind(tmp);
+        svcx_line_reader lr;
+        svcx_lr_init(&lr, fileno(tmp), 0, svcx_default_allocator());
+        svcx_string_view line;
+        while (svcx_lr_next(&lr, &line)) {
+            lines++;
+            bytes += line.len + 1;
+        }
+        svcx_lr_free(&lr);
+    }
+    double t2 = now_seconds();
+    double gb = (double)BYTES * ROUNDS / 1e9;
+    printf("lines: fgets %.2f GB/s, line reader %.2f GB/s\n",
+        gb / (t1 - t0),
+        gb / (t2 - t1));
+    if (bytes != 2 * ROUNDS * (size_t)BYTES || lines == 0) {
+        printf("line reader byte count mismatch\n");
+    }
+
+    free(chunk);
+    fclose(tmp);
+}
+
+static void bench_template(void) {
+    enum { LINES = 1 << 19 };
+    static const char *const paths[] = {"/", "/api/v1/items", "/login"};
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, svcx_default_allocator());
+    svcx_vector_reserve(&sb.buf, LINES * 64);
+
+    double t0 = now_seconds();
+    for (size_t i = 0; i < LINES; i++) {
+        svcx_sb_append_fmt(&sb,
+            "%s %s %d %zu %s\n",
+            "GET",
+            paths[i % 3],
+            200 + (int)(i % 5),
+            i * 37 % 100000,
+            "curl/8.0");
+    }
+    double t1 = now_seconds();
+    size_t fmt_size = sb.buf.size;
+    svcx_sb_clear(&sb);
+
+    svcx_template t;
+    svcx_tmpl_compile(&t,
+        SVCX_SV("{method} {path} {status:i} {bytes:u} {agent}\n"),
+        svcx_default_allocator());
+    svcx_tmpl_arg args[5];
+    args[0] = SVCX_TMPL_STR(SVCX_SV("GET"));
+    args[4] = SVCX_TMPL_STR(SVCX_SV("curl/8.0"));
+    svcx_string_view path_svs[3];
+    for (size_t i = 0; i < 3; i++) {
+        path_svs[i] = svcx_sv_from_cstr(paths[i]);
+    }
+    double t2 = now_seconds();
+    for (size_t i = 0; i < LINES; i++) {
+        args[1] = SVCX_TMPL_STR(path_svs[i % 3]);
+        args[2] = SVCX_TMPL_I64(200 + (int)(i % 5));
+        args[3] = SVCX_TMPL_U64(i * 37 % 100000);
+        svcx_tmpl_render(&t, &sb, args);
+    }
+    double t3 = now_seconds();
+
+    printf("access log lines: append_fmt %.1f MB/s, template %.1f MB/s\n",
+        fmt_size / (t1 - t0) / 1e6,
+        sb.buf.size / (t3 - t2) / 1e6);
+
+    svcx_tmpl_free(&t);
+    svcx_sb_free(&sb);
+}
+
+enum { CACHE_KEYS = 1 << 16, CACHE_OPS = 1 << 21 };
+
+typedef struct cache_bench {
+    svcx_cmap *cm;
+    svcx_map *m;
+    pthread_mutex_t *lock;
+    svcx_string_view *keys;
+    unsigned seed;
+} cache_bench;
+
+static void cache_touch(
+    svcx_string_view key, void *value, bool inserted, void *ctx) {
+    SVCX_UNUSED(key);
+    SVCX_UNUSED(inserted);
+    SVCX_UNUSED(ctx);
+    *(uint64_t *)value += 1;
+}
+
+// Mostly lookups with one upsert in sixteen, like a shared cache.
+static void *cache_worker(void *arg) {
+    cache_bench *b = arg;
+    unsigned seed = b->seed;
+    volatile uint64_t sink = 0;
+    for (int i = 0; i < CACHE_OPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        svcx_string_view key = b->keys[(seed >> 8) % CACHE_KEYS];
+        bool write = (seed >> 28) == 0;
+        if (b->cm && write) {
+            svcx_cmap_upsert(b->cm, key, cache_touch, NULL);
+        } else if (b->cm) {
+            uint64_t value;
+            svcx_cmap_get(b->cm, key, &value);
+            sink += value;
+        } else {
+            pthread_mutex_lock(b->lock);
+            void *value;
+            if (write) {
+                svcx_map_get_or_insert(b->m, &key, &value, NULL);
+                cache_touch(key, value, false, NULL);
+            } else {
+                sink += *(uint64_t *)svcx_map_get(b->m, &key);
+            }
+            pthread_mutex_unlock(b->lock);
+        }
+    }
+    return NULL;
+}
+
+static double run_cache_bench(cache_bench *b, int nthreads) {
+    pthread_t threads[64];
+    cache_bench args[64];
+    double t0 = now_seconds();
+    for (int i = 0; i < nthreads; i++) {
+        args[i] = *b;
+        args[i].seed = (unsigned)i * 7919 + 1;
+        pthread_create(&threads[i], NULL, cache_worker, &args[i]);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return (double)CACHE_OPS * nthreads / (now_seconds() - t0) / 1e6;
+}
+
+static void bench_cmap(void) {
+    char *names = malloc(CACHE_KEYS * 24);
+    svcx_string_view *keys = malloc(CACHE_KEYS * sizeof(svcx_string_view));
+    svcx_cmap cm;
+    svcx_map m;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    svcx_cmap_init(&cm, 0, sizeof(uint64_t), svcx_default_allocator());
+    svcx_map_init_sv(&m, sizeof(uint64_t), svcx_default_allocator());
+    for (int i = 0; i < CACHE_KEYS; i++) {
+        int n = snprintf(names + i * 24, 24, "user:%d:session", i);
+        keys[i] = svcx_sv_from_parts(names + i * 24, (size_t)n);
+        uint64_t zero = 0;
+        svcx_cmap_insert(&cm, keys[i], &zero);
+        svcx_map_insert(&m, &keys[i], &zero);
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cpus < 1 ? 1 : cpus > 64 ? 64 : (int)cpus;
+    printf("shared cache, 15/16 lookups (Mops/s, %d keys)\n", CACHE_KEYS);
+    for (int n = 1;; n = n * 2 < max_threads ? n * 2 : max_threads) {
+        cache_bench locked = {NULL, &m, &lock, keys, 0};
+        cache_bench sharded = {&cm, NULL, NULL, keys, 0};
+        double a = run_cache_bench(&locked, n);
+        double b = run_cache_bench(&sharded, n);
+        printf("  %2d threads: global lock %7.1f, svcx_cmap %7.1f\n", n, a, b);
+        if (n == max_threads) {
+            break;
+        }
+    }
+
+    svcx_map_free(&m);
+    svcx_cmap_free(&cm);
+    free(keys);
+    free(names);
+}
+
+int main() {
+    bench_sv_find();
+    bench_hash();
+    bench_parse();
+    bench_format();
+    bench_template();
+    bench_escape();
+    bench_encoding();
+    bench_utf8();
+    bench_icase();
+    bench_file();
+    bench_line_reader();
+    bench_cmap();
+    return 0;
+}
@@ -1,10 +1,56 @@
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 
 #define SVCX_DEBUG
 #define SVCX_IMPLEMENTATION
 #include "svcxtend.h"
 
+// An allocator over malloc whose allocations fail once it has handed out
+// left of them, for testing the error paths.
+typedef struct test_budget {
+    size_t left;
+} test_budget;
+
+static void *test_budget_alloc(void *ctx, size_t size) {
+    test_budget *b = (test_budget *)ctx;
+    if (b->left == 0) {
+        return NULL;
+    }
+    b->left--;
+    return malloc(size);
+}
+
+static void *test_budget_realloc(void *ctx, void *ptr, size_t size) {
+    test_budget *b = (test_budget *)ctx;
+    if (b->left == 0) {
+        return NULL;
+    }
+    b->left--;
+    return realloc(ptr, size);
+}
+
+static void test_budget_free(void *ctx, void *ptr) {
+    SVCX_UNUSED(ctx);
+    free(ptr);
+}
+
+static svcx_allocator test_budget_allocator(test_budget *b) {
+    return (svcx_allocator){
+        .alloc = test_budget_alloc,
+        .realloc = test_budget_realloc,
+        .free = test_budget_free,
+        .ctx = b,
+    };
+}
+
+// A linear congruential generator for test data. It returns the whole new
+// state, whose high bits are the random ones.
+static uint64_t test_rand(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state;
+}
+
 void test_vector() {
     svcx_arena arena;
     svcx_arena_init(&arena, 1024 * 1024);
@@ -42,6 +88,306 @@ void test_vector() {
     svcx_arena_free_all(&arena);
 }
 
+typedef struct span_entry {
+    int id;
+    float score;
+} span_entry;
+
+void test_span() {
+    int raw[] = {0, 1, 2, 3, 4, 5, 6};
+    svcx_span all = SVCX_SPAN_OF_ARRAY(raw);
+    assert(all.count == 7 && SVCX_SPAN_AT(all, int, 6) == 6);
+    assert(svcx_span_at(all, 7) == NULL);
+
+    svcx_span odd = svcx_span_strided(svcx_span_slice(all, 1, 7), 2);
+    assert(odd.count == 3);
+    assert(SVCX_SPAN_AT(odd, int, 0) == 1 && SVCX_SPAN_AT(odd, int, 2) == 5);
+
+    svcx_span tail = svcx_span_subspan(all, 5, 100);
+    assert(tail.count == 2 && SVCX_SPAN_AT(tail, int, 0) == 5);
+
+    int sum = 0;
+    foreach_s(const int *it, odd) {
+        sum += *it;
+    }
+    assert(sum == 9);
+
+    span_entry entries[] = {{1, 0.5f}, {2, 0.25f}, {3, 1.0f}};
+    svcx_span scores = SVCX_SPAN_FIELD(entries, 3, span_entry, score);
+    assert(SVCX_SPAN_AT(scores, float, 1) == 0.25f);
+
+    // The adopted buffer is used in place and freed by the vector.
+    int *buf = malloc(4 * sizeof(int));
+    buf[0] = 42;
+    svcx_vector v;
+    svcx_vector_adopt(&v, buf, 1, 4, sizeof(int), svcx_default_allocator());
+    assert(v.data == buf && svcx_vector_size(&v) == 1);
+
+    svcx_vector_append_span(&v, odd);
+    assert(v.data == buf && svcx_vector_size(&v) == 4);
+    assert(*(int *)svcx_vector_at(&v, 3) == 5);
+
+    svcx_vector_append_span(&v, svcx_span_from_vector(&v));
+    assert(svcx_vector_size(&v) == 8);
+    assert(*(int *)svcx_vector_at(&v, 4) == 42);
+    svcx_vector_free(&v);
+}
+
+void test_kernels() {
+    enum { N = 1003 };
+    svcx_vector iv;
+    svcx_vector_init(&iv, sizeof(int32_t), svcx_default_allocator());
+    int64_t big[N];
+    float fl[N];
+    double db[N];
+
+    int64_t ref_sum = 0, ref_big = 0, ref_dot = 0;
+    double ref_fsum = 0.0, ref_fdot = 0.0;
+    for (int i = 0; i < N; i++) {
+        int32_t x = (int32_t)((i * 7919) % 2001) - 1000;
+        SVCX_VECTOR_PUSH(&iv, int32_t, x);
+        big[i] = (int64_t)x * 3000000000LL;
+        fl[i] = (float)x * 0.5f;
+        db[i] = (double)x * 0.25;
+        ref_sum += x;
+        ref_big += big[i];
+        ref_dot += (int64_t)x * x;
+        ref_fsum += fl[i];
+        ref_fdot += db[i] * db[i];
+    }
+    ((int32_t *)iv.data)[N / 2] = -5000;
+    ((int32_t *)iv.data)[N - 1] = 5000;
+    ref_sum += -5000 - (((N / 2) * 7919) % 2001 - 1000);
+    ref_sum += 5000 - (((N - 1) * 7919) % 2001 - 1000);
+
+    svcx_span s = svcx_span_from_vector(&iv);
+    assert(svcx_sum_i32(s) == ref_sum);
+    assert(svcx_sum_i64(SVCX_SPAN_OF_ARRAY(big)) == ref_big);
+    assert(svcx_sum_f32(SVCX_SPAN_OF_ARRAY(fl)) == ref_fsum);
+
+    int32_t lo, hi;
+    size_t at;
+    assert(svcx_minmax_i32(s, &lo, &hi) == SVCX_OK);
+    assert(lo == -5000 && hi == 5000);
+    assert(svcx_argmin_i32(s, &at) == SVCX_OK && at == N / 2);
+    assert(svcx_argmax_i32(s, &at) == SVCX_OK && at == N - 1);
+    assert(svcx_minmax_i32(svcx_span_subspan(s, 0, 0), &lo, &hi) ==
+           SVCX_KERNEL_EMPTY_ERR);
+
+    int64_t blo, bhi;
+    svcx_minmax_i64(SVCX_SPAN_OF_ARRAY(big), &blo, &bhi);
+    assert(blo == -1000 * 3000000000LL && bhi == 1000 * 3000000000LL);
+    double dlo, dhi;
+    svcx_minmax_f64(SVCX_SPAN_OF_ARRAY(db), &dlo, &dhi);
+    assert(dlo == -250.0 && dhi == 250.0);
+    assert(svcx_argmax_f32(SVCX_SPAN_OF_ARRAY(fl), &at) == SVCX_OK);
+    assert(fl[at] == 500.0f);
+
+    // Strided spans take the scalar path and must agree with it.
+    svcx_span every3 = svcx_span_strided(s, 3);
+    int64_t strided_sum = 0;
+    foreach_s(const int32_t *it, every3) {
+        strided_sum += *it;
+    }
+    assert(svcx_sum_i32(every3) == strided_sum);
+
+    int64_t dot;
+    assert(svcx_dot_i32(s, svcx_span_subspan(s, 1, N), &dot) ==
+           SVCX_KERNEL_LENGTH_ERR);
+    ref_dot += 5000LL * 5000 * 2;
+    ref_dot -= (int64_t)(((N / 2) * 7919) % 2001 - 1000) *
+               (((N / 2) * 7919) % 2001 - 1000);
+    ref_dot -= (int64_t)(((N - 1) * 7919) % 2001 - 1000) *
+               (((N - 1) * 7919) % 2001 - 1000);
+    assert(svcx_dot_i32(s, s, &dot) == SVCX_OK && dot == ref_dot);
+    double fdot;
+    svcx_dot_f64(SVCX_SPAN_OF_ARRAY(db), SVCX_SPAN_OF_ARRAY(db), &fdot);
+    assert(fdot == ref_fdot);
+
+    int32_t clamped[N];
+    svcx_clamp_i32(s, -10, 10, clamped);
+    for (int i = 0; i < N; i++) {
+        int32_t x = *(int32_t *)svcx_vector_at(&iv, i);
+        assert(clamped[i] == (x < -10 ? -10 : (x > 10 ? 10 : x)));
+    }
+    svcx_clamp_f64(SVCX_SPAN_OF_ARRAY(db), -1.0, 1.0, db);
+    svcx_minmax_f64(SVCX_SPAN_OF_ARRAY(db), &dlo, &dhi);
+    assert(dlo == -1.0 && dhi == 1.0);
+
+    int64_t prefix[N];
+    svcx_prefix_sum_i64(SVCX_SPAN_OF_ARRAY(big), prefix);
+    assert(prefix[0] == big[0] && prefix[N - 1] == ref_big);
+
+    uint64_t counts[4] = {0};
+    svcx_histogram_i32(s, -1000, 1000, counts, 4);
+    assert(counts[0] + counts[1] + counts[2] + counts[3] == N);
+    int32_t edges[] = {-1001, -1000, -501, -500, 499, 500, 999, 1000};
+    uint64_t edge_counts[4] = {0};
+    svcx_histogram_i32(SVCX_SPAN_OF_ARRAY(edges), -1000, 1000, edge_counts, 4);
+    assert(edge_counts[0] == 3 && edge_counts[1] == 1);
+    assert(edge_counts[2] == 1 && edge_counts[3] == 3);
+
+    svcx_vector_free(&iv);
+}
+
+void test_deque() {
+    svcx_deque q;
+    svcx_deque_init(&q, sizeof(int), svcx_default_allocator());
+
+    for (int i = 0; i < 6; i++) {
+        SVCX_DEQUE_PUSH_BACK(&q, int, i);
+    }
+    SVCX_DEQUE_PUSH_FRONT(&q, int, -1);
+
+    int ret = 0;
+    svcx_deque_pop_front(&q, &ret);
+    assert(ret == -1);
+    svcx_deque_pop_front(&q, &ret);
+    assert(ret == 0);
+
+    // Wrap around the end of the ring and force a grow while wrapped.
+    for (int i = 6; i < 20; i++) {
+        SVCX_DEQUE_PUSH_BACK(&q, int, i);
+    }
+    assert(svcx_deque_size(&q) == 19);
+    for (size_t i = 0; i < svcx_deque_size(&q); i++) {
+        assert(*(int *)svcx_deque_at(&q, i) == (int)i + 1);
+    }
+    assert(svcx_deque_at(&q, 19) == NULL);
+
+    svcx_deque_pop_back(&q, &ret);
+    assert(ret == 19);
+    assert(*(int *)svcx_deque_back(&q) == 18);
+
+    int drained[32];
+    assert(svcx_deque_pop_front_n(&q, drained, 32) == 18);
+    assert(drained[0] == 1 && drained[17] == 18);
+    assert(svcx_deque_pop_front(&q, &ret) == SVCX_DEQ_POP_EMPTY_ERR);
+    svcx_deque_free(&q);
+
+    svcx_deque ring;
+    svcx_allocator deft = svcx_default_allocator();
+    assert(svcx_deque_init_fixed(&ring, sizeof(int), 3, deft) == SVCX_OK);
+    assert(ring.cap == 4);
+    for (int i = 0; i < 10; i++) {
+        SVCX_DEQUE_PUSH_BACK(&ring, int, i);
+    }
+    assert(svcx_deque_size(&ring) == 4);
+    assert(*(int *)svcx_deque_front(&ring) == 6);
+    assert(*(int *)svcx_deque_back(&ring) == 9);
+
+    void *first;
+    void *second;
+    size_t first_count;
+    size_t second_count;
+    svcx_deque_spans(&ring, &first, &first_count, &second, &second_count);
+    assert(first_count + second_count == 4);
+    assert(*(int *)first == 6);
+
+    int batch[] = {10, 11, 12, 13, 14, 15};
+    svcx_deque_push_back_n(&ring, batch, SVCX_ARRAY_LEN(batch));
+    assert(*(int *)svcx_deque_front(&ring) == 12);
+    assert(*(int *)svcx_deque_back(&ring) == 15);
+    assert(svcx_deque_reserve(&ring, 8) == SVCX_DEQ_FIXED_CAP_ERR);
+
+    SVCX_DEQUE_PUSH_FRONT(&ring, int, 99);
+    assert(*(int *)svcx_deque_front(&ring) == 99);
+    assert(*(int *)svcx_deque_back(&ring) == 14);
+    svcx_deque_free(&ring);
+}
+
+void test_bitset() {
+    svcx_allocator deft = svcx_default_allocator();
+
+    // Sizes chosen to exercise the SIMD bodies, the scalar tails, a partial
+    // last word and more than one rank superblock.
+    enum { NBITS = 9001 };
+    static bool flags[NBITS];
+    static bool other[NBITS];
+    unsigned seed = 12345;
+    for (size_t i = 0; i < NBITS; i++) {
+        seed = seed * 1103515245 + 12345;
+        flags[i] = (seed >> 16) % 7 == 0;
+        other[i] = (seed >> 20) % 3 == 0;
+    }
+
+    svcx_bitset b;
+    svcx_bitset o;
+    assert(svcx_bitset_from_bools(&b, flags, NBITS, deft) == SVCX_OK);
+    assert(svcx_bitset_from_bools(&o, other, NBITS, deft) == SVCX_OK);
+
+    size_t expected = 0;
+    for (size_t i = 0; i < NBITS; i++) {
+        assert(svcx_bitset_test(&b, i) == flags[i]);
+        expected += flags[i];
+    }
+    assert(svcx_bitset_count(&b) == expected);
+
+    // Rank and select agree with a naive count, with and without the index.
+    for (int pass = 0; pass < 2; pass++) {
+        size_t ones = 0;
+        for (size_t i = 0; i < NBITS; i++) {
+            if (i % 97 == 0) {
+                assert(svcx_bitset_rank(&b, i) == ones);
+            }
+            if (flags[i]) {
+                size_t pos;
+                assert(svcx_bitset_select(&b, ones, &pos) && pos == i);
+                ones++;
+            }
+        }
+        assert(svcx_bitset_rank(&b, NBITS) == ones);
+        size_t pos;
+        assert(!svcx_bitset_select(&b, ones, &pos));
+        assert(svcx_bitset_build_rank(&b) == SVCX_OK);
+    }
+
+    svcx_bitset_iter it;
+    svcx_bitset_iter_init(&it, &b);
+    size_t pos;
+    size_t prev = 0;
+    size_t seen = 0;
+    while (svcx_bitset_iter_next(&it, &pos)) {
+        assert(flags[pos] && (seen == 0 || pos > prev));
+        prev = pos;
+        seen++;
+    }
+    assert(seen == expected);
+
+    svcx_bitset_xor(&b, &o);
+    for (size_t i = 0; i < NBITS; i++) {
+        assert(svcx_bitset_test(&b, i) == (flags[i] != other[i]));
+    }
+    svcx_bitset_xor(&b, &o);
+    svcx_bitset_andnot(&b, &o);
+    for (size_t i = 0; i < NBITS; i++) {
+        assert(svcx_bitset_test(&b, i) == (flags[i] && !other[i]));
+    }
+    svcx_bitset_or(&b, &o);
+    svcx_bitset_and(&b, &o);
+    for (size_t i = 0; i < NBITS; i++) {
+        assert(svcx_bitset_test(&b, i) == other[i]);
+    }
+
+    svcx_bitset_set_all(&b);
+    assert(svcx_bitset_count(&b) == NBITS);
+    svcx_bitset_reset(&b, 5);
+    svcx_bitset_flip(&b, 6);
+    assert(!svcx_bitset_test(&b, 5) && !svcx_bitset_test(&b, 6));
+    assert(svcx_bitset_count(&b) == NBITS - 2);
+    svcx_bitset_reset_all(&b);
+    svcx_bitset_set(&b, NBITS - 1);
+    assert(svcx_bitset_count(&b) == 1);
+
+    svcx_bitset small;
+    svcx_bitset_init(&small, 10, deft);
+    assert(svcx_bitset_and(&b, &small) == SVCX_BITSET_SIZE_MISMATCH_ERR);
+
+    svcx_bitset_free(&small);
+    svcx_bitset_free(&o);
+    svcx_bitset_free(&b);
+}
+
 void test_string_utils() {
     svcx_arena arena;
     svcx_arena_init(&arena, 1024 * 1024);
@@ -90,8 +436,2353 @@ void test_string_utils() {
     svcx_arena_free_all(&arena);
 }
 
+static size_t naive_find(svcx_string_view h, svcx_string_view n, bool last) {
+    size_t found = -1;
+    for (size_t i = 0; n.len <= h.len && i <= h.len - n.len; i++) {
+        if (memcmp(h.data + i, n.data, n.len) == 0) {
+            found = i;
+            if (!last) {
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+void test_sv_search() {
+    svcx_string_view log = SVCX_SV("GET /index.html 200\nGET /a.png 404\n");
+    assert(svcx_sv_find(log, SVCX_SV("GET")) == 0);
+    assert(svcx_sv_find_from(log, SVCX_SV("GET"), 1) == 20);
+    assert(svcx_sv_find_from(log, SVCX_SV("GET"), 21) == (size_t)-1);
+    assert(svcx_sv_find_from(log, SVCX_SV(""), log.len) == log.len);
+    assert(svcx_sv_find_from(log, SVCX_SV("G"), log.len + 1) == (size_t)-1);
+    assert(svcx_sv_rfind(log, SVCX_SV("GET")) == 20);
+    assert(svcx_sv_rfind(log, SVCX_SV("\n")) == log.len - 1);
+    assert(svcx_sv_rfind(log, SVCX_SV("")) == log.len);
+    assert(!svcx_sv_contains(log, SVCX_SV("POST")));
+
+    // Random haystacks over a small alphabet produce many partial matches,
+    // with needles on both sides of the Two-Way threshold.
+    char hay[3000];
+    char needle[80];
+    unsigned seed = 12345;
+    for (int round = 0; round < 200; round++) {
+        int alphabet = 2 + round % 3;
+        size_t hlen = 100 + (size_t)(round * 13) % 2900;
+        for (size_t i = 0; i < hlen; i++) {
+            seed = seed * 1103515245 + 12345;
+            hay[i] = (char)('a' + (seed >> 16) % alphabet);
+        }
+        size_t m = 1 + (size_t)round % 70;
+        size_t from = (seed >> 8) % (hlen - m);
+        memcpy(needle, hay + from, m);
+        if (round % 4 == 0) {
+            needle[m - 1] = 'z';
+        }
+
+        svcx_string_view h = svcx_sv_from_parts(hay, hlen);
+        svcx_string_view n = svcx_sv_from_parts(needle, m);
+        assert(svcx_sv_find(h, n) == naive_find(h, n, false));
+        assert(svcx_sv_rfind(h, n) == naive_find(h, n, true));
+
+        size_t count = 0;
+        for (size_t i = svcx_sv_find(h, n); i != (size_t)-1;
+             i = svcx_sv_find_from(h, n, i + 1)) {
+            count++;
+        }
+        size_t ref = 0;
+        for (size_t i = 0; i + m <= hlen; i++) {
+            ref += memcmp(hay + i, needle, m) == 0;
+        }
+        assert(count == ref);
+    }
+
+    // Periodic needle in a periodic haystack.
+    memset(hay, 'a', sizeof(hay));
+    memset(needle, 'a', 64);
+    needle[63] = 'b';
+    svcx_string_view h = svcx_sv_from_parts(hay, sizeof(hay));
+    assert(svcx_sv_find(h, svcx_sv_from_parts(needle, 64)) == (size_t)-1);
+    hay[sizeof(hay) - 1] = 'b';
+    assert(svcx_sv_find(h, svcx_sv_from_parts(needle, 64)) ==
+           sizeof(hay) - 64);
+}
+
+static size_t ref_find_icase(
+    const char *h, size_t hlen, const char *n, size_t m) {
+    for (size_t i = 0; i + m <= hlen; i++) {
+        size_t k = 0;
+        while (k < m && tolower((unsigned char)h[i + k]) ==
+                            tolower((unsigned char)n[k])) {
+            k++;
+        }
+        if (k == m) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void test_icase() {
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, svcx_default_allocator());
+
+    svcx_string_view name = SVCX_SV("Content-Length");
+    assert(svcx_sv_eq_icase(name, SVCX_SV("content-length")));
+    assert(svcx_sv_eq_icase(name, SVCX_SV("CONTENT-LENGTH")));
+    assert(!svcx_sv_eq_icase(name, SVCX_SV("Content-Lengths")));
+    assert(!svcx_sv_eq_icase(name, SVCX_SV("Content_Length")));
+    assert(svcx_sv_starts_with_icase(name, SVCX_SV("CONTENT")));
+    assert(!svcx_sv_starts_with_icase(SVCX_SV("Con"), SVCX_SV("CONTENT")));
+    assert(svcx_sv_ends_with_icase(name, SVCX_SV("-length")));
+    assert(!svcx_sv_ends_with_icase(name, SVCX_SV("-lengtx")));
+    assert(svcx_sv_eq_icase(SVCX_SV(""), SVCX_SV("")));
+    assert(svcx_sv_find_icase(SVCX_SV("Accept: TEXT/html"), SVCX_SV("text")) ==
+           8);
+    assert(svcx_sv_find_icase(SVCX_SV("abc"), SVCX_SV("")) == 0);
+    assert(svcx_sv_find_icase(SVCX_SV("abc"), SVCX_SV("abcd")) == (size_t)-1);
+
+    // Only letters fold: '@' and '`', '[' and '{', and bytes above 0x7F
+    // differ by 0x20 too.
+    assert(!svcx_sv_eq_icase(SVCX_SV("@[^"), SVCX_SV("`{~")));
+    assert(!svcx_sv_eq_icase(SVCX_SV("\xc1"), SVCX_SV("\xe1")));
+
+    // Every byte value, at every position of a few SIMD blocks.
+    char a[80];
+    char b[80];
+    char lower[80];
+    char upper[80];
+    for (int c = 0; c < 256; c++) {
+        for (size_t pos = 0; pos < sizeof(a); pos += 7) {
+            for (size_t i = 0; i < sizeof(a); i++) {
+                a[i] = (char)('a' + i % 26);
+                b[i] = (char)('A' + i % 26);
+            }
+            a[pos] = (char)c;
+            b[pos] = (char)c;
+            for (size_t i = 0; i < sizeof(a); i++) {
+                lower[i] = (char)tolower((unsigned char)a[i]);
+                upper[i] = (char)toupper((unsigned char)a[i]);
+            }
+            svcx_string_view sa = svcx_sv_from_parts(a, sizeof(a));
+            svcx_string_view sbv = svcx_sv_from_parts(b, sizeof(b));
+            assert(svcx_sv_eq_icase(sa, sbv));
+
+            svcx_sb_clear(&sb);
+            assert(svcx_sb_append_lower(&sb, sa) == SVCX_OK);
+            assert(memcmp(sb.buf.data, lower, sizeof(a)) == 0);
+            svcx_sb_clear(&sb);
+            assert(svcx_sb_append_upper(&sb, sa) == SVCX_OK);
+            assert(memcmp(sb.buf.data, upper, sizeof(a)) == 0);
+            svcx_ascii_upper(a, sizeof(a));
+            assert(memcmp(a, upper, sizeof(a)) == 0);
+            svcx_ascii_lower(a, sizeof(a));
+            assert(memcmp(a, lower, sizeof(a)) == 0);
+
+            // A byte that only differs in bit 0x20 must not match unless
+            // both are letters.
+            a[pos] = (char)(c ^ 0x20);
+            assert(svcx_sv_eq_icase(sa, sbv) == (isalpha(c) != 0));
+        }
+    }
+
+    // Random text from an alphabet of letters and their non-letter
+    // neighbours, against a tolower reference.
+    static const char alphabet[] = "aAbB@`[{\xc1\xe1";
+    char hay[200];
+    char needle[40];
+    uint64_t rng = 3;
+    for (int round = 0; round < 3000; round++) {
+        size_t hlen = (size_t)round % sizeof(hay);
+        size_t m = 1 + (size_t)round % 37;
+        for (size_t i = 0; i < hlen; i++) {
+            uint64_t r = test_rand(&rng);
+            hay[i] = alphabet[(r >> 33) % 4 ? (r >> 40) % 4 : (r >> 40) % 10];
+        }
+        for (size_t i = 0; i < m; i++) {
+            uint64_t r = test_rand(&rng);
+            needle[i] = alphabet[(r >> 33) % 4 ? (r >> 40) % 4
+                                               : (r >> 40) % 10];
+        }
+        svcx_string_view h = svcx_sv_from_parts(hay, hlen);
+        svcx_string_view n = svcx_sv_from_parts(needle, m);
+        assert(svcx_sv_find_icase(h, n) ==
+               ref_find_icase(hay, hlen, needle, m));
+        assert(svcx_sv_starts_with_icase(h, n) ==
+               (hlen >= m && ref_find_icase(hay, m, needle, m) == 0));
+    }
+
+    svcx_sb_free(&sb);
+}
+
+// Joins the remaining parts of a split iterator with '|'.
+static void join_split(svcx_split_iter *it, char *out, size_t cap) {
+    svcx_string_view token;
+    size_t len = 0;
+    bool first = true;
+    out[0] = '\0';
+    while (svcx_sv_split_next(it, &token)) {
+        len += (size_t)snprintf(out + len,
+            cap - len,
+            "%s%.*s",
+            first ? "" : "|",
+            (int)token.len,
+            token.data);
+        first = false;
+    }
+}
+
+void test_split_iter() {
+    char out[256];
+    svcx_split_iter it;
+
+    svcx_sv_split_init(&it, SVCX_SV("a,b,,c,"), ',');
+    join_split(&it, out, sizeof(out));
+    assert(strcmp(out, "a|b||c|") == 0);
+
+    svcx_string_view token;
+    svcx_sv_split_init(&it, SVCX_SV(""), ',');
+    assert(svcx_sv_split_next(&it, &token) && token.len == 0);
+    assert(!svcx_sv_split_next(&it, &token));
+
+    svcx_sv_split_str_init(&it, SVCX_SV("k1 => v1 => => v3"), SVCX_SV(" => "));
+    join_split(&it, out, sizeof(out));
+    assert(strcmp(out, "k1|v1|=> v3") == 0);
+
+    svcx_sv_split_any_init(&it, SVCX_SV("a=1;b=2&c"), SVCX_SV(";&"));
+    join_split(&it, out, sizeof(out));
+    assert(strcmp(out, "a=1|b=2|c") == 0);
+
+    svcx_sv_split_any_init(&it, SVCX_SV("x.y-z_w"), SVCX_SV("._-/"));
+    join_split(&it, out, sizeof(out));
+    assert(strcmp(out, "x|y|z|w") == 0);
+
+    svcx_sv_split_ws_init(&it, SVCX_SV("  GET \t /index.html\r\n"));
+    join_split(&it, out, sizeof(out));
+    assert(strcmp(out, "GET|/index.html") == 0);
+
+    svcx_sv_split_ws_init(&it, SVCX_SV(" \n\t "));
+    assert(!svcx_sv_split_next(&it, &token));
+
+    // Long inputs go through the SIMD scans; compare with svcx_sv_split.
+    char text[1000];
+    for (size_t i = 0; i < sizeof(text); i++) {
+        text[i] = i % 37 == 0 ? ',' : (i % 53 == 0 ? ' ' : 'a' + i % 26);
+    }
+    svcx_string_view sv = svcx_sv_from_parts(text, sizeof(text));
+    svcx_vector parts;
+    svcx_vector_init(
+        &parts, sizeof(svcx_string_view), svcx_default_allocator());
+    assert(svcx_sv_split(sv, ',', &parts) == SVCX_OK);
+
+    size_t n = 0;
+    svcx_sv_split_any_init(&it, sv, SVCX_SV(","));
+    while (svcx_sv_split_next(&it, &token)) {
+        svcx_string_view *ref = svcx_vector_at(&parts, n++);
+        assert(ref->data == token.data && ref->len == token.len);
+    }
+    assert(n == svcx_vector_size(&parts));
+
+    size_t words = 0;
+    svcx_sv_split_ws_init(&it, sv);
+    while (svcx_sv_split_next(&it, &token)) {
+        assert(token.len > 0 && !memchr(token.data, ' ', token.len));
+        words++;
+    }
+    assert(words == sizeof(text) / 53 + 1);
+    svcx_vector_free(&parts);
+}
+
+void test_byteset() {
+    svcx_byteset delims;
+    svcx_byteset_init(&delims, SVCX_SV(" ,;"));
+    svcx_string_view line = SVCX_SV("alpha, beta;gamma");
+    assert(svcx_sv_cspan(line, &delims) == 5);
+    assert(svcx_sv_find_first_of(line, &delims) == 5);
+    assert(svcx_sv_span(svcx_sv_substring(line, 5, line.len), &delims) == 2);
+    assert(svcx_sv_find_first_not_of(SVCX_SV(",,;"), &delims) == (size_t)-1);
+    assert(svcx_sv_find_first_of(SVCX_SV("abc"), &delims) == (size_t)-1);
+
+    svcx_string_view t = svcx_sv_trim(SVCX_SV("\t\v hi there \r\n\f"));
+    assert(t.len == 8 && memcmp(t.data, "hi there", 8) == 0);
+    t = svcx_sv_trim_start(SVCX_SV("  x "));
+    assert(t.len == 2 && t.data[0] == 'x');
+    t = svcx_sv_trim_end(SVCX_SV(" x  "));
+    assert(t.len == 2 && t.data[1] == 'x');
+    assert(svcx_sv_trim(SVCX_SV("   ")).len == 0);
+
+    svcx_byteset dashes;
+    svcx_byteset_init(&dashes, SVCX_SV("-"));
+    t = svcx_sv_trim_set(SVCX_SV("--x-y--"), &dashes);
+    assert(t.len == 3 && memcmp(t.data, "x-y", 3) == 0);
+
+    // Every byte value must be classified the same way by the table and the
+    // nibble lookup, including bytes >= 0x80.
+    const svcx_byteset *ws = svcx_byteset_whitespace();
+    for (int c = 0; c < 256; c++) {
+        assert(svcx_byteset_contains(ws, (unsigned char)c) ==
+               (c == ' ' || (c >= '\t' && c <= '\r')));
+    }
+
+    unsigned char all[256 + 64];
+    for (int round = 0; round < 64; round++) {
+        svcx_byteset set;
+        svcx_byteset_init(&set, SVCX_SV(""));
+        for (int c = round; c < 256; c += 3 + round % 11) {
+            svcx_byteset_add(&set, (unsigned char)c);
+        }
+        if (round == 0) {
+            set = *ws;
+        } else if (round >= 48) {
+            // Long runs of members cross several SIMD blocks.
+            svcx_byteset_init(&set, SVCX_SV(""));
+            for (int c = 0; c < 256; c++) {
+                if (c != ((round * 5) & 0xFF)) {
+                    svcx_byteset_add(&set, (unsigned char)c);
+                }
+            }
+        }
+
+        // A copy of the whitespace set goes through the nibble lookup, and
+        // the shared one through the whitespace compares.
+        const svcx_byteset *use = round == 1 ? ws : &set;
+
+        for (int i = 0; i < 256 + 64; i++) {
+            all[i] = (unsigned char)((i * 7 + round) & 0xFF);
+        }
+        svcx_string_view sv = svcx_sv_from_parts((const char *)all, 256 + 64);
+        for (size_t start = 0; start < 40; start++) {
+            svcx_string_view sub = svcx_sv_substring(sv, start, sv.len);
+            const unsigned char *p = (const unsigned char *)sub.data;
+            size_t span = 0, cspan = 0;
+            while (span < sub.len && svcx_byteset_contains(use, p[span])) {
+                span++;
+            }
+            while (cspan < sub.len && !svcx_byteset_contains(use, p[cspan])) {
+                cspan++;
+            }
+            assert(svcx_sv_span(sub, use) == span);
+            assert(svcx_sv_cspan(sub, use) == cspan);
+        }
+    }
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+void test_hash() {
+    uint8_t data[300];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    // Streaming in two or three pieces must match the one-shot hash for
+    // every length around the 16 and 48 byte boundaries.
+    for (size_t len = 0; len <= 200; len++) {
+        uint64_t expected = svcx_hash_bytes(data, len, 42);
+        assert(expected != svcx_hash_bytes(data, len, 43));
+        for (size_t cut = 0; cut <= len; cut += 1 + cut / 8) {
+            svcx_hasher h;
+            svcx_hasher_init(&h, 42);
+            svcx_hasher_update(&h, data, cut);
+            svcx_hasher_update(&h, data + cut, (len - cut) / 2);
+            svcx_hasher_update(
+                &h, data + cut + (len - cut) / 2, len - cut - (len - cut) / 2);
+            assert(svcx_hasher_final(&h) == expected);
+        }
+    }
+    svcx_hasher h;
+    svcx_hasher_init(&h, 0);
+    for (size_t i = 0; i < sizeof(data); i++) {
+        svcx_hasher_update(&h, data + i, 1);
+    }
+    assert(svcx_hasher_final(&h) == svcx_hash_bytes(data, sizeof(data), 0));
+
+    // Short keys that differ in a single byte or only in length must not
+    // collide, and the low bits must spread evenly over buckets.
+    enum { KEYS = 50000 };
+    static char storage[KEYS][16];
+    static svcx_string_view keys[KEYS];
+    static uint64_t hashes[KEYS];
+    static uint64_t batch[KEYS];
+    for (int i = 0; i < KEYS; i++) {
+        int n = snprintf(storage[i], sizeof(storage[i]), "key%d", i);
+        keys[i] = svcx_sv_from_parts(storage[i], (size_t)n);
+        if (i % 1000 == 999) {
+            keys[i].len = 20 + (size_t)i % 7;
+            keys[i].data = (const char *)data + i / 1000;
+        }
+        hashes[i] = svcx_hash_sv(keys[i], 7);
+    }
+
+    svcx_hash_sv_batch(keys, KEYS, 7, batch);
+    assert(memcmp(batch, hashes, sizeof(hashes)) == 0);
+
+    uint32_t buckets[256] = {0};
+    for (int i = 0; i < KEYS; i++) {
+        buckets[hashes[i] & 255]++;
+    }
+    for (int i = 0; i < 256; i++) {
+        assert(buckets[i] > KEYS / 256 / 2 && buckets[i] < KEYS / 256 * 2);
+    }
+
+    qsort(hashes, KEYS, sizeof(uint64_t), compare_u64);
+    for (int i = 1; i < KEYS; i++) {
+        assert(hashes[i] != hashes[i - 1]);
+    }
+
+    assert(svcx_hash_sv(SVCX_SV(""), 0) != svcx_hash_sv(SVCX_SV("\0"), 0));
+    assert(svcx_hash_sv(SVCX_SV("ab"), 0) != svcx_hash_sv(SVCX_SV("ba"), 0));
+}
+
+typedef struct map_value {
+    uint64_t a;
+    uint8_t b;
+} map_value;
+
+// The alignment of map_value, without C11 _Alignof.
+typedef struct map_value_align {
+    char c;
+    map_value v;
+} map_value_align;
+
+void test_map() {
+    svcx_allocator alloc = svcx_default_allocator();
+
+    // Random inserts, overwrites and removals against a reference array, with
+    // keys from a small range so that removals keep hitting full groups.
+    enum { RANGE = 4096 };
+    static int64_t ref[RANGE];
+    static bool present[RANGE];
+    svcx_map m;
+    svcx_map_init(&m, sizeof(uint32_t), sizeof(int64_t), alloc);
+    assert(svcx_map_get(&m, &(uint32_t){1}) == NULL);
+    assert(!svcx_map_remove(&m, &(uint32_t){1}));
+
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    size_t count = 0;
+    for (int i = 0; i < 200000; i++) {
+        uint64_t r = test_rand(&rng);
+        uint32_t key = (uint32_t)(r >> 33) % (i < 100000 ? RANGE : 512);
+        int64_t value = (int64_t)(r >> 20);
+        if ((r >> 8) % 3 == 0) {
+            assert(svcx_map_remove(&m, &key) == present[key]);
+            count -= present[key];
+            present[key] = false;
+        } else {
+            assert(svcx_map_insert(&m, &key, &value) == SVCX_OK);
+            count += !present[key];
+            present[key] = true;
+            ref[key] = value;
+        }
+        assert(svcx_map_size(&m) == count);
+    }
+    // The second phase only touches 512 keys, so tombstones must not have
+    // forced the table to keep growing.
+    assert(m.cap <= 8192);
+    for (uint32_t key = 0; key < RANGE; key++) {
+        int64_t *value = svcx_map_get(&m, &key);
+        assert((value != NULL) == present[key]);
+        assert(!value || *value == ref[key]);
+    }
+
+    size_t seen = 0;
+    svcx_map_iter it;
+    const uint32_t *key;
+    int64_t *value;
+    svcx_map_iter_init(&it, &m);
+    while (svcx_map_iter_next(&it, (const void **)&key, (void **)&value)) {
+        assert(present[*key] && *value == ref[*key]);
+        seen++;
+    }
+    assert(seen == count);
+
+    uint32_t last = *key;
+    assert(svcx_map_rehash(&m, 0) == SVCX_OK);
+    assert(svcx_map_size(&m) == count);
+    assert(*(int64_t *)svcx_map_get(&m, &last) == ref[last]);
+    svcx_map_clear(&m);
+    assert(svcx_map_size(&m) == 0);
+    svcx_map_iter_init(&it, &m);
+    assert(!svcx_map_iter_next(&it, NULL, NULL));
+    svcx_map_free(&m);
+
+    // Reserving up front means the table does not move while inserting.
+    svcx_map_init(&m, sizeof(uint64_t), sizeof(map_value), alloc);
+    assert(svcx_map_reserve(&m, 1000) == SVCX_OK);
+    char *slots = m.slots;
+    for (uint64_t i = 0; i < 1000; i++) {
+        map_value *v;
+        bool inserted;
+        assert(svcx_map_get_or_insert(&m, &i, (void **)&v, &inserted) ==
+               SVCX_OK);
+        assert(inserted && v->a == 0 && v->b == 0);
+        assert((uintptr_t)v % offsetof(map_value_align, v) == 0);
+        v->a = i * i;
+        v->b = (uint8_t)i;
+    }
+    assert(m.slots == slots);
+    for (uint64_t i = 0; i < 1000; i++) {
+        map_value *v;
+        bool inserted;
+        svcx_map_get_or_insert(&m, &i, (void **)&v, &inserted);
+        assert(!inserted && v->a == i * i && v->b == (uint8_t)i);
+    }
+    svcx_map_free(&m);
+
+    // String view keys are compared by contents, and maps without values act
+    // as sets. An arena works since the map never reallocates in place.
+    svcx_arena arena;
+    svcx_arena_init(&arena, 1024 * 1024);
+    svcx_map words;
+    svcx_map_init_sv(&words, sizeof(int), svcx_arena_allocator(&arena));
+    svcx_string_view text = SVCX_SV("the quick fox jumps over the lazy "
+                                    "dog and the fox jumps back");
+    svcx_split_iter split;
+    svcx_string_view word;
+    svcx_sv_split_ws_init(&split, text);
+    while (svcx_sv_split_next(&split, &word)) {
+        int *n;
+        assert(svcx_map_get_or_insert(&words, &word, (void **)&n, NULL) ==
+               SVCX_OK);
+        (*n)++;
+    }
+    char buf[] = "fox";
+    assert(*(int *)svcx_map_get(&words, &SVCX_SV("the")) == 3);
+    assert(*(int *)svcx_map_get(&words, &SVCX_SV(buf)) == 2);
+    assert(*(int *)svcx_map_get(&words, &SVCX_SV("dog")) == 1);
+    assert(!svcx_map_contains(&words, &SVCX_SV("cat")));
+    assert(svcx_map_size(&words) == 9);
+
+    svcx_map set;
+    svcx_map_init_sv(&set, 0, svcx_arena_allocator(&arena));
+    for (int i = 0; i < 3; i++) {
+        assert(svcx_map_insert(&set, &SVCX_SV("x"), NULL) == SVCX_OK);
+    }
+    assert(svcx_map_size(&set) == 1 && svcx_map_contains(&set, &SVCX_SV("x")));
+    svcx_arena_free_all(&arena);
+}
+
+#ifdef SVCX__HAS_ATOMICS
+typedef struct cmap_pair {
+    int64_t a;
+    int64_t b;
+} cmap_pair;
+
+typedef struct cmap_thread {
+    svcx_cmap *cm;
+    svcx_string_view *keys;
+    int nkeys;
+    int id;
+    bool torn;
+} cmap_thread;
+
+static void cmap_bump(
+    svcx_string_view key, void *value, bool inserted, void *ctx) {
+    SVCX_UNUSED(key);
+    SVCX_UNUSED(ctx);
+    cmap_pair *p = value;
+    assert(inserted == (p->a == 0));
+    p->a += 1;
+    p->b -= 1;
+}
+
+static void *cmap_writer(void *arg) {
+    cmap_thread *t = arg;
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < t->nkeys; i++) {
+            int k = (i * 7 + t->id * 13) % t->nkeys;
+            assert(svcx_cmap_upsert(t->cm, t->keys[k], cmap_bump, NULL) ==
+                   SVCX_OK);
+        }
+    }
+    return NULL;
+}
+
+// Writers keep a == -b in every value, so seeing anything else means a torn
+// read got through.
+static void *cmap_reader(void *arg) {
+    cmap_thread *t = arg;
+    for (int round = 0; round < 400; round++) {
+        for (int i = 0; i < t->nkeys; i++) {
+            cmap_pair p;
+            if (svcx_cmap_get(t->cm, t->keys[i], &p) && p.a != -p.b) {
+                t->torn = true;
+            }
+        }
+    }
+    return NULL;
+}
+
+void test_cmap() {
+    svcx_cmap cm;
+    assert(svcx_cmap_init(&cm, 3, sizeof(int), svcx_default_allocator()) ==
+           SVCX_OK);
+    assert(cm.nshards == 4);
+    assert(!svcx_cmap_get(&cm, SVCX_SV("missing"), NULL));
+    assert(!svcx_cmap_remove(&cm, SVCX_SV("missing")));
+
+    // Keys are copied, so the buffer they came from can be reused.
+    enum { KEYS = 5000 };
+    char buf[32];
+    for (int i = 0; i < KEYS; i++) {
+        int n = snprintf(buf, sizeof(buf), "key-%d", i);
+        assert(svcx_cmap_insert(&cm, svcx_sv_from_parts(buf, (size_t)n), &i) ==
+               SVCX_OK);
+    }
+    assert(svcx_cmap_size(&cm) == KEYS);
+    for (int i = 0; i < KEYS; i += 2) {
+        int n = snprintf(buf, sizeof(buf), "key-%d", i);
+        assert(svcx_cmap_remove(&cm, svcx_sv_from_parts(buf, (size_t)n)));
+    }
+    for (int i = 0; i < KEYS; i++) {
+        int n = snprintf(buf, sizeof(buf), "key-%d", i);
+        int value = -1;
+        svcx_string_view key = svcx_sv_from_parts(buf, (size_t)n);
+        bool found = svcx_cmap_get(&cm, key, &value);
+        assert(found == (i % 2 == 1));
+        assert(!found || value == i);
+    }
+    assert(svcx_cmap_size(&cm) == KEYS / 2);
+    int zero = 0;
+    assert(svcx_cmap_insert(&cm, SVCX_SV(""), &zero) == SVCX_OK);
+    assert(svcx_cmap_contains(&cm, SVCX_SV("")));
+    svcx_cmap_free(&cm);
+
+    // Concurrent upserts must not lose updates, and concurrent readers must
+    // only ever see complete values.
+    enum { THREADS = 4, SHARED = 64 };
+    static char names[SHARED][16];
+    svcx_string_view keys[SHARED];
+    for (int i = 0; i < SHARED; i++) {
+        int n = snprintf(names[i], sizeof(names[i]), "shared-%d", i);
+        keys[i] = svcx_sv_from_parts(names[i], (size_t)n);
+    }
+    assert(svcx_cmap_init(
+               &cm, 8, sizeof(cmap_pair), svcx_default_allocator()) == SVCX_OK);
+
+    pthread_t threads[THREADS * 2];
+    cmap_thread args[THREADS * 2];
+    for (int i = 0; i < THREADS * 2; i++) {
+        args[i] = (cmap_thread){&cm, keys, SHARED, i, false};
+        pthread_create(&threads[i],
+            NULL,
+            i < THREADS ? cmap_writer : cmap_reader,
+            &args[i]);
+    }
+    for (int i = 0; i < THREADS * 2; i++) {
+        pthread_join(threads[i], NULL);
+        assert(!args[i].torn);
+    }
+    for (int i = 0; i < SHARED; i++) {
+        cmap_pair p;
+        assert(svcx_cmap_get(&cm, keys[i], &p));
+        assert(p.a == THREADS * 200 && p.b == -p.a);
+    }
+    svcx_cmap_free(&cm);
+}
+
+#endif // SVCX__HAS_ATOMICS
+
+static bool sv_eq(svcx_string_view a, svcx_string_view b) {
+    return a.len == b.len && memcmp(a.data, b.data, a.len) == 0;
+}
+
+void test_interner() {
+    svcx_interner in;
+    svcx_interner_init(&in, svcx_default_allocator());
+
+    // Ids are dense and follow the order of first appearance, and the
+    // interned strings do not depend on the buffer they came from.
+    svcx_string_view text =
+        SVCX_SV("GET /a host=x GET /b host=y GET /a host=x");
+    svcx_split_iter it;
+    svcx_string_view token;
+    uint32_t ids[9];
+    size_t n = 0;
+    svcx_sv_split_ws_init(&it, text);
+    while (svcx_sv_split_next(&it, &token)) {
+        char copy[16];
+        memcpy(copy, token.data, token.len);
+        assert(svcx_interner_intern(&in,
+                   svcx_sv_from_parts(copy, token.len),
+                   &ids[n++]) == SVCX_OK);
+        memset(copy, '?', sizeof(copy));
+    }
+    uint32_t expected[9] = {0, 1, 2, 0, 3, 4, 0, 1, 2};
+    assert(n == 9 && memcmp(ids, expected, sizeof(ids)) == 0);
+    assert(svcx_interner_count(&in) == 5);
+    assert(sv_eq(svcx_interner_resolve(&in, 4), SVCX_SV("host=y")));
+
+    uint32_t id;
+    assert(svcx_interner_find(&in, SVCX_SV("/b"), &id) && id == 3);
+    assert(!svcx_interner_find(&in, SVCX_SV("POST"), &id));
+    assert(svcx_interner_count(&in) == 5);
+
+    // Enough strings to span several blocks; earlier views must not move.
+    svcx_string_view first = svcx_interner_resolve(&in, 0);
+    char buf[64];
+    for (int i = 0; i < 20000; i++) {
+        int len = snprintf(buf, sizeof(buf), "%040d", i);
+        assert(svcx_interner_intern(
+                   &in, svcx_sv_from_parts(buf, (size_t)len), &id) == SVCX_OK);
+        assert(id == (uint32_t)i + 5);
+    }
+    assert(svcx_interner_resolve(&in, 0).data == first.data);
+    assert(sv_eq(svcx_interner_resolve(&in, 12345 + 5),
+        SVCX_SV("0000000000000000000000000000000000012345")));
+    assert(svcx_interner_intern(&in, SVCX_SV(""), &id) == SVCX_OK);
+    assert(svcx_interner_resolve(&in, id).len == 0);
+    svcx_interner_free(&in);
+
+    // The same through an arena.
+    svcx_arena arena;
+    svcx_arena_init(&arena, 1024 * 1024);
+    svcx_interner_init(&in, svcx_arena_allocator(&arena));
+    assert(svcx_interner_intern(&in, SVCX_SV("a"), &id) == SVCX_OK && id == 0);
+    assert(svcx_interner_intern(&in, SVCX_SV("b"), &id) == SVCX_OK && id == 1);
+    assert(svcx_interner_intern(&in, SVCX_SV("a"), &id) == SVCX_OK && id == 0);
+    svcx_interner_free(&in);
+    svcx_arena_free_all(&arena);
+}
+
+#ifdef SVCX__HAS_ATOMICS
+static void *cinterner_worker(void *arg) {
+    svcx_cinterner *ci = ((void **)arg)[0];
+    uint32_t *ids = ((void **)arg)[1];
+    char buf[32];
+    for (int i = 0; i < 3000; i++) {
+        int n = snprintf(buf, sizeof(buf), "token-%d", i);
+        uint32_t id;
+        assert(svcx_cinterner_intern(
+                   ci, svcx_sv_from_parts(buf, (size_t)n), &id) == SVCX_OK);
+        svcx_string_view sv = svcx_cinterner_resolve(ci, id);
+        assert(sv_eq(sv, svcx_sv_from_parts(buf, (size_t)n)));
+        ids[i] = id;
+    }
+    return NULL;
+}
+
+void test_cinterner() {
+    uint32_t id;
+
+    // Threads interning the same strings must agree on every id, and the ids
+    // must stay dense.
+    enum { THREADS = 4 };
+    static uint32_t thread_ids[THREADS][3000];
+    svcx_cinterner ci;
+    assert(svcx_cinterner_init(&ci, svcx_default_allocator()) == SVCX_OK);
+    pthread_t threads[THREADS];
+    void *args[THREADS][2];
+    for (int i = 0; i < THREADS; i++) {
+        args[i][0] = &ci;
+        args[i][1] = thread_ids[i];
+        pthread_create(&threads[i], NULL, cinterner_worker, args[i]);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(svcx_cinterner_count(&ci) == 3000);
+    static bool seen[3000];
+    for (int i = 0; i < 3000; i++) {
+        for (int t = 1; t < THREADS; t++) {
+            assert(thread_ids[t][i] == thread_ids[0][i]);
+        }
+        assert(thread_ids[0][i] < 3000 && !seen[thread_ids[0][i]]);
+        seen[thread_ids[0][i]] = true;
+    }
+    assert(svcx_cinterner_find(&ci, SVCX_SV("token-7"), &id));
+    assert(id == thread_ids[0][7]);
+    assert(!svcx_cinterner_find(&ci, SVCX_SV("token-3000"), NULL));
+    svcx_cinterner_free(&ci);
+
+    // A failed allocation must not use up an id, so the ids stay dense once
+    // the allocator recovers.
+    test_budget budget = {1000};
+    assert(svcx_cinterner_init(&ci, test_budget_allocator(&budget)) ==
+           SVCX_OK);
+    char name[16];
+    for (uint32_t i = 0; i < 16; i++) {
+        snprintf(name, sizeof(name), "s%u", (unsigned)i);
+        assert(svcx_cinterner_intern(&ci, svcx_sv_from_cstr(name), &id) ==
+                   SVCX_OK &&
+               id == i);
+    }
+    // The 17th id needs a new bucket, so some budget fails in the map and
+    // some in the bucket.
+    svcx_result r;
+    for (size_t left = 0;; left++) {
+        budget.left = left;
+        r = svcx_cinterner_intern(&ci, SVCX_SV("late"), &id);
+        if (r == SVCX_OK) {
+            break;
+        }
+        assert(r == SVCX_INTERNER_ALLOC_ERR);
+        assert(svcx_cinterner_count(&ci) == 16);
+        assert(!svcx_cinterner_find(&ci, SVCX_SV("late"), NULL));
+    }
+    assert(id == 16 && svcx_cinterner_count(&ci) == 17);
+    assert(sv_eq(svcx_cinterner_resolve(&ci, 16), SVCX_SV("late")));
+    assert(sv_eq(svcx_cinterner_resolve(&ci, 3), SVCX_SV("s3")));
+    svcx_cinterner_free(&ci);
+}
+#endif // SVCX__HAS_ATOMICS
+
+// Parses the whole C string with svcx_sv_parse_f64 and strtod, and checks
+// that they agree on the bits of the value and on the length.
+static void check_parse_f64(const char *text) {
+    char *end;
+    double expected = strtod(text, &end);
+    double value = -1.0;
+    size_t len = 99;
+    svcx_result r = svcx_sv_parse_f64(svcx_sv_from_cstr(text), &value, &len);
+    assert(len == (size_t)(end - text));
+    if (len == 0) {
+        assert(r == SVCX_PARSE_INVALID_ERR);
+    } else if (expected != expected) {
+        assert(r == SVCX_OK && value != value);
+    } else {
+        assert(memcmp(&value, &expected, sizeof(double)) == 0);
+    }
+}
+
+void test_parse() {
+    uint64_t u;
+    int64_t i;
+    size_t len;
+
+    assert(svcx_sv_parse_u64(SVCX_SV("12345678901234567890x"), &u, &len) ==
+           SVCX_OK);
+    assert(u == 12345678901234567890ULL && len == 20);
+    assert(svcx_sv_parse_u64(SVCX_SV("18446744073709551615"), &u, &len) ==
+           SVCX_OK);
+    assert(u == UINT64_MAX);
+    assert(svcx_sv_parse_u64(SVCX_SV("18446744073709551616"), &u, &len) ==
+           SVCX_PARSE_RANGE_ERR);
+    assert(u == UINT64_MAX && len == 20);
+    assert(svcx_sv_parse_u64(SVCX_SV("0000000000000000000000042"), &u, &len) ==
+           SVCX_OK);
+    assert(u == 42 && len == 25);
+    assert(svcx_sv_parse_u64(SVCX_SV("+7"), &u, &len) == SVCX_OK && u == 7);
+    assert(svcx_sv_parse_u64(SVCX_SV("-7"), &u, &len) ==
+           SVCX_PARSE_INVALID_ERR);
+    assert(len == 0);
+    assert(svcx_sv_parse_u64(SVCX_SV(" 7"), &u, &len) ==
+           SVCX_PARSE_INVALID_ERR);
+    assert(svcx_sv_parse_u64(SVCX_SV(""), &u, NULL) == SVCX_PARSE_INVALID_ERR);
+
+    assert(svcx_sv_parse_i64(SVCX_SV("-9223372036854775808"), &i, &len) ==
+           SVCX_OK);
+    assert(i == INT64_MIN && len == 20);
+    assert(svcx_sv_parse_i64(SVCX_SV("9223372036854775807,"), &i, &len) ==
+           SVCX_OK);
+    assert(i == INT64_MAX && len == 19);
+    assert(svcx_sv_parse_i64(SVCX_SV("9223372036854775808"), &i, &len) ==
+           SVCX_PARSE_RANGE_ERR);
+    assert(i == INT64_MAX);
+    assert(svcx_sv_parse_i64(SVCX_SV("-99999999999999999999"), &i, &len) ==
+           SVCX_PARSE_RANGE_ERR);
+    assert(i == INT64_MIN && len == 21);
+    assert(svcx_sv_parse_i64(SVCX_SV("-"), &i, &len) ==
+           SVCX_PARSE_INVALID_ERR);
+
+    // Every length of digit run against strtoull, so the SWAR chunks meet
+    // both the scalar tail and the end of the view.
+    char buf[64];
+    uint64_t rng = 12345;
+    for (int n = 1; n <= 20; n++) {
+        for (int k = 0; k < 200; k++) {
+            for (int j = 0; j < n; j++) {
+                buf[j] = (char)('0' + (test_rand(&rng) >> 33) % 10);
+            }
+            buf[n] = '\0';
+            svcx_result r =
+                svcx_sv_parse_u64(svcx_sv_from_parts(buf, n), &u, &len);
+            assert(len == (size_t)n);
+            if (r == SVCX_OK) {
+                assert(u == strtoull(buf, NULL, 10));
+            } else {
+                assert(r == SVCX_PARSE_RANGE_ERR && n == 20);
+            }
+        }
+    }
+
+    static const char *const floats[] = {
+        "0",
+        "-0",
+        "0.0e100",
+        "1",
+        "3.14159",
+        "-2.5e-3",
+        ".5",
+        "5.",
+        "1e",
+        "1e+",
+        "1E-2x",
+        "123456789012345678901234567890",
+        "0.000000000000000000000000000001234",
+        "9007199254740993",
+        "9007199254740992.5",
+        "1.7976931348623157e308",
+        "1.7976931348623158e308",
+        "1.7976931348623159e308",
+        "2.2250738585072011e-308",
+        "2.2250738585072014e-308",
+        "4.9e-324",
+        "2.4703282292062327e-324",
+        "2.4703282292062328e-324",
+        "1e-400",
+        "1e99999999999",
+        "0.1",
+        "0.30000000000000004",
+        "7.2057594037927933e16",
+        "1.00000000000000011102230246251565404236316680908203125",
+        "1.00000000000000011102230246251565404236316680908203124",
+        "1.00000000000000011102230246251565404236316680908203126",
+        "inf",
+        "-Infinity",
+        "INFINITE",
+        "nan",
+        "NaN(",
+        ".",
+        "-",
+        "+.e1",
+        "e5",
+    };
+    for (size_t k = 0; k < SVCX_ARRAY_LEN(floats); k++) {
+        check_parse_f64(floats[k]);
+    }
+
+    double d;
+    assert(svcx_sv_parse_f64(SVCX_SV("-1e400"), &d, &len) ==
+           SVCX_PARSE_RANGE_ERR);
+    assert(d < 0 && d * 2 == d && len == 6);
+    assert(svcx_sv_parse_f64(SVCX_SV("12.5"), &d, NULL) == SVCX_OK);
+    assert(d == 12.5);
+
+    // A long run of digits that rounds up only because of its last digit.
+    static char big[1200];
+    memcpy(big, "9007199254740993", 16);
+    memset(big + 16, '0', 1100);
+    big[1116] = '1';
+    big[1117] = 'e';
+    big[1118] = '-';
+    memcpy(big + 1119, "1101", 5);
+    check_parse_f64(big);
+    big[1116] = '0';
+    check_parse_f64(big);
+
+    // Random decimals of every shape against strtod.
+    for (int k = 0; k < 200000; k++) {
+        size_t n = 0;
+        uint64_t bits = test_rand(&rng);
+        if (bits & 1) {
+            buf[n++] = '-';
+        }
+        int digits = 1 + (int)((bits >> 1) % 25);
+        int dot = (int)((bits >> 6) % (digits + 2));
+        for (int j = 0; j < digits; j++) {
+            if (j == dot) {
+                buf[n++] = '.';
+            }
+            buf[n++] = (char)('0' + (test_rand(&rng) >> 33) % 10);
+        }
+        if ((bits >> 12) & 1) {
+            n += (size_t)snprintf(
+                buf + n, 16, "e%d", (int)((bits >> 13) % 700) - 350);
+        }
+        buf[n] = '\0';
+        check_parse_f64(buf);
+    }
+}
+
+// Checks that the shortest form of v reads back as v and has the same
+// significant digits as the shortest correctly rounded %e form.
+static void check_format_f64(svcx_string_builder *sb, double v) {
+    svcx_sb_clear(sb);
+    assert(svcx_sb_append_f64(sb, v) == SVCX_OK);
+    const char *text = svcx_sb_cstr(sb);
+    assert(strtod(text, NULL) == v);
+
+    char expected[32];
+    for (int prec = 0; prec < 17; prec++) {
+        snprintf(expected, sizeof(expected), "%.*e", prec, v);
+        if (strtod(expected, NULL) == v) {
+            break;
+        }
+    }
+    char digits[32];
+    size_t n = 0;
+    for (const char *p = expected; *p && *p != 'e'; p++) {
+        if (*p >= '0' && *p <= '9') {
+            digits[n++] = *p;
+        }
+    }
+    while (n > 1 && digits[n - 1] == '0') {
+        n--;
+    }
+
+    // Collect the significant digits of our output the same way.
+    char ours[32];
+    size_t m = 0;
+    for (const char *p = text; *p && *p != 'e'; p++) {
+        if ((*p >= '1' && *p <= '9') || (*p == '0' && m > 0)) {
+            ours[m++] = *p;
+        }
+    }
+    while (m > 1 && ours[m - 1] == '0') {
+        m--;
+    }
+
+    // Below a power of two the rounding interval is narrower than above it,
+    // so the shortest form may be one digit shorter than the nearest.
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    if ((bits & 0x000fffffffffffffULL) == 0) {
+        assert(m <= n);
+    } else {
+        assert(m == n && memcmp(ours, digits, n) == 0);
+    }
+}
+
+static void check_format(svcx_string_builder *sb, double v, const char *text) {
+    svcx_sb_clear(sb);
+    assert(svcx_sb_append_f64(sb, v) == SVCX_OK);
+    assert(strcmp(svcx_sb_cstr(sb), text) == 0);
+}
+
+static svcx_result log_line(svcx_string_builder *sb, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    SVCX_SB_APPEND_LIT(sb, "[log] ");
+    svcx_result r = svcx_sb_append_vfmt(sb, fmt, args);
+    va_end(args);
+    return r;
+}
+
+void test_format() {
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, svcx_default_allocator());
+
+    assert(svcx_sb_append_u64(&sb, 0) == SVCX_OK);
+    assert(svcx_sb_append_i64(&sb, -42) == SVCX_OK);
+    assert(svcx_sb_append_u64(&sb, UINT64_MAX) == SVCX_OK);
+    assert(svcx_sb_append_i64(&sb, INT64_MIN) == SVCX_OK);
+    assert(svcx_sb_append_hex(&sb, 0) == SVCX_OK);
+    assert(svcx_sb_append_hex(&sb, 0xdeadbeef) == SVCX_OK);
+    assert(svcx_sb_append_hex(&sb, UINT64_MAX) == SVCX_OK);
+    assert(strcmp(svcx_sb_cstr(&sb),
+               "0-4218446744073709551615-9223372036854775808"
+               "0deadbeefffffffffffffffff") == 0);
+
+    char expected[32];
+    uint64_t rng = 99;
+    for (int k = 0; k < 100000; k++) {
+        uint64_t r = test_rand(&rng);
+        uint64_t u = r >> (r & 63);
+        int64_t i = (int64_t)(r ^ (r >> 17)) >> (r >> 58);
+        svcx_sb_clear(&sb);
+        svcx_sb_append_u64(&sb, u);
+        snprintf(expected, sizeof(expected), "%llu", (unsigned long long)u);
+        assert(strcmp(svcx_sb_cstr(&sb), expected) == 0);
+        svcx_sb_clear(&sb);
+        svcx_sb_append_i64(&sb, i);
+        snprintf(expected, sizeof(expected), "%lld", (long long)i);
+        assert(strcmp(svcx_sb_cstr(&sb), expected) == 0);
+        svcx_sb_clear(&sb);
+        svcx_sb_append_hex(&sb, u);
+        snprintf(expected, sizeof(expected), "%llx", (unsigned long long)u);
+        assert(strcmp(svcx_sb_cstr(&sb), expected) == 0);
+    }
+
+    check_format(&sb, 0.0, "0");
+    check_format(&sb, -0.0, "-0");
+    check_format(&sb, 1.0, "1");
+    check_format(&sb, -1.5, "-1.5");
+    check_format(&sb, 0.1, "0.1");
+    check_format(&sb, 0.1 + 0.2, "0.30000000000000004");
+    check_format(&sb, 100.0, "100");
+    check_format(&sb, 123.456, "123.456");
+    check_format(&sb, 1e20, "100000000000000000000");
+    check_format(&sb, 1e21, "1e+21");
+    check_format(&sb, 0.000001, "0.000001");
+    check_format(&sb, 1.5e-7, "1.5e-7");
+    check_format(&sb, 9007199254740993.0, "9007199254740992");
+    check_format(&sb, 5e-324, "5e-324");
+    check_format(&sb, 1.7976931348623157e308, "1.7976931348623157e+308");
+    check_format(&sb, 2.2250738585072014e-308, "2.2250738585072014e-308");
+    check_format(&sb, 1.0 / 0.0, "inf");
+    check_format(&sb, -1.0 / 0.0, "-inf");
+    check_format(&sb, 0.0 / 0.0, "nan");
+
+    // Random bit patterns cover normals and subnormals of every exponent,
+    // powers of two sit at the asymmetric interval boundary.
+    for (int k = 0; k < 200000; k++) {
+        uint64_t bits = test_rand(&rng);
+        if (k % 4 == 0) {
+            bits &= 0x800fffffffffffffULL;
+        }
+        if (k % 16 == 1) {
+            bits &= 0xfff0000000000000ULL;
+        }
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        if (v == v && v - v == 0.0) {
+            check_format_f64(&sb, v);
+        }
+    }
+    for (int x = 1; x < 1000; x++) {
+        check_format_f64(&sb, x / 1000.0);
+        check_format_f64(&sb, (double)x * 1e15);
+    }
+
+    // Outputs of every length around the capacity, so some fit exactly,
+    // some miss only the terminating zero and some need to grow.
+    svcx_sb_free(&sb);
+    svcx_sb_init(&sb, svcx_default_allocator());
+    char pad[200];
+    memset(pad, 'x', sizeof(pad));
+    size_t total = 0;
+    for (int n = 0; n < 150; n++) {
+        assert(svcx_sb_append_fmt(&sb, "%.*s%d", n, pad, n % 10) == SVCX_OK);
+        total += (size_t)n + 1;
+        assert(sb.buf.size == total);
+        assert(((char *)sb.buf.data)[total - 1] == '0' + n % 10);
+    }
+    svcx_sb_clear(&sb);
+    assert(log_line(&sb, "%s=%d", "retries", 3) == SVCX_OK);
+    assert(log_line(&sb, " %05.1f", 2.25) == SVCX_OK);
+    assert(strcmp(svcx_sb_cstr(&sb), "[log] retries=3[log]  002.2") == 0);
+    svcx_sb_free(&sb);
+
+    svcx_arena arena;
+    svcx_arena_init(&arena, 64 * 1024);
+    svcx_sb_init(&sb, svcx_arena_allocator(&arena));
+    for (int i = 0; i < 100; i++) {
+        assert(svcx_sb_append_fmt(&sb, "%d,", i) == SVCX_OK);
+    }
+    assert(svcx_sv_ends_with(svcx_sb_view(&sb), SVCX_SV("98,99,")));
+    svcx_arena_free_all(&arena);
+}
+
+// A sink that writes at most chunk bytes per call, and fails once limit bytes
+// have been written in total.
+typedef struct test_sink {
+    char data[1 << 16];
+    size_t len;
+    size_t chunk;
+    size_t limit;
+    size_t calls;
+} test_sink;
+
+static ptrdiff_t test_sink_write(void *ctx, const void *data, size_t len) {
+    test_sink *ts = ctx;
+    ts->calls++;
+    if (ts->len >= ts->limit) {
+        return -1;
+    }
+    size_t n = len < ts->chunk ? len : ts->chunk;
+    n = n < ts->limit - ts->len ? n : ts->limit - ts->len;
+    memcpy(ts->data + ts->len, data, n);
+    ts->len += n;
+    return (ptrdiff_t)n;
+}
+
+void test_sb_sink() {
+    svcx_allocator alloc = svcx_default_allocator();
+    static test_sink ts;
+    ts = (test_sink){.chunk = 7, .limit = sizeof(ts.data)};
+
+    // Every append function goes through the buffer, which never grows much
+    // past the threshold, and short writes are retried.
+    svcx_string_builder sb;
+    svcx_sb_init_sink(&sb, alloc, test_sink_write, &ts, 64);
+    svcx_string_builder ref;
+    svcx_sb_init(&ref, alloc);
+    for (int i = 0; i < 200; i++) {
+        svcx_string_builder *b[] = {&sb, &ref};
+        for (int j = 0; j < 2; j++) {
+            assert(svcx_sb_append_fmt(b[j], "%d:", i) == SVCX_OK);
+            assert(SVCX_SB_APPEND_LIT(b[j], "row ") == SVCX_OK);
+            assert(svcx_sb_append_u64(b[j], (uint64_t)i * 1000003) == SVCX_OK);
+            assert(svcx_sb_append_f64(b[j], i / 8.0) == SVCX_OK);
+            assert(svcx_sb_push_char(b[j], '\n') == SVCX_OK);
+        }
+        assert(sb.buf.size < 64);
+        assert(sb.buf.cap <= 128);
+    }
+    assert(svcx_sb_flush(&sb) == SVCX_OK);
+    assert(sb.buf.size == 0);
+    assert(ts.len == ref.buf.size);
+    assert(memcmp(ts.data, ref.buf.data, ts.len) == 0);
+
+    // Large appends skip the buffer, after what was buffered before them.
+    char big[1000];
+    memset(big, 'x', sizeof(big));
+    ts.len = 0;
+    svcx_sb_push_char(&sb, '<');
+    assert(svcx_sb_append(&sb, big, sizeof(big)) == SVCX_OK);
+    assert(sb.buf.size == 0 && sb.buf.cap <= 128);
+    svcx_sb_push_char(&sb, '>');
+    assert(ts.len == 1 + sizeof(big));
+    assert(ts.data[0] == '<' && ts.data[sizeof(big)] == 'x');
+    assert(svcx_sb_flush(&sb) == SVCX_OK);
+    assert(ts.len == 2 + sizeof(big) && ts.data[ts.len - 1] == '>');
+
+    // A failed write keeps what was not written, so flushing again after the
+    // sink recovers loses nothing.
+    ts = (test_sink){.chunk = 7, .limit = 10};
+    assert(svcx_sb_append_sv(&sb, SVCX_SV("0123456789abcdefghij")) == SVCX_OK);
+    assert(svcx_sb_append(&sb, big, 100) == SVCX_SB_FLUSH_ERR);
+    assert(ts.len == 10);
+    assert(sb.buf.size == 110);
+    assert(svcx_sb_flush(&sb) == SVCX_SB_FLUSH_ERR);
+    ts.limit = sizeof(ts.data);
+    assert(svcx_sb_flush(&sb) == SVCX_OK);
+    assert(ts.len == 120);
+    assert(memcmp(ts.data, "0123456789abcdefghijxxx", 23) == 0);
+    svcx_sb_free(&sb);
+    svcx_sb_free(&ref);
+
+    // When the unwritten part of a large append cannot be kept either, the
+    // append says so, and what was buffered before it is still kept.
+    test_budget budget = {.left = 1};
+    ts = (test_sink){.chunk = 7, .limit = 10};
+    svcx_sb_init_sink(&sb, test_budget_allocator(&budget), test_sink_write,
+        &ts, 64);
+    assert(svcx_sb_append_sv(&sb, SVCX_SV("0123456789abcdefghij")) == SVCX_OK);
+    assert(svcx_sb_append(&sb, big, 100) == SVCX_SB_APPEND_ERR);
+    assert(ts.len == 10 && sb.buf.size == 10);
+    ts.limit = sizeof(ts.data);
+    assert(svcx_sb_flush(&sb) == SVCX_OK);
+    assert(ts.len == 20 && memcmp(ts.data, "0123456789abcdefghij", 20) == 0);
+    svcx_sb_free(&sb);
+
+    // Plain string builders never flush, and flushing them does nothing.
+    svcx_sb_init(&sb, alloc);
+    assert(svcx_sb_append(&sb, big, sizeof(big)) == SVCX_OK);
+    assert(svcx_sb_flush(&sb) == SVCX_OK);
+    assert(sb.buf.size == sizeof(big));
+    svcx_sb_free(&sb);
+
+    // File descriptors and FILE streams.
+    FILE *f = tmpfile();
+    assert(f);
+    svcx_sb_init_fd(&sb, alloc, fileno(f), 16);
+    for (int i = 0; i < 100; i++) {
+        svcx_sb_append_fmt(&sb, "%d,", i);
+    }
+    assert(svcx_sb_flush(&sb) == SVCX_OK);
+    svcx_sb_free(&sb);
+    svcx_sb_init_file(&sb, alloc, f, 0);
+    assert(sb.flush_at == SVCX_SB_DEFAULT_FLUSH_AT);
+    SVCX_SB_APPEND_LIT(&sb, "end");
+    assert(svcx_sb_flush(&sb) == SVCX_OK);
+    svcx_sb_free(&sb);
+    fflush(f);
+
+    rewind(f);
+    char text[512];
+    size_t n = fread(text, 1, sizeof(text) - 1, f);
+    text[n] = '\0';
+    assert(strncmp(text, "0,1,2,", 6) == 0);
+    assert(strcmp(text + n - 9, "98,99,end") == 0);
+    fclose(f);
+}
+
+void test_gather_builder() {
+    svcx_allocator alloc = svcx_default_allocator();
+    svcx_gather_builder gb;
+    svcx_gb_init(&gb, alloc);
+
+    // Large slices are referenced and runs of small ones share one copy.
+    static char body[4096];
+    for (size_t i = 0; i < sizeof(body); i++) {
+        body[i] = (char)('a' + i % 26);
+    }
+    char header[32];
+    strcpy(header, "HTTP/1.1 200 OK\r\n");
+    assert(svcx_gb_append_sv(&gb, svcx_sv_from_cstr(header)) == SVCX_OK);
+    assert(SVCX_GB_APPEND_LIT(&gb, "\r\n") == SVCX_OK);
+    memset(header, '?', sizeof(header));
+    svcx_string_view payload = svcx_sv_from_parts(body, sizeof(body));
+    assert(svcx_gb_append_sv(&gb, payload) == SVCX_OK);
+    assert(SVCX_GB_APPEND_LIT(&gb, "--") == SVCX_OK);
+    assert(svcx_gb_append_copy(&gb, svcx_sv_from_parts(body, 1000)) == SVCX_OK);
+    assert(svcx_gb_append_sv(&gb, SVCX_SV("")) == SVCX_OK);
+    assert(gb.parts.size == 3);
+    const svcx_string_view *parts = gb.parts.data;
+    assert(parts[1].data == body);
+    assert(parts[2].len == 1002);
+    assert(svcx_gb_len(&gb) == 19 + sizeof(body) + 1002);
+
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, alloc);
+    assert(svcx_gb_flatten(&gb, &sb) == SVCX_OK);
+    assert(sb.buf.size == svcx_gb_len(&gb));
+    const char *flat = sb.buf.data;
+    assert(memcmp(flat, "HTTP/1.1 200 OK\r\n\r\nabc", 22) == 0);
+    assert(memcmp(flat + 19 + sizeof(body), "--abc", 5) == 0);
+
+    // Short writes through a sink.
+    static test_sink ts;
+    ts = (test_sink){.chunk = 100, .limit = sizeof(ts.data)};
+    assert(svcx_gb_write(&gb, test_sink_write, &ts) == SVCX_OK);
+    assert(ts.len == sb.buf.size && memcmp(ts.data, flat, ts.len) == 0);
+    ts = (test_sink){.chunk = 100, .limit = 50};
+    assert(svcx_gb_write(&gb, test_sink_write, &ts) == SVCX_GB_WRITE_ERR);
+
+    // Enough slices for several writev batches.
+    svcx_gb_clear(&gb);
+    svcx_sb_clear(&sb);
+    gb.copy_below = 8;
+    for (size_t i = 0; i < 300; i++) {
+        svcx_gb_append_sv(&gb, svcx_sv_from_parts(body + i, 8 + i % 3));
+        svcx_gb_append_sv(&gb, SVCX_SV(","));
+    }
+    assert(gb.parts.size == 600);
+    svcx_gb_flatten(&gb, &sb);
+    FILE *f = tmpfile();
+    assert(f);
+    assert(svcx_gb_writev(&gb, fileno(f)) == SVCX_OK);
+    rewind(f);
+    char *text = malloc(sb.buf.size);
+    assert(fread(text, 1, sb.buf.size, f) == sb.buf.size);
+    assert(fgetc(f) == EOF);
+    assert(memcmp(text, sb.buf.data, sb.buf.size) == 0);
+    free(text);
+    fclose(f);
+
+    // Empty slices are dropped even when nothing is copied, so writing them
+    // does not fail.
+    svcx_gb_clear(&gb);
+    gb.copy_below = 0;
+    assert(svcx_gb_append_sv(&gb, SVCX_SV("")) == SVCX_OK);
+    assert(gb.parts.size == 0);
+    f = tmpfile();
+    assert(f);
+    assert(svcx_gb_writev(&gb, fileno(f)) == SVCX_OK);
+    fclose(f);
+
+    // Clearing keeps the slice list and the scratch block, so refilling the
+    // builder does not allocate.
+    test_budget budget = {.left = 10};
+    svcx_gather_builder reuse;
+    svcx_gb_init(&reuse, test_budget_allocator(&budget));
+    assert(SVCX_GB_APPEND_LIT(&reuse, "a") == SVCX_OK);
+    svcx_gb_clear(&reuse);
+    budget.left = 0;
+    assert(SVCX_GB_APPEND_LIT(&reuse, "b") == SVCX_OK);
+    assert(svcx_gb_len(&reuse) == 1);
+    svcx_gb_free(&reuse);
+
+    svcx_sb_free(&sb);
+    svcx_gb_free(&gb);
+}
+
+void test_file() {
+    svcx_allocator alloc = svcx_default_allocator();
+    svcx_mapped_file f;
+
+    enum { SIZE = 200000 };
+    char *data = malloc(SIZE);
+    for (size_t i = 0; i < SIZE; i++) {
+        data[i] = (char)('a' + i * 7 % 26);
+    }
+
+    // A regular file is mapped, and an empty one gives an empty view.
+    FILE *tmp = tmpfile();
+    assert(tmp);
+    assert(svcx_file_map_fd(&f, fileno(tmp), alloc) == SVCX_OK);
+    assert(f.view.len == 0);
+    svcx_file_unmap(&f);
+    assert(fwrite(data, 1, SIZE, tmp) == SIZE && fflush(tmp) == 0);
+    assert(svcx_file_map_fd(&f, fileno(tmp), alloc) == SVCX_OK);
+#ifndef _WIN32
+    assert(f.mapped);
+#endif
+    assert(f.view.len == SIZE && memcmp(f.view.data, data, SIZE) == 0);
+    svcx_file_unmap(&f);
+    assert(f.view.data == NULL && f.view.len == 0);
+
+    assert(svcx_file_map(&f, "/nonexistent/svcx", alloc) ==
+           SVCX_FILE_OPEN_ERR);
+    assert(f.view.len == 0);
+    svcx_file_unmap(&f);
+
+#ifndef _WIN32
+    // Pipes are read, into an arena as well as with the default allocator.
+    svcx_arena arena;
+    svcx_arena_init(&arena, 1024 * 1024);
+    for (int use_arena = 0; use_arena < 2; use_arena++) {
+        int fds[2];
+        assert(pipe(fds) == 0);
+        assert(write(fds[1], data, 5000) == 5000);
+        close(fds[1]);
+        svcx_allocator a = use_arena ? svcx_arena_allocator(&arena) : alloc;
+        assert(svcx_file_map_fd(&f, fds[0], a) == SVCX_OK);
+        close(fds[0]);
+        assert(!f.mapped);
+        assert(f.view.len == 5000 && memcmp(f.view.data, data, 5000) == 0);
+        svcx_file_unmap(&f);
+    }
+    assert(arena.used >= 5000 && arena.used < 6000);
+    svcx_arena_free_all(&arena);
+#endif
+
+#ifdef __linux__
+    // Files in procfs report a size of 0 but are not empty.
+    assert(svcx_file_map(&f, "/proc/self/status", alloc) == SVCX_OK);
+    assert(!f.mapped);
+    assert(svcx_sv_starts_with(f.view, SVCX_SV("Name:")));
+    svcx_file_unmap(&f);
+
+    // Reads start from the beginning wherever the descriptor was left.
+    FILE *status = fopen("/proc/self/status", "r");
+    assert(status);
+    char line[64];
+    assert(fgets(line, sizeof(line), status));
+    assert(svcx_file_map_fd(&f, fileno(status), alloc) == SVCX_OK);
+    assert(!f.mapped);
+    assert(svcx_sv_starts_with(f.view, SVCX_SV("Name:")));
+    svcx_file_unmap(&f);
+    fclose(status);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fileno(tmp));
+    assert(svcx_file_map(&f, path, alloc) == SVCX_OK);
+    assert(f.mapped && f.view.len == SIZE);
+    assert(memcmp(f.view.data, data, SIZE) == 0);
+    svcx_file_unmap(&f);
+#endif
+
+    fclose(tmp);
+    free(data);
+}
+
+// Checks that reading text through a line reader with the given buffer size
+// gives the same lines as splitting it, or fails if a line does not fit.
+static void check_lines(const char *text, size_t len, size_t cap) {
+    FILE *tmp = tmpfile();
+    assert(tmp);
+    assert(fwrite(text, 1, len, tmp) == len && fflush(tmp) == 0);
+    rewind(tmp);
+
+    svcx_line_reader lr;
+    assert(svcx_lr_init(&lr, fileno(tmp), cap, svcx_default_allocator()) ==
+           SVCX_OK);
+    size_t pos = 0;
+    bool too_long = false;
+    svcx_string_view line;
+    while (pos < len) {
+        const char *nl = memchr(text + pos, '\n', len - pos);
+        size_t end = nl ? (size_t)(nl - text) : len;
+        if (end - pos >= cap) {
+            too_long = true;
+            break;
+        }
+        size_t want = end - pos;
+        if (nl && want > 0 && text[end - 1] == '\r') {
+            want--;
+        }
+        assert(svcx_lr_next(&lr, &line));
+        assert(line.len == want && memcmp(line.data, text + pos, want) == 0);
+        pos = end + 1;
+    }
+    assert(!svcx_lr_next(&lr, &line));
+    assert(lr.err == (too_long ? SVCX_LR_LINE_TOO_LONG_ERR : SVCX_OK));
+    assert(!svcx_lr_next(&lr, &line));
+    svcx_lr_free(&lr);
+    fclose(tmp);
+}
+
+void test_line_reader() {
+    static const char *const texts[] = {
+        "",
+        "\n",
+        "one",
+        "one\ntwo\n",
+        "one\r\ntwo\r\n\r\nlast",
+        "\n\n\r\n\n",
+        "a\rb\r\r\nc\r",
+        "a fairly long line that will need a refill\nshort\n",
+    };
+    for (size_t i = 0; i < SVCX_ARRAY_LEN(texts); i++) {
+        for (size_t cap = 1; cap < 60; cap++) {
+            check_lines(texts[i], strlen(texts[i]), cap);
+        }
+    }
+
+    // Random lines of random lengths, some of them CRLF, through buffers
+    // that are smaller and larger than the lines.
+    char text[4000];
+    uint64_t rng = 17;
+    for (int round = 0; round < 40; round++) {
+        for (size_t i = 0; i < sizeof(text); i++) {
+            uint32_t r = (uint32_t)(test_rand(&rng) >> 33);
+            text[i] = r % 40 == 0 ? '\n' : r % 40 == 1 ? '\r' : 'a' + r % 26;
+        }
+        size_t len = sizeof(text) - (size_t)round;
+        check_lines(text, len, 64 + (size_t)round * 5);
+        check_lines(text, len, 4096);
+    }
+
+#ifndef _WIN32
+    // A pipe hands out data in pieces, and a bad descriptor fails to read.
+    int fds[2];
+    assert(pipe(fds) == 0);
+    assert(write(fds[1], "x\r\ny", 4) == 4);
+    close(fds[1]);
+    svcx_line_reader lr;
+    svcx_string_view line;
+    assert(svcx_lr_init(&lr, fds[0], 0, svcx_default_allocator()) == SVCX_OK);
+    assert(svcx_lr_next(&lr, &line) && line.len == 1 && line.data[0] == 'x');
+    assert(svcx_lr_next(&lr, &line) && line.len == 1 && line.data[0] == 'y');
+    assert(!svcx_lr_next(&lr, &line) && lr.err == SVCX_OK);
+    svcx_lr_free(&lr);
+    close(fds[0]);
+
+    assert(svcx_lr_init(&lr, -1, 64, svcx_default_allocator()) == SVCX_OK);
+    assert(!svcx_lr_next(&lr, &line) && lr.err == SVCX_LR_READ_ERR);
+    svcx_lr_free(&lr);
+#endif
+}
+
+static void check_json(const char *raw, size_t len, const char *escaped) {
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, svcx_default_allocator());
+    svcx_sb_append_json_escaped(&sb, svcx_sv_from_parts(raw, len));
+    assert(strcmp(svcx_sb_cstr(&sb), escaped) == 0);
+    svcx_sb_clear(&sb);
+    svcx_sb_append_json_unescaped(&sb, svcx_sv_from_cstr(escaped));
+    assert(sb.buf.size == len && memcmp(sb.buf.data, raw, len) == 0);
+    svcx_sb_free(&sb);
+}
+
+static void check_csv(const char *raw, const char *quoted) {
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, svcx_default_allocator());
+    svcx_sb_append_csv_quoted(&sb, svcx_sv_from_cstr(raw), ',');
+    assert(strcmp(svcx_sb_cstr(&sb), quoted) == 0);
+    svcx_sb_clear(&sb);
+    svcx_sb_append_csv_unquoted(&sb, svcx_sv_from_cstr(quoted));
+    assert(strcmp(svcx_sb_cstr(&sb), raw) == 0);
+    svcx_sb_free(&sb);
+}
+
+void test_escape() {
+    check_json("", 0, "");
+    check_json("plain", 5, "plain");
+    check_json("a\"b\\c", 5, "a\\\"b\\\\c");
+    check_json("\b\f\n\r\t", 5, "\\b\\f\\n\\r\\t");
+    check_json("\x01\x1f\x7f", 3, "\\u0001\\u001f\x7f");
+    check_json("nul\0!", 5, "nul\\u0000!");
+    check_json("caf\xc3\xa9", 5, "caf\xc3\xa9");
+
+    // Specials on both sides of and inside every SIMD block.
+    char raw[200];
+    char expected[400];
+    for (size_t i = 0; i < sizeof(raw) - 1; i++) {
+        raw[i] = (char)('a' + i % 26);
+    }
+    raw[sizeof(raw) - 1] = '\0';
+    for (size_t i = 0; i < 70; i++) {
+        char *p = expected;
+        raw[i] = '"';
+        raw[i + 31] = '\n';
+        for (size_t j = 0; j < sizeof(raw) - 1; j++) {
+            if (raw[j] == '"') {
+                *p++ = '\\';
+                *p++ = '"';
+            } else if (raw[j] == '\n') {
+                *p++ = '\\';
+                *p++ = 'n';
+            } else {
+                *p++ = raw[j];
+            }
+        }
+        *p = '\0';
+        check_json(raw, strlen(raw), expected);
+        raw[i] = (char)('a' + i % 26);
+        raw[i + 31] = (char)('a' + (i + 31) % 26);
+    }
+
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, svcx_default_allocator());
+    svcx_sb_append_json_unescaped(
+        &sb, SVCX_SV("\\/\\u00e9\\u20AC\\ud83d\\ude00"));
+    assert(strcmp(svcx_sb_cstr(&sb),
+               "/\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80") == 0);
+    static const char *const bad_json[] = {
+        "\\",
+        "ab\\x",
+        "\\u12",
+        "\\u12g4",
+        "\\ud83d",
+        "\\ud83dx\\ude00",
+        "\\ud83d\\u0041",
+        "\\ude00",
+    };
+    for (size_t i = 0; i < SVCX_ARRAY_LEN(bad_json); i++) {
+        svcx_sb_clear(&sb);
+        assert(svcx_sb_append_json_unescaped(&sb,
+                   svcx_sv_from_cstr(bad_json[i])) ==
+               SVCX_SB_UNESCAPE_INVALID_ERR);
+        assert(sb.buf.size == 0);
+    }
+
+    check_csv("", "");
+    check_csv("plain text", "plain text");
+    check_csv("a,b", "\"a,b\"");
+    check_csv("say \"hi\"", "\"say \"\"hi\"\"\"");
+    check_csv("\"", "\"\"\"\"");
+    check_csv("two\r\nlines", "\"two\r\nlines\"");
+
+    svcx_sb_clear(&sb);
+    svcx_sb_append_csv_quoted(&sb, SVCX_SV("a,b;c"), ';');
+    assert(strcmp(svcx_sb_cstr(&sb), "\"a,b;c\"") == 0);
+    static const char *const bad_csv[] = {"\"", "\"abc", "\"a\"b\"", "\"\"\""};
+    for (size_t i = 0; i < SVCX_ARRAY_LEN(bad_csv); i++) {
+        svcx_sb_clear(&sb);
+        assert(svcx_sb_append_csv_unquoted(&sb,
+                   svcx_sv_from_cstr(bad_csv[i])) ==
+               SVCX_SB_UNESCAPE_INVALID_ERR);
+        assert(sb.buf.size == 0);
+    }
+    svcx_sb_free(&sb);
+}
+
+// Straightforward base64 encoder to check the real one against.
+static size_t ref_base64(const uint8_t *src, size_t len, bool url, char *out) {
+    char chars[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+                     "0123456789+/";
+    if (url) {
+        chars[62] = '-';
+        chars[63] = '_';
+    }
+    size_t n = 0;
+    uint32_t bits = 0;
+    int nbits = 0;
+    for (size_t i = 0; i < len; i++) {
+        bits = bits << 8 | src[i];
+        nbits += 8;
+        while (nbits >= 6) {
+            nbits -= 6;
+            out[n++] = chars[bits >> nbits & 63];
+        }
+    }
+    if (nbits > 0) {
+        out[n++] = chars[bits << (6 - nbits) & 63];
+    }
+    while (!url && n % 4 != 0) {
+        out[n++] = '=';
+    }
+    return n;
+}
+
+void test_encoding() {
+    svcx_allocator alloc = svcx_default_allocator();
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, alloc);
+    svcx_vector bytes;
+    svcx_vector_init(&bytes, 1, alloc);
+
+    static const char *const rfc[][2] = {
+        {"", ""},
+        {"f", "Zg=="},
+        {"fo", "Zm8="},
+        {"foo", "Zm9v"},
+        {"foob", "Zm9vYg=="},
+        {"fooba", "Zm9vYmE="},
+        {"foobar", "Zm9vYmFy"},
+    };
+    for (size_t i = 0; i < SVCX_ARRAY_LEN(rfc); i++) {
+        svcx_sb_clear(&sb);
+        svcx_sb_append_base64(
+            &sb, rfc[i][0], strlen(rfc[i][0]), SVCX_BASE64_STD);
+        assert(strcmp(svcx_sb_cstr(&sb), rfc[i][1]) == 0);
+    }
+    svcx_sb_clear(&sb);
+    svcx_sb_append_hex_encoded(&sb, "\x00\x7f\xab\xff", 4);
+    assert(strcmp(svcx_sb_cstr(&sb), "007fabff") == 0);
+
+    // Round trips of every length up to a few SIMD blocks, in all formats.
+    uint8_t data[300];
+    char text[601];
+    uint8_t back[300];
+    uint64_t rng = 99;
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(test_rand(&rng) >> 56);
+    }
+    for (size_t len = 0; len <= sizeof(data); len++) {
+        size_t n;
+        svcx_sb_clear(&sb);
+        assert(svcx_sb_append_hex_encoded(&sb, data, len) == SVCX_OK);
+        assert(sb.buf.size == 2 * len);
+        for (size_t i = 0; i < len; i++) {
+            snprintf(text + 2 * i, 3, "%02x", data[i]);
+        }
+        assert(memcmp(sb.buf.data, text, 2 * len) == 0);
+        assert(svcx_hex_decode(svcx_sb_view(&sb), back, len, &n) == SVCX_OK);
+        assert(n == len && memcmp(back, data, len) == 0);
+
+        for (int url = 0; url < 2; url++) {
+            svcx_base64_alphabet alphabet =
+                url ? SVCX_BASE64_URL : SVCX_BASE64_STD;
+            svcx_sb_clear(&sb);
+            svcx_sb_append_base64(&sb, data, len, alphabet);
+            size_t ref_len = ref_base64(data, len, url, text);
+            assert(sb.buf.size == ref_len);
+            assert(memcmp(sb.buf.data, text, ref_len) == 0);
+            assert(svcx_base64_decoded_len(svcx_sb_view(&sb), alphabet) ==
+                   len);
+            assert(svcx_base64_decode(
+                       svcx_sb_view(&sb), alphabet, back, len, &n) == SVCX_OK);
+            assert(n == len && memcmp(back, data, len) == 0);
+        }
+    }
+
+    // A bad character anywhere, including inside the SIMD blocks.
+    svcx_sb_clear(&sb);
+    svcx_sb_append_base64(&sb, data, 240, SVCX_BASE64_URL);
+    char *chars = sb.buf.data;
+    size_t n;
+    for (size_t i = 0; i < sb.buf.size; i++) {
+        char saved = chars[i];
+        static const char bad[] = {'+', '/', '=', '*', '\0', (char)0xC3};
+        for (size_t j = 0; j < sizeof(bad); j++) {
+            chars[i] = bad[j];
+            assert(svcx_base64_decode(svcx_sb_view(&sb),
+                       SVCX_BASE64_URL,
+                       back,
+                       sizeof(back),
+                       &n) == SVCX_DECODE_INVALID_ERR);
+        }
+        chars[i] = saved;
+    }
+    svcx_sb_clear(&sb);
+    svcx_sb_append_hex_encoded(&sb, data, 100);
+    chars = sb.buf.data;
+    for (size_t i = 0; i < sb.buf.size; i++) {
+        char saved = chars[i];
+        chars[i] = i % 2 ? 'g' : '/';
+        assert(svcx_hex_decode(svcx_sb_view(&sb), back, 100, &n) ==
+               SVCX_DECODE_INVALID_ERR);
+        chars[i] = saved;
+    }
+    assert(svcx_hex_decode(SVCX_SV("AbCd"), back, 2, &n) == SVCX_OK);
+    assert(n == 2 && back[0] == 0xAB && back[1] == 0xCD);
+    assert(svcx_hex_decode(SVCX_SV("abc"), back, 2, &n) ==
+           SVCX_DECODE_INVALID_ERR);
+    assert(svcx_hex_decode(SVCX_SV("abcd"), back, 1, &n) ==
+           SVCX_DECODE_SPACE_ERR);
+
+    static const char *const bad_std[] = {
+        "Zg=", "Zg", "Z===", "Zh==", "Zm9=", "=Zg=", "Zg==Zg==", "Zm8=Zm8="};
+    for (size_t i = 0; i < SVCX_ARRAY_LEN(bad_std); i++) {
+        assert(svcx_base64_decode(svcx_sv_from_cstr(bad_std[i]),
+                   SVCX_BASE64_STD,
+                   back,
+                   sizeof(back),
+                   &n) == SVCX_DECODE_INVALID_ERR);
+    }
+    static const char *const bad_url[] = {"Zg==", "Z", "Zh", "Zm9", "Zm9vY"};
+    for (size_t i = 0; i < SVCX_ARRAY_LEN(bad_url); i++) {
+        assert(svcx_base64_decode(svcx_sv_from_cstr(bad_url[i]),
+                   SVCX_BASE64_URL,
+                   back,
+                   sizeof(back),
+                   &n) == SVCX_DECODE_INVALID_ERR);
+    }
+    assert(svcx_base64_decode(
+               SVCX_SV("Zm9vYg=="), SVCX_BASE64_STD, back, 3, &n) ==
+           SVCX_DECODE_SPACE_ERR);
+
+    // Decoding into vectors appends, and leaves them alone on error.
+    assert(svcx_hex_decode_vec(SVCX_SV("6869"), &bytes) == SVCX_OK);
+    assert(svcx_base64_decode_vec(SVCX_SV("LXRoZXJl"), SVCX_BASE64_URL,
+               &bytes) == SVCX_OK);
+    assert(svcx_base64_decode_vec(SVCX_SV("!!!!"), SVCX_BASE64_URL, &bytes) ==
+           SVCX_DECODE_INVALID_ERR);
+    assert(bytes.size == 8 && memcmp(bytes.data, "hi-there", 8) == 0);
+
+    svcx_vector_free(&bytes);
+    svcx_sb_free(&sb);
+}
+
+// Returns the length of the longest valid UTF-8 prefix, by decoding each
+// code point and checking its value.
+static size_t ref_utf8_valid_len(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        unsigned char c = p[i];
+        size_t n = c < 0x80 ? 1 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+        if ((c & 0xC0) == 0x80 || c > 0xF7 || len - i < n) {
+            return i;
+        }
+        uint32_t cp = n == 1 ? c : c & (0x7F >> n);
+        for (size_t k = 1; k < n; k++) {
+            if ((p[i + k] & 0xC0) != 0x80) {
+                return i;
+            }
+            cp = cp << 6 | (p[i + k] & 0x3F);
+        }
+        static const uint32_t min[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (cp < min[n] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            return i;
+        }
+        i += n;
+    }
+    return len;
+}
+
+static size_t ref_utf8_encode(unsigned char *out, uint32_t cp) {
+    if (cp < 0x80) {
+        out[0] = (unsigned char)cp;
+        return 1;
+    }
+    size_t n = cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+    for (size_t k = n - 1; k > 0; k--) {
+        out[k] = (unsigned char)(0x80 | (cp & 0x3F));
+        cp >>= 6;
+    }
+    out[0] = (unsigned char)((0xF00 >> n) | cp);
+    return n;
+}
+
+static void check_utf8(const unsigned char *p, size_t len) {
+    svcx_string_view sv = svcx_sv_from_parts((const char *)p, len);
+    size_t ref = ref_utf8_valid_len(p, len);
+    size_t valid_len = SIZE_MAX;
+    assert(svcx_utf8_validate(sv, &valid_len) == (ref == len));
+    assert(valid_len == ref);
+}
+
+void test_utf8() {
+    svcx_allocator alloc = svcx_default_allocator();
+    svcx_vector units;
+    svcx_vector_init(&units, sizeof(uint16_t), alloc);
+    svcx_vector points;
+    svcx_vector_init(&points, sizeof(uint32_t), alloc);
+
+    svcx_string_view s = SVCX_SV("na\xc3\xafve \xf0\x9f\x8d\x95");
+    size_t valid_len;
+    assert(svcx_utf8_validate(s, &valid_len) && valid_len == s.len);
+    assert(svcx_utf8_count(s) == 7);
+    assert(svcx_utf8_offset(s, 3) == 4);
+    assert(svcx_utf8_offset(s, 7) == s.len);
+    assert(svcx_utf8_index(s, 4) == 3);
+    assert(svcx_utf8_to_utf16(s, &units) == SVCX_OK);
+    assert(units.size == 8);
+    assert(((uint16_t *)units.data)[6] == 0xD83C);
+    assert(((uint16_t *)units.data)[7] == 0xDF55);
+    assert(svcx_utf8_validate(SVCX_SV(""), &valid_len) && valid_len == 0);
+
+    static const char *const bad[] = {
+        "\x80",             // lone continuation
+        "\xc0\xaf",         // overlong two bytes
+        "\xe0\x9f\xbf",     // overlong three bytes
+        "\xf0\x8f\xbf\xbf", // overlong four bytes
+        "\xed\xa0\x80",     // surrogate
+        "\xf4\x90\x80\x80", // above U+10FFFF
+        "\xf5\x80\x80\x80", // bad lead
+        "\xe2\x82",         // cut short
+        "\xe2\x28\xa1",     // not a continuation
+        "\xff",
+    };
+    for (size_t i = 0; i < SVCX_ARRAY_LEN(bad); i++) {
+        svcx_string_view b = svcx_sv_from_cstr(bad[i]);
+        assert(!svcx_utf8_validate(b, &valid_len) && valid_len == 0);
+        assert(svcx_utf8_to_utf16(b, &units) == SVCX_UTF8_INVALID_ERR);
+        assert(svcx_utf8_to_utf32(b, &points) == SVCX_UTF8_INVALID_ERR);
+    }
+    assert(units.size == 8 && points.size == 0);
+    svcx_vector_clear(&units);
+
+    // Random text, mostly ASCII, mostly not, or without 4-byte sequences,
+    // with its code points kept to check counting, offsets and transcoding.
+    enum { MAX_POINTS = 700 };
+    unsigned char text[4 * MAX_POINTS];
+    uint32_t cps[MAX_POINTS];
+    size_t offsets[MAX_POINTS + 1];
+    uint64_t rng = 7;
+    for (int round = 0; round < 60; round++) {
+        size_t count = (size_t)round * 11 % MAX_POINTS;
+        size_t len = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t r = (uint32_t)(test_rand(&rng) >> 33);
+            uint32_t kind = round % 3 == 0   ? r % 4
+                            : round % 3 == 1 ? r % 3
+                            : r % 64         ? 0
+                                             : r % 4;
+            uint32_t cp = r >> 8 & 0x7F;
+            if (kind == 1) {
+                cp = 0x80 + (r >> 8) % 0x780;
+            } else if (kind == 2) {
+                cp = 0x800 + (r >> 8) % 0xF800;
+            } else if (kind == 3) {
+                cp = 0x10000 + (r >> 8) % 0x100000;
+            }
+            if (cp >= 0xD800 && cp <= 0xDFFF) {
+                cp = 0xFFFD;
+            }
+            cps[i] = cp;
+            offsets[i] = len;
+            len += ref_utf8_encode(text + len, cp);
+        }
+        offsets[count] = len;
+        svcx_string_view sv = svcx_sv_from_parts((const char *)text, len);
+
+        check_utf8(text, len);
+        assert(svcx_utf8_count(sv) == count);
+        for (size_t i = 0; i <= count; i += 1 + i / 8) {
+            assert(svcx_utf8_offset(sv, i) == offsets[i]);
+            assert(svcx_utf8_index(sv, offsets[i]) == i);
+        }
+
+        svcx_vector_clear(&points);
+        assert(svcx_utf8_to_utf32(sv, &points) == SVCX_OK);
+        assert(points.size == count);
+        assert(count == 0 ||
+               memcmp(points.data, cps, count * sizeof(uint32_t)) == 0);
+
+        svcx_vector_clear(&units);
+        assert(svcx_utf8_to_utf16(sv, &units) == SVCX_OK);
+        const uint16_t *u = units.data;
+        size_t k = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (cps[i] < 0x10000) {
+                assert(u[k++] == cps[i]);
+            } else {
+                assert(u[k++] == 0xD800 + ((cps[i] - 0x10000) >> 10));
+                assert(u[k++] == 0xDC00 + (cps[i] & 0x3FF));
+            }
+        }
+        assert(units.size == k);
+
+        // Prefixes and suffixes put the sequences at every offset in the
+        // SIMD blocks, and end them inside blocks.
+        for (size_t i = 0; i <= count && i < 40; i++) {
+            svcx_vector_clear(&points);
+            assert(svcx_utf8_to_utf32(svcx_sv_from_parts((const char *)text,
+                                          offsets[count - i]),
+                       &points) == SVCX_OK);
+            assert(points.size == count - i);
+            assert(count == i || memcmp(points.data,
+                                     cps,
+                                     (count - i) * sizeof(uint32_t)) == 0);
+            svcx_vector_clear(&points);
+            assert(svcx_utf8_to_utf32(
+                       svcx_sv_from_parts((const char *)text + offsets[i],
+                           len - offsets[i]),
+                       &points) == SVCX_OK);
+            assert(points.size == count - i);
+            assert(count == i || memcmp(points.data,
+                                     cps + i,
+                                     (count - i) * sizeof(uint32_t)) == 0);
+        }
+
+        // Every kind of error at every position, including inside and
+        // across the SIMD blocks.
+        if (round % 6 == 0 || round % 6 == 1) {
+            static const unsigned char subs[] = {
+                0x80, 0xBF, 0xC1, 0xC2, 0xE0, 0xED, 0xF0, 0xF4, 0xF8, 'a'};
+            for (size_t i = 0; i < len && i < 300; i++) {
+                unsigned char saved = text[i];
+                for (size_t j = 0; j < sizeof(subs); j++) {
+                    text[i] = subs[j];
+                    check_utf8(text, len);
+                }
+                text[i] = saved;
+            }
+            for (size_t cut = 0; cut < len && cut < 200; cut++) {
+                check_utf8(text, cut);
+            }
+        }
+    }
+
+    // Sequences straddling block boundaries after ASCII, and random bytes.
+    unsigned char buf[160];
+    static const char *const seqs[] = {
+        "\xc3\xaf", "\xe2\x82\xac", "\xf0\x9f\x8d\x95", "\xed\xa0\x80",
+        "\xf4\x90\x80\x80", "\xe0\x9f\xbf", "\xc2"};
+    for (size_t i = 0; i < SVCX_ARRAY_LEN(seqs); i++) {
+        size_t n = strlen(seqs[i]);
+        for (size_t pad = 0; pad < 100; pad++) {
+            memset(buf, 'x', sizeof(buf));
+            memcpy(buf + pad, seqs[i], n);
+            check_utf8(buf, sizeof(buf));
+            check_utf8(buf, pad + n);
+        }
+    }
+    for (int round = 0; round < 2000; round++) {
+        size_t len = (size_t)round % sizeof(buf);
+        for (size_t i = 0; i < len; i++) {
+            uint8_t r = (uint8_t)(test_rand(&rng) >> 56);
+            buf[i] = r % 4 ? (uint8_t)(0x80 | r % 0x40) : r;
+        }
+        check_utf8(buf, len);
+    }
+
+    svcx_vector_free(&points);
+    svcx_vector_free(&units);
+}
+
+void test_template() {
+    svcx_allocator alloc = svcx_default_allocator();
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, alloc);
+
+    // The format text is copied, so the buffer it came from can change.
+    char fmt[] = "{method} {path} {status:i} {bytes:u} {ms:f}ms id={id:x} "
+                 "{{{method}}}\n";
+    svcx_template t;
+    assert(svcx_tmpl_compile(&t, svcx_sv_from_cstr(fmt), alloc) == SVCX_OK);
+    memset(fmt, '?', sizeof(fmt) - 1);
+    assert(t.nslots == 6);
+    assert(svcx_tmpl_slot(&t, SVCX_SV("method")) == 0);
+    assert(svcx_tmpl_slot(&t, SVCX_SV("id")) == 5);
+    assert(svcx_tmpl_slot(&t, SVCX_SV("user")) == (size_t)-1);
+
+    svcx_tmpl_arg args[6];
+    args[svcx_tmpl_slot(&t, SVCX_SV("method"))] = SVCX_TMPL_STR(SVCX_SV("GET"));
+    args[svcx_tmpl_slot(&t, SVCX_SV("path"))] = SVCX_TMPL_STR(SVCX_SV("/a"));
+    args[svcx_tmpl_slot(&t, SVCX_SV("status"))] = SVCX_TMPL_I64(-1);
+    args[svcx_tmpl_slot(&t, SVCX_SV("bytes"))] = SVCX_TMPL_U64(512);
+    args[svcx_tmpl_slot(&t, SVCX_SV("ms"))] = SVCX_TMPL_F64(0.25);
+    args[svcx_tmpl_slot(&t, SVCX_SV("id"))] = SVCX_TMPL_U64(0xbeef);
+    assert(svcx_tmpl_render(&t, &sb, args) == SVCX_OK);
+    assert(svcx_tmpl_render(&t, &sb, args) == SVCX_OK);
+    const char *line = "GET /a -1 512 0.25ms id=beef {GET}\n";
+    assert(sb.buf.size == 2 * strlen(line));
+    assert(memcmp(sb.buf.data, line, strlen(line)) == 0);
+    svcx_tmpl_free(&t);
+
+    // Positional holes, reused slots and a template without holes.
+    svcx_sb_clear(&sb);
+    assert(svcx_tmpl_compile(&t, SVCX_SV("{} + {} = {2:i}, {0}!"), alloc) ==
+           SVCX_OK);
+    assert(t.nslots == 3);
+    svcx_tmpl_arg pos[] = {
+        SVCX_TMPL_STR(SVCX_SV("one")),
+        SVCX_TMPL_STR(SVCX_SV("two")),
+        SVCX_TMPL_I64(3),
+    };
+    svcx_tmpl_render(&t, &sb, pos);
+    assert(strcmp(svcx_sb_cstr(&sb), "one + two = 3, one!") == 0);
+    svcx_tmpl_free(&t);
+
+    svcx_sb_clear(&sb);
+    assert(svcx_tmpl_compile(&t, SVCX_SV("}}plain{{"), alloc) == SVCX_OK);
+    assert(t.nslots == 0);
+    svcx_tmpl_render(&t, &sb, NULL);
+    assert(strcmp(svcx_sb_cstr(&sb), "}plain{") == 0);
+    svcx_tmpl_free(&t);
+
+    svcx_sb_clear(&sb);
+    assert(svcx_tmpl_compile(&t, SVCX_SV(""), alloc) == SVCX_OK);
+    assert(svcx_tmpl_render(&t, &sb, NULL) == SVCX_OK);
+    assert(sb.buf.size == 0);
+    svcx_tmpl_free(&t);
+
+    // Literals take no args, so a heap array with one per hole is enough
+    // (the sanitizer catches reads past it).
+    svcx_sb_clear(&sb);
+    assert(svcx_tmpl_compile(&t, SVCX_SV("a {{b}} {x:u} c {{}}"), alloc) ==
+           SVCX_OK);
+    assert(t.nslots == 1);
+    svcx_tmpl_arg *one = malloc(sizeof(*one));
+    *one = SVCX_TMPL_U64(7);
+    assert(svcx_tmpl_render(&t, &sb, one) == SVCX_OK);
+    assert(strcmp(svcx_sb_cstr(&sb), "a {b} 7 c {}") == 0);
+    free(one);
+    svcx_tmpl_free(&t);
+
+    static const char *const bad[] = {
+        "{",
+        "{name",
+        "a}b",
+        "{x:q}",
+        "{x:}",
+        "{x:ii}",
+        "{a{b}}",
+        "{name} {0}",
+        "{0} {name}",
+    };
+    for (size_t i = 0; i < SVCX_ARRAY_LEN(bad); i++) {
+        assert(svcx_tmpl_compile(&t, svcx_sv_from_cstr(bad[i]), alloc) ==
+               SVCX_TMPL_SYNTAX_ERR);
+    }
+
+    svcx_sb_free(&sb);
+}
+
+void test_aho_corasick() {
+    svcx_allocator a = svcx_default_allocator();
+    svcx_vector patterns;
+    svcx_vector_init(&patterns, sizeof(svcx_string_view), a);
+    SVCX_VECTOR_PUSH(&patterns, svcx_string_view, SVCX_SV("he"));
+    SVCX_VECTOR_PUSH(&patterns, svcx_string_view, SVCX_SV("she"));
+    SVCX_VECTOR_PUSH(&patterns, svcx_string_view, SVCX_SV("his"));
+    SVCX_VECTOR_PUSH(&patterns, svcx_string_view, SVCX_SV("hers"));
+    SVCX_VECTOR_PUSH(&patterns, svcx_string_view, SVCX_SV("he"));
+
+    svcx_aho_corasick ac;
+    assert(svcx_ac_init(&ac, &patterns, a) == SVCX_OK);
+
+    svcx_ac_match first;
+    assert(svcx_ac_find_first(&ac, SVCX_SV("ushers"), &first));
+    assert(first.pattern == 1 && first.start == 1 && first.end == 4);
+    assert(svcx_ac_find_first(&ac, SVCX_SV("found in there"), NULL));
+    assert(!svcx_ac_find_first(&ac, SVCX_SV("xyz"), NULL));
+
+    svcx_vector matches;
+    svcx_vector_init(&matches, sizeof(svcx_ac_match), a);
+    assert(svcx_ac_find_all(&ac, SVCX_SV("ushers, his"), &matches) == SVCX_OK);
+    assert(svcx_vector_size(&matches) == 5);
+    svcx_ac_match *m = (svcx_ac_match *)matches.data;
+    assert(m[0].pattern == 1 && m[0].end == 4);
+    assert(m[1].pattern == 4 && m[2].pattern == 0 && m[2].start == 2);
+    assert(m[3].pattern == 3 && m[3].start == 2 && m[3].end == 6);
+    assert(m[4].pattern == 2 && m[4].start == 8);
+    svcx_ac_free(&ac);
+
+    // Many patterns with more than three leading bytes disable the
+    // prefilter; compare both automata against svcx_sv_find.
+    static const char *const words[] = {"error", "warn", "timeout", "refused",
+        "reset", "denied", "panic", "fatal", "oom", "retry"};
+    for (size_t n = 2; n <= SVCX_ARRAY_LEN(words); n += 8) {
+        svcx_vector_clear(&patterns);
+        for (size_t i = 0; i < n; i++) {
+            SVCX_VECTOR_PUSH(
+                &patterns, svcx_string_view, svcx_sv_from_cstr(words[i]));
+        }
+        assert(svcx_ac_init(&ac, &patterns, a) == SVCX_OK);
+
+        char text[400];
+        size_t len = 0;
+        for (int i = 0; len + 10 < sizeof(text); i++) {
+            const char *w = i % 7 == 3 ? words[i % SVCX_ARRAY_LEN(words)]
+                                       : "log line ";
+            len += (size_t)snprintf(text + len, sizeof(text) - len, "%s", w);
+        }
+        svcx_string_view sv = svcx_sv_from_parts(text, len);
+
+        svcx_vector_clear(&matches);
+        assert(svcx_ac_find_all(&ac, sv, &matches) == SVCX_OK);
+        size_t expected = 0;
+        for (size_t i = 0; i < n; i++) {
+            svcx_string_view w = svcx_sv_from_cstr(words[i]);
+            for (size_t at = svcx_sv_find(sv, w); at != (size_t)-1;
+                 at = svcx_sv_find_from(sv, w, at + 1)) {
+                expected++;
+            }
+        }
+        assert(svcx_vector_size(&matches) == expected);
+        foreach_v(svcx_ac_match *it, matches) {
+            svcx_string_view w = svcx_sv_from_cstr(words[it->pattern]);
+            assert(it->end - it->start == w.len);
+            assert(memcmp(text + it->start, w.data, w.len) == 0);
+        }
+        svcx_ac_free(&ac);
+    }
+
+    svcx_vector_clear(&patterns);
+    SVCX_VECTOR_PUSH(&patterns, svcx_string_view, SVCX_SV(""));
+    assert(svcx_ac_init(&ac, &patterns, a) == SVCX_AC_EMPTY_PATTERN_ERR);
+
+    svcx_vector_free(&matches);
+    svcx_vector_free(&patterns);
+}
+
+// Fills a roaring bitmap and a reference flag array with a mix of sparse
+// (array), dense (bitmap) and consecutive (run) containers.
+static void fill_roaring(svcx_roaring *r, bool *ref, size_t n, unsigned seed) {
+    for (size_t i = 0; i < n; i++) {
+        seed = seed * 1103515245 + 12345;
+        unsigned rnd = seed >> 8;
+        size_t key = i >> 16;
+        bool in = key == 0   ? rnd % 100 == 0
+                  : key == 1 ? rnd % 3 != 0
+                  : key == 2 ? (i & 0xFFFF) % 1000 < 400
+                             : rnd % 5000 == 0;
+        ref[i] = in;
+        if (in) {
+            svcx_roaring_add(r, (uint32_t)i);
+        }
+    }
+}
+
+static void check_roaring(const svcx_roaring *r, const bool *ref, size_t n) {
+    uint64_t card = 0;
+    for (size_t i = 0; i < n; i++) {
+        assert(svcx_roaring_contains(r, (uint32_t)i) == ref[i]);
+        card += ref[i];
+    }
+    assert(svcx_roaring_cardinality(r) == card);
+
+    svcx_roaring_iter it;
+    svcx_roaring_iter_init(&it, r);
+    uint32_t value;
+    uint64_t seen = 0;
+    uint32_t prev = 0;
+    while (svcx_roaring_iter_next(&it, &value)) {
+        assert(value < n && ref[value] && (seen == 0 || value > prev));
+        prev = value;
+        seen++;
+    }
+    assert(seen == card);
+}
+
+void test_roaring() {
+    enum { N = 4 * 65536 };
+    static bool ref_a[N];
+    static bool ref_b[N];
+    static bool expect[N];
+
+    svcx_allocator deft = svcx_default_allocator();
+    svcx_roaring a;
+    svcx_roaring b;
+    svcx_roaring out;
+    svcx_roaring_init(&a, deft);
+    svcx_roaring_init(&b, deft);
+    svcx_roaring_init(&out, deft);
+
+    fill_roaring(&a, ref_a, N, 1);
+    fill_roaring(&b, ref_b, N, 2);
+    check_roaring(&a, ref_a, N);
+
+    // Run the set operations with and without run containers.
+    for (int pass = 0; pass < 2; pass++) {
+        svcx_roaring_and(&out, &a, &b);
+        for (size_t i = 0; i < N; i++) {
+            expect[i] = ref_a[i] && ref_b[i];
+        }
+        check_roaring(&out, expect, N);
+
+        svcx_roaring_or(&out, &a, &b);
+        for (size_t i = 0; i < N; i++) {
+            expect[i] = ref_a[i] || ref_b[i];
+        }
+        check_roaring(&out, expect, N);
+
+        svcx_roaring_xor(&out, &a, &b);
+        for (size_t i = 0; i < N; i++) {
+            expect[i] = ref_a[i] != ref_b[i];
+        }
+        check_roaring(&out, expect, N);
+
+        svcx_roaring_andnot(&out, &a, &b);
+        for (size_t i = 0; i < N; i++) {
+            expect[i] = ref_a[i] && !ref_b[i];
+        }
+        check_roaring(&out, expect, N);
+
+        svcx_roaring_run_optimize(&a);
+        svcx_roaring_run_optimize(&b);
+    }
+    assert(((svcx_roaring_container *)a.containers.data)[2].kind ==
+           SVCX_ROARING_RUN);
+
+    svcx_string_builder sb;
+    svcx_sb_init(&sb, deft);
+    assert(svcx_roaring_serialize(&a, &sb) == SVCX_OK);
+    assert(svcx_roaring_deserialize(&out, svcx_sb_view(&sb)) == SVCX_OK);
+    check_roaring(&out, ref_a, N);
+
+    svcx_string_view truncated = svcx_sb_view(&sb);
+    truncated.len -= 3;
+    assert(svcx_roaring_deserialize(&out, truncated) ==
+           SVCX_ROARING_DESERIALIZE_ERR);
+    assert(svcx_roaring_cardinality(&out) == 0);
+
+    // Modifying a run container expands it, and removing values from a
+    // bitmap container turns it back into an array.
+    for (size_t i = 2 * 65536; i < 3 * 65536; i += 7) {
+        svcx_roaring_remove(&a, (uint32_t)i);
+        ref_a[i] = false;
+    }
+    for (size_t i = 65536; i < 2 * 65536; i++) {
+        if (i % 16 != 0) {
+            svcx_roaring_remove(&a, (uint32_t)i);
+            ref_a[i] = false;
+        }
+    }
+    check_roaring(&a, ref_a, N);
+    assert(((svcx_roaring_container *)a.containers.data)[1].kind ==
+           SVCX_ROARING_ARRAY);
+
+    svcx_roaring_add(&a, 0xFFFFFFFF);
+    assert(svcx_roaring_contains(&a, 0xFFFFFFFF));
+    svcx_roaring_remove(&a, 0xFFFFFFFF);
+    check_roaring(&a, ref_a, N);
+
+    // Running out of memory partway through an operation leaves a valid
+    // result to free. Here the intersection of two bitmap containers is
+    // small enough to be turned into an array.
+    svcx_roaring_clear(&a);
+    svcx_roaring_clear(&b);
+    for (uint32_t i = 0; i < 65536; i++) {
+        if (i < 60000) {
+            svcx_roaring_add(&a, i);
+        }
+        if (i % 20 == 0 || i >= 60000) {
+            svcx_roaring_add(&b, i);
+        }
+    }
+    for (size_t budget = 0; budget < 6; budget++) {
+        test_budget tb = {budget};
+        svcx_roaring small;
+        svcx_roaring_init(&small, test_budget_allocator(&tb));
+        svcx_result r = svcx_roaring_and(&small, &a, &b);
+        assert(r == SVCX_OK || r == SVCX_ROARING_ALLOC_ERR);
+        if (r == SVCX_OK) {
+            assert(svcx_roaring_cardinality(&small) == 3000);
+            assert(svcx_roaring_contains(&small, 40));
+            assert(!svcx_roaring_contains(&small, 41));
+        }
+        svcx_roaring_free(&small);
+    }
+
+    svcx_sb_free(&sb);
+    svcx_roaring_free(&out);
+    svcx_roaring_free(&b);
+    svcx_roaring_free(&a);
+}
+
 int main() {
     test_vector();
+    test_span();
+    test_kernels();
+    test_deque();
+    test_bitset();
     test_string_utils();
+    test_sv_search();
+    test_icase();
+    test_split_iter();
+    test_byteset();
+    test_hash();
+    test_parse();
+    test_format();
+    test_escape();
+    test_encoding();
+    test_utf8();
+    test_template();
+    test_sb_sink();
+    test_gather_builder();
+    test_file();
+    test_line_reader();
+    test_map();
+#ifdef SVCX__HAS_ATOMICS
+    test_cmap();
+#endif
+    test_interner();
+#ifdef SVCX__HAS_ATOMICS
+    test_cinterner();
+#endif
+    test_aho_corasick();
+    test_roaring();
     return 0;
 }
@@ -32,14 +32,37 @@
 //   append the static inline keywords to all functions in the file.
 // - SVCX_DEBUG - If defined, enables assertions inside svcx functions
 //   that validate the data passed into them.
+// - SVCX_NO_SIMD - If defined, disables the SSE2 and AVX2 code paths, so
+//   only the portable scalar implementations are compiled.
+// - SVCX_NO_AVX2 - If defined, disables only the AVX2 code paths, which are
+//   otherwise selected at runtime on CPUs that support them.
 //
 // # Contents
 //
 // This library contains various utilities for C development, such as:
 // - A default allocator
 // - An arena allocator
-// - A vector
+// - A vector and a non-owning span
+// - A deque (ring buffer)
+// - A bitset with rank/select support
+// - SIMD numeric kernels (sum, min/max, dot product, histogram) over spans
 // - A string view (non-owning) and string builder (owning) constructs
+// - Locale-independent integer and float parsing and formatting
+// - UTF-8 validation, code point counting and transcoding
+// - A buffered writer mode of the string builder for large outputs
+// - JSON and CSV escaping and unescaping into the string builder
+// - Hex and base64 encoding and decoding
+// - ASCII case-insensitive comparison and search, and case conversion
+// - Pre-compiled format templates for the string builder
+// - A gather builder that references large slices instead of copying them
+// - Whole-file loading through read-only memory mappings
+// - A streaming line reader with a fixed-size buffer
+// - An Aho-Corasick automaton for multi-pattern search
+// - A fast 64-bit hash for byte ranges and string views
+// - An open addressing hash map with SIMD probing
+// - A sharded concurrent hash map with lock-free reads
+// - A string interner mapping strings to dense ids
+// - A roaring (compressed) bitmap for sets of 32-bit integers
 
 #ifndef SVCXTEND_H
 #define SVCXTEND_H
@@ -56,11 +79,23 @@
 #endif // SVCXDEF
 
 #include <ctype.h>
+#include <float.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// The concurrent map and interner need C11 atomics. GCC leaves
+// __STDC_NO_ATOMICS__ undefined in C99 mode too, so the version is checked.
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L &&                \
+    !defined(__STDC_NO_ATOMICS__)
+#define SVCX__HAS_ATOMICS
+#include <stdatomic.h>
+#endif
+
 #ifndef SVCX_ASSERT
 #ifdef SVCX_DEBUG
 #define SVCX_ASSERT(cond)                                                      \
@@ -105,6 +140,17 @@
     } while (0)
 #define SVCX_ARRAY_LEN(array) (sizeof(array) / sizeof(array[0]))
 
+//
+// Some functions in this library have SSE2 and AVX2 implementations. SSE2
+// is part of every x86-64 CPU and is used whenever the compiler targets it,
+// while the AVX2 implementations are compiled alongside the scalar ones and
+// selected at runtime.
+//
+// The svcx_cpu_has_avx2 function returns true if the AVX2 implementations
+// are compiled in and the CPU running the program supports them.
+//
+SVCXDEF bool svcx_cpu_has_avx2(void);
+
 /*
  * The results returned by SVCX functions.
  *
@@ -128,12 +174,55 @@ typedef enum svcx_result {
     SVCX_VEC_APPEND_STRIDE_ERR,
     SVCX_VEC_APPEND_GROW_ERR,
     SVCX_VEC_FROM_ARR_MALLOC_ERR,
+    SVCX_DEQ_GROW_MEM_ERR,
+    SVCX_DEQ_FIXED_CAP_ERR,
+    SVCX_DEQ_INIT_ALLOC_ERR,
+    SVCX_DEQ_PUSH_GROW_ERR,
+    SVCX_DEQ_POP_EMPTY_ERR,
+    SVCX_BITSET_ALLOC_ERR,
+    SVCX_BITSET_SIZE_MISMATCH_ERR,
+    SVCX_BITSET_RANK_ALLOC_ERR,
+    SVCX_KERNEL_EMPTY_ERR,
+    SVCX_KERNEL_LENGTH_ERR,
     SVCX_SV_SPLIT_ERR,
     SVCX_SB_PUSHC_ERR,
     SVCX_SB_APPEND_ERR,
     SVCX_SB_APPEND_SV_ERR,
     SVCX_SB_FMT_INVALID_ARG_ERR,
-    SVCX_SB_FMT_RESERVE_ERR
+    SVCX_SB_FMT_RESERVE_ERR,
+    SVCX_SB_APPEND_NUM_ERR,
+    SVCX_SB_FLUSH_ERR,
+    SVCX_SB_ESCAPE_RESERVE_ERR,
+    SVCX_SB_UNESCAPE_INVALID_ERR,
+    SVCX_SB_ENCODE_RESERVE_ERR,
+    SVCX_SB_CASE_RESERVE_ERR,
+    SVCX_DECODE_INVALID_ERR,
+    SVCX_DECODE_SPACE_ERR,
+    SVCX_DECODE_ALLOC_ERR,
+    SVCX_TMPL_SYNTAX_ERR,
+    SVCX_TMPL_ALLOC_ERR,
+    SVCX_TMPL_RENDER_ERR,
+    SVCX_GB_ALLOC_ERR,
+    SVCX_GB_WRITE_ERR,
+    SVCX_FILE_OPEN_ERR,
+    SVCX_FILE_READ_ERR,
+    SVCX_FILE_ALLOC_ERR,
+    SVCX_LR_ALLOC_ERR,
+    SVCX_LR_READ_ERR,
+    SVCX_LR_LINE_TOO_LONG_ERR,
+    SVCX_AC_EMPTY_PATTERN_ERR,
+    SVCX_AC_ALLOC_ERR,
+    SVCX_AC_PUSH_ERR,
+    SVCX_MAP_ALLOC_ERR,
+    SVCX_CMAP_ALLOC_ERR,
+    SVCX_INTERNER_ALLOC_ERR,
+    SVCX_PARSE_INVALID_ERR,
+    SVCX_PARSE_RANGE_ERR,
+    SVCX_UTF8_INVALID_ERR,
+    SVCX_UTF8_ALLOC_ERR,
+    SVCX_ROARING_ALLOC_ERR,
+    SVCX_ROARING_SERIALIZE_ERR,
+    SVCX_ROARING_DESERIALIZE_ERR
 } svcx_result;
 
 SVCXDEF const char *svcx_error_string(svcx_result);
@@ -422,6 +511,462 @@ SVCXDEF size_t svcx_vector_size(svcx_vector *v);
         _keep = !_keep, _i++)                                                  \
         for (iter = (a) + _i; _keep; _keep = !_keep)
 
+/*
+ * A span is a non-owning and read-only view of elements stored elsewhere,
+ * such as in a vector, a static array, a memory mapped file or a network
+ * buffer. Creating a span never allocates or copies.
+ *
+ * The stride is the distance in bytes between two consecutive elements. For
+ * contiguous memory it is equal to the element size (same as the stride of
+ * a vector), but it can be larger to view every n-th element, or a single
+ * field in an array of structs. The element size itself is implied by the
+ * code reading the span.
+ */
+typedef struct svcx_span {
+    const void *data;
+    size_t count;
+    size_t stride;
+} svcx_span;
+
+//
+// Functions for working with spans and for moving memory into and out of
+// vectors without copying.
+//
+// The svcx_span_from_parts function constructs a span from a pointer to the
+// first element, the element count and the stride in bytes.
+//
+// The svcx_span_from_vector function returns a span over the elements of the
+// vector. The span is invalidated by any operation that grows the vector.
+//
+// The svcx_span_at function returns a pointer to the element at the given
+// index, or NULL if the index is out of bounds.
+//
+// The svcx_span_subspan function returns a span of count elements starting at
+// the start index, and the svcx_span_slice function returns the elements in
+// the range [start, end). Both are clamped to the bounds of the span.
+//
+// The svcx_span_strided function returns a span of every step-th element,
+// starting with the first one.
+//
+// The svcx_vector_append_span function appends the elements of the span to
+// the vector, with a single memcpy if the span is contiguous. The element
+// size is taken from the vector's stride.
+//
+// The svcx_vector_adopt function initializes a vector that takes ownership of
+// an existing buffer holding count elements with room for cap, without
+// copying it. The buffer must have been allocated by the given allocator,
+// since the vector frees it when it grows or is freed. To run read-only
+// algorithms over memory the vector should not own, use a span instead.
+//
+// Alongside the functions, the SVCX_SPAN_OF_ARRAY macro creates a span over a
+// static array, the SVCX_SPAN_FIELD macro creates a span over a single field
+// of an array of structs, the SVCX_SPAN_AT macro reads an element by value
+// and the foreach_s macro loops over the elements of a span.
+//
+// Example:
+// ```c
+// typedef struct { int id; float score; } entry;
+// entry entries[] = {{1, 0.5f}, {2, 0.25f}, {3, 1.0f}};
+//
+// svcx_span scores = SVCX_SPAN_FIELD(entries, 3, entry, score);
+// float second = SVCX_SPAN_AT(scores, float, 1); // 0.25f
+//
+// int raw[] = {0, 1, 2, 3, 4, 5};
+// svcx_span odd = svcx_span_strided(
+//     svcx_span_slice(SVCX_SPAN_OF_ARRAY(raw), 1, 6), 2); // 1, 3, 5
+//
+// foreach_s(const int *it, odd) {
+//     printf("%d ", *it);
+// }
+//
+// int *buf = malloc(4 * sizeof(int));
+// svcx_vector v;
+// svcx_vector_adopt(&v, buf, 0, 4, sizeof(int), svcx_default_allocator());
+// svcx_vector_append_span(&v, odd);
+// svcx_vector_free(&v); // frees buf
+// ```
+//
+SVCXDEF svcx_span svcx_span_from_parts(
+    const void *data, size_t count, size_t stride);
+SVCXDEF svcx_span svcx_span_from_vector(const svcx_vector *v);
+SVCXDEF const void *svcx_span_at(svcx_span s, size_t index);
+SVCXDEF svcx_span svcx_span_subspan(svcx_span s, size_t start, size_t count);
+SVCXDEF svcx_span svcx_span_slice(svcx_span s, size_t start, size_t end);
+SVCXDEF svcx_span svcx_span_strided(svcx_span s, size_t step);
+SVCXDEF svcx_result svcx_vector_append_span(svcx_vector *dst, svcx_span src);
+SVCXDEF void svcx_vector_adopt(svcx_vector *v,
+    void *data,
+    size_t count,
+    size_t cap,
+    size_t stride,
+    svcx_allocator a);
+
+#define SVCX_SPAN_OF_ARRAY(array)                                              \
+    svcx_span_from_parts((array), SVCX_ARRAY_LEN(array), sizeof((array)[0]))
+
+#define SVCX_SPAN_FIELD(array, count, T, field)                                \
+    svcx_span_from_parts(&(array)[0].field, (count), sizeof(T))
+
+#define SVCX_SPAN_AT(s, T, index) (*(const T *)svcx_span_at((s), (index)))
+
+#define foreach_s(iter, s)                                                     \
+    for (size_t _i = 0, _keep = 1; _keep && _i < (s).count;                    \
+        _keep = !_keep, _i++)                                                  \
+        for (iter = (const void *)((const char *)(s).data + _i * (s).stride); \
+             _keep;                                                            \
+             _keep = !_keep)
+
+//
+// Numeric kernels over spans of int32_t, int64_t, float and double values.
+// To run a kernel over a vector, pass svcx_span_from_vector(&v). Contiguous
+// spans are processed with SSE2 or AVX2 (selected at runtime), while strided
+// spans and the remaining tail elements use the scalar code. The integer dot
+// products and the int64_t minmax and clamp only have AVX2 code, and are
+// scalar on CPUs without it.
+//
+// The svcx_sum_* functions return the sum of the elements. Integer sums are
+// accumulated in 64 bits (wrapping on overflow) and float sums in double
+// precision. The SIMD code adds floating point values in a different order
+// than a plain loop, so the last bits of the result may differ from it.
+//
+// The svcx_minmax_* functions store the smallest and largest element into min
+// and max (either may be NULL). The svcx_argmin_* and svcx_argmax_* functions
+// store the index of the first smallest or largest element. They return an
+// error for empty spans. The results are unspecified if the data contains
+// NaN values.
+//
+// The svcx_dot_* functions compute the dot product of two spans of the same
+// length, with the same accumulation types as the sum functions.
+//
+// The svcx_prefix_sum_* functions write the inclusive prefix sums of the span
+// into out, which must have room for s.count elements and may be equal to
+// s.data. Integer prefix sums wrap on overflow.
+//
+// The svcx_clamp_* functions write every element clamped to [lo, hi] into
+// out, which may also be equal to s.data.
+//
+// The svcx_histogram_* functions count the elements into nbuckets buckets of
+// equal width covering [lo, hi). Elements below lo are counted in the first
+// bucket and elements at or above hi in the last one, while NaN values are
+// skipped. The counts are added to the existing values in counts, so a
+// histogram can be accumulated over multiple spans.
+//
+// Example:
+// ```c
+// svcx_vector v;
+// svcx_vector_init(&v, sizeof(int32_t), svcx_default_allocator());
+// SVCX_VECTOR_PUSH(&v, int32_t, 3);
+// SVCX_VECTOR_PUSH(&v, int32_t, -7);
+// SVCX_VECTOR_PUSH(&v, int32_t, 12);
+//
+// svcx_span s = svcx_span_from_vector(&v);
+// int64_t total = svcx_sum_i32(s); // 8
+//
+// size_t lowest;
+// svcx_argmin_i32(s, &lowest); // 1
+//
+// uint64_t counts[4] = {0};
+// svcx_histogram_i32(s, 0, 16, counts, 4); // {2, 0, 0, 1}
+//
+// svcx_vector_free(&v);
+// ```
+//
+SVCXDEF int64_t svcx_sum_i32(svcx_span s);
+SVCXDEF int64_t svcx_sum_i64(svcx_span s);
+SVCXDEF double svcx_sum_f32(svcx_span s);
+SVCXDEF double svcx_sum_f64(svcx_span s);
+SVCXDEF svcx_result svcx_minmax_i32(svcx_span s, int32_t *min, int32_t *max);
+SVCXDEF svcx_result svcx_minmax_i64(svcx_span s, int64_t *min, int64_t *max);
+SVCXDEF svcx_result svcx_minmax_f32(svcx_span s, float *min, float *max);
+SVCXDEF svcx_result svcx_minmax_f64(svcx_span s, double *min, double *max);
+SVCXDEF svcx_result svcx_argmin_i32(svcx_span s, size_t *index);
+SVCXDEF svcx_result svcx_argmin_i64(svcx_span s, size_t *index);
+SVCXDEF svcx_result svcx_argmin_f32(svcx_span s, size_t *index);
+SVCXDEF svcx_result svcx_argmin_f64(svcx_span s, size_t *index);
+SVCXDEF svcx_result svcx_argmax_i32(svcx_span s, size_t *index);
+SVCXDEF svcx_result svcx_argmax_i64(svcx_span s, size_t *index);
+SVCXDEF svcx_result svcx_argmax_f32(svcx_span s, size_t *index);
+SVCXDEF svcx_result svcx_argmax_f64(svcx_span s, size_t *index);
+SVCXDEF svcx_result svcx_dot_i32(svcx_span a, svcx_span b, int64_t *out);
+SVCXDEF svcx_result svcx_dot_i64(svcx_span a, svcx_span b, int64_t *out);
+SVCXDEF svcx_result svcx_dot_f32(svcx_span a, svcx_span b, double *out);
+SVCXDEF svcx_result svcx_dot_f64(svcx_span a, svcx_span b, double *out);
+SVCXDEF void svcx_prefix_sum_i32(svcx_span s, int32_t *out);
+SVCXDEF void svcx_prefix_sum_i64(svcx_span s, int64_t *out);
+SVCXDEF void svcx_prefix_sum_f32(svcx_span s, float *out);
+SVCXDEF void svcx_prefix_sum_f64(svcx_span s, double *out);
+SVCXDEF void svcx_clamp_i32(svcx_span s, int32_t lo, int32_t hi, int32_t *out);
+SVCXDEF void svcx_clamp_i64(svcx_span s, int64_t lo, int64_t hi, int64_t *out);
+SVCXDEF void svcx_clamp_f32(svcx_span s, float lo, float hi, float *out);
+SVCXDEF void svcx_clamp_f64(svcx_span s, double lo, double hi, double *out);
+SVCXDEF void svcx_histogram_i32(svcx_span s,
+    int32_t lo,
+    int32_t hi,
+    uint64_t *counts,
+    size_t nbuckets);
+SVCXDEF void svcx_histogram_i64(svcx_span s,
+    int64_t lo,
+    int64_t hi,
+    uint64_t *counts,
+    size_t nbuckets);
+SVCXDEF void svcx_histogram_f32(
+    svcx_span s, float lo, float hi, uint64_t *counts, size_t nbuckets);
+SVCXDEF void svcx_histogram_f64(
+    svcx_span s, double lo, double hi, uint64_t *counts, size_t nbuckets);
+
+/*
+ * A deque (double-ended queue) is a ring buffer that holds data of arbitrary
+ * types and supports constant time pushes and pops at both of its ends. The
+ * capacity of the deque is always a power of two, so the ring indices can be
+ * wrapped with a mask instead of a division.
+ *
+ * Same as the vector, it uses it's own allocator to handle memory and only
+ * needs the svcx_alloc and svcx_free functions. A deque can also be created
+ * with a fixed capacity, in which case it never grows and pushing into a full
+ * deque overwrites the element at the opposite end. This is useful for bounded
+ * buffers, such as keeping only the last N telemetry samples.
+ */
+typedef struct svcx_deque {
+    void *data;
+    size_t head;
+    size_t size;
+    size_t cap;
+    size_t stride;
+    bool fixed;
+    svcx_allocator a;
+} svcx_deque;
+
+/*
+ * An internal deque grow operation. Should not be used by user code as it
+ * may cause undefined behavior. To interact with the deque, use the functions
+ * in the block below.
+ */
+SVCXDEF svcx_result _svcx_deque_grow(svcx_deque *d, size_t min_cap);
+
+//
+// Functions for manipulating a deque.
+//
+// The svcx_deque_init function initializes the given deque with the provided
+// allocator and stride (size of the stored data type). The deque grows on
+// demand.
+//
+// The svcx_deque_init_fixed function initializes a fixed-capacity deque in
+// overwrite mode. The capacity is rounded up to the next power of two and
+// allocated immediately. Pushing into a full fixed deque drops the element at
+// the other end (push_back drops the front, push_front drops the back).
+//
+// The svcx_deque_clear function resets the deque's size count to 0.
+//
+// The svcx_deque_reserve function attempts to reserve space for at least
+// min_cap elements. Reserving past the capacity of a fixed deque fails.
+//
+// The svcx_deque_push_back and svcx_deque_push_front functions add the element
+// pointed to by elem to the back/front of the deque. The SVCX_DEQUE_PUSH_BACK
+// and SVCX_DEQUE_PUSH_FRONT macros allow the user to pass in actual values.
+//
+// The svcx_deque_pop_back and svcx_deque_pop_front functions remove the
+// element at the back/front of the deque and return it in the out_elem
+// pointer, if it is not NULL.
+//
+// The svcx_deque_at function returns a pointer to the element at the given
+// logical index (0 is the front), or NULL if the index is out of bounds. The
+// svcx_deque_front and svcx_deque_back functions are shorthands for the first
+// and last element.
+//
+// The svcx_deque_spans function returns the contents of the deque as (at most)
+// two contiguous spans of memory, in order. The second span is empty when the
+// contents do not wrap around the end of the buffer. This allows bulk copies
+// with two memcpy calls instead of per element access.
+//
+// The svcx_deque_push_back_n function pushes count elements from the given
+// array to the back of the deque using at most two memcpy calls. In a fixed
+// deque, the oldest elements are overwritten, and if count is larger than the
+// capacity, only the last elements of the array are kept.
+//
+// The svcx_deque_pop_front_n function pops up to max_count elements from the
+// front of the deque into the out array (which may be NULL to discard them)
+// and returns the number of elements popped.
+//
+// The svcx_deque_free function frees the memory of the deque and zeroes out
+// it's data fields.
+//
+// The svcx_deque_size function returns the number of elements in the deque.
+//
+// Example:
+// ```c
+// svcx_deque q;
+// svcx_deque_init(&q, sizeof(int), svcx_default_allocator());
+//
+// SVCX_DEQUE_PUSH_BACK(&q, int, 1);
+// SVCX_DEQUE_PUSH_BACK(&q, int, 2);
+// SVCX_DEQUE_PUSH_FRONT(&q, int, 0);
+//
+// int val;
+// svcx_deque_pop_front(&q, &val); // val == 0
+//
+// svcx_deque ring;
+// svcx_deque_init_fixed(&ring, sizeof(int), 4, svcx_default_allocator());
+// for (int i = 0; i < 10; i++) {
+//     SVCX_DEQUE_PUSH_BACK(&ring, int, i); // ring holds 6, 7, 8, 9
+// }
+//
+// svcx_deque_free(&ring);
+// svcx_deque_free(&q);
+// ```
+//
+SVCXDEF void svcx_deque_init(svcx_deque *d, size_t stride, svcx_allocator a);
+SVCXDEF svcx_result svcx_deque_init_fixed(
+    svcx_deque *d, size_t stride, size_t cap, svcx_allocator a);
+SVCXDEF void svcx_deque_clear(svcx_deque *d);
+SVCXDEF svcx_result svcx_deque_reserve(svcx_deque *d, size_t min_cap);
+SVCXDEF svcx_result svcx_deque_push_back(svcx_deque *d, const void *elem);
+SVCXDEF svcx_result svcx_deque_push_front(svcx_deque *d, const void *elem);
+SVCXDEF svcx_result svcx_deque_pop_back(svcx_deque *d, void *out_elem);
+SVCXDEF svcx_result svcx_deque_pop_front(svcx_deque *d, void *out_elem);
+SVCXDEF void *svcx_deque_at(svcx_deque *d, size_t index);
+SVCXDEF void *svcx_deque_front(svcx_deque *d);
+SVCXDEF void *svcx_deque_back(svcx_deque *d);
+SVCXDEF void svcx_deque_spans(svcx_deque *d,
+    void **first,
+    size_t *first_count,
+    void **second,
+    size_t *second_count);
+SVCXDEF svcx_result svcx_deque_push_back_n(
+    svcx_deque *d, const void *elems, size_t count);
+SVCXDEF size_t svcx_deque_pop_front_n(
+    svcx_deque *d, void *out, size_t max_count);
+SVCXDEF void svcx_deque_free(svcx_deque *d);
+SVCXDEF size_t svcx_deque_size(svcx_deque *d);
+
+#define SVCX_DEQUE_PUSH_BACK(d, T, value)                                      \
+    do {                                                                       \
+        T tmp = (value);                                                       \
+        svcx_deque_push_back((d), &tmp);                                       \
+    } while (0)
+
+#define SVCX_DEQUE_PUSH_FRONT(d, T, value)                                     \
+    do {                                                                       \
+        T tmp = (value);                                                       \
+        svcx_deque_push_front((d), &tmp);                                      \
+    } while (0)
+
+/*
+ * A bitset is a fixed-size, packed array of bits stored in 64-bit words. It
+ * uses 8 times less memory than an array of bool values and allows combining
+ * whole sets with word-at-a-time (and SIMD, where available) boolean
+ * operations.
+ *
+ * The bits past nbits in the last word are always kept at zero, so counting
+ * and iteration never have to mask them out.
+ *
+ * Rank and select queries can be accelerated by building a small auxiliary
+ * index with svcx_bitset_build_rank. The index stores a 64-bit count for every
+ * 4096 bits and a 16-bit count for every 512 bits (under 5% of the bitset's
+ * size). Any modification of the bitset invalidates the index, after which
+ * rank and select fall back to scanning the words until it is rebuilt.
+ */
+typedef struct svcx_bitset {
+    uint64_t *words;
+    size_t nbits;
+    size_t nwords;
+    uint64_t *rank_super;
+    uint16_t *rank_sub;
+    size_t rank_ones;
+    bool rank_valid;
+    svcx_allocator a;
+} svcx_bitset;
+
+/*
+ * An iterator over the set bits of a bitset. It holds a copy of the word being
+ * scanned, from which the set bits are extracted with a count trailing zeros
+ * instruction, so sparse bitsets are iterated without testing every bit.
+ */
+typedef struct svcx_bitset_iter {
+    const uint64_t *words;
+    size_t nwords;
+    size_t index;
+    uint64_t word;
+} svcx_bitset_iter;
+
+//
+// Functions for working with a bitset.
+//
+// The svcx_bitset_init function allocates a bitset of nbits bits, all set to
+// zero, using the provided allocator.
+//
+// The svcx_bitset_from_bools function initializes a bitset from an array of
+// count bool values, such as the data of a svcx_vector of bools.
+//
+// The svcx_bitset_free function frees the memory of the bitset and its rank
+// index.
+//
+// The svcx_bitset_set, svcx_bitset_reset and svcx_bitset_flip functions set,
+// clear and toggle the bit at the given index, while the svcx_bitset_test
+// function returns its value.
+//
+// The svcx_bitset_set_all and svcx_bitset_reset_all functions set or clear
+// all of the bits in the bitset.
+//
+// The svcx_bitset_count function returns the number of set bits, using the
+// hardware population count where available.
+//
+// The svcx_bitset_and, svcx_bitset_or, svcx_bitset_xor and svcx_bitset_andnot
+// functions combine src into dst in place (dst = dst OP src, with andnot
+// computing dst & ~src). Both bitsets must have the same number of bits.
+//
+// The svcx_bitset_build_rank function (re)builds the rank/select index.
+//
+// The svcx_bitset_rank function returns the number of set bits in the range
+// [0, pos). The svcx_bitset_select function finds the position of the set bit
+// with the given 0-based rank k and returns false if there are not enough set
+// bits.
+//
+// The svcx_bitset_iter_init and svcx_bitset_iter_next functions iterate over
+// the positions of the set bits in increasing order.
+//
+// Example:
+// ```c
+// svcx_bitset mask;
+// svcx_bitset_init(&mask, 1000, svcx_default_allocator());
+// svcx_bitset_set(&mask, 3);
+// svcx_bitset_set(&mask, 700);
+//
+// svcx_bitset_build_rank(&mask);
+// size_t before = svcx_bitset_rank(&mask, 700); // 1
+//
+// svcx_bitset_iter it;
+// svcx_bitset_iter_init(&it, &mask);
+// size_t pos;
+// while (svcx_bitset_iter_next(&it, &pos)) {
+//     printf("%zu\n", pos); // 3, 700
+// }
+//
+// svcx_bitset_free(&mask);
+// ```
+//
+SVCXDEF svcx_result svcx_bitset_init(
+    svcx_bitset *b, size_t nbits, svcx_allocator a);
+SVCXDEF svcx_result svcx_bitset_from_bools(
+    svcx_bitset *b, const bool *flags, size_t count, svcx_allocator a);
+SVCXDEF void svcx_bitset_free(svcx_bitset *b);
+SVCXDEF void svcx_bitset_set(svcx_bitset *b, size_t index);
+SVCXDEF void svcx_bitset_reset(svcx_bitset *b, size_t index);
+SVCXDEF void svcx_bitset_flip(svcx_bitset *b, size_t index);
+SVCXDEF bool svcx_bitset_test(const svcx_bitset *b, size_t index);
+SVCXDEF void svcx_bitset_set_all(svcx_bitset *b);
+SVCXDEF void svcx_bitset_reset_all(svcx_bitset *b);
+SVCXDEF size_t svcx_bitset_count(const svcx_bitset *b);
+SVCXDEF svcx_result svcx_bitset_and(svcx_bitset *dst, const svcx_bitset *src);
+SVCXDEF svcx_result svcx_bitset_or(svcx_bitset *dst, const svcx_bitset *src);
+SVCXDEF svcx_result svcx_bitset_xor(svcx_bitset *dst, const svcx_bitset *src);
+SVCXDEF svcx_result svcx_bitset_andnot(
+    svcx_bitset *dst, const svcx_bitset *src);
+SVCXDEF svcx_result svcx_bitset_build_rank(svcx_bitset *b);
+SVCXDEF size_t svcx_bitset_rank(const svcx_bitset *b, size_t pos);
+SVCXDEF bool svcx_bitset_select(const svcx_bitset *b, size_t k, size_t *pos);
+SVCXDEF void svcx_bitset_iter_init(svcx_bitset_iter *it, const svcx_bitset *b);
+SVCXDEF bool svcx_bitset_iter_next(svcx_bitset_iter *it, size_t *pos);
+
 /*
  * A string view is a non-owning and immutable data structure for representing
  * strings of characters. The value of the string view can refer to string
@@ -453,12 +998,21 @@ typedef struct svcx_string_view {
 // character of needle in the haystack. If the function could not find
 // the needle in the haystack, -1 is returned.
 //
+// The svcx_sv_find_from function works like svcx_sv_find, but starts the
+// search at the given index, which allows looping over all occurrences
+// without re-slicing the haystack. The svcx_sv_rfind function returns the
+// index of the last occurrence of the needle instead (or the length of the
+// haystack for an empty needle). Short needles are searched for with SIMD
+// and long ones with the Two-Way algorithm, which runs in linear time even on
+// inputs like "aaaa...ab".
+//
 // The svcx_sv_starts_with and svcx_sv_ends_with functions check if the
 // string view starts or ends with the given prefix/suffix - if yes, the
 // functions return true, and false otherwise.
 //
 // The svcx_sv_trim_start and svcx_trim_end functions trim the whitespace from
 // string view from the beginning/end respectively, returning a new string view.
+// Whitespace is the set returned by svcx_byteset_whitespace, described below.
 //
 // The svcx_sv_split function splits the string view based on the provided
 // delimiter and returns the different string views in the out vector. The
@@ -511,6 +1065,10 @@ SVCXDEF svcx_string_view svcx_sv_from_cstr(const char *data);
 SVCXDEF bool svcx_sv_contains(
     svcx_string_view haystack, svcx_string_view needle);
 SVCXDEF size_t svcx_sv_find(svcx_string_view haystack, svcx_string_view needle);
+SVCXDEF size_t svcx_sv_find_from(
+    svcx_string_view haystack, svcx_string_view needle, size_t start);
+SVCXDEF size_t svcx_sv_rfind(
+    svcx_string_view haystack, svcx_string_view needle);
 SVCXDEF bool svcx_sv_starts_with(svcx_string_view sv, svcx_string_view prefix);
 SVCXDEF bool svcx_sv_ends_with(svcx_string_view sv, svcx_string_view suffix);
 SVCXDEF svcx_string_view svcx_sv_trim_start(svcx_string_view sv);
@@ -523,116 +1081,1566 @@ SVCXDEF svcx_string_view svcx_sv_substring(
 
 #define SVCX_SV(lit) ((svcx_string_view){(lit), sizeof(lit) - 1})
 
+typedef enum svcx_split_kind {
+    SVCX_SPLIT_CHAR,
+    SVCX_SPLIT_STR,
+    SVCX_SPLIT_ANY,
+    SVCX_SPLIT_WHITESPACE,
+} svcx_split_kind;
+
 /*
- * A string builder is an owning and mutable data structure for dynamically
- * creating strings of characters, but it does not provide Unicode semantics.
- * The string builder is built on top of the svcx_vector and is thus arena
- * friendly.
+ * A split iterator produces the parts of a string view one at a time,
+ * without allocating or copying. The tokens point into the original string
+ * view, which has to outlive the iterator.
  */
-typedef struct svcx_string_builder {
-    svcx_vector buf;
-} svcx_string_builder;
+typedef struct svcx_split_iter {
+    svcx_string_view rest;
+    svcx_string_view delim;
+    char ch;
+    uint8_t kind;
+    bool done;
+} svcx_split_iter;
 
 //
-// Functions for manipulating a string builder.
+// Functions for lazily splitting a string view.
 //
-// The svcx_sb_init function initializes the string builder with the given
-// allocator.
+// The svcx_sv_split_init function prepares an iterator that splits on a
+// single character, svcx_sv_split_str_init on a (non-empty) string and
+// svcx_sv_split_any_init on any of the characters in a set. These produce
+// the same parts as svcx_sv_split, including empty parts between adjacent
+// delimiters, so n delimiters always give n + 1 parts.
 //
-// The svcx_sb_clear function clears the data inside the string builder by
-// clearing the buffer vector. This allows the string builder to be reused
-// as the memory remains allocated.
+// The svcx_sv_split_ws_init function prepares an iterator that splits on runs
+// of whitespace (' ', '\t', '\n', '\v', '\f' and '\r') and never produces
+// empty parts.
 //
-// The svcx_sb_free function frees the memory held by the string builder,
-// rendering it unusable in the future. The free function depends on the
-// provided allocator, making it a no-op for arenas.
+// The svcx_sv_split_next function stores the next part into token and
+// returns true, or returns false once all parts have been produced. The
+// delimiters are found with memchr, SIMD or svcx_sv_find_from, so even long
+// tokens are scanned in wide chunks.
 //
-// The svcx_sb_push_char function pushes the given character to the end
-// of the string builder.
+// Example:
+// ```c
+// svcx_split_iter it;
+// svcx_string_view token;
 //
-// The svcx_sb_append function appends the given C string to the string
-// builder. This is a manual function, meaning the size must be provided
-// by the user, thus the next function will be more commonly used.
+// svcx_sv_split_init(&it, SVCX_SV("a,b,,c"), ',');
+// while (svcx_sv_split_next(&it, &token)) {
+//     printf("[%.*s]", (int)token.len, token.data); // [a][b][][c]
+// }
 //
-// The svcx_sb_append_cstr function appends the given C string to the
-// string builder, automatically calculating the length. It is a wrapper
-// around the svcx_sb_append function.
+// svcx_sv_split_ws_init(&it, SVCX_SV("  GET  /index.html\r\n"));
+// while (svcx_sv_split_next(&it, &token)) {
+//     printf("[%.*s]", (int)token.len, token.data); // [GET][/index.html]
+// }
+// ```
 //
-// The svcx_sb_append_sv function appends the string represented by the
-// given string view to the string builder.
+SVCXDEF void svcx_sv_split_init(
+    svcx_split_iter *it, svcx_string_view sv, char delimiter);
+SVCXDEF void svcx_sv_split_str_init(
+    svcx_split_iter *it, svcx_string_view sv, svcx_string_view delimiter);
+SVCXDEF void svcx_sv_split_any_init(
+    svcx_split_iter *it, svcx_string_view sv, svcx_string_view set);
+SVCXDEF void svcx_sv_split_ws_init(svcx_split_iter *it, svcx_string_view sv);
+SVCXDEF bool svcx_sv_split_next(svcx_split_iter *it, svcx_string_view *token);
+
+/*
+ * A byte set is a precomputed set of byte values used for classifying
+ * characters, for example the delimiters of a tokenizer. It is built once
+ * and can then be used for any number of scans.
+ *
+ * Alongside the 256-entry membership table, the set stores two 16-entry
+ * nibble tables that let the AVX2 code classify 32 bytes at once with the
+ * vpshufb instruction: bit h of nibbles[h / 8][lo] is set if the byte
+ * (h << 4) | lo is a member, with h taken modulo 8.
+ */
+typedef struct svcx_byteset {
+    bool table[256];
+    uint8_t nibbles[2][16];
+} svcx_byteset;
+
 //
-// The svcx_sb_append_fmt function is a variadic function, meaning it
-// allows for an arbitrary number of parameters, and essentially acts
-// as C's printf() function, allowing the user to specify a format
-// string and parameters from which to construct the string to be
-// appended to the string builder.
+// Functions for character-class scanning.
 //
-// The svcx_sb_cstr function returns a null-terminated view (C string)
-// from the string builder's buffer. The returned string is valid until
-// the next append or clear, and arena backed strings live as long as
-// the arena.
+// The svcx_byteset_init function initializes a byte set containing the bytes
+// of the given string view, svcx_byteset_add adds a single byte to it and
+// svcx_byteset_contains checks if a byte is a member. The
+// svcx_byteset_whitespace function returns a shared, locale-independent set
+// of the ASCII whitespace characters (' ', '\t', '\n', '\v', '\f', '\r').
 //
-// The svcx_sb_build function finalizes the string builder, essentially
-// transfering ownership of the data to the returned pointer. The function
-// returns the string constructed by the string builder. After calling this
-// function, the string builder should not be used again.
+// The svcx_sv_find_first_of function returns the index of the first byte of
+// the string view that is in the set, and svcx_sv_find_first_not_of the index
+// of the first byte that is not. Both return -1 if there is no such byte.
 //
-// The svcx_sb_view function returns a non-owning string view of the data
-// contained within the string builder.
+// The svcx_sv_span function returns the length of the longest prefix made only
+// of bytes in the set, and svcx_sv_cspan the length of the longest prefix made
+// only of bytes not in the set (like strspn and strcspn).
 //
-// Alongside these functions, a SVCX_SB_APPEND_LIT macro is provided, which
-// increases ergonomics of appending to the string builder.
+// The svcx_sv_trim_set function trims the bytes in the set from both ends of
+// the string view. The svcx_sv_trim family uses it with the whitespace set, so
+// it no longer depends on the current locale.
 //
-// Example: An example of string builder functions is provided in the
-// string view example, as they work in tandem.
+// Scans over the shared whitespace set run with SSE2 or AVX2, and scans over
+// other sets use an AVX2 nibble lookup, or the table on CPUs without AVX2.
 //
+// Example:
+// ```c
+// svcx_byteset delims;
+// svcx_byteset_init(&delims, SVCX_SV(" ,;"));
 //
-SVCXDEF void svcx_sb_init(svcx_string_builder *sb, svcx_allocator a);
-SVCXDEF void svcx_sb_clear(svcx_string_builder *sb);
-SVCXDEF void svcx_sb_free(svcx_string_builder *sb);
-SVCXDEF svcx_result svcx_sb_push_char(svcx_string_builder *sb, char c);
-SVCXDEF svcx_result svcx_sb_append(
-    svcx_string_builder *sb, const char *str, size_t len);
-SVCXDEF svcx_result svcx_sb_append_cstr(
-    svcx_string_builder *sb, const char *cstr);
-SVCXDEF svcx_result svcx_sb_append_sv(
-    svcx_string_builder *sb, svcx_string_view sv);
-SVCXDEF svcx_result svcx_sb_append_fmt(
-    svcx_string_builder *sb, const char *fmt, ...);
-SVCXDEF const char *svcx_sb_cstr(svcx_string_builder *sb);
-SVCXDEF char *svcx_sb_build(svcx_string_builder *sb);
-SVCXDEF svcx_string_view svcx_sb_view(svcx_string_builder *sb);
+// svcx_string_view line = SVCX_SV("alpha, beta;gamma");
+// size_t word = svcx_sv_cspan(line, &delims); // 5
+// size_t comma = svcx_sv_find_first_of(line, &delims); // 5
+// size_t beta = svcx_sv_find_first_not_of(
+//     svcx_sv_substring(line, word, line.len), &delims); // 2
+//
+// svcx_byteset dashes;
+// svcx_byteset_init(&dashes, SVCX_SV("-"));
+// svcx_string_view x = svcx_sv_trim_set(SVCX_SV("--x--"), &dashes); // "x"
+// ```
+//
+SVCXDEF void svcx_byteset_init(svcx_byteset *set, svcx_string_view chars);
+SVCXDEF void svcx_byteset_add(svcx_byteset *set, unsigned char c);
+SVCXDEF bool svcx_byteset_contains(const svcx_byteset *set, unsigned char c);
+SVCXDEF const svcx_byteset *svcx_byteset_whitespace(void);
+SVCXDEF size_t svcx_sv_find_first_of(
+    svcx_string_view sv, const svcx_byteset *set);
+SVCXDEF size_t svcx_sv_find_first_not_of(
+    svcx_string_view sv, const svcx_byteset *set);
+SVCXDEF size_t svcx_sv_span(svcx_string_view sv, const svcx_byteset *set);
+SVCXDEF size_t svcx_sv_cspan(svcx_string_view sv, const svcx_byteset *set);
+SVCXDEF svcx_string_view svcx_sv_trim_set(
+    svcx_string_view sv, const svcx_byteset *set);
 
-#define SVCX_SB_APPEND_LIT(sb, lit) svcx_sb_append_sv((sb), SVCX_SV(lit))
+//
+// Functions for parsing numbers from string views.
+//
+// The svcx_sv_parse_u64, svcx_sv_parse_i64 and svcx_sv_parse_f64 functions
+// parse a number from the start of the string view into value, and store the
+// number of bytes it took into len (which can be NULL). Parsing stops at the
+// first byte that cannot continue the number, so the view does not need to
+// end after it. Unlike strtol and strtod, leading whitespace is not skipped
+// and the current locale is never used.
+//
+// The integer functions accept decimal digits, with an optional '+' or '-'
+// sign for svcx_sv_parse_i64 and an optional '+' for svcx_sv_parse_u64. The
+// float function accepts decimal numbers in the form of strtod (an optional
+// sign, digits with an optional '.', and an optional exponent), as well as
+// "inf", "infinity" and "nan" in any case. The result is correctly rounded.
+//
+// The functions return SVCX_PARSE_INVALID_ERR if the view does not start
+// with a number, and SVCX_PARSE_RANGE_ERR if the number does not fit into
+// the type, in which case value is set to the closest representable value
+// (infinity for floats) and len still covers the whole number.
+//
+// Example:
+// ```c
+// svcx_string_view line = SVCX_SV("42 -7 3.25e2");
+// uint64_t a;
+// int64_t b;
+// double c;
+// size_t len;
+// svcx_sv_parse_u64(line, &a, &len); // a == 42, len == 2
+// line = svcx_sv_substring(line, len + 1, line.len);
+// svcx_sv_parse_i64(line, &b, &len); // b == -7, len == 2
+// line = svcx_sv_substring(line, len + 1, line.len);
+// svcx_sv_parse_f64(line, &c, &len); // c == 325.0, len == 6
+// ```
+//
+SVCXDEF svcx_result svcx_sv_parse_u64(
+    svcx_string_view sv, uint64_t *value, size_t *len);
+SVCXDEF svcx_result svcx_sv_parse_i64(
+    svcx_string_view sv, int64_t *value, size_t *len);
+SVCXDEF svcx_result svcx_sv_parse_f64(
+    svcx_string_view sv, double *value, size_t *len);
 
-#ifdef SVCX_IMPLEMENTATION
+//
+// Functions for working with UTF-8 in string views.
+//
+// The svcx_utf8_validate function returns whether the string view holds
+// well-formed UTF-8 (no overlong forms, surrogates, code points above
+// U+10FFFF, or cut short sequences), and stores the length of its longest
+// valid prefix in valid_len (which can be NULL), so the offset of the first
+// bad byte is known.
+//
+// The svcx_utf8_count function returns the number of code points in the
+// string view. The svcx_utf8_index function returns the index of the code
+// point that starts at byte offset (the number of code points starting
+// before it), and the svcx_utf8_offset function goes the other way,
+// returning the byte offset where the code point with the given index
+// starts, or sv.len if there are not that many code points. These three
+// functions assume the input is valid.
+//
+// The svcx_utf8_to_utf16 and svcx_utf8_to_utf32 functions validate the
+// string view and append its code points to a vector of uint16_t (with
+// surrogate pairs above U+FFFF) or uint32_t. They return
+// SVCX_UTF8_INVALID_ERR for malformed input, appending nothing.
+//
+// Validation runs on 32 bytes at a time with AVX2, using the lookup table
+// algorithm of John Keiser and Daniel Lemire, counting runs on whole blocks
+// with SIMD. Transcoding decodes 16 bytes at a time with SIMD, and blocks
+// with 4-byte sequences (such as emoji) 8 bytes at a time with AVX2. Without
+// AVX2, each 4-byte sequence is decoded on its own by scalar code, so text
+// full of them transcodes at scalar speed.
+//
+// Example:
+// ```c
+// svcx_string_view s = SVCX_SV("na\xc3\xafve \xf0\x9f\x8d\x95");
+// size_t valid_len;
+// svcx_utf8_validate(s, &valid_len); // true, valid_len == s.len
+// svcx_utf8_count(s); // 7
+// svcx_utf8_offset(s, 3); // 4, the byte offset of 'v'
+//
+// svcx_vector units;
+// svcx_vector_init(&units, sizeof(uint16_t), svcx_default_allocator());
+// svcx_utf8_to_utf16(s, &units); // 8 units, the last two a surrogate pair
+// ```
+//
+SVCXDEF bool svcx_utf8_validate(svcx_string_view sv, size_t *valid_len);
+SVCXDEF size_t svcx_utf8_count(svcx_string_view sv);
+SVCXDEF size_t svcx_utf8_index(svcx_string_view sv, size_t offset);
+SVCXDEF size_t svcx_utf8_offset(svcx_string_view sv, size_t index);
+SVCXDEF svcx_result svcx_utf8_to_utf16(svcx_string_view sv, svcx_vector *out);
+SVCXDEF svcx_result svcx_utf8_to_utf32(svcx_string_view sv, svcx_vector *out);
 
-SVCXDEF const char *svcx_error_string(svcx_result r) {
-    switch (r) {
-    case SVCX_OK:
-        return "no error";
-    case SVCX_VEC_GROW_MEM_ERR:
-        return "vector grow could not allocate memory";
-    case SVCX_VEC_ERR_OOM:
-        return "vector reserve out of memory";
-    case SVCX_VEC_PUSH_GROW_ERR:
-        return "vector push could not grow vector";
-    case SVCX_VEC_POP_EMPTY_ERR:
-        return "vector is empty on pop";
-    case SVCX_VEC_INSERT_OOB:
-        return "index out of bounds on vector insert";
-    case SVCX_VEC_INSERT_GROW_ERR:
-        return "vector insert could not grow memory";
-    case SVCX_VEC_APPEND_STRIDE_ERR:
-        return "vectors differ in stride values on append";
-    case SVCX_VEC_APPEND_GROW_ERR:
-        return "vector append could not grow vector";
-    case SVCX_VEC_FROM_ARR_MALLOC_ERR:
-        return "vector from array could not malloc memory";
-    case SVCX_SV_SPLIT_ERR:
-        return "string view split could not push to output vector";
-    case SVCX_SB_PUSHC_ERR:
-        return "string builder could not push char to internal vector";
+/*
+ * A hasher computes the same 64-bit hash as svcx_hash_bytes over data that
+ * is fed to it in pieces, for example a key assembled from several fields or
+ * a file read in chunks. It keeps the last 16 bytes it has processed, since
+ * the final block of the hash may overlap them.
+ */
+typedef struct svcx_hasher {
+    uint64_t seed;
+    uint64_t see1;
+    uint64_t see2;
+    size_t total;
+    size_t buffered;
+    bool striped;
+    uint8_t buf[16 + 48];
+} svcx_hasher;
+
+//
+// Fast non-cryptographic hashing, using the construction of wyhash. The
+// hashes are well distributed in all bits, so they can be used directly for
+// hash tables, bloom filters and deduplication, but they do not protect
+// against attackers who can choose the keys and see the hash values.
+//
+// The svcx_hash_bytes function hashes a range of bytes and svcx_hash_sv a
+// string view. Different seeds give independent hash functions. The hashes
+// are the same on every platform.
+//
+// The svcx_hasher_init, svcx_hasher_update and svcx_hasher_final functions
+// hash data that arrives in pieces. The result only depends on the
+// concatenation of the pieces, and matches svcx_hash_bytes over it.
+//
+// The svcx_hash_sv_batch function stores the hashes of count string views
+// into out. It is faster than hashing them one by one, especially when the
+// keys are scattered over memory: the seed setup is shared, the data of the
+// upcoming keys is prefetched and short keys are hashed four at a time.
+//
+// Example:
+// ```c
+// uint64_t h1 = svcx_hash_sv(SVCX_SV("hello world"), 0);
+//
+// svcx_hasher h;
+// svcx_hasher_init(&h, 0);
+// svcx_hasher_update(&h, "hello", 5);
+// svcx_hasher_update(&h, " world", 6);
+// assert(svcx_hasher_final(&h) == h1);
+//
+// svcx_string_view keys[] = {SVCX_SV("a"), SVCX_SV("b"), SVCX_SV("c")};
+// uint64_t hashes[3];
+// svcx_hash_sv_batch(keys, 3, 0, hashes);
+// ```
+//
+SVCXDEF uint64_t svcx_hash_bytes(const void *data, size_t len, uint64_t seed);
+SVCXDEF uint64_t svcx_hash_sv(svcx_string_view sv, uint64_t seed);
+SVCXDEF void svcx_hasher_init(svcx_hasher *h, uint64_t seed);
+SVCXDEF void svcx_hasher_update(svcx_hasher *h, const void *data, size_t len);
+SVCXDEF uint64_t svcx_hasher_final(const svcx_hasher *h);
+SVCXDEF void svcx_hash_sv_batch(const svcx_string_view *svs,
+    size_t count,
+    uint64_t seed,
+    uint64_t *out);
+
+typedef uint64_t (*svcx_map_hash_fn)(
+    const void *key, size_t key_size, uint64_t seed);
+typedef bool (*svcx_map_eq_fn)(const void *a, const void *b, size_t key_size);
+
+/*
+ * A map is an open addressing hash table that maps keys to values of fixed
+ * sizes, similar to how a vector stores elements of a fixed stride. It
+ * follows the design of the Swiss tables from Abseil: next to the slots it
+ * keeps one control byte per slot, holding 7 bits of the hash of the key in
+ * that slot or a marker for empty and deleted slots. A lookup compares the
+ * control bytes of 16 slots at once (with SSE2), and only looks at the keys
+ * whose hash bits match.
+ *
+ * Keys and values are copied into the slots. A key is laid out first in its
+ * slot, followed by the value, which is aligned based on its size. The map
+ * grows when it is 7/8 full, and all of its memory (one block per table)
+ * comes from the allocator.
+ *
+ * The seed is mixed into every hash. It is 0 after initialization, and can be
+ * set to another value (for example a random one) while the map is empty.
+ */
+typedef struct svcx_map {
+    uint8_t *ctrl;
+    char *slots;
+    size_t cap;
+    size_t size;
+    size_t growth_left;
+    size_t key_size;
+    size_t value_size;
+    size_t value_offset;
+    size_t slot_size;
+    svcx_map_hash_fn hash;
+    svcx_map_eq_fn eq;
+    uint64_t seed;
+    svcx_allocator a;
+} svcx_map;
+
+typedef struct svcx_map_iter {
+    const svcx_map *m;
+    size_t index;
+} svcx_map_iter;
+
+//
+// Functions for working with a map.
+//
+// The svcx_map_init function initializes a map whose keys are compared and
+// hashed byte by byte, which suits integers and structs without padding. The
+// svcx_map_init_sv function initializes a map with svcx_string_view keys,
+// which are compared and hashed by their contents. The map only stores the
+// views, so the characters must outlive it. The svcx_map_init_custom
+// function takes the hash and equality functions to use. No memory is
+// allocated until the first insertion.
+//
+// The svcx_map_free function frees the memory of the map, and svcx_map_clear
+// removes all entries while keeping the memory.
+//
+// The svcx_map_reserve function makes room for count entries in total, so
+// that inserting them will not rehash. The svcx_map_rehash function rebuilds
+// the table with room for at least count entries (and the current ones),
+// which also drops the markers left behind by removals.
+//
+// The svcx_map_get function returns a pointer to the value stored for the key,
+// or NULL if the key is not in the map. The pointer is valid until the next
+// insertion. The svcx_map_contains function checks if the key is in the map.
+//
+// The svcx_map_insert function inserts the key with the value, or overwrites
+// the value if the key is already present. The svcx_map_get_or_insert function
+// stores a pointer to the value of the key into value, inserting the key with
+// a zeroed value first if needed, and reports which happened in inserted
+// (which can be NULL).
+//
+// The svcx_map_remove function removes the key and returns true if it was
+// present. The slot is marked as deleted only if a lookup may have probed
+// past it while it was full; otherwise it becomes empty again, so maps that
+// see many removals do not fill up with tombstones.
+//
+// The svcx_map_iter_init and svcx_map_iter_next functions iterate over the
+// entries in an unspecified order. The map must not be modified during the
+// iteration, except for the values.
+//
+// Example:
+// ```c
+// svcx_map ages;
+// svcx_map_init_sv(&ages, sizeof(int), svcx_default_allocator());
+//
+// int age = 42;
+// svcx_map_insert(&ages, &SVCX_SV("alice"), &age);
+//
+// int *count;
+// svcx_map_get_or_insert(&ages, &SVCX_SV("bob"), (void **)&count, NULL);
+// *count += 1;
+//
+// int *alice = svcx_map_get(&ages, &SVCX_SV("alice")); // *alice == 42
+//
+// svcx_map_iter it;
+// const svcx_string_view *name;
+// int *value;
+// svcx_map_iter_init(&it, &ages);
+// while (svcx_map_iter_next(&it, (const void **)&name, (void **)&value)) {
+//     printf("%.*s: %d\n", (int)name->len, name->data, *value);
+// }
+//
+// svcx_map_free(&ages);
+// ```
+//
+SVCXDEF void svcx_map_init(svcx_map *m,
+    size_t key_size,
+    size_t value_size,
+    svcx_allocator a);
+SVCXDEF void svcx_map_init_sv(svcx_map *m, size_t value_size, svcx_allocator a);
+SVCXDEF void svcx_map_init_custom(svcx_map *m,
+    size_t key_size,
+    size_t value_size,
+    svcx_map_hash_fn hash,
+    svcx_map_eq_fn eq,
+    svcx_allocator a);
+SVCXDEF void svcx_map_free(svcx_map *m);
+SVCXDEF void svcx_map_clear(svcx_map *m);
+SVCXDEF svcx_result svcx_map_reserve(svcx_map *m, size_t count);
+SVCXDEF svcx_result svcx_map_rehash(svcx_map *m, size_t count);
+SVCXDEF void *svcx_map_get(const svcx_map *m, const void *key);
+SVCXDEF bool svcx_map_contains(const svcx_map *m, const void *key);
+SVCXDEF svcx_result svcx_map_insert(
+    svcx_map *m, const void *key, const void *value);
+SVCXDEF svcx_result svcx_map_get_or_insert(
+    svcx_map *m, const void *key, void **value, bool *inserted);
+SVCXDEF bool svcx_map_remove(svcx_map *m, const void *key);
+SVCXDEF size_t svcx_map_size(const svcx_map *m);
+SVCXDEF void svcx_map_iter_init(svcx_map_iter *it, const svcx_map *m);
+SVCXDEF bool svcx_map_iter_next(
+    svcx_map_iter *it, const void **key, void **value);
+
+#ifdef SVCX__HAS_ATOMICS
+/*
+ * A concurrent map is a hash map with svcx_string_view keys that can be used
+ * from multiple threads at once. It is split into shards (a power of two),
+ * and the hash of a key picks its shard. Every shard is padded to its own
+ * cache lines and has its own lock, so threads that touch different shards
+ * do not contend.
+ *
+ * The lock of a shard is a sequence counter, which writers make odd while
+ * they modify the shard. Readers do not take the lock: they look up the key
+ * and copy its value out, then retry if the counter changed in the meantime.
+ * Lookups therefore never block writers and scale with the number of cores.
+ *
+ * Keys are copied into memory owned by their shard, and neither the entries
+ * nor replaced tables are freed before svcx_cmap_free, so a reader racing a
+ * writer can never touch freed memory. Removed entries are only reclaimed
+ * when the map is freed, so the map suits caches that are mostly added to.
+ * The allocator is shared by all shards and must be thread-safe (like the
+ * default allocator). The concurrent map needs C11 atomics, and is left out
+ * when compiling as C99 or without <stdatomic.h>.
+ */
+typedef struct svcx_cmap_shard {
+    atomic_uint seq;
+    struct svcx__cmap_table *_Atomic table;
+    atomic_size_t size;
+    size_t used;
+    struct svcx__block *blocks;
+    char *bump;
+    size_t bump_left;
+} svcx_cmap_shard;
+
+typedef struct svcx_cmap {
+    char *shards;
+    void *mem;
+    size_t nshards;
+    size_t shard_stride;
+    size_t value_size;
+    uint64_t seed;
+    svcx_allocator a;
+} svcx_cmap;
+
+typedef void (*svcx_cmap_update_fn)(
+    svcx_string_view key, void *value, bool inserted, void *ctx);
+
+//
+// Functions for working with a concurrent map. Except for svcx_cmap_init and
+// svcx_cmap_free, all of them can be called from any number of threads.
+//
+// The svcx_cmap_init function initializes a map with the given number of
+// shards (rounded up to a power of two, or a default when 0) and values of
+// value_size bytes.
+//
+// The svcx_cmap_get function copies the value of the key into value (which
+// can be NULL) and returns true if the key is present, without taking a lock.
+// The svcx_cmap_contains function checks if the key is present.
+//
+// The svcx_cmap_insert function inserts the key with the value, or overwrites
+// the value if the key is already present. The svcx_cmap_upsert function calls
+// update with a pointer to the value of the key while holding the lock of its
+// shard, inserting the key with a zeroed value first if needed. The key passed
+// to update is the copy owned by the map, which stays valid until the map is
+// freed. The update function must be short and must not call into the same
+// map.
+//
+// The svcx_cmap_remove function removes the key and returns true if it was
+// present. The svcx_cmap_size function returns the number of entries, which is
+// only exact when no other thread is writing.
+//
+// Example:
+// ```c
+// static void count(
+//     svcx_string_view key, void *value, bool inserted, void *ctx) {
+//     *(int *)value += 1;
+// }
+//
+// svcx_cmap hits;
+// svcx_cmap_init(&hits, 0, sizeof(int), svcx_default_allocator());
+//
+// // From any thread:
+// svcx_cmap_upsert(&hits, SVCX_SV("/index.html"), count, NULL);
+//
+// int n;
+// if (svcx_cmap_get(&hits, SVCX_SV("/index.html"), &n)) {
+//     printf("%d hits\n", n);
+// }
+//
+// svcx_cmap_free(&hits);
+// ```
+//
+SVCXDEF svcx_result svcx_cmap_init(svcx_cmap *cm,
+    size_t nshards,
+    size_t value_size,
+    svcx_allocator a);
+SVCXDEF void svcx_cmap_free(svcx_cmap *cm);
+SVCXDEF bool svcx_cmap_get(
+    const svcx_cmap *cm, svcx_string_view key, void *value);
+SVCXDEF bool svcx_cmap_contains(const svcx_cmap *cm, svcx_string_view key);
+SVCXDEF svcx_result svcx_cmap_insert(
+    svcx_cmap *cm, svcx_string_view key, const void *value);
+SVCXDEF svcx_result svcx_cmap_upsert(svcx_cmap *cm,
+    svcx_string_view key,
+    svcx_cmap_update_fn update,
+    void *ctx);
+SVCXDEF bool svcx_cmap_remove(svcx_cmap *cm, svcx_string_view key);
+SVCXDEF size_t svcx_cmap_size(const svcx_cmap *cm);
+#endif // SVCX__HAS_ATOMICS
+
+/*
+ * An interner stores each distinct string once and gives it a dense id,
+ * starting from 0 in the order of first appearance. Interned strings can be
+ * compared by their ids instead of their characters, and an id resolves back
+ * to the string in constant time.
+ *
+ * The characters are copied into blocks of memory owned by the interner, so
+ * the interned views stay valid (and do not move) until the interner is freed.
+ * All memory comes from the allocator, which can be an arena.
+ */
+typedef struct svcx_interner {
+    svcx_map ids;
+    svcx_vector views;
+    struct svcx__block *blocks;
+    char *bump;
+    size_t bump_left;
+    svcx_allocator a;
+} svcx_interner;
+
+//
+// Functions for working with an interner.
+//
+// The svcx_interner_init function initializes an empty interner, and
+// svcx_interner_free frees all of its memory, including the interned strings.
+//
+// The svcx_interner_intern function stores the id of the string into id,
+// adding the string first if it has not been interned yet. The
+// svcx_interner_find function looks up the id without adding the string, and
+// returns false if it is not interned.
+//
+// The svcx_interner_resolve function returns the string of an id, which must
+// have been returned by this interner. The svcx_interner_count function
+// returns the number of distinct strings, which is also the next id.
+//
+// Example:
+// ```c
+// svcx_interner in;
+// svcx_interner_init(&in, svcx_default_allocator());
+//
+// uint32_t a, b;
+// svcx_interner_intern(&in, SVCX_SV("example.com"), &a);
+// svcx_interner_intern(&in, SVCX_SV("example.com"), &b); // a == b
+//
+// svcx_string_view host = svcx_interner_resolve(&in, a);
+//
+// svcx_interner_free(&in);
+// ```
+//
+SVCXDEF void svcx_interner_init(svcx_interner *in, svcx_allocator a);
+SVCXDEF void svcx_interner_free(svcx_interner *in);
+SVCXDEF svcx_result svcx_interner_intern(
+    svcx_interner *in, svcx_string_view sv, uint32_t *id);
+SVCXDEF bool svcx_interner_find(
+    const svcx_interner *in, svcx_string_view sv, uint32_t *id);
+SVCXDEF svcx_string_view svcx_interner_resolve(
+    const svcx_interner *in, uint32_t id);
+SVCXDEF size_t svcx_interner_count(const svcx_interner *in);
+
+#ifdef SVCX__HAS_ATOMICS
+#define SVCX__CINTERNER_BUCKETS 29
+
+/*
+ * A concurrent interner is the thread-safe variant of the interner. It keeps
+ * the strings in a concurrent map, so looking up strings that are already
+ * interned does not take a lock, and the views of the ids are kept in buckets
+ * of doubling sizes that never move, so resolving an id is lock-free too.
+ *
+ * The ids are dense, but their order between threads is unspecified. The
+ * allocator must be thread-safe. Like the concurrent map, it needs C11
+ * atomics.
+ */
+typedef struct svcx_cinterner {
+    svcx_cmap ids;
+    svcx_string_view *_Atomic buckets[SVCX__CINTERNER_BUCKETS];
+    atomic_uint_least32_t count;
+} svcx_cinterner;
+
+//
+// Functions for working with a concurrent interner. They behave like the ones
+// of the interner, and all except svcx_cinterner_init and svcx_cinterner_free
+// can be called from any number of threads. An id can be resolved by any
+// thread that got it from svcx_cinterner_intern or svcx_cinterner_find. The
+// svcx_cinterner_count function returns the number of ids handed out, and a
+// call that fails to allocate does not use up an id.
+//
+SVCXDEF svcx_result svcx_cinterner_init(
+    svcx_cinterner *ci, svcx_allocator a);
+SVCXDEF void svcx_cinterner_free(svcx_cinterner *ci);
+SVCXDEF svcx_result svcx_cinterner_intern(
+    svcx_cinterner *ci, svcx_string_view sv, uint32_t *id);
+SVCXDEF bool svcx_cinterner_find(
+    const svcx_cinterner *ci, svcx_string_view sv, uint32_t *id);
+SVCXDEF svcx_string_view svcx_cinterner_resolve(
+    const svcx_cinterner *ci, uint32_t id);
+SVCXDEF size_t svcx_cinterner_count(const svcx_cinterner *ci);
+#endif // SVCX__HAS_ATOMICS
+
+/*
+ * A sink write function writes up to len bytes of data and returns how many
+ * it wrote, which may be fewer than len, or a negative value on error.
+ */
+typedef ptrdiff_t (*svcx_sb_write_fn)(
+    void *ctx, const void *data, size_t len);
+
+/*
+ * A string builder is an owning and mutable data structure for dynamically
+ * creating strings of characters, but it does not provide Unicode semantics.
+ * The string builder is built on top of the svcx_vector and is thus arena
+ * friendly.
+ *
+ * The fmt_hint field holds the length of the last formatted append, so the
+ * next one can make room for a similar output up front.
+ *
+ * A string builder with a sink is a buffered writer: once the buffer holds
+ * flush_at bytes, it is written out through the write function and emptied,
+ * so the memory used stays bounded no matter how large the output gets.
+ */
+typedef struct svcx_string_builder {
+    svcx_vector buf;
+    size_t fmt_hint;
+    svcx_sb_write_fn write;
+    void *write_ctx;
+    size_t flush_at;
+} svcx_string_builder;
+
+// The flush threshold used by the sink init functions when given 0.
+#define SVCX_SB_DEFAULT_FLUSH_AT (64 * 1024)
+
+//
+// Functions for manipulating a string builder.
+//
+// The svcx_sb_init function initializes the string builder with the given
+// allocator.
+//
+// The svcx_sb_init_sink function initializes the string builder as a
+// buffered writer, which hands its contents to the write function whenever
+// they reach flush_at bytes (SVCX_SB_DEFAULT_FLUSH_AT if 0). Appends at least
+// flush_at bytes long skip the buffer and are written out directly. The
+// svcx_sb_init_fd and svcx_sb_init_file functions are the same, but write to
+// a file descriptor (retrying interrupted writes) or a FILE stream (which is
+// not flushed itself).
+//
+// The svcx_sb_flush function writes out everything in the buffer, calling
+// the write function again after short writes, and does nothing for a string
+// builder without a sink. When a write fails, every append function and
+// svcx_sb_flush return SVCX_SB_FLUSH_ERR, and the bytes that were not
+// written stay in the buffer, so flushing can be tried again. An append
+// that skipped the buffer returns SVCX_SB_APPEND_ERR instead if the buffer
+// cannot grow to keep its unwritten bytes, which are then lost. The
+// svcx_sb_free function does not flush, so it should be called first, and
+// svcx_sb_cstr, svcx_sb_build and svcx_sb_view only see what has not been
+// written out yet.
+//
+// The svcx_sb_clear function clears the data inside the string builder by
+// clearing the buffer vector. This allows the string builder to be reused
+// as the memory remains allocated.
+//
+// The svcx_sb_free function frees the memory held by the string builder,
+// rendering it unusable in the future. The free function depends on the
+// provided allocator, making it a no-op for arenas.
+//
+// The svcx_sb_push_char function pushes the given character to the end
+// of the string builder.
+//
+// The svcx_sb_append function appends the given C string to the string
+// builder. This is a manual function, meaning the size must be provided
+// by the user, thus the next function will be more commonly used.
+//
+// The svcx_sb_append_cstr function appends the given C string to the
+// string builder, automatically calculating the length. It is a wrapper
+// around the svcx_sb_append function.
+//
+// The svcx_sb_append_sv function appends the string represented by the
+// given string view to the string builder.
+//
+// The svcx_sb_append_fmt function is a variadic function, meaning it
+// allows for an arbitrary number of parameters, and essentially acts
+// as C's printf() function, allowing the user to specify a format
+// string and parameters from which to construct the string to be
+// appended to the string builder. It formats straight into the spare capacity
+// of the buffer, and only grows the buffer and formats again if the output
+// did not fit. The svcx_sb_append_vfmt function is the same, but takes a
+// va_list, so that variadic wrappers can forward their arguments.
+//
+// The svcx_sb_append_u64, svcx_sb_append_i64 and svcx_sb_append_hex functions
+// append an integer in decimal or in lowercase hexadecimal (without a prefix)
+// without going through the format machinery. The svcx_sb_append_f64 function
+// appends the shortest decimal that reads back as the same double, laid out
+// like in JavaScript: "0.1", "100", "1.5e-7" and "1e+21", or "nan", "inf" and
+// "-inf" for special values.
+//
+// The svcx_sb_append_json_escaped function appends the string escaped for
+// use inside a JSON string literal (without the surrounding quotes): quotes,
+// backslashes and control characters are escaped, using the short forms
+// like \n where JSON has them and \u00XX otherwise, and all other bytes are
+// copied as they are. The svcx_sb_append_json_unescaped function reverses
+// it, turning \uXXXX escapes (including surrogate pairs) into UTF-8, and
+// returns SVCX_SB_UNESCAPE_INVALID_ERR for an unknown or cut short escape
+// or an unpaired surrogate, in which case nothing is appended.
+//
+// The svcx_sb_append_csv_quoted function appends the string as a CSV field
+// separated by delim. A field that contains delim, a quote, '\r' or '\n' is
+// wrapped in quotes with its quotes doubled, and any other field is appended
+// as it is. The svcx_sb_append_csv_unquoted function reverses it, and
+// returns SVCX_SB_UNESCAPE_INVALID_ERR (appending nothing) for a quoted
+// field with a stray quote or no closing quote.
+//
+// The escaping functions find the bytes that need work 16 or 32 at a time
+// and copy the runs between them in bulk.
+//
+// The svcx_sb_cstr function returns a null-terminated view (C string)
+// from the string builder's buffer. The returned string is valid until
+// the next append or clear, and arena backed strings live as long as
+// the arena.
+//
+// The svcx_sb_build function finalizes the string builder, essentially
+// transfering ownership of the data to the returned pointer. The function
+// returns the string constructed by the string builder. After calling this
+// function, the string builder should not be used again.
+//
+// The svcx_sb_view function returns a non-owning string view of the data
+// contained within the string builder.
+//
+// Alongside these functions, a SVCX_SB_APPEND_LIT macro is provided, which
+// increases ergonomics of appending to the string builder.
+//
+// Example: An example of string builder functions is provided in the
+// string view example, as they work in tandem. A buffered writer is used
+// the same way:
+// ```c
+// svcx_string_builder out;
+// svcx_sb_init_fd(&out, svcx_default_allocator(), 1, 0);
+// for (size_t i = 0; i < nrows; i++) {
+//     svcx_sb_append_u64(&out, rows[i].id);
+//     svcx_sb_push_char(&out, '\n');
+// }
+// svcx_sb_flush(&out);
+// svcx_sb_free(&out);
+// ```
+//
+SVCXDEF void svcx_sb_init(svcx_string_builder *sb, svcx_allocator a);
+SVCXDEF void svcx_sb_init_sink(svcx_string_builder *sb,
+    svcx_allocator a,
+    svcx_sb_write_fn write,
+    void *ctx,
+    size_t flush_at);
+SVCXDEF void svcx_sb_init_fd(
+    svcx_string_builder *sb, svcx_allocator a, int fd, size_t flush_at);
+SVCXDEF void svcx_sb_init_file(
+    svcx_string_builder *sb, svcx_allocator a, FILE *f, size_t flush_at);
+SVCXDEF svcx_result svcx_sb_flush(svcx_string_builder *sb);
+SVCXDEF void svcx_sb_clear(svcx_string_builder *sb);
+SVCXDEF void svcx_sb_free(svcx_string_builder *sb);
+SVCXDEF svcx_result svcx_sb_push_char(svcx_string_builder *sb, char c);
+SVCXDEF svcx_result svcx_sb_append(
+    svcx_string_builder *sb, const char *str, size_t len);
+SVCXDEF svcx_result svcx_sb_append_cstr(
+    svcx_string_builder *sb, const char *cstr);
+SVCXDEF svcx_result svcx_sb_append_sv(
+    svcx_string_builder *sb, svcx_string_view sv);
+SVCXDEF svcx_result svcx_sb_append_fmt(
+    svcx_string_builder *sb, const char *fmt, ...);
+SVCXDEF svcx_result svcx_sb_append_vfmt(
+    svcx_string_builder *sb, const char *fmt, va_list args);
+SVCXDEF svcx_result svcx_sb_append_u64(svcx_string_builder *sb, uint64_t v);
+SVCXDEF svcx_result svcx_sb_append_i64(svcx_string_builder *sb, int64_t v);
+SVCXDEF svcx_result svcx_sb_append_hex(svcx_string_builder *sb, uint64_t v);
+SVCXDEF svcx_result svcx_sb_append_f64(svcx_string_builder *sb, double v);
+SVCXDEF svcx_result svcx_sb_append_json_escaped(
+    svcx_string_builder *sb, svcx_string_view sv);
+SVCXDEF svcx_result svcx_sb_append_json_unescaped(
+    svcx_string_builder *sb, svcx_string_view sv);
+SVCXDEF svcx_result svcx_sb_append_csv_quoted(
+    svcx_string_builder *sb, svcx_string_view sv, char delim);
+SVCXDEF svcx_result svcx_sb_append_csv_unquoted(
+    svcx_string_builder *sb, svcx_string_view sv);
+SVCXDEF const char *svcx_sb_cstr(svcx_string_builder *sb);
+SVCXDEF char *svcx_sb_build(svcx_string_builder *sb);
+SVCXDEF svcx_string_view svcx_sb_view(svcx_string_builder *sb);
+
+#define SVCX_SB_APPEND_LIT(sb, lit) svcx_sb_append_sv((sb), SVCX_SV(lit))
+
+typedef enum svcx_base64_alphabet {
+    SVCX_BASE64_STD,
+    SVCX_BASE64_URL,
+} svcx_base64_alphabet;
+
+//
+// Functions for hex and base64 encoding and decoding.
+//
+// The svcx_sb_append_hex_encoded function appends two lowercase hex digits
+// for each byte of data. The svcx_sb_append_base64 function appends data in
+// base64 (RFC 4648), either in the standard alphabet with '=' padding or in
+// the URL-safe alphabet ('-' and '_' instead of '+' and '/') without
+// padding. Both reserve room for the whole output once and write straight
+// into it.
+//
+// The svcx_hex_decode function decodes sv into the out buffer, which must
+// have room for sv.len / 2 bytes, and stores the decoded length in len. It
+// accepts either case of digits. The svcx_base64_decode function is the
+// same for base64, and needs room for svcx_base64_decoded_len bytes. Both
+// are strict: they return SVCX_DECODE_INVALID_ERR for characters outside the
+// alphabet, an impossible length, wrong padding (padding is required for the
+// standard alphabet and not allowed for the URL-safe one) or nonzero unused
+// bits in the last group, and SVCX_DECODE_SPACE_ERR if out is too small. On
+// error, out may have been partly written. The svcx_hex_decode_vec and
+// svcx_base64_decode_vec functions append the decoded bytes to a vector of
+// bytes instead, appending nothing on error.
+//
+// Hex works on 16 or 32 bytes at a time with SSE2 or AVX2, and base64 on
+// blocks with AVX2 only, falling back to scalar code on CPUs without it.
+//
+// Example:
+// ```c
+// uint8_t id[16];
+// svcx_sb_append_hex_encoded(&sb, id, sizeof(id)); // 32 hex digits
+//
+// uint8_t key[32];
+// size_t len;
+// svcx_base64_decode(SVCX_SV("aGVsbG8="), SVCX_BASE64_STD, key, 32, &len);
+// // key holds "hello" and len is 5
+// ```
+//
+SVCXDEF svcx_result svcx_sb_append_hex_encoded(
+    svcx_string_builder *sb, const void *data, size_t len);
+SVCXDEF svcx_result svcx_hex_decode(
+    svcx_string_view sv, void *out, size_t cap, size_t *len);
+SVCXDEF svcx_result svcx_hex_decode_vec(
+    svcx_string_view sv, svcx_vector *out);
+SVCXDEF svcx_result svcx_sb_append_base64(svcx_string_builder *sb,
+    const void *data,
+    size_t len,
+    svcx_base64_alphabet alphabet);
+SVCXDEF size_t svcx_base64_decoded_len(
+    svcx_string_view sv, svcx_base64_alphabet alphabet);
+SVCXDEF svcx_result svcx_base64_decode(svcx_string_view sv,
+    svcx_base64_alphabet alphabet,
+    void *out,
+    size_t cap,
+    size_t *len);
+SVCXDEF svcx_result svcx_base64_decode_vec(svcx_string_view sv,
+    svcx_base64_alphabet alphabet,
+    svcx_vector *out);
+
+//
+// Functions for ASCII case-insensitive comparison and case conversion.
+//
+// The svcx_sv_eq_icase function returns whether two string views are equal
+// when ASCII letters are compared without regard to case, and the
+// svcx_sv_starts_with_icase and svcx_sv_ends_with_icase functions are the
+// case-insensitive svcx_sv_starts_with and svcx_sv_ends_with. The
+// svcx_sv_find_icase function returns the index of the first
+// case-insensitive occurrence of needle in haystack, or -1. Candidates are
+// found with the same first and last byte filter as svcx_sv_find, but there
+// is no Two-Way fallback, so long needles that nearly match everywhere are
+// slow.
+//
+// The svcx_ascii_lower and svcx_ascii_upper functions convert the ASCII
+// letters of a buffer in place, and the svcx_sb_append_lower and
+// svcx_sb_append_upper functions append a converted copy of a string view.
+// Bytes outside 'A' to 'Z' and 'a' to 'z', including all of UTF-8 beyond
+// ASCII, are never changed or folded.
+//
+// None of them allocate, apart from the string builder growing, and they
+// fold 16 or 32 bytes at a time where the CPU allows it (8 otherwise).
+//
+// Example:
+// ```c
+// svcx_string_view name = SVCX_SV("Content-Length");
+// svcx_sv_eq_icase(name, SVCX_SV("content-length")); // true
+// svcx_sv_find_icase(SVCX_SV("Accept: TEXT/html"), SVCX_SV("text")); // 8
+//
+// char method[] = "get";
+// svcx_ascii_upper(method, 3); // "GET"
+// ```
+//
+SVCXDEF bool svcx_sv_eq_icase(svcx_string_view a, svcx_string_view b);
+SVCXDEF bool svcx_sv_starts_with_icase(
+    svcx_string_view sv, svcx_string_view prefix);
+SVCXDEF bool svcx_sv_ends_with_icase(
+    svcx_string_view sv, svcx_string_view suffix);
+SVCXDEF size_t svcx_sv_find_icase(
+    svcx_string_view haystack, svcx_string_view needle);
+SVCXDEF void svcx_ascii_lower(char *data, size_t len);
+SVCXDEF void svcx_ascii_upper(char *data, size_t len);
+SVCXDEF svcx_result svcx_sb_append_lower(
+    svcx_string_builder *sb, svcx_string_view sv);
+SVCXDEF svcx_result svcx_sb_append_upper(
+    svcx_string_builder *sb, svcx_string_view sv);
+
+typedef enum svcx_tmpl_type {
+    SVCX_TMPL_LIT,
+    SVCX_TMPL_STR,
+    SVCX_TMPL_I64,
+    SVCX_TMPL_U64,
+    SVCX_TMPL_HEX,
+    SVCX_TMPL_F64,
+} svcx_tmpl_type;
+
+typedef union svcx_tmpl_arg {
+    svcx_string_view s;
+    int64_t i;
+    uint64_t u;
+    double f;
+} svcx_tmpl_arg;
+
+typedef struct svcx_tmpl_op {
+    svcx_tmpl_type type;
+    uint32_t slot;
+    uint32_t offset;
+    uint32_t len;
+} svcx_tmpl_op;
+
+/*
+ * A template is a format string compiled once into a list of operations, so
+ * it can be rendered many times without parsing the format again. Each
+ * operation either copies a slice of literal text or writes one argument.
+ *
+ * A hole is written as {name}, {name:type}, {0}, {0:type} or {} (the slot
+ * after the highest one so far), and "{{" and "}}" stand for literal braces.
+ * The type is one of s (string view, the default), i (int64_t), u
+ * (uint64_t), x (uint64_t in hexadecimal) and f (double, in the shortest
+ * form). Named holes get their slots in the order the names first appear,
+ * and a template can not mix named and positional holes. The same slot can
+ * be used more than once.
+ *
+ * The template keeps its own copy of the format text.
+ */
+typedef struct svcx_template {
+    char *text;
+    svcx_vector ops;
+    svcx_vector names;
+    size_t nslots;
+    size_t literal_len;
+    svcx_allocator a;
+} svcx_template;
+
+//
+// Functions for working with templates.
+//
+// The svcx_tmpl_compile function compiles the format into the template, and
+// returns SVCX_TMPL_SYNTAX_ERR if the format is malformed (in which case
+// there is nothing to free). The svcx_tmpl_free function frees the template.
+//
+// The svcx_tmpl_slot function returns the slot of a named hole, or -1 if the
+// template has no hole with that name. Looking the slots up once after
+// compiling lets the arguments be filled in by index.
+//
+// The svcx_tmpl_render function appends the template to the string builder,
+// taking the value of each hole from the args array at the index of its slot
+// (which must hold the member matching the type of the hole). It reserves
+// room for the whole output before writing any of it.
+//
+// Example:
+// ```c
+// svcx_template t;
+// svcx_tmpl_compile(&t,
+//     SVCX_SV("{method} {path} {status:i} {ms:f}ms\n"),
+//     svcx_default_allocator());
+//
+// svcx_tmpl_arg args[4];
+// args[svcx_tmpl_slot(&t, SVCX_SV("method"))] = SVCX_TMPL_STR(SVCX_SV("GET"));
+// args[svcx_tmpl_slot(&t, SVCX_SV("path"))] = SVCX_TMPL_STR(path);
+// args[svcx_tmpl_slot(&t, SVCX_SV("status"))] = SVCX_TMPL_I64(200);
+// args[svcx_tmpl_slot(&t, SVCX_SV("ms"))] = SVCX_TMPL_F64(1.25);
+// svcx_tmpl_render(&t, &sb, args); // "GET /index.html 200 1.25ms\n"
+//
+// svcx_tmpl_free(&t);
+// ```
+//
+SVCXDEF svcx_result svcx_tmpl_compile(
+    svcx_template *t, svcx_string_view fmt, svcx_allocator a);
+SVCXDEF void svcx_tmpl_free(svcx_template *t);
+SVCXDEF size_t svcx_tmpl_slot(const svcx_template *t, svcx_string_view name);
+SVCXDEF svcx_result svcx_tmpl_render(const svcx_template *t,
+    svcx_string_builder *sb,
+    const svcx_tmpl_arg *args);
+
+#define SVCX_TMPL_STR(sv) ((svcx_tmpl_arg){.s = (sv)})
+#define SVCX_TMPL_I64(x) ((svcx_tmpl_arg){.i = (int64_t)(x)})
+#define SVCX_TMPL_U64(x) ((svcx_tmpl_arg){.u = (uint64_t)(x)})
+#define SVCX_TMPL_F64(x) ((svcx_tmpl_arg){.f = (double)(x)})
+
+/*
+ * A gather builder assembles a string out of slices without copying the
+ * large ones. Slices at least copy_below bytes long are only referenced, so
+ * the memory they point into must stay valid and unchanged for as long as
+ * the builder is used. Shorter slices are copied into scratch blocks owned
+ * by the builder, and consecutive copies are merged into a single slice, so
+ * many small appends do not turn into many tiny writes.
+ *
+ * The result is written out with one writev call per batch of slices, or
+ * flattened into a string builder when a contiguous copy is needed.
+ */
+typedef struct svcx_gather_builder {
+    svcx_vector parts;
+    struct svcx__block *blocks;
+    char *bump;
+    size_t bump_left;
+    size_t len;
+    size_t copy_below;
+    svcx_allocator a;
+} svcx_gather_builder;
+
+// The copy_below threshold set by svcx_gb_init.
+#define SVCX_GB_DEFAULT_COPY_BELOW 256
+
+//
+// Functions for working with a gather builder.
+//
+// The svcx_gb_init function initializes the gather builder with the given
+// allocator. The copy_below field can be changed at any time. The
+// svcx_gb_free function frees the slice list and the scratch blocks, and
+// the svcx_gb_clear function empties the builder so it can be reused,
+// keeping the slice list and the current scratch block.
+//
+// The svcx_gb_append_sv function appends a slice, referencing it if it is at
+// least copy_below bytes long and copying it otherwise. The
+// svcx_gb_append_copy function always copies, for slices of temporary
+// buffers, and the SVCX_GB_APPEND_LIT macro copies a string literal. Both
+// skip empty slices. The
+// svcx_gb_len function returns the total length.
+//
+// The svcx_gb_flatten function appends the whole result to a string builder
+// (reserving for all of it at once, unless the string builder has a sink).
+//
+// The svcx_gb_write function writes the result through a sink write function
+// (see svcx_sb_write_fn), and the svcx_gb_writev function writes it to a
+// file descriptor with writev, which is a plain loop of writes on Windows.
+// Both call again after short or interrupted writes, and return
+// SVCX_GB_WRITE_ERR if a write fails. Neither one clears the builder.
+//
+// Example:
+// ```c
+// svcx_gather_builder gb;
+// svcx_gb_init(&gb, svcx_default_allocator());
+// svcx_gb_append_copy(&gb, SVCX_SV("HTTP/1.1 200 OK\r\n\r\n"));
+// svcx_gb_append_sv(&gb, body); // referenced, not copied
+// svcx_gb_writev(&gb, client_fd);
+// svcx_gb_free(&gb);
+// ```
+//
+SVCXDEF void svcx_gb_init(svcx_gather_builder *gb, svcx_allocator a);
+SVCXDEF void svcx_gb_free(svcx_gather_builder *gb);
+SVCXDEF void svcx_gb_clear(svcx_gather_builder *gb);
+SVCXDEF svcx_result svcx_gb_append_sv(
+    svcx_gather_builder *gb, svcx_string_view sv);
+SVCXDEF svcx_result svcx_gb_append_copy(
+    svcx_gather_builder *gb, svcx_string_view sv);
+SVCXDEF size_t svcx_gb_len(const svcx_gather_builder *gb);
+SVCXDEF svcx_result svcx_gb_flatten(
+    const svcx_gather_builder *gb, svcx_string_builder *sb);
+SVCXDEF svcx_result svcx_gb_write(
+    const svcx_gather_builder *gb, svcx_sb_write_fn write, void *ctx);
+SVCXDEF svcx_result svcx_gb_writev(const svcx_gather_builder *gb, int fd);
+
+#define SVCX_GB_APPEND_LIT(gb, lit) svcx_gb_append_copy((gb), SVCX_SV(lit))
+
+/*
+ * A mapped file holds the whole contents of a file as a string view. Regular
+ * files are mapped read-only into memory, and anything that cannot be mapped
+ * (pipes, terminals, procfs files, which report a size of 0) is read into a
+ * single allocation of exactly its size from the allocator instead, which
+ * the mapped field tells apart.
+ */
+typedef struct svcx_mapped_file {
+    svcx_string_view view;
+    bool mapped;
+    svcx_allocator a;
+} svcx_mapped_file;
+
+//
+// Functions for loading whole files.
+//
+// The svcx_file_map function opens the file at path and loads it into the
+// mapped file, and the svcx_file_map_fd function does the same for a file
+// descriptor that is already open (and leaves it open). Mappings are hinted
+// for sequential access and prefetched when the C library declares
+// posix_madvise (strict ISO modes hide it). They return SVCX_FILE_OPEN_ERR if
+// the file cannot be opened, SVCX_FILE_READ_ERR if it cannot be read, and
+// SVCX_FILE_ALLOC_ERR if the allocation for reading it fails. An empty file
+// gives an empty view.
+//
+// The whole file is loaded whatever the offset of the descriptor; a file
+// that is read rather than mapped leaves the offset at its end. Input of
+// unknown size, such as a pipe, is first gathered in a scratch buffer from
+// svcx_default_allocator() and then copied into one allocation from the
+// given allocator, so an arena or budget allocator does not bound the
+// scratch memory.
+//
+// The svcx_file_unmap function unmaps or frees the contents, after which the
+// view must not be used.
+//
+// A mapping may see later writes to the file, and touching a part of it that
+// another process has truncated away raises SIGBUS, so files that change
+// while they are being read are better read through svcx_file_map_fd on a
+// pipe or with the line reader. On Windows, files are always read.
+//
+// Example:
+// ```c
+// svcx_mapped_file f;
+// if (svcx_file_map(&f, "access.log", svcx_default_allocator()) == SVCX_OK) {
+//     bool text = svcx_utf8_validate(f.view, NULL);
+//     svcx_file_unmap(&f);
+// }
+// ```
+//
+SVCXDEF svcx_result svcx_file_map(
+    svcx_mapped_file *f, const char *path, svcx_allocator a);
+SVCXDEF svcx_result svcx_file_map_fd(
+    svcx_mapped_file *f, int fd, svcx_allocator a);
+SVCXDEF void svcx_file_unmap(svcx_mapped_file *f);
+
+/*
+ * A line reader streams the lines of a file descriptor through a buffer of
+ * fixed size, so files and pipes of any length are read in bounded memory.
+ * The lines point into the buffer and are only valid until the next call.
+ */
+typedef struct svcx_line_reader {
+    char *buf;
+    size_t cap;
+    size_t start;
+    size_t end;
+    size_t scan;
+    int fd;
+    bool eof;
+    svcx_result err;
+    svcx_allocator a;
+} svcx_line_reader;
+
+// The buffer size used by svcx_lr_init when given 0.
+#define SVCX_LR_DEFAULT_BUF_SIZE (1024 * 1024)
+
+//
+// Functions for reading lines from a file descriptor.
+//
+// The svcx_lr_init function allocates a buffer of buf_size bytes
+// (SVCX_LR_DEFAULT_BUF_SIZE if 0) for reading fd, and returns
+// SVCX_LR_ALLOC_ERR if it cannot. The svcx_lr_free function frees the
+// buffer, and neither one opens or closes fd.
+//
+// The svcx_lr_next function stores the next line, without its '\n' and
+// without a '\r' right before it, into line and returns true, or returns
+// false at the end of the input or on error. A last line without a '\n' is
+// produced too. After it returns false, the err field is SVCX_OK at the end
+// of the input, SVCX_LR_READ_ERR if a read failed, or
+// SVCX_LR_LINE_TOO_LONG_ERR for a line of buf_size bytes or more (not
+// counting its '\n'), which cannot fit in the buffer.
+//
+// The buffer is filled with reads as large as the free space in it, and
+// the line ends are found with memchr. When the buffer runs out in the
+// middle of a line, the partial line is moved to the front with one memmove
+// before the next read.
+//
+// Example:
+// ```c
+// svcx_line_reader lr;
+// svcx_lr_init(&lr, 0, 0, svcx_default_allocator()); // stdin
+// svcx_string_view line;
+// while (svcx_lr_next(&lr, &line)) {
+//     if (svcx_sv_starts_with(line, SVCX_SV("ERROR"))) {
+//         printf("%.*s\n", (int)line.len, line.data);
+//     }
+// }
+// if (lr.err != SVCX_OK) {
+//     printf("%s\n", svcx_error_string(lr.err));
+// }
+// svcx_lr_free(&lr);
+// ```
+//
+SVCXDEF svcx_result svcx_lr_init(
+    svcx_line_reader *lr, int fd, size_t buf_size, svcx_allocator a);
+SVCXDEF void svcx_lr_free(svcx_line_reader *lr);
+SVCXDEF bool svcx_lr_next(svcx_line_reader *lr, svcx_string_view *line);
+
+/*
+ * An Aho-Corasick automaton finds every occurrence of a set of patterns in a
+ * text with a single pass over it, no matter how many patterns there are.
+ *
+ * The automaton is compiled into a dense transition table, so matching does
+ * one table lookup per input byte and never backtracks. To keep the table
+ * small, bytes that behave the same in every pattern share a column: the
+ * classes array maps each byte to its column, and all bytes that do not
+ * appear in any pattern map to column 0.
+ *
+ * Only the lengths of the patterns are kept, so the views used to build the
+ * automaton do not need to outlive it.
+ */
+typedef struct svcx_aho_corasick {
+    uint32_t *trans;
+    uint32_t *out;
+    uint32_t *dict;
+    uint32_t *pattern_next;
+    uint32_t *pattern_len;
+    size_t nstates;
+    size_t nclasses;
+    size_t npatterns;
+    uint16_t classes[256];
+    unsigned char start_bytes[3];
+    size_t nstart;
+    svcx_allocator a;
+} svcx_aho_corasick;
+
+/*
+ * A single match of an Aho-Corasick automaton. The pattern is the index of
+ * the pattern in the vector the automaton was built from, and the match
+ * covers the bytes [start, end) of the text.
+ */
+typedef struct svcx_ac_match {
+    size_t pattern;
+    size_t start;
+    size_t end;
+} svcx_ac_match;
+
+//
+// Functions for working with an Aho-Corasick automaton.
+//
+// The svcx_ac_init function builds the automaton from a vector of non-empty
+// svcx_string_view patterns, using the allocator for its tables. Duplicate
+// patterns are allowed and are all reported. When the patterns start with at
+// most three distinct bytes, the search skips over text that cannot start a
+// match with SIMD instead of walking the automaton byte by byte.
+//
+// The svcx_ac_find_first function finds the match that ends first in the
+// text. If several patterns end at the same position, the longest one is
+// reported. It returns false if there is no match, and the match can be NULL
+// if only its presence is of interest.
+//
+// The svcx_ac_find_all function pushes every match, including overlapping
+// ones, to the out vector, which must be initialized with a stride of
+// sizeof(svcx_ac_match). The matches are ordered by their end position.
+//
+// The svcx_ac_free function frees the tables of the automaton.
+//
+// Example:
+// ```c
+// svcx_vector patterns;
+// svcx_vector_init(
+//     &patterns, sizeof(svcx_string_view), svcx_default_allocator());
+// SVCX_VECTOR_PUSH(&patterns, svcx_string_view, SVCX_SV("he"));
+// SVCX_VECTOR_PUSH(&patterns, svcx_string_view, SVCX_SV("she"));
+// SVCX_VECTOR_PUSH(&patterns, svcx_string_view, SVCX_SV("hers"));
+//
+// svcx_aho_corasick ac;
+// svcx_ac_init(&ac, &patterns, svcx_default_allocator());
+//
+// svcx_vector matches;
+// svcx_vector_init(&matches, sizeof(svcx_ac_match), svcx_default_allocator());
+// svcx_ac_find_all(&ac, SVCX_SV("ushers"), &matches);
+// // {1, 1, 4} "she", {0, 2, 4} "he", {2, 2, 6} "hers"
+//
+// svcx_vector_free(&matches);
+// svcx_ac_free(&ac);
+// svcx_vector_free(&patterns);
+// ```
+//
+SVCXDEF svcx_result svcx_ac_init(
+    svcx_aho_corasick *ac, const svcx_vector *patterns, svcx_allocator a);
+SVCXDEF bool svcx_ac_find_first(const svcx_aho_corasick *ac,
+    svcx_string_view text,
+    svcx_ac_match *match);
+SVCXDEF svcx_result svcx_ac_find_all(
+    const svcx_aho_corasick *ac, svcx_string_view text, svcx_vector *out);
+SVCXDEF void svcx_ac_free(svcx_aho_corasick *ac);
+
+/*
+ * A roaring bitmap is a compressed set of 32-bit integers. The values are
+ * partitioned by their high 16 bits into containers, and each container
+ * stores the low 16 bits in the representation that suits its contents:
+ * - an array container holds up to 4096 sorted values,
+ * - a bitmap container holds a 65536 bit bitmap (8 KiB),
+ * - a run container holds sorted runs of consecutive values.
+ *
+ * Containers are converted between the array and bitmap representations
+ * automatically as values are added and removed. Run containers are only
+ * created by svcx_roaring_run_optimize (or deserialization), and are expanded
+ * back when they are modified.
+ *
+ * The containers are kept sorted by key in a svcx_vector, and all memory comes
+ * from the allocator the bitmap was initialized with.
+ */
+typedef struct svcx_roaring_run {
+    uint16_t start;
+    uint16_t length; // The run covers [start, start + length]
+} svcx_roaring_run;
+
+typedef enum svcx_roaring_kind {
+    SVCX_ROARING_ARRAY,
+    SVCX_ROARING_BITMAP,
+    SVCX_ROARING_RUN,
+} svcx_roaring_kind;
+
+typedef struct svcx_roaring_container {
+    void *data;
+    uint32_t card;
+    uint32_t len;
+    uint32_t cap;
+    uint16_t key;
+    uint8_t kind;
+} svcx_roaring_container;
+
+typedef struct svcx_roaring {
+    svcx_vector containers;
+} svcx_roaring;
+
+typedef struct svcx_roaring_iter {
+    const svcx_roaring *r;
+    size_t container;
+    uint32_t index;
+    uint32_t offset;
+    uint64_t word;
+} svcx_roaring_iter;
+
+//
+// Functions for working with a roaring bitmap.
+//
+// The svcx_roaring_init function initializes an empty bitmap with the given
+// allocator, and the svcx_roaring_free function frees all of its memory.
+//
+// The svcx_roaring_clear function removes all values from the bitmap.
+//
+// The svcx_roaring_add and svcx_roaring_remove functions add or remove a
+// single value, while the svcx_roaring_contains function checks if the value
+// is in the set.
+//
+// The svcx_roaring_cardinality function returns the number of values in the
+// set.
+//
+// The svcx_roaring_and, svcx_roaring_or, svcx_roaring_xor and
+// svcx_roaring_andnot functions store the result of the operation on the a
+// and b bitmaps into out, which must be initialized and must not be a or b.
+// The previous contents of out are discarded. Each pair of containers is
+// combined with a dedicated array/bitmap routine, so sparse containers are
+// merged as sorted arrays and dense ones word by word.
+//
+// The svcx_roaring_run_optimize function converts every container that would
+// be smaller as a list of runs into a run container.
+//
+// The svcx_roaring_iter_init and svcx_roaring_iter_next functions iterate
+// over the values of the set in increasing order.
+//
+// The svcx_roaring_serialize function appends the bitmap in a portable
+// little-endian binary format to the string builder, and the
+// svcx_roaring_deserialize function reads it back into an initialized (empty)
+// bitmap, validating the input.
+//
+// Example:
+// ```c
+// svcx_roaring ids;
+// svcx_roaring_init(&ids, svcx_default_allocator());
+// svcx_roaring_add(&ids, 7);
+// svcx_roaring_add(&ids, 1 << 20);
+//
+// svcx_roaring_iter it;
+// svcx_roaring_iter_init(&it, &ids);
+// uint32_t id;
+// while (svcx_roaring_iter_next(&it, &id)) {
+//     printf("%u\n", id);
+// }
+//
+// svcx_string_builder sb;
+// svcx_sb_init(&sb, svcx_default_allocator());
+// svcx_roaring_serialize(&ids, &sb);
+//
+// svcx_roaring_free(&ids);
+// svcx_sb_free(&sb);
+// ```
+//
+SVCXDEF void svcx_roaring_init(svcx_roaring *r, svcx_allocator a);
+SVCXDEF void svcx_roaring_free(svcx_roaring *r);
+SVCXDEF void svcx_roaring_clear(svcx_roaring *r);
+SVCXDEF svcx_result svcx_roaring_add(svcx_roaring *r, uint32_t value);
+SVCXDEF svcx_result svcx_roaring_remove(svcx_roaring *r, uint32_t value);
+SVCXDEF bool svcx_roaring_contains(const svcx_roaring *r, uint32_t value);
+SVCXDEF uint64_t svcx_roaring_cardinality(const svcx_roaring *r);
+SVCXDEF svcx_result svcx_roaring_and(
+    svcx_roaring *out, const svcx_roaring *a, const svcx_roaring *b);
+SVCXDEF svcx_result svcx_roaring_or(
+    svcx_roaring *out, const svcx_roaring *a, const svcx_roaring *b);
+SVCXDEF svcx_result svcx_roaring_xor(
+    svcx_roaring *out, const svcx_roaring *a, const svcx_roaring *b);
+SVCXDEF svcx_result svcx_roaring_andnot(
+    svcx_roaring *out, const svcx_roaring *a, const svcx_roaring *b);
+SVCXDEF svcx_result svcx_roaring_run_optimize(svcx_roaring *r);
+SVCXDEF void svcx_roaring_iter_init(
+    svcx_roaring_iter *it, const svcx_roaring *r);
+SVCXDEF bool svcx_roaring_iter_next(svcx_roaring_iter *it, uint32_t *value);
+SVCXDEF svcx_result svcx_roaring_serialize(
+    const svcx_roaring *r, svcx_string_builder *sb);
+SVCXDEF svcx_result svcx_roaring_deserialize(
+    svcx_roaring *r, svcx_string_view sv);
+
+#ifdef SVCX_IMPLEMENTATION
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <limits.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if !defined(SVCX_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define SVCX__SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(SVCX__SSE2) && !defined(SVCX_NO_AVX2) &&                           \
+    defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SVCX__AVX2
+#include <immintrin.h>
+#define SVCX__AVX2_FN __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#endif
+
+SVCXDEF bool svcx_cpu_has_avx2(void) {
+#ifdef SVCX__AVX2
+    // The same features that SVCX__AVX2_FN lets the compiler use.
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") &&
+           __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+#else
+    return false;
+#endif
+}
+
+// Calls the AVX2 or the SSE2 variant of an internal function, depending on
+// the CPU, or evaluates to 0 when SIMD is disabled. Both variants must exist
+// and return the amount of work they did, which the caller finishes with its
+// scalar code.
+#if defined(SVCX__AVX2)
+#define SVCX__SIMD_CALL(fn, ...)                                               \
+    (svcx_cpu_has_avx2() ? fn##_avx2(__VA_ARGS__) : fn##_sse2(__VA_ARGS__))
+#elif defined(SVCX__SSE2)
+#define SVCX__SIMD_CALL(fn, ...) fn##_sse2(__VA_ARGS__)
+#else
+#define SVCX__SIMD_CALL(fn, ...) ((size_t)0)
+#endif
+
+// Calls the AVX2 variant of an internal function on CPUs that have AVX2, or
+// evaluates to 0, for kernels that SSE2 lacks the instructions for. Only the
+// AVX2 variant exists, and the caller does all of the work otherwise.
+#if defined(SVCX__AVX2)
+#define SVCX__AVX2_CALL(fn, ...)                                               \
+    (svcx_cpu_has_avx2() ? fn##_avx2(__VA_ARGS__) : (size_t)0)
+#else
+#define SVCX__AVX2_CALL(fn, ...) ((size_t)0)
+#endif
+
+//
+// Internal bit manipulation helpers. The builtins compile to single
+// instructions where the target supports them.
+//
+static int svcx__ctz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static int svcx__clz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while (!(x & (1ULL << 63))) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static int svcx__popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+SVCXDEF const char *svcx_error_string(svcx_result r) {
+    switch (r) {
+    case SVCX_OK:
+        return "no error";
+    case SVCX_VEC_GROW_MEM_ERR:
+        return "vector grow could not allocate memory";
+    case SVCX_VEC_ERR_OOM:
+        return "vector reserve out of memory";
+    case SVCX_VEC_PUSH_GROW_ERR:
+        return "vector push could not grow vector";
+    case SVCX_VEC_POP_EMPTY_ERR:
+        return "vector is empty on pop";
+    case SVCX_VEC_INSERT_OOB:
+        return "index out of bounds on vector insert";
+    case SVCX_VEC_INSERT_GROW_ERR:
+        return "vector insert could not grow memory";
+    case SVCX_VEC_APPEND_STRIDE_ERR:
+        return "vectors differ in stride values on append";
+    case SVCX_VEC_APPEND_GROW_ERR:
+        return "vector append could not grow vector";
+    case SVCX_VEC_FROM_ARR_MALLOC_ERR:
+        return "vector from array could not malloc memory";
+    case SVCX_DEQ_GROW_MEM_ERR:
+        return "deque grow could not allocate memory";
+    case SVCX_DEQ_FIXED_CAP_ERR:
+        return "fixed capacity deque cannot grow";
+    case SVCX_DEQ_INIT_ALLOC_ERR:
+        return "fixed deque init could not allocate memory";
+    case SVCX_DEQ_PUSH_GROW_ERR:
+        return "deque push could not grow deque";
+    case SVCX_DEQ_POP_EMPTY_ERR:
+        return "deque is empty on pop";
+    case SVCX_BITSET_ALLOC_ERR:
+        return "bitset could not allocate memory";
+    case SVCX_BITSET_SIZE_MISMATCH_ERR:
+        return "bitsets differ in size";
+    case SVCX_BITSET_RANK_ALLOC_ERR:
+        return "bitset could not allocate memory for rank index";
+    case SVCX_KERNEL_EMPTY_ERR:
+        return "kernel requires a non-empty span";
+    case SVCX_KERNEL_LENGTH_ERR:
+        return "kernel spans differ in length";
+    case SVCX_SV_SPLIT_ERR:
+        return "string view split could not push to output vector";
+    case SVCX_SB_PUSHC_ERR:
+        return "string builder could not push char to internal vector";
     case SVCX_SB_APPEND_ERR:
         return "string builder could not reserve memory for append";
     case SVCX_SB_APPEND_SV_ERR:
@@ -641,560 +2649,9379 @@ SVCXDEF const char *svcx_error_string(svcx_result r) {
         return "string builder invalid arguments provided to format";
     case SVCX_SB_FMT_RESERVE_ERR:
         return "string builder could not reserve memory for format";
+    case SVCX_SB_APPEND_NUM_ERR:
+        return "string builder could not reserve memory for number";
+    case SVCX_SB_FLUSH_ERR:
+        return "string builder could not write to its sink";
+    case SVCX_SB_ESCAPE_RESERVE_ERR:
+        return "string builder could not reserve memory for escaping";
+    case SVCX_SB_UNESCAPE_INVALID_ERR:
+        return "string builder was given a malformed escaped string";
+    case SVCX_SB_ENCODE_RESERVE_ERR:
+        return "string builder could not reserve memory for encoding";
+    case SVCX_SB_CASE_RESERVE_ERR:
+        return "string builder could not reserve memory for case conversion";
+    case SVCX_DECODE_INVALID_ERR:
+        return "decoder was given malformed input";
+    case SVCX_DECODE_SPACE_ERR:
+        return "decoder output buffer is too small";
+    case SVCX_DECODE_ALLOC_ERR:
+        return "decoder could not allocate memory for output";
+    case SVCX_TMPL_SYNTAX_ERR:
+        return "template format is malformed";
+    case SVCX_TMPL_ALLOC_ERR:
+        return "template could not allocate memory";
+    case SVCX_TMPL_RENDER_ERR:
+        return "template could not reserve memory for rendering";
+    case SVCX_GB_ALLOC_ERR:
+        return "gather builder could not allocate memory";
+    case SVCX_GB_WRITE_ERR:
+        return "gather builder could not write its slices";
+    case SVCX_FILE_OPEN_ERR:
+        return "file could not be opened";
+    case SVCX_FILE_READ_ERR:
+        return "file could not be read";
+    case SVCX_FILE_ALLOC_ERR:
+        return "file could not be loaded due to failed allocation";
+    case SVCX_LR_ALLOC_ERR:
+        return "line reader could not allocate its buffer";
+    case SVCX_LR_READ_ERR:
+        return "line reader could not read its input";
+    case SVCX_LR_LINE_TOO_LONG_ERR:
+        return "line reader found a line longer than its buffer";
+    case SVCX_AC_EMPTY_PATTERN_ERR:
+        return "aho-corasick patterns must not be empty";
+    case SVCX_AC_ALLOC_ERR:
+        return "aho-corasick automaton could not allocate memory";
+    case SVCX_AC_PUSH_ERR:
+        return "aho-corasick could not push match to output vector";
+    case SVCX_MAP_ALLOC_ERR:
+        return "map could not allocate memory for table";
+    case SVCX_CMAP_ALLOC_ERR:
+        return "concurrent map could not allocate memory";
+    case SVCX_INTERNER_ALLOC_ERR:
+        return "interner could not allocate memory";
+    case SVCX_PARSE_INVALID_ERR:
+        return "string view does not start with a number";
+    case SVCX_PARSE_RANGE_ERR:
+        return "parsed number is out of range";
+    case SVCX_UTF8_INVALID_ERR:
+        return "string is not valid UTF-8";
+    case SVCX_UTF8_ALLOC_ERR:
+        return "UTF-8 transcoding could not allocate memory for output";
+    case SVCX_ROARING_ALLOC_ERR:
+        return "roaring bitmap could not allocate memory";
+    case SVCX_ROARING_SERIALIZE_ERR:
+        return "roaring bitmap could not reserve memory for serialization";
+    case SVCX_ROARING_DESERIALIZE_ERR:
+        return "roaring bitmap serialized data is malformed";
     default:
         return "unknown error";
     }
 }
 
-SVCXDEF void *svcx__malloc(void *ctx, size_t size) {
-    SVCX_UNUSED(ctx);
-    return malloc(size);
+SVCXDEF void *svcx__malloc(void *ctx, size_t size) {
+    SVCX_UNUSED(ctx);
+    return malloc(size);
+}
+
+SVCXDEF void *svcx__realloc(void *ctx, void *ptr, size_t size) {
+    SVCX_UNUSED(ctx);
+    return realloc(ptr, size);
+}
+
+SVCXDEF void svcx__free(void *ctx, void *ptr) {
+    SVCX_UNUSED(ctx);
+    free(ptr);
+}
+
+SVCXDEF svcx_allocator svcx_default_allocator(void) {
+    svcx_allocator a = {
+        .alloc = svcx__malloc,
+        .realloc = svcx__realloc,
+        .free = svcx__free,
+        .ctx = NULL,
+    };
+    return a;
+}
+
+SVCXDEF void *svcx_alloc(svcx_allocator *a, size_t size) {
+    return a->alloc(a->ctx, size);
+}
+
+SVCXDEF void *svcx_realloc(svcx_allocator *a, void *ptr, size_t size) {
+    return a->realloc(a->ctx, ptr, size);
+}
+
+SVCXDEF void svcx_free(svcx_allocator *a, void *ptr) { a->free(a->ctx, ptr); }
+
+SVCXDEF bool svcx_allocator_is_valid(const svcx_allocator *a) {
+    return a && a->alloc && a->free;
+}
+
+SVCXDEF void *svcx_alloc_zero(svcx_allocator *a, size_t size) {
+    void *p = svcx_alloc(a, size);
+    if (p) {
+        memset(p, 0, size);
+    }
+    return p;
+}
+
+SVCXDEF svcx_allocator svcx_arena_allocator(svcx_arena *arena) {
+    svcx_allocator a = {.alloc = svcx_arena_alloc,
+        .realloc = svcx_arena_realloc,
+        .free = svcx_arena_free,
+        .ctx = arena};
+    return a;
+}
+
+SVCXDEF void svcx_arena_init(svcx_arena *arena, size_t size) {
+    arena->base = malloc(size);
+    arena->size = size;
+    arena->used = 0;
+}
+
+SVCXDEF void *svcx_arena_alloc(void *ctx, size_t size) {
+    svcx_arena *arena = (svcx_arena *)ctx;
+
+    size = (size + 7) & ~7; // Align to 8 bytes
+
+    if (arena->used + size > arena->size) {
+        return NULL;
+    }
+
+    void *ptr = arena->base + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+SVCXDEF void *svcx_arena_realloc(void *ctx, void *ptr, size_t size) {
+    SVCX_UNSUPPORTED("Reallocation is not supported in arenas.");
+    SVCX_UNUSED(ctx);
+    SVCX_UNUSED(ptr);
+    SVCX_UNUSED(size);
+    return NULL;
+}
+
+SVCXDEF void svcx_arena_free(void *ctx, void *ptr) {
+    SVCX_UNUSED(ctx);
+    SVCX_UNUSED(ptr);
+    // A free in an arena is a no-op
+}
+
+SVCXDEF void svcx_arena_reset(svcx_arena *arena) { arena->used = 0; }
+
+SVCXDEF void svcx_arena_free_all(svcx_arena *arena) {
+    free(arena->base);
+    arena->size = 0;
+    arena->used = 0;
+}
+
+SVCXDEF svcx_result _svcx_vector_grow(svcx_vector *v, size_t min_cap) {
+    size_t new_cap = v->cap ? v->cap * 2 : 8;
+    if (new_cap < min_cap) {
+        new_cap = min_cap;
+    }
+
+    // We cannot use svcx_realloc here in case the user uses an allocator
+    // that does not support realloc (like arena).
+    // void *new_data = svcx_realloc(&v->a, v->data, new_cap * v->stride);
+
+    size_t new_size = new_cap * v->stride;
+    void *new_data;
+    if (v->data) {
+        new_data = svcx_alloc(&v->a, new_size);
+        if (!new_data) {
+            return SVCX_VEC_GROW_MEM_ERR;
+        }
+
+        memcpy(new_data, v->data, v->size * v->stride);
+        svcx_free(&v->a, v->data);
+    } else {
+        new_data = svcx_alloc(&v->a, new_size);
+        if (!new_data) {
+            return SVCX_VEC_GROW_MEM_ERR;
+        }
+    }
+
+    v->data = new_data;
+    v->cap = new_cap;
+    return SVCX_OK;
+}
+
+SVCXDEF void svcx_vector_init(svcx_vector *v, size_t stride, svcx_allocator a) {
+    v->data = NULL;
+    v->size = 0;
+    v->cap = 0;
+    v->stride = stride;
+    v->a = a;
+}
+
+SVCXDEF void svcx_vector_clear(svcx_vector *v) {
+    SVCX_ASSERT(v);
+    v->size = 0;
+}
+
+SVCXDEF svcx_result svcx_vector_reserve(svcx_vector *v, size_t min_cap) {
+    if (min_cap <= v->cap) {
+        return SVCX_OK;
+    }
+
+    size_t new_cap = v->cap ? v->cap : 8;
+
+    while (new_cap < min_cap) {
+        new_cap *= 2;
+    }
+
+    size_t new_size_bytes = new_cap * v->stride;
+
+    void *new_data = svcx_alloc(&v->a, new_size_bytes);
+    if (!new_data) {
+        return SVCX_VEC_ERR_OOM;
+    }
+
+    if (v->data && v->size > 0) {
+        memcpy(new_data, v->data, v->size * v->stride);
+    }
+
+    if (v->data) {
+        svcx_free(&v->a, v->data);
+    }
+
+    v->data = new_data;
+    v->cap = new_cap;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_vector_push(svcx_vector *v, const void *elem) {
+    SVCX_ASSERT(v);
+
+    if (v->size == v->cap) {
+        int err = _svcx_vector_grow(v, v->size + 1);
+        if (err != 0) {
+            return SVCX_VEC_PUSH_GROW_ERR;
+        }
+    }
+
+    void *dst = (char *)v->data + v->size * v->stride;
+    memcpy(dst, elem, v->stride);
+    v->size++;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_vector_pop(svcx_vector *v, void *out_elem) {
+    SVCX_ASSERT(v);
+
+    if (v->size == 0) {
+        return SVCX_VEC_POP_EMPTY_ERR;
+    }
+
+    v->size--;
+
+    if (out_elem) {
+        void *src = (char *)v->data + v->size * v->stride;
+        memcpy(out_elem, src, v->stride);
+    }
+
+    return SVCX_OK;
+}
+
+SVCXDEF void *svcx_vector_at(svcx_vector *v, size_t index) {
+    SVCX_ASSERT(v);
+
+    if (index >= v->size) {
+        return NULL;
+    }
+
+    return (char *)v->data + index * v->stride;
+}
+
+SVCXDEF svcx_result svcx_vector_insert(
+    svcx_vector *v, size_t index, const void *elem) {
+    SVCX_ASSERT(v);
+    if (index > v->size) {
+        return SVCX_VEC_INSERT_OOB;
+    }
+
+    if (v->size == v->cap) {
+        int err = _svcx_vector_grow(v, v->size + 1);
+        if (err != 0) {
+            return SVCX_VEC_INSERT_GROW_ERR;
+        }
+    }
+
+    void *dst = (char *)v->data + index * v->stride;
+    memmove((char *)dst + v->stride, dst, (v->size - index) * v->stride);
+
+    memcpy(dst, elem, v->stride);
+    v->size++;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_vector_append(
+    svcx_vector *dst, const svcx_vector *src) {
+    SVCX_ASSERT(dst);
+    SVCX_ASSERT(src);
+
+    if (dst->stride != src->stride) {
+        return SVCX_VEC_APPEND_STRIDE_ERR;
+    }
+
+    size_t new_size = dst->size + src->size;
+
+    if (new_size > dst->cap) {
+        int err = _svcx_vector_grow(dst, new_size);
+        if (err != 0) {
+            return SVCX_VEC_APPEND_GROW_ERR;
+        }
+    }
+
+    memcpy((char *)dst->data + dst->size * dst->stride,
+        src->data,
+        src->size * src->stride);
+    dst->size = new_size;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_vector_from_array(svcx_vector *v,
+    const void *array,
+    size_t count,
+    size_t stride,
+    svcx_allocator a) {
+    svcx_vector_init(v, stride, a);
+
+    if (count == 0) {
+        return 0;
+    }
+
+    v->data = (void *)svcx_alloc(&v->a, count * stride);
+    if (!v->data) {
+        return SVCX_VEC_FROM_ARR_MALLOC_ERR;
+    }
+
+    memcpy(v->data, array, count * stride);
+    v->size = count;
+    v->cap = count;
+    return SVCX_OK;
+}
+
+SVCXDEF void svcx_vector_free(svcx_vector *v) {
+    SVCX_ASSERT(v);
+
+    if (v->data) {
+        svcx_free(&v->a, v->data);
+    }
+
+    v->data = NULL;
+    v->size = 0;
+    v->cap = 0;
+}
+
+SVCXDEF size_t svcx_vector_size(svcx_vector *v) {
+    SVCX_ASSERT(v);
+    return v->size;
+}
+
+SVCXDEF svcx_span svcx_span_from_parts(
+    const void *data, size_t count, size_t stride) {
+    svcx_span s;
+    s.data = data;
+    s.count = count;
+    s.stride = stride;
+    return s;
+}
+
+SVCXDEF svcx_span svcx_span_from_vector(const svcx_vector *v) {
+    SVCX_ASSERT(v);
+    return svcx_span_from_parts(v->data, v->size, v->stride);
+}
+
+SVCXDEF const void *svcx_span_at(svcx_span s, size_t index) {
+    if (index >= s.count) {
+        return NULL;
+    }
+    return (const char *)s.data + index * s.stride;
+}
+
+SVCXDEF svcx_span svcx_span_subspan(svcx_span s, size_t start, size_t count) {
+    SVCX_ASSERT(start <= s.count);
+
+    if (start > s.count) {
+        start = s.count;
+    }
+    if (count > s.count - start) {
+        count = s.count - start;
+    }
+
+    return svcx_span_from_parts(
+        (const char *)s.data + start * s.stride, count, s.stride);
+}
+
+SVCXDEF svcx_span svcx_span_slice(svcx_span s, size_t start, size_t end) {
+    SVCX_ASSERT(start <= end);
+
+    if (start > end) {
+        start = end;
+    }
+    return svcx_span_subspan(s, start, end - start);
+}
+
+SVCXDEF svcx_span svcx_span_strided(svcx_span s, size_t step) {
+    SVCX_ASSERT(step > 0);
+
+    if (step <= 1) {
+        return s;
+    }
+    return svcx_span_from_parts(
+        s.data, (s.count + step - 1) / step, s.stride * step);
+}
+
+SVCXDEF svcx_result svcx_vector_append_span(svcx_vector *dst, svcx_span src) {
+    SVCX_ASSERT(dst);
+    SVCX_ASSERT(src.data || src.count == 0);
+
+    size_t new_size = dst->size + src.count;
+
+    if (new_size > dst->cap) {
+        // The span may point into the vector itself, in which case it has to
+        // follow the elements into the grown buffer.
+        uintptr_t old = (uintptr_t)dst->data;
+        uintptr_t from = (uintptr_t)src.data;
+        bool inside = dst->data && from >= old &&
+                      from < old + dst->size * dst->stride;
+
+        int err = _svcx_vector_grow(dst, new_size);
+        if (err != 0) {
+            return SVCX_VEC_APPEND_GROW_ERR;
+        }
+
+        if (inside) {
+            src.data = (char *)dst->data + (from - old);
+        }
+    }
+
+    char *out = (char *)dst->data + dst->size * dst->stride;
+    if (src.stride == dst->stride) {
+        memcpy(out, src.data, src.count * src.stride);
+    } else {
+        for (size_t i = 0; i < src.count; i++) {
+            memcpy(out + i * dst->stride,
+                (const char *)src.data + i * src.stride,
+                dst->stride);
+        }
+    }
+
+    dst->size = new_size;
+    return SVCX_OK;
+}
+
+SVCXDEF void svcx_vector_adopt(svcx_vector *v,
+    void *data,
+    size_t count,
+    size_t cap,
+    size_t stride,
+    svcx_allocator a) {
+    SVCX_ASSERT(count <= cap);
+    SVCX_ASSERT(data || cap == 0);
+
+    svcx_vector_init(v, stride, a);
+    v->data = data;
+    v->size = count;
+    v->cap = cap;
+}
+
+//
+// Numeric kernels. The SIMD variants process the longest prefix of the input
+// that fills whole registers, fold their partial results into the values the
+// caller passes in and return the number of elements they processed. The
+// public functions then finish the tail (or the whole span, if it is strided
+// or SIMD is disabled) with a scalar loop.
+//
+#define SVCX__SPAN_GET(s, T, i)                                                \
+    (*(const T *)((const char *)(s).data + (i) * (s).stride))
+
+#ifdef SVCX__SSE2
+// SSE2 lacks the signed 32-bit min/max (SSE4.1) instructions.
+static __m128i svcx__min_epi32_sse2(__m128i a, __m128i b) {
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+static __m128i svcx__max_epi32_sse2(__m128i a, __m128i b) {
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+static size_t svcx__sum_i32_sse2(const int32_t *p, size_t n, uint64_t *sum) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i sign = _mm_cmpgt_epi32(_mm_setzero_si128(), v);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, sign));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, sign));
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    *sum += lanes[0] + lanes[1];
+    return i;
+}
+
+static size_t svcx__sum_i64_sse2(const int64_t *p, size_t n, uint64_t *sum) {
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_epi64(acc0, _mm_loadu_si128((const __m128i *)(p + i)));
+        acc1 = _mm_add_epi64(
+            acc1, _mm_loadu_si128((const __m128i *)(p + i + 2)));
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(acc0, acc1));
+    *sum += lanes[0] + lanes[1];
+    return i;
+}
+
+static size_t svcx__sum_f32_sse2(const float *p, size_t n, double *sum) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(p + i);
+        acc0 = _mm_add_pd(acc0, _mm_cvtps_pd(v));
+        acc1 = _mm_add_pd(acc1, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    *sum += lanes[0] + lanes[1];
+    return i;
+}
+
+static size_t svcx__sum_f64_sse2(const double *p, size_t n, double *sum) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(p + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(p + i + 2));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    *sum += lanes[0] + lanes[1];
+    return i;
+}
+
+static size_t svcx__minmax_i32_sse2(
+    const int32_t *p, size_t n, int32_t *min, int32_t *max) {
+    __m128i lo = _mm_set1_epi32(*min);
+    __m128i hi = _mm_set1_epi32(*max);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        lo = svcx__min_epi32_sse2(lo, v);
+        hi = svcx__max_epi32_sse2(hi, v);
+    }
+
+    int32_t lanes_lo[4], lanes_hi[4];
+    _mm_storeu_si128((__m128i *)lanes_lo, lo);
+    _mm_storeu_si128((__m128i *)lanes_hi, hi);
+    for (int k = 0; k < 4; k++) {
+        *min = lanes_lo[k] < *min ? lanes_lo[k] : *min;
+        *max = lanes_hi[k] > *max ? lanes_hi[k] : *max;
+    }
+    return i;
+}
+
+static size_t svcx__minmax_f32_sse2(
+    const float *p, size_t n, float *min, float *max) {
+    __m128 lo = _mm_set1_ps(*min);
+    __m128 hi = _mm_set1_ps(*max);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(p + i);
+        lo = _mm_min_ps(lo, v);
+        hi = _mm_max_ps(hi, v);
+    }
+
+    float lanes_lo[4], lanes_hi[4];
+    _mm_storeu_ps(lanes_lo, lo);
+    _mm_storeu_ps(lanes_hi, hi);
+    for (int k = 0; k < 4; k++) {
+        *min = lanes_lo[k] < *min ? lanes_lo[k] : *min;
+        *max = lanes_hi[k] > *max ? lanes_hi[k] : *max;
+    }
+    return i;
+}
+
+static size_t svcx__minmax_f64_sse2(
+    const double *p, size_t n, double *min, double *max) {
+    __m128d lo = _mm_set1_pd(*min);
+    __m128d hi = _mm_set1_pd(*max);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(p + i);
+        lo = _mm_min_pd(lo, v);
+        hi = _mm_max_pd(hi, v);
+    }
+
+    double lanes_lo[2], lanes_hi[2];
+    _mm_storeu_pd(lanes_lo, lo);
+    _mm_storeu_pd(lanes_hi, hi);
+    for (int k = 0; k < 2; k++) {
+        *min = lanes_lo[k] < *min ? lanes_lo[k] : *min;
+        *max = lanes_hi[k] > *max ? lanes_hi[k] : *max;
+    }
+    return i;
+}
+
+static size_t svcx__dot_f32_sse2(
+    const float *a, const float *b, size_t n, double *sum) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(a + i);
+        __m128 y = _mm_loadu_ps(b + i);
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_cvtps_pd(x), _mm_cvtps_pd(y)));
+        acc1 = _mm_add_pd(acc1,
+            _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)),
+                _mm_cvtps_pd(_mm_movehl_ps(y, y))));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    *sum += lanes[0] + lanes[1];
+    return i;
+}
+
+static size_t svcx__dot_f64_sse2(
+    const double *a, const double *b, size_t n, double *sum) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(
+            acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1,
+            _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    *sum += lanes[0] + lanes[1];
+    return i;
+}
+
+static size_t svcx__clamp_i32_sse2(
+    const int32_t *p, size_t n, int32_t lo, int32_t hi, int32_t *out) {
+    __m128i vlo = _mm_set1_epi32(lo);
+    __m128i vhi = _mm_set1_epi32(hi);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        v = svcx__min_epi32_sse2(svcx__max_epi32_sse2(v, vlo), vhi);
+        _mm_storeu_si128((__m128i *)(out + i), v);
+    }
+    return i;
+}
+
+// The bound is the first operand of maxps/minps, so NaN elements are passed
+// through unchanged, the same as in the scalar loop.
+static size_t svcx__clamp_f32_sse2(
+    const float *p, size_t n, float lo, float hi, float *out) {
+    __m128 vlo = _mm_set1_ps(lo);
+    __m128 vhi = _mm_set1_ps(hi);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(p + i);
+        _mm_storeu_ps(out + i, _mm_min_ps(vhi, _mm_max_ps(vlo, v)));
+    }
+    return i;
+}
+
+static size_t svcx__clamp_f64_sse2(
+    const double *p, size_t n, double lo, double hi, double *out) {
+    __m128d vlo = _mm_set1_pd(lo);
+    __m128d vhi = _mm_set1_pd(hi);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(p + i);
+        _mm_storeu_pd(out + i, _mm_min_pd(vhi, _mm_max_pd(vlo, v)));
+    }
+    return i;
+}
+#endif // SVCX__SSE2
+
+#ifdef SVCX__AVX2
+SVCX__AVX2_FN static size_t svcx__sum_i32_avx2(
+    const int32_t *p, size_t n, uint64_t *sum) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        acc0 = _mm256_add_epi64(
+            acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc1 = _mm256_add_epi64(
+            acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+    *sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__sum_i64_avx2(
+    const int64_t *p, size_t n, uint64_t *sum) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_epi64(
+            acc0, _mm256_loadu_si256((const __m256i *)(p + i)));
+        acc1 = _mm256_add_epi64(
+            acc1, _mm256_loadu_si256((const __m256i *)(p + i + 4)));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+    *sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__sum_f32_avx2(
+    const float *p, size_t n, double *sum) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(p + i);
+        acc0 = _mm256_add_pd(
+            acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+        acc1 = _mm256_add_pd(
+            acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    *sum += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__sum_f64_avx2(
+    const double *p, size_t n, double *sum) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(p + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(p + i + 4));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    *sum += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__minmax_i32_avx2(
+    const int32_t *p, size_t n, int32_t *min, int32_t *max) {
+    __m256i lo = _mm256_set1_epi32(*min);
+    __m256i hi = _mm256_set1_epi32(*max);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        lo = _mm256_min_epi32(lo, v);
+        hi = _mm256_max_epi32(hi, v);
+    }
+
+    int32_t lanes_lo[8], lanes_hi[8];
+    _mm256_storeu_si256((__m256i *)lanes_lo, lo);
+    _mm256_storeu_si256((__m256i *)lanes_hi, hi);
+    for (int k = 0; k < 8; k++) {
+        *min = lanes_lo[k] < *min ? lanes_lo[k] : *min;
+        *max = lanes_hi[k] > *max ? lanes_hi[k] : *max;
+    }
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__minmax_i64_avx2(
+    const int64_t *p, size_t n, int64_t *min, int64_t *max) {
+    __m256i lo = _mm256_set1_epi64x(*min);
+    __m256i hi = _mm256_set1_epi64x(*max);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        lo = _mm256_blendv_epi8(lo, v, _mm256_cmpgt_epi64(lo, v));
+        hi = _mm256_blendv_epi8(hi, v, _mm256_cmpgt_epi64(v, hi));
+    }
+
+    int64_t lanes_lo[4], lanes_hi[4];
+    _mm256_storeu_si256((__m256i *)lanes_lo, lo);
+    _mm256_storeu_si256((__m256i *)lanes_hi, hi);
+    for (int k = 0; k < 4; k++) {
+        *min = lanes_lo[k] < *min ? lanes_lo[k] : *min;
+        *max = lanes_hi[k] > *max ? lanes_hi[k] : *max;
+    }
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__minmax_f32_avx2(
+    const float *p, size_t n, float *min, float *max) {
+    __m256 lo = _mm256_set1_ps(*min);
+    __m256 hi = _mm256_set1_ps(*max);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(p + i);
+        lo = _mm256_min_ps(lo, v);
+        hi = _mm256_max_ps(hi, v);
+    }
+
+    float lanes_lo[8], lanes_hi[8];
+    _mm256_storeu_ps(lanes_lo, lo);
+    _mm256_storeu_ps(lanes_hi, hi);
+    for (int k = 0; k < 8; k++) {
+        *min = lanes_lo[k] < *min ? lanes_lo[k] : *min;
+        *max = lanes_hi[k] > *max ? lanes_hi[k] : *max;
+    }
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__minmax_f64_avx2(
+    const double *p, size_t n, double *min, double *max) {
+    __m256d lo = _mm256_set1_pd(*min);
+    __m256d hi = _mm256_set1_pd(*max);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(p + i);
+        lo = _mm256_min_pd(lo, v);
+        hi = _mm256_max_pd(hi, v);
+    }
+
+    double lanes_lo[4], lanes_hi[4];
+    _mm256_storeu_pd(lanes_lo, lo);
+    _mm256_storeu_pd(lanes_hi, hi);
+    for (int k = 0; k < 4; k++) {
+        *min = lanes_lo[k] < *min ? lanes_lo[k] : *min;
+        *max = lanes_hi[k] > *max ? lanes_hi[k] : *max;
+    }
+    return i;
+}
+
+// The elements are sign extended into 64-bit lanes, where vpmuldq multiplies
+// the low halves into full 64-bit products.
+SVCX__AVX2_FN static size_t svcx__dot_i32_avx2(
+    const int32_t *a, const int32_t *b, size_t n, uint64_t *sum) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        acc0 = _mm256_add_epi64(acc0,
+            _mm256_mul_epi32(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)),
+                _mm256_cvtepi32_epi64(_mm256_castsi256_si128(y))));
+        acc1 = _mm256_add_epi64(acc1,
+            _mm256_mul_epi32(
+                _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)),
+                _mm256_cvtepi32_epi64(_mm256_extracti128_si256(y, 1))));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+    *sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return i;
+}
+
+// AVX2 has no 64-bit multiply (vpmullq is AVX-512), so the scalar loop is used.
+SVCX__AVX2_FN static size_t svcx__dot_i64_avx2(
+    const int64_t *a, const int64_t *b, size_t n, uint64_t *sum) {
+    SVCX_UNUSED(a);
+    SVCX_UNUSED(b);
+    SVCX_UNUSED(n);
+    SVCX_UNUSED(sum);
+    return 0;
+}
+
+SVCX__AVX2_FN static size_t svcx__dot_f32_avx2(
+    const float *a, const float *b, size_t n, double *sum) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(a + i);
+        __m256 y = _mm256_loadu_ps(b + i);
+        acc0 = _mm256_add_pd(acc0,
+            _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(x)),
+                _mm256_cvtps_pd(_mm256_castps256_ps128(y))));
+        acc1 = _mm256_add_pd(acc1,
+            _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)),
+                _mm256_cvtps_pd(_mm256_extractf128_ps(y, 1))));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    *sum += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__dot_f64_avx2(
+    const double *a, const double *b, size_t n, double *sum) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0,
+            _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1,
+            _mm256_mul_pd(
+                _mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    *sum += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__clamp_i32_avx2(
+    const int32_t *p, size_t n, int32_t lo, int32_t hi, int32_t *out) {
+    __m256i vlo = _mm256_set1_epi32(lo);
+    __m256i vhi = _mm256_set1_epi32(hi);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        v = _mm256_min_epi32(_mm256_max_epi32(v, vlo), vhi);
+        _mm256_storeu_si256((__m256i *)(out + i), v);
+    }
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__clamp_i64_avx2(
+    const int64_t *p, size_t n, int64_t lo, int64_t hi, int64_t *out) {
+    __m256i vlo = _mm256_set1_epi64x(lo);
+    __m256i vhi = _mm256_set1_epi64x(hi);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        v = _mm256_blendv_epi8(v, vlo, _mm256_cmpgt_epi64(vlo, v));
+        v = _mm256_blendv_epi8(v, vhi, _mm256_cmpgt_epi64(v, vhi));
+        _mm256_storeu_si256((__m256i *)(out + i), v);
+    }
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__clamp_f32_avx2(
+    const float *p, size_t n, float lo, float hi, float *out) {
+    __m256 vlo = _mm256_set1_ps(lo);
+    __m256 vhi = _mm256_set1_ps(hi);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(p + i);
+        _mm256_storeu_ps(out + i, _mm256_min_ps(vhi, _mm256_max_ps(vlo, v)));
+    }
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__clamp_f64_avx2(
+    const double *p, size_t n, double lo, double hi, double *out) {
+    __m256d vlo = _mm256_set1_pd(lo);
+    __m256d vhi = _mm256_set1_pd(hi);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(p + i);
+        _mm256_storeu_pd(out + i, _mm256_min_pd(vhi, _mm256_max_pd(vlo, v)));
+    }
+    return i;
+}
+#endif // SVCX__AVX2
+
+//
+// The public kernels are the same for every element type apart from the
+// accumulator, so they are generated from a single definition. Integer sums
+// are accumulated as unsigned values, which makes overflow wrap instead of
+// being undefined. CMP_CALL dispatches minmax and clamp, and DOT_CALL the dot
+// product: SSE2 has no 64-bit compare (pcmpgtq is SSE4.2) and no signed
+// multiply (pmuldq is SSE4.1), so those only have AVX2 variants.
+//
+#define SVCX__DEFINE_KERNELS(T, name, SUM_T, ACC_T, CMP_CALL, DOT_CALL)        \
+    SVCXDEF SUM_T svcx_sum_##name(svcx_span s) {                               \
+        SVCX_ASSERT(s.data || s.count == 0);                                   \
+                                                                               \
+        ACC_T sum = 0;                                                         \
+        size_t i = 0;                                                          \
+        if (s.stride == sizeof(T)) {                                           \
+            i = SVCX__SIMD_CALL(svcx__sum_##name, s.data, s.count, &sum);      \
+        }                                                                      \
+        for (; i < s.count; i++) {                                             \
+            sum += (ACC_T)SVCX__SPAN_GET(s, T, i);                             \
+        }                                                                      \
+        return (SUM_T)sum;                                                     \
+    }                                                                          \
+                                                                               \
+    SVCXDEF svcx_result svcx_minmax_##name(svcx_span s, T *min, T *max) {      \
+        if (s.count == 0) {                                                    \
+            return SVCX_KERNEL_EMPTY_ERR;                                      \
+        }                                                                      \
+        SVCX_ASSERT(s.data);                                                   \
+                                                                               \
+        T lo = SVCX__SPAN_GET(s, T, 0);                                        \
+        T hi = lo;                                                             \
+        size_t i = 1;                                                          \
+        if (s.stride == sizeof(T)) {                                           \
+            i = CMP_CALL(svcx__minmax_##name, s.data, s.count, &lo, &hi);      \
+        }                                                                      \
+        for (; i < s.count; i++) {                                             \
+            T v = SVCX__SPAN_GET(s, T, i);                                     \
+            lo = v < lo ? v : lo;                                              \
+            hi = v > hi ? v : hi;                                              \
+        }                                                                      \
+                                                                               \
+        if (min) {                                                             \
+            *min = lo;                                                         \
+        }                                                                      \
+        if (max) {                                                             \
+            *max = hi;                                                         \
+        }                                                                      \
+        return SVCX_OK;                                                        \
+    }                                                                          \
+                                                                               \
+    SVCXDEF svcx_result svcx_argmin_##name(svcx_span s, size_t *index) {       \
+        SVCX_ASSERT(index);                                                    \
+                                                                               \
+        T target;                                                              \
+        svcx_result res = svcx_minmax_##name(s, &target, NULL);                \
+        if (res != SVCX_OK) {                                                  \
+            return res;                                                        \
+        }                                                                      \
+        size_t i = 0;                                                          \
+        while (SVCX__SPAN_GET(s, T, i) != target && i + 1 < s.count) {         \
+            i++;                                                               \
+        }                                                                      \
+        *index = i;                                                            \
+        return SVCX_OK;                                                        \
+    }                                                                          \
+                                                                               \
+    SVCXDEF svcx_result svcx_argmax_##name(svcx_span s, size_t *index) {       \
+        SVCX_ASSERT(index);                                                    \
+                                                                               \
+        T target;                                                              \
+        svcx_result res = svcx_minmax_##name(s, NULL, &target);                \
+        if (res != SVCX_OK) {                                                  \
+            return res;                                                        \
+        }                                                                      \
+        size_t i = 0;                                                          \
+        while (SVCX__SPAN_GET(s, T, i) != target && i + 1 < s.count) {         \
+            i++;                                                               \
+        }                                                                      \
+        *index = i;                                                            \
+        return SVCX_OK;                                                        \
+    }                                                                          \
+                                                                               \
+    SVCXDEF svcx_result svcx_dot_##name(                                       \
+        svcx_span a, svcx_span b, SUM_T *out) {                                \
+        SVCX_ASSERT(out);                                                      \
+        if (a.count != b.count) {                                              \
+            return SVCX_KERNEL_LENGTH_ERR;                                     \
+        }                                                                      \
+                                                                               \
+        ACC_T sum = 0;                                                         \
+        size_t i = 0;                                                          \
+        if (a.stride == sizeof(T) && b.stride == sizeof(T)) {                  \
+            i = DOT_CALL(svcx__dot_##name, a.data, b.data, a.count, &sum);     \
+        }                                                                      \
+        for (; i < a.count; i++) {                                             \
+            sum += (ACC_T)SVCX__SPAN_GET(a, T, i) *                            \
+                   (ACC_T)SVCX__SPAN_GET(b, T, i);                             \
+        }                                                                      \
+        *out = (SUM_T)sum;                                                     \
+        return SVCX_OK;                                                        \
+    }                                                                          \
+                                                                               \
+    SVCXDEF void svcx_clamp_##name(svcx_span s, T lo, T hi, T *out) {          \
+        SVCX_ASSERT(out || s.count == 0);                                      \
+        SVCX_ASSERT(!(hi < lo));                                               \
+                                                                               \
+        size_t i = 0;                                                          \
+        if (s.stride == sizeof(T)) {                                           \
+            i = CMP_CALL(svcx__clamp_##name, s.data, s.count, lo, hi, out);    \
+        }                                                                      \
+        for (; i < s.count; i++) {                                             \
+            T v = SVCX__SPAN_GET(s, T, i);                                     \
+            out[i] = v < lo ? lo : (v > hi ? hi : v);                          \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    SVCXDEF void svcx_histogram_##name(                                        \
+        svcx_span s, T lo, T hi, uint64_t *counts, size_t nbuckets) {          \
+        SVCX_ASSERT(counts && nbuckets > 0);                                   \
+        SVCX_ASSERT(lo < hi);                                                  \
+                                                                               \
+        double scale = (double)nbuckets / ((double)hi - (double)lo);           \
+        for (size_t i = 0; i < s.count; i++) {                                 \
+            T v = SVCX__SPAN_GET(s, T, i);                                     \
+            size_t bucket;                                                     \
+            if (v < lo) {                                                      \
+                bucket = 0;                                                    \
+            } else if (v < hi) {                                               \
+                bucket = (size_t)(((double)v - (double)lo) * scale);           \
+                bucket = bucket < nbuckets ? bucket : nbuckets - 1;            \
+            } else if (v >= hi) {                                              \
+                bucket = nbuckets - 1;                                         \
+            } else {                                                           \
+                continue; /* NaN */                                            \
+            }                                                                  \
+            counts[bucket]++;                                                  \
+        }                                                                      \
+    }
+
+SVCX__DEFINE_KERNELS(
+    int32_t, i32, int64_t, uint64_t, SVCX__SIMD_CALL, SVCX__AVX2_CALL)
+SVCX__DEFINE_KERNELS(
+    int64_t, i64, int64_t, uint64_t, SVCX__AVX2_CALL, SVCX__AVX2_CALL)
+SVCX__DEFINE_KERNELS(
+    float, f32, double, double, SVCX__SIMD_CALL, SVCX__SIMD_CALL)
+SVCX__DEFINE_KERNELS(
+    double, f64, double, double, SVCX__SIMD_CALL, SVCX__SIMD_CALL)
+
+// Prefix sums are sequential, so they are left to the compiler.
+#define SVCX__DEFINE_PREFIX_SUM(T, name, ACC_T)                                \
+    SVCXDEF void svcx_prefix_sum_##name(svcx_span s, T *out) {                 \
+        SVCX_ASSERT(out || s.count == 0);                                      \
+                                                                               \
+        ACC_T acc = 0;                                                         \
+        for (size_t i = 0; i < s.count; i++) {                                 \
+            acc += (ACC_T)SVCX__SPAN_GET(s, T, i);                             \
+            out[i] = (T)acc;                                                   \
+        }                                                                      \
+    }
+
+SVCX__DEFINE_PREFIX_SUM(int32_t, i32, uint32_t)
+SVCX__DEFINE_PREFIX_SUM(int64_t, i64, uint64_t)
+SVCX__DEFINE_PREFIX_SUM(float, f32, float)
+SVCX__DEFINE_PREFIX_SUM(double, f64, double)
+
+SVCXDEF svcx_result _svcx_deque_grow(svcx_deque *d, size_t min_cap) {
+    size_t new_cap = d->cap ? d->cap * 2 : 8;
+    while (new_cap < min_cap) {
+        new_cap *= 2;
+    }
+
+    void *new_data = svcx_alloc(&d->a, new_cap * d->stride);
+    if (!new_data) {
+        return SVCX_DEQ_GROW_MEM_ERR;
+    }
+
+    // Linearize the ring into the new buffer, so the head starts at 0.
+    if (d->data) {
+        void *first;
+        void *second;
+        size_t first_count;
+        size_t second_count;
+        svcx_deque_spans(d, &first, &first_count, &second, &second_count);
+
+        memcpy(new_data, first, first_count * d->stride);
+        memcpy((char *)new_data + first_count * d->stride,
+            second,
+            second_count * d->stride);
+        svcx_free(&d->a, d->data);
+    }
+
+    d->data = new_data;
+    d->head = 0;
+    d->cap = new_cap;
+    return SVCX_OK;
+}
+
+SVCXDEF void svcx_deque_init(svcx_deque *d, size_t stride, svcx_allocator a) {
+    d->data = NULL;
+    d->head = 0;
+    d->size = 0;
+    d->cap = 0;
+    d->stride = stride;
+    d->fixed = false;
+    d->a = a;
+}
+
+SVCXDEF svcx_result svcx_deque_init_fixed(
+    svcx_deque *d, size_t stride, size_t cap, svcx_allocator a) {
+    SVCX_ASSERT(cap > 0);
+    svcx_deque_init(d, stride, a);
+
+    size_t pow2 = 1;
+    while (pow2 < cap) {
+        pow2 *= 2;
+    }
+
+    d->data = svcx_alloc(&d->a, pow2 * stride);
+    if (!d->data) {
+        return SVCX_DEQ_INIT_ALLOC_ERR;
+    }
+
+    d->cap = pow2;
+    d->fixed = true;
+    return SVCX_OK;
+}
+
+SVCXDEF void svcx_deque_clear(svcx_deque *d) {
+    SVCX_ASSERT(d);
+    d->head = 0;
+    d->size = 0;
+}
+
+SVCXDEF svcx_result svcx_deque_reserve(svcx_deque *d, size_t min_cap) {
+    SVCX_ASSERT(d);
+
+    if (min_cap <= d->cap) {
+        return SVCX_OK;
+    }
+    if (d->fixed) {
+        return SVCX_DEQ_FIXED_CAP_ERR;
+    }
+
+    return _svcx_deque_grow(d, min_cap);
+}
+
+SVCXDEF svcx_result svcx_deque_push_back(svcx_deque *d, const void *elem) {
+    SVCX_ASSERT(d);
+
+    if (d->size == d->cap) {
+        if (d->fixed) {
+            // Overwrite the oldest element by moving the head past it.
+            memcpy((char *)d->data + d->head * d->stride, elem, d->stride);
+            d->head = (d->head + 1) & (d->cap - 1);
+            return SVCX_OK;
+        }
+
+        if (_svcx_deque_grow(d, d->size + 1) != SVCX_OK) {
+            return SVCX_DEQ_PUSH_GROW_ERR;
+        }
+    }
+
+    size_t tail = (d->head + d->size) & (d->cap - 1);
+    memcpy((char *)d->data + tail * d->stride, elem, d->stride);
+    d->size++;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_deque_push_front(svcx_deque *d, const void *elem) {
+    SVCX_ASSERT(d);
+
+    if (d->size == d->cap && !d->fixed) {
+        if (_svcx_deque_grow(d, d->size + 1) != SVCX_OK) {
+            return SVCX_DEQ_PUSH_GROW_ERR;
+        }
+    }
+
+    // In a full fixed deque, the new head slot is the slot of the last
+    // element, which gets overwritten.
+    d->head = (d->head - 1) & (d->cap - 1);
+    memcpy((char *)d->data + d->head * d->stride, elem, d->stride);
+    if (d->size < d->cap) {
+        d->size++;
+    }
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_deque_pop_back(svcx_deque *d, void *out_elem) {
+    SVCX_ASSERT(d);
+
+    if (d->size == 0) {
+        return SVCX_DEQ_POP_EMPTY_ERR;
+    }
+
+    d->size--;
+
+    if (out_elem) {
+        size_t index = (d->head + d->size) & (d->cap - 1);
+        memcpy(out_elem, (char *)d->data + index * d->stride, d->stride);
+    }
+
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_deque_pop_front(svcx_deque *d, void *out_elem) {
+    SVCX_ASSERT(d);
+
+    if (d->size == 0) {
+        return SVCX_DEQ_POP_EMPTY_ERR;
+    }
+
+    if (out_elem) {
+        memcpy(out_elem, (char *)d->data + d->head * d->stride, d->stride);
+    }
+
+    d->head = (d->head + 1) & (d->cap - 1);
+    d->size--;
+    return SVCX_OK;
+}
+
+SVCXDEF void *svcx_deque_at(svcx_deque *d, size_t index) {
+    SVCX_ASSERT(d);
+
+    if (index >= d->size) {
+        return NULL;
+    }
+
+    size_t slot = (d->head + index) & (d->cap - 1);
+    return (char *)d->data + slot * d->stride;
+}
+
+SVCXDEF void *svcx_deque_front(svcx_deque *d) { return svcx_deque_at(d, 0); }
+
+SVCXDEF void *svcx_deque_back(svcx_deque *d) {
+    SVCX_ASSERT(d);
+    return d->size ? svcx_deque_at(d, d->size - 1) : NULL;
+}
+
+SVCXDEF void svcx_deque_spans(svcx_deque *d,
+    void **first,
+    size_t *first_count,
+    void **second,
+    size_t *second_count) {
+    SVCX_ASSERT(d);
+
+    size_t until_end = d->cap - d->head;
+    *first = (char *)d->data + d->head * d->stride;
+    *second = d->data;
+
+    if (d->size <= until_end) {
+        *first_count = d->size;
+        *second_count = 0;
+    } else {
+        *first_count = until_end;
+        *second_count = d->size - until_end;
+    }
+}
+
+SVCXDEF svcx_result svcx_deque_push_back_n(
+    svcx_deque *d, const void *elems, size_t count) {
+    SVCX_ASSERT(d);
+    SVCX_ASSERT(elems || count == 0);
+
+    if (count == 0) {
+        return SVCX_OK;
+    }
+
+    if (d->fixed) {
+        if (count >= d->cap) {
+            // Only the last cap elements survive, so skip the rest.
+            elems = (const char *)elems + (count - d->cap) * d->stride;
+            count = d->cap;
+            d->head = 0;
+            d->size = 0;
+        } else if (d->size + count > d->cap) {
+            size_t dropped = d->size + count - d->cap;
+            d->head = (d->head + dropped) & (d->cap - 1);
+            d->size -= dropped;
+        }
+    } else if (d->size + count > d->cap) {
+        if (_svcx_deque_grow(d, d->size + count) != SVCX_OK) {
+            return SVCX_DEQ_PUSH_GROW_ERR;
+        }
+    }
+
+    size_t tail = (d->head + d->size) & (d->cap - 1);
+    size_t until_end = d->cap - tail;
+    size_t first = count < until_end ? count : until_end;
+
+    memcpy((char *)d->data + tail * d->stride, elems, first * d->stride);
+    memcpy(d->data,
+        (const char *)elems + first * d->stride,
+        (count - first) * d->stride);
+    d->size += count;
+    return SVCX_OK;
+}
+
+SVCXDEF size_t svcx_deque_pop_front_n(
+    svcx_deque *d, void *out, size_t max_count) {
+    SVCX_ASSERT(d);
+
+    size_t count = max_count < d->size ? max_count : d->size;
+    if (count == 0) {
+        return 0;
+    }
+
+    if (out) {
+        size_t until_end = d->cap - d->head;
+        size_t first = count < until_end ? count : until_end;
+
+        memcpy(out, (char *)d->data + d->head * d->stride, first * d->stride);
+        memcpy((char *)out + first * d->stride,
+            d->data,
+            (count - first) * d->stride);
+    }
+
+    d->head = (d->head + count) & (d->cap - 1);
+    d->size -= count;
+    return count;
+}
+
+SVCXDEF void svcx_deque_free(svcx_deque *d) {
+    SVCX_ASSERT(d);
+
+    if (d->data) {
+        svcx_free(&d->a, d->data);
+    }
+
+    d->data = NULL;
+    d->head = 0;
+    d->size = 0;
+    d->cap = 0;
+}
+
+SVCXDEF size_t svcx_deque_size(svcx_deque *d) {
+    SVCX_ASSERT(d);
+    return d->size;
+}
+
+//
+// Internal word kernels, shared by the bit containers. Each SIMD variant
+// processes as many whole vectors as it can and returns the number of words
+// it handled, leaving the tail to the scalar loop.
+//
+typedef enum svcx__bitop {
+    SVCX__BITOP_AND,
+    SVCX__BITOP_OR,
+    SVCX__BITOP_XOR,
+    SVCX__BITOP_ANDNOT,
+} svcx__bitop;
+
+#ifdef SVCX__SSE2
+static size_t svcx__words_op_sse2(
+    uint64_t *dst, const uint64_t *src, size_t n, svcx__bitop op) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(src + i));
+        switch (op) {
+        case SVCX__BITOP_AND:
+            x = _mm_and_si128(x, y);
+            break;
+        case SVCX__BITOP_OR:
+            x = _mm_or_si128(x, y);
+            break;
+        case SVCX__BITOP_XOR:
+            x = _mm_xor_si128(x, y);
+            break;
+        case SVCX__BITOP_ANDNOT:
+            x = _mm_andnot_si128(y, x);
+            break;
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), x);
+    }
+    return i;
+}
+#endif // SVCX__SSE2
+
+#ifdef SVCX__AVX2
+SVCX__AVX2_FN static size_t svcx__words_op_avx2(
+    uint64_t *dst, const uint64_t *src, size_t n, svcx__bitop op) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(src + i));
+        switch (op) {
+        case SVCX__BITOP_AND:
+            x = _mm256_and_si256(x, y);
+            break;
+        case SVCX__BITOP_OR:
+            x = _mm256_or_si256(x, y);
+            break;
+        case SVCX__BITOP_XOR:
+            x = _mm256_xor_si256(x, y);
+            break;
+        case SVCX__BITOP_ANDNOT:
+            x = _mm256_andnot_si256(y, x);
+            break;
+        }
+        _mm256_storeu_si256((__m256i *)(dst + i), x);
+    }
+    return i;
+}
+
+// Nibble lookup population count (Mula et al.), with the per-byte counts
+// summed into 64-bit lanes by psadbw.
+SVCX__AVX2_FN static size_t svcx__popcount_words_avx2(
+    const uint64_t *w, size_t n) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2,
+        3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    __m256i acc = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(w + i));
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+            _mm256_shuffle_epi8(lookup, hi));
+        acc = _mm256_add_epi64(
+            acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+    }
+
+    size_t count = (size_t)(_mm256_extract_epi64(acc, 0) +
+                            _mm256_extract_epi64(acc, 1) +
+                            _mm256_extract_epi64(acc, 2) +
+                            _mm256_extract_epi64(acc, 3));
+    for (; i < n; i++) {
+        count += (size_t)__builtin_popcountll(w[i]);
+    }
+    return count;
+}
+
+SVCX__AVX2_FN static int svcx__select64_bmi2(uint64_t w, unsigned k) {
+    return (int)_tzcnt_u64(_pdep_u64((uint64_t)1 << k, w));
+}
+#endif // SVCX__AVX2
+
+static void svcx__words_op(
+    uint64_t *dst, const uint64_t *src, size_t n, svcx__bitop op) {
+    size_t i = 0;
+#if defined(SVCX__AVX2)
+    if (svcx_cpu_has_avx2()) {
+        i = svcx__words_op_avx2(dst, src, n, op);
+    } else {
+        i = svcx__words_op_sse2(dst, src, n, op);
+    }
+#elif defined(SVCX__SSE2)
+    i = svcx__words_op_sse2(dst, src, n, op);
+#endif
+
+    for (; i < n; i++) {
+        switch (op) {
+        case SVCX__BITOP_AND:
+            dst[i] &= src[i];
+            break;
+        case SVCX__BITOP_OR:
+            dst[i] |= src[i];
+            break;
+        case SVCX__BITOP_XOR:
+            dst[i] ^= src[i];
+            break;
+        case SVCX__BITOP_ANDNOT:
+            dst[i] &= ~src[i];
+            break;
+        }
+    }
+}
+
+static size_t svcx__popcount_words(const uint64_t *w, size_t n) {
+#ifdef SVCX__AVX2
+    if (svcx_cpu_has_avx2()) {
+        return svcx__popcount_words_avx2(w, n);
+    }
+#endif
+
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        count += (size_t)svcx__popcount64(w[i]);
+    }
+    return count;
+}
+
+// Returns the position of the k-th (0-based) set bit in w, k < popcount(w).
+static int svcx__select64(uint64_t w, unsigned k) {
+#ifdef SVCX__AVX2
+    if (svcx_cpu_has_avx2()) {
+        return svcx__select64_bmi2(w, k);
+    }
+#endif
+
+    int base = 0;
+    for (;;) {
+        unsigned in_byte = (unsigned)svcx__popcount64(w & 0xFF);
+        if (k < in_byte) {
+            break;
+        }
+        k -= in_byte;
+        w >>= 8;
+        base += 8;
+    }
+    while (k--) {
+        w &= w - 1;
+    }
+    return base + svcx__ctz64(w);
+}
+
+#define SVCX__BITSET_SUB_WORDS 8
+#define SVCX__BITSET_SUPER_WORDS 64
+
+// Clears the bits past nbits in the last word, keeping the invariant that
+// they are always zero.
+static void svcx__bitset_mask_tail(svcx_bitset *b) {
+    if (b->nbits % 64) {
+        b->words[b->nwords - 1] &= ((uint64_t)1 << (b->nbits % 64)) - 1;
+    }
+}
+
+SVCXDEF svcx_result svcx_bitset_init(
+    svcx_bitset *b, size_t nbits, svcx_allocator a) {
+    b->nbits = nbits;
+    b->nwords = (nbits + 63) / 64;
+    b->rank_super = NULL;
+    b->rank_sub = NULL;
+    b->rank_ones = 0;
+    b->rank_valid = false;
+    b->a = a;
+    b->words = NULL;
+
+    if (b->nwords == 0) {
+        return SVCX_OK;
+    }
+
+    b->words = (uint64_t *)svcx_alloc_zero(&b->a, b->nwords * sizeof(uint64_t));
+    if (!b->words) {
+        return SVCX_BITSET_ALLOC_ERR;
+    }
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_bitset_from_bools(
+    svcx_bitset *b, const bool *flags, size_t count, svcx_allocator a) {
+    SVCX_ASSERT(flags || count == 0);
+
+    svcx_result r = svcx_bitset_init(b, count, a);
+    if (r != SVCX_OK) {
+        return r;
+    }
+
+    for (size_t w = 0; w < b->nwords; w++) {
+        size_t base = w * 64;
+        size_t end = base + 64 < count ? base + 64 : count;
+        uint64_t word = 0;
+        for (size_t i = base; i < end; i++) {
+            word |= (uint64_t)(flags[i] != 0) << (i - base);
+        }
+        b->words[w] = word;
+    }
+    return SVCX_OK;
+}
+
+SVCXDEF void svcx_bitset_free(svcx_bitset *b) {
+    SVCX_ASSERT(b);
+
+    if (b->words) {
+        svcx_free(&b->a, b->words);
+    }
+    if (b->rank_super) {
+        svcx_free(&b->a, b->rank_super);
+    }
+
+    b->words = NULL;
+    b->rank_super = NULL;
+    b->rank_sub = NULL;
+    b->nbits = 0;
+    b->nwords = 0;
+    b->rank_ones = 0;
+    b->rank_valid = false;
+}
+
+SVCXDEF void svcx_bitset_set(svcx_bitset *b, size_t index) {
+    SVCX_ASSERT(index < b->nbits);
+    b->words[index / 64] |= (uint64_t)1 << (index % 64);
+    b->rank_valid = false;
+}
+
+SVCXDEF void svcx_bitset_reset(svcx_bitset *b, size_t index) {
+    SVCX_ASSERT(index < b->nbits);
+    b->words[index / 64] &= ~((uint64_t)1 << (index % 64));
+    b->rank_valid = false;
+}
+
+SVCXDEF void svcx_bitset_flip(svcx_bitset *b, size_t index) {
+    SVCX_ASSERT(index < b->nbits);
+    b->words[index / 64] ^= (uint64_t)1 << (index % 64);
+    b->rank_valid = false;
+}
+
+SVCXDEF bool svcx_bitset_test(const svcx_bitset *b, size_t index) {
+    SVCX_ASSERT(index < b->nbits);
+    return (b->words[index / 64] >> (index % 64)) & 1;
+}
+
+SVCXDEF void svcx_bitset_set_all(svcx_bitset *b) {
+    if (b->nwords == 0) {
+        return;
+    }
+    memset(b->words, 0xFF, b->nwords * sizeof(uint64_t));
+    svcx__bitset_mask_tail(b);
+    b->rank_valid = false;
+}
+
+SVCXDEF void svcx_bitset_reset_all(svcx_bitset *b) {
+    if (b->nwords == 0) {
+        return;
+    }
+    memset(b->words, 0, b->nwords * sizeof(uint64_t));
+    b->rank_valid = false;
+}
+
+SVCXDEF size_t svcx_bitset_count(const svcx_bitset *b) {
+    if (b->rank_valid) {
+        return b->rank_ones;
+    }
+    return svcx__popcount_words(b->words, b->nwords);
+}
+
+static svcx_result svcx__bitset_op(
+    svcx_bitset *dst, const svcx_bitset *src, svcx__bitop op) {
+    SVCX_ASSERT(dst);
+    SVCX_ASSERT(src);
+
+    if (dst->nbits != src->nbits) {
+        return SVCX_BITSET_SIZE_MISMATCH_ERR;
+    }
+
+    svcx__words_op(dst->words, src->words, dst->nwords, op);
+    dst->rank_valid = false;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_bitset_and(svcx_bitset *dst, const svcx_bitset *src) {
+    return svcx__bitset_op(dst, src, SVCX__BITOP_AND);
+}
+
+SVCXDEF svcx_result svcx_bitset_or(svcx_bitset *dst, const svcx_bitset *src) {
+    return svcx__bitset_op(dst, src, SVCX__BITOP_OR);
+}
+
+SVCXDEF svcx_result svcx_bitset_xor(svcx_bitset *dst, const svcx_bitset *src) {
+    return svcx__bitset_op(dst, src, SVCX__BITOP_XOR);
+}
+
+SVCXDEF svcx_result svcx_bitset_andnot(
+    svcx_bitset *dst, const svcx_bitset *src) {
+    return svcx__bitset_op(dst, src, SVCX__BITOP_ANDNOT);
+}
+
+SVCXDEF svcx_result svcx_bitset_build_rank(svcx_bitset *b) {
+    SVCX_ASSERT(b);
+
+    size_t nsub =
+        (b->nwords + SVCX__BITSET_SUB_WORDS - 1) / SVCX__BITSET_SUB_WORDS;
+    size_t nsuper =
+        (b->nwords + SVCX__BITSET_SUPER_WORDS - 1) / SVCX__BITSET_SUPER_WORDS;
+
+    if (!b->rank_super && nsuper > 0) {
+        // Both levels live in a single allocation, the 16-bit counts after
+        // the 64-bit ones.
+        size_t bytes = nsuper * sizeof(uint64_t) + nsub * sizeof(uint16_t);
+        b->rank_super = (uint64_t *)svcx_alloc(&b->a, bytes);
+        if (!b->rank_super) {
+            return SVCX_BITSET_RANK_ALLOC_ERR;
+        }
+        b->rank_sub = (uint16_t *)(b->rank_super + nsuper);
+    }
+
+    size_t total = 0;
+    size_t in_super = 0;
+    for (size_t s = 0; s < nsub; s++) {
+        if (s % (SVCX__BITSET_SUPER_WORDS / SVCX__BITSET_SUB_WORDS) == 0) {
+            b->rank_super[s * SVCX__BITSET_SUB_WORDS /
+                          SVCX__BITSET_SUPER_WORDS] = total;
+            in_super = 0;
+        }
+        b->rank_sub[s] = (uint16_t)in_super;
+
+        size_t start = s * SVCX__BITSET_SUB_WORDS;
+        size_t end = start + SVCX__BITSET_SUB_WORDS;
+        if (end > b->nwords) {
+            end = b->nwords;
+        }
+        size_t ones = svcx__popcount_words(b->words + start, end - start);
+        total += ones;
+        in_super += ones;
+    }
+
+    b->rank_ones = total;
+    b->rank_valid = true;
+    return SVCX_OK;
+}
+
+SVCXDEF size_t svcx_bitset_rank(const svcx_bitset *b, size_t pos) {
+    SVCX_ASSERT(pos <= b->nbits);
+
+    if (pos >= b->nbits) {
+        return svcx_bitset_count(b);
+    }
+
+    size_t word = pos / 64;
+    size_t rank = 0;
+    size_t start = 0;
+    if (b->rank_valid) {
+        size_t sub = word / SVCX__BITSET_SUB_WORDS;
+        rank = b->rank_super[word / SVCX__BITSET_SUPER_WORDS] +
+               b->rank_sub[sub];
+        start = sub * SVCX__BITSET_SUB_WORDS;
+    }
+
+    rank += svcx__popcount_words(b->words + start, word - start);
+    if (pos % 64) {
+        uint64_t mask = ((uint64_t)1 << (pos % 64)) - 1;
+        rank += (size_t)svcx__popcount64(b->words[word] & mask);
+    }
+    return rank;
+}
+
+SVCXDEF bool svcx_bitset_select(const svcx_bitset *b, size_t k, size_t *pos) {
+    size_t word = 0;
+
+    if (b->rank_valid) {
+        if (k >= b->rank_ones) {
+            return false;
+        }
+
+        // Find the last superblock and then the last subblock whose
+        // cumulative count does not exceed k.
+        size_t nsuper = (b->nwords + SVCX__BITSET_SUPER_WORDS - 1) /
+                        SVCX__BITSET_SUPER_WORDS;
+        size_t lo = 0;
+        size_t hi = nsuper;
+        while (hi - lo > 1) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (b->rank_super[mid] <= k) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        k -= b->rank_super[lo];
+
+        size_t nsub =
+            (b->nwords + SVCX__BITSET_SUB_WORDS - 1) / SVCX__BITSET_SUB_WORDS;
+        size_t sub = lo * (SVCX__BITSET_SUPER_WORDS / SVCX__BITSET_SUB_WORDS);
+        size_t sub_end =
+            sub + SVCX__BITSET_SUPER_WORDS / SVCX__BITSET_SUB_WORDS;
+        if (sub_end > nsub) {
+            sub_end = nsub;
+        }
+        while (sub + 1 < sub_end && b->rank_sub[sub + 1] <= k) {
+            sub++;
+        }
+        k -= b->rank_sub[sub];
+        word = sub * SVCX__BITSET_SUB_WORDS;
+    }
+
+    for (; word < b->nwords; word++) {
+        size_t ones = (size_t)svcx__popcount64(b->words[word]);
+        if (k < ones) {
+            int bit = svcx__select64(b->words[word], (unsigned)k);
+            *pos = word * 64 + (size_t)bit;
+            return true;
+        }
+        k -= ones;
+    }
+    return false;
+}
+
+SVCXDEF void svcx_bitset_iter_init(
+    svcx_bitset_iter *it, const svcx_bitset *b) {
+    it->words = b->words;
+    it->nwords = b->nwords;
+    it->index = 0;
+    it->word = b->nwords ? b->words[0] : 0;
+}
+
+SVCXDEF bool svcx_bitset_iter_next(svcx_bitset_iter *it, size_t *pos) {
+    while (it->word == 0) {
+        if (++it->index >= it->nwords) {
+            it->index = it->nwords;
+            return false;
+        }
+        it->word = it->words[it->index];
+    }
+
+    *pos = it->index * 64 + (size_t)svcx__ctz64(it->word);
+    it->word &= it->word - 1;
+    return true;
+}
+
+SVCXDEF svcx_string_view svcx_sv_from_parts(const char *data, size_t size) {
+    svcx_string_view sv;
+    sv.data = data;
+    sv.len = size;
+    return sv;
+}
+
+SVCXDEF svcx_string_view svcx_sv_from_cstr(const char *data) {
+    return (svcx_string_view){data, strlen(data)};
+}
+
+SVCXDEF bool svcx_sv_contains(
+    svcx_string_view haystack, svcx_string_view needle) {
+    return svcx_sv_find_from(haystack, needle, 0) != (size_t)-1;
+}
+
+SVCXDEF size_t svcx_sv_find(
+    svcx_string_view haystack, svcx_string_view needle) {
+    return svcx_sv_find_from(haystack, needle, 0);
+}
+
+//
+// Substring search. Short needles are found with the SIMD filter from
+// "SIMD-friendly algorithms for substring searching" (Mula): the first and
+// last bytes of the needle are compared against a block of candidate
+// positions at once, and only positions where both match are checked with
+// memcmp. Long needles use the Two-Way algorithm (Crochemore and Perrin, with
+// the shift table from musl), which runs in linear time on any input.
+//
+// The SIMD functions return how many leading (or for rfind, trailing)
+// candidate positions are known not to match, stopping at the block holding
+// the first match so that the scalar loop can confirm it.
+//
+#define SVCX__SV_TWOWAY_MIN 32
+
+#ifdef SVCX__SSE2
+static size_t svcx__sv_find_sse2(
+    const char *h, size_t hlen, const char *n, size_t m) {
+    const __m128i first = _mm_set1_epi8(n[0]);
+    const __m128i last = _mm_set1_epi8(n[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= hlen; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(h + i + m - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            size_t j = i + (size_t)svcx__ctz64(mask);
+            if (memcmp(h + j, n, m) == 0) {
+                return j;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return i;
+}
+
+static size_t svcx__sv_rfind_sse2(
+    const char *h, size_t hlen, const char *n, size_t m) {
+    const __m128i first = _mm_set1_epi8(n[0]);
+    const __m128i last = _mm_set1_epi8(n[m - 1]);
+    size_t end = hlen - m + 1;
+    while (end >= 16) {
+        size_t i = end - 16;
+        __m128i a = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(h + i + m - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            int bit = 63 - svcx__clz64(mask);
+            if (memcmp(h + i + bit, n, m) == 0) {
+                return (hlen - m + 1) - (i + (size_t)bit + 1);
+            }
+            mask &= ~(1u << bit);
+        }
+        end = i;
+    }
+    return (hlen - m + 1) - end;
+}
+#endif // SVCX__SSE2
+
+#ifdef SVCX__AVX2
+SVCX__AVX2_FN static size_t svcx__sv_find_avx2(
+    const char *h, size_t hlen, const char *n, size_t m) {
+    const __m256i first = _mm256_set1_epi8(n[0]);
+    const __m256i last = _mm256_set1_epi8(n[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= hlen; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(h + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(h + i + m - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask) {
+            size_t j = i + (size_t)_tzcnt_u32(mask);
+            if (memcmp(h + j, n, m) == 0) {
+                return j;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__sv_rfind_avx2(
+    const char *h, size_t hlen, const char *n, size_t m) {
+    const __m256i first = _mm256_set1_epi8(n[0]);
+    const __m256i last = _mm256_set1_epi8(n[m - 1]);
+    size_t end = hlen - m + 1;
+    while (end >= 32) {
+        size_t i = end - 32;
+        __m256i a = _mm256_loadu_si256((const __m256i *)(h + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(h + i + m - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask) {
+            int bit = 63 - svcx__clz64(mask);
+            if (memcmp(h + i + bit, n, m) == 0) {
+                return (hlen - m + 1) - (i + (size_t)bit + 1);
+            }
+            mask &= ~(1u << bit);
+        }
+        end = i;
+    }
+    return (hlen - m + 1) - end;
+}
+#endif // SVCX__AVX2
+
+// Returns the index of the first occurrence of n in h, or -1. The needle must
+// not be longer than the haystack.
+static size_t svcx__sv_twoway(
+    const unsigned char *h, size_t hlen, const unsigned char *n, size_t m) {
+    size_t byteset[256 / (8 * sizeof(size_t))] = {0};
+    size_t shift[256];
+    const size_t word_bits = 8 * sizeof(size_t);
+
+    for (size_t i = 0; i < m; i++) {
+        byteset[n[i] / word_bits] |= (size_t)1 << (n[i] % word_bits);
+        shift[n[i]] = i + 1;
+    }
+
+    // Maximal suffix of the needle under both orderings of the alphabet,
+    // which gives the critical factorization n = n[0..ms] n[ms+1..].
+    size_t ms = 0, p = 1, p0 = 1;
+    for (int pass = 0; pass < 2; pass++) {
+        size_t ip = (size_t)-1, jp = 0, k = 1, per = 1;
+        while (jp + k < m) {
+            unsigned char a = n[ip + k], b = n[jp + k];
+            if (a == b) {
+                if (k == per) {
+                    jp += per;
+                    k = 1;
+                } else {
+                    k++;
+                }
+            } else if (pass == 0 ? a > b : a < b) {
+                jp += k;
+                k = 1;
+                per = jp - ip;
+            } else {
+                ip = jp++;
+                k = per = 1;
+            }
+        }
+
+        if (pass == 0) {
+            ms = ip;
+            p0 = per;
+        } else if (ip + 1 > ms + 1) {
+            ms = ip;
+            p = per;
+        } else {
+            p = p0;
+        }
+    }
+
+    // For periodic needles, the prefix that is known to match after a shift
+    // by the period is remembered, which keeps the search linear.
+    size_t mem0;
+    if (memcmp(n, n + p, ms + 1) != 0) {
+        mem0 = 0;
+        p = (ms > m - ms - 1 ? ms : m - ms - 1) + 1;
+    } else {
+        mem0 = m - p;
+    }
+
+    size_t mem = 0;
+    size_t pos = 0;
+    while (hlen - pos >= m) {
+        const unsigned char *w = h + pos;
+        unsigned char tail = w[m - 1];
+        if (!(byteset[tail / word_bits] & ((size_t)1 << (tail % word_bits)))) {
+            pos += m;
+            mem = 0;
+            continue;
+        }
+        size_t k = m - shift[tail];
+        if (k) {
+            pos += k < mem ? mem : k;
+            mem = 0;
+            continue;
+        }
+
+        k = ms + 1 > mem ? ms + 1 : mem;
+        while (k < m && n[k] == w[k]) {
+            k++;
+        }
+        if (k < m) {
+            pos += k - ms;
+            mem = 0;
+            continue;
+        }
+
+        k = ms + 1;
+        while (k > mem && n[k - 1] == w[k - 1]) {
+            k--;
+        }
+        if (k <= mem) {
+            return pos;
+        }
+        pos += p;
+        mem = mem0;
+    }
+    return -1;
+}
+
+SVCXDEF size_t svcx_sv_find_from(
+    svcx_string_view haystack, svcx_string_view needle, size_t start) {
+    if (start > haystack.len || needle.len > haystack.len - start) {
+        return -1;
+    }
+    if (needle.len == 0) {
+        return start;
+    }
+
+    const char *h = haystack.data + start;
+    size_t hlen = haystack.len - start;
+    const char *n = needle.data;
+    size_t m = needle.len;
+
+    if (m == 1) {
+        const char *p = memchr(h, n[0], hlen);
+        return p ? start + (size_t)(p - h) : (size_t)-1;
+    }
+    if (m >= SVCX__SV_TWOWAY_MIN) {
+        size_t pos = svcx__sv_twoway(
+            (const unsigned char *)h, hlen, (const unsigned char *)n, m);
+        return pos == (size_t)-1 ? pos : start + pos;
+    }
+
+    size_t i = SVCX__SIMD_CALL(svcx__sv_find, h, hlen, n, m);
+    size_t last = hlen - m;
+    while (i <= last) {
+        const char *p = memchr(h + i, n[0], last - i + 1);
+        if (!p) {
+            break;
+        }
+        i = (size_t)(p - h);
+        if (memcmp(p, n, m) == 0) {
+            return start + i;
+        }
+        i++;
+    }
+    return -1;
+}
+
+SVCXDEF size_t svcx_sv_rfind(
+    svcx_string_view haystack, svcx_string_view needle) {
+    if (needle.len > haystack.len) {
+        return -1;
+    }
+    if (needle.len == 0) {
+        return haystack.len;
+    }
+
+    const char *h = haystack.data;
+    const char *n = needle.data;
+    size_t m = needle.len;
+
+    size_t i = (haystack.len - m + 1) -
+               SVCX__SIMD_CALL(svcx__sv_rfind, h, haystack.len, n, m);
+    while (i > 0) {
+        i--;
+        if (h[i] == n[0] && memcmp(h + i, n, m) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+SVCXDEF bool svcx_sv_starts_with(svcx_string_view sv, svcx_string_view prefix) {
+    if (prefix.len > sv.len) {
+        return false;
+    }
+    return memcmp(sv.data, prefix.data, prefix.len) == 0;
+}
+
+SVCXDEF bool svcx_sv_ends_with(svcx_string_view sv, svcx_string_view suffix) {
+    if (suffix.len > sv.len) {
+        return false;
+    }
+
+    const char *start = sv.data + (sv.len - suffix.len);
+    return memcmp(start, suffix.data, suffix.len) == 0;
+}
+
+SVCXDEF svcx_string_view svcx_sv_trim_start(svcx_string_view sv) {
+    size_t start = svcx_sv_span(sv, svcx_byteset_whitespace());
+    return svcx_sv_from_parts(sv.data + start, sv.len - start);
+}
+
+SVCXDEF svcx_string_view svcx_sv_trim_end(svcx_string_view sv) {
+    const svcx_byteset *ws = svcx_byteset_whitespace();
+    size_t end = sv.len;
+
+    while (end > 0 && ws->table[(unsigned char)sv.data[end - 1]]) {
+        end--;
+    }
+
+    return svcx_sv_from_parts(sv.data, end);
+}
+
+SVCXDEF svcx_string_view svcx_sv_trim(svcx_string_view sv) {
+    return svcx_sv_trim_set(sv, svcx_byteset_whitespace());
+}
+
+SVCXDEF svcx_result svcx_sv_split(
+    svcx_string_view sv, char delimiter, svcx_vector *out) {
+    svcx_split_iter it;
+    svcx_string_view part;
+
+    svcx_sv_split_init(&it, sv, delimiter);
+    while (svcx_sv_split_next(&it, &part)) {
+        svcx_result r = svcx_vector_push(out, &part);
+        if (r != SVCX_OK) {
+            return SVCX_SV_SPLIT_ERR;
+        }
+    }
+
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_string_view svcx_sv_substring(
+    svcx_string_view sv, size_t start, size_t end) {
+    SVCX_ASSERT(start <= end);
+    SVCX_ASSERT(end <= sv.len);
+
+    if (start > end) {
+        start = end;
+    }
+    if (end > sv.len) {
+        end = sv.len;
+    }
+
+    return svcx_sv_from_parts(sv.data + start, end - start);
+}
+
+//
+// Byte scanning helpers. Like the other SIMD variants, they return the
+// number of leading bytes they ruled out, stopping at the first hit inside
+// the last block they loaded, and the callers finish the scan with scalar
+// code.
+//
+// svcx__find_byte3 looks for any of the first nbytes (one to three) bytes,
+// and svcx__find_space looks for the first byte that is (or, when want is
+// false, is not) in svcx__whitespace_set, defined with the byte sets below.
+//
+#ifdef SVCX__SSE2
+static size_t svcx__find_byte3_sse2(
+    const char *p, size_t len, const unsigned char *bytes, size_t nbytes) {
+    const __m128i b0 = _mm_set1_epi8((char)bytes[0]);
+    const __m128i b1 = _mm_set1_epi8((char)bytes[nbytes > 1 ? 1 : 0]);
+    const __m128i b2 = _mm_set1_epi8((char)bytes[nbytes > 2 ? 2 : 0]);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i eq = _mm_or_si128(_mm_cmpeq_epi8(v, b0),
+            _mm_or_si128(_mm_cmpeq_epi8(v, b1), _mm_cmpeq_epi8(v, b2)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(eq);
+        if (mask) {
+            return i + (size_t)svcx__ctz64(mask);
+        }
+    }
+    return i;
+}
+
+// Whitespace is ' ' or a byte in ['\t', '\r'], tested with signed compares
+// (bytes >= 0x80 are negative and fall outside the range).
+static size_t svcx__find_space_sse2(const char *p, size_t len, bool want) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i below = _mm_set1_epi8('\t' - 1);
+    const __m128i above = _mm_set1_epi8('\r' + 1);
+    const unsigned flip = want ? 0 : 0xFFFF;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+            _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(ws) ^ flip;
+        if (mask) {
+            return i + (size_t)svcx__ctz64(mask);
+        }
+    }
+    return i;
+}
+#endif // SVCX__SSE2
+
+#ifdef SVCX__AVX2
+SVCX__AVX2_FN static size_t svcx__find_byte3_avx2(
+    const char *p, size_t len, const unsigned char *bytes, size_t nbytes) {
+    const __m256i b0 = _mm256_set1_epi8((char)bytes[0]);
+    const __m256i b1 = _mm256_set1_epi8((char)bytes[nbytes > 1 ? 1 : 0]);
+    const __m256i b2 = _mm256_set1_epi8((char)bytes[nbytes > 2 ? 2 : 0]);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i eq = _mm256_or_si256(_mm256_cmpeq_epi8(v, b0),
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, b1), _mm256_cmpeq_epi8(v, b2)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(eq);
+        if (mask) {
+            return i + (size_t)_tzcnt_u32(mask);
+        }
+    }
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__find_space_avx2(
+    const char *p, size_t len, bool want) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i below = _mm256_set1_epi8('\t' - 1);
+    const __m256i above = _mm256_set1_epi8('\r' + 1);
+    const uint32_t flip = want ? 0 : 0xFFFFFFFF;
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+            _mm256_and_si256(_mm256_cmpgt_epi8(v, below),
+                _mm256_cmpgt_epi8(above, v)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(ws) ^ flip;
+        if (mask) {
+            return i + (size_t)_tzcnt_u32(mask);
+        }
+    }
+    return i;
+}
+#endif // SVCX__AVX2
+
+// Returns the index of the first byte of sv that is in the set, or sv.len.
+// Small sets are compared directly, larger ones go through a byte set.
+static size_t svcx__sv_find_any(svcx_string_view sv, svcx_string_view set) {
+    if (set.len == 0) {
+        return sv.len;
+    }
+    if (set.len > 3) {
+        svcx_byteset bytes;
+        svcx_byteset_init(&bytes, set);
+        return svcx_sv_cspan(sv, &bytes);
+    }
+
+    size_t i = SVCX__SIMD_CALL(svcx__find_byte3,
+        sv.data,
+        sv.len,
+        (const unsigned char *)set.data,
+        set.len);
+    while (i < sv.len && !memchr(set.data, sv.data[i], set.len)) {
+        i++;
+    }
+    return i;
+}
+
+//
+// Byte sets. The whitespace set is spelled out so that it can be shared
+// without any initialization at runtime. It is the only definition of
+// whitespace: the split iterators and trimming scan with it, and
+// svcx__find_space tests the same bytes with compares.
+//
+static const svcx_byteset svcx__whitespace_set = {
+    .table =
+        {
+            ['\t'] = true,
+            ['\n'] = true,
+            ['\v'] = true,
+            ['\f'] = true,
+            ['\r'] = true,
+            [' '] = true,
+        },
+    .nibbles =
+        {
+            {0x04, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x01, 0x01, 0x01, 0x01, 0, 0},
+            {0},
+        },
+};
+
+SVCXDEF void svcx_byteset_init(svcx_byteset *set, svcx_string_view chars) {
+    SVCX_ASSERT(set);
+    SVCX_ASSERT(chars.data || chars.len == 0);
+
+    memset(set, 0, sizeof(*set));
+    for (size_t i = 0; i < chars.len; i++) {
+        svcx_byteset_add(set, (unsigned char)chars.data[i]);
+    }
+}
+
+SVCXDEF void svcx_byteset_add(svcx_byteset *set, unsigned char c) {
+    SVCX_ASSERT(set);
+
+    set->table[c] = true;
+    set->nibbles[c >> 7][c & 0x0F] |= (uint8_t)(1u << ((c >> 4) & 7));
+}
+
+SVCXDEF bool svcx_byteset_contains(const svcx_byteset *set, unsigned char c) {
+    SVCX_ASSERT(set);
+    return set->table[c];
+}
+
+SVCXDEF const svcx_byteset *svcx_byteset_whitespace(void) {
+    return &svcx__whitespace_set;
+}
+
+#ifdef SVCX__AVX2
+// The low nibble of each byte selects a row of bits from one of the two
+// nibble tables (depending on the top bit of the byte), and the high nibble
+// selects the bit to test in that row.
+SVCX__AVX2_FN static size_t svcx__scan_set_avx2(
+    const char *p, size_t len, const svcx_byteset *set, bool want) {
+    const __m256i rows0 = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)set->nibbles[0]));
+    const __m256i rows1 = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)set->nibbles[1]));
+    const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2,
+        4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16,
+        32, 64, -128);
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    const __m256i seven = _mm256_set1_epi8(7);
+    const uint32_t flip = want ? 0 : 0xFFFFFFFF;
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(rows0, lo),
+            _mm256_shuffle_epi8(rows1, lo),
+            _mm256_cmpgt_epi8(hi, seven));
+        __m256i bit = _mm256_shuffle_epi8(bits, hi);
+        __m256i member = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(member) ^ flip;
+        if (mask) {
+            return i + (size_t)_tzcnt_u32(mask);
+        }
+    }
+    return i;
+}
+#endif // SVCX__AVX2
+
+// Returns the index of the first byte whose membership in the set equals
+// want, or sv.len.
+static size_t svcx__sv_scan_set(
+    svcx_string_view sv, const svcx_byteset *set, bool want) {
+    SVCX_ASSERT(set);
+    SVCX_ASSERT(sv.data || sv.len == 0);
+
+    // The whitespace set is a range and a byte, which SSE2 can compare
+    // directly. Other sets need the shuffles of the AVX2 nibble lookup.
+    const unsigned char *p = (const unsigned char *)sv.data;
+    size_t i;
+    if (set == &svcx__whitespace_set) {
+        i = SVCX__SIMD_CALL(svcx__find_space, sv.data, sv.len, want);
+    } else {
+        i = SVCX__AVX2_CALL(svcx__scan_set, sv.data, sv.len, set, want);
+    }
+    while (i < sv.len && set->table[p[i]] != want) {
+        i++;
+    }
+    return i;
+}
+
+SVCXDEF size_t svcx_sv_find_first_of(
+    svcx_string_view sv, const svcx_byteset *set) {
+    size_t i = svcx__sv_scan_set(sv, set, true);
+    return i < sv.len ? i : (size_t)-1;
+}
+
+SVCXDEF size_t svcx_sv_find_first_not_of(
+    svcx_string_view sv, const svcx_byteset *set) {
+    size_t i = svcx__sv_scan_set(sv, set, false);
+    return i < sv.len ? i : (size_t)-1;
+}
+
+SVCXDEF size_t svcx_sv_span(svcx_string_view sv, const svcx_byteset *set) {
+    return svcx__sv_scan_set(sv, set, false);
+}
+
+SVCXDEF size_t svcx_sv_cspan(svcx_string_view sv, const svcx_byteset *set) {
+    return svcx__sv_scan_set(sv, set, true);
+}
+
+SVCXDEF svcx_string_view svcx_sv_trim_set(
+    svcx_string_view sv, const svcx_byteset *set) {
+    size_t start = svcx_sv_span(sv, set);
+    size_t end = sv.len;
+
+    while (end > start && set->table[(unsigned char)sv.data[end - 1]]) {
+        end--;
+    }
+
+    return svcx_sv_from_parts(sv.data + start, end - start);
+}
+
+static void svcx__split_init(svcx_split_iter *it,
+    svcx_string_view sv,
+    svcx_string_view delim,
+    svcx_split_kind kind) {
+    SVCX_ASSERT(it);
+    SVCX_ASSERT(sv.data || sv.len == 0);
+
+    it->rest = sv;
+    it->delim = delim;
+    it->ch = '\0';
+    it->kind = (uint8_t)kind;
+    it->done = false;
+}
+
+SVCXDEF void svcx_sv_split_init(
+    svcx_split_iter *it, svcx_string_view sv, char delimiter) {
+    svcx__split_init(it, sv, svcx_sv_from_parts(NULL, 0), SVCX_SPLIT_CHAR);
+    it->ch = delimiter;
+}
+
+SVCXDEF void svcx_sv_split_str_init(
+    svcx_split_iter *it, svcx_string_view sv, svcx_string_view delimiter) {
+    SVCX_ASSERT(delimiter.len > 0);
+    svcx__split_init(it, sv, delimiter, SVCX_SPLIT_STR);
+}
+
+SVCXDEF void svcx_sv_split_any_init(
+    svcx_split_iter *it, svcx_string_view sv, svcx_string_view set) {
+    svcx__split_init(it, sv, set, SVCX_SPLIT_ANY);
+}
+
+SVCXDEF void svcx_sv_split_ws_init(svcx_split_iter *it, svcx_string_view sv) {
+    svcx__split_init(
+        it, sv, svcx_sv_from_parts(NULL, 0), SVCX_SPLIT_WHITESPACE);
+}
+
+SVCXDEF bool svcx_sv_split_next(svcx_split_iter *it, svcx_string_view *token) {
+    SVCX_ASSERT(it && token);
+
+    if (it->done) {
+        return false;
+    }
+
+    svcx_string_view rest = it->rest;
+    size_t at = rest.len;
+    size_t skip = 0;
+
+    switch ((svcx_split_kind)it->kind) {
+    case SVCX_SPLIT_CHAR: {
+        const char *p = rest.len ? memchr(rest.data, it->ch, rest.len) : NULL;
+        if (p) {
+            at = (size_t)(p - rest.data);
+            skip = 1;
+        }
+        break;
+    }
+    case SVCX_SPLIT_STR:
+        if (it->delim.len > 0) {
+            size_t p = svcx_sv_find_from(rest, it->delim, 0);
+            if (p != (size_t)-1) {
+                at = p;
+                skip = it->delim.len;
+            }
+        }
+        break;
+    case SVCX_SPLIT_ANY:
+        at = svcx__sv_find_any(rest, it->delim);
+        skip = at < rest.len ? 1 : 0;
+        break;
+    case SVCX_SPLIT_WHITESPACE: {
+        size_t start = svcx__sv_scan_set(rest, &svcx__whitespace_set, false);
+        if (start == rest.len) {
+            it->done = true;
+            return false;
+        }
+        rest.data += start;
+        rest.len -= start;
+        at = svcx__sv_scan_set(rest, &svcx__whitespace_set, true);
+        break;
+    }
+    }
+
+    // A delimiter is always found before the end of the rest, so a token
+    // that reaches the end is the last one.
+    *token = svcx_sv_from_parts(rest.data, at);
+    it->done = at == rest.len;
+    it->rest = svcx_sv_from_parts(rest.data + at + skip, rest.len - at - skip);
+    return true;
+}
+
+//
+// Hashing. The reads are little-endian on every platform, so the hashes do
+// not depend on the byte order.
+//
+static const uint64_t svcx__wyp[4] = {0x2d358dccaa6c78a5ULL,
+    0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL,
+    0x4d5a2da51de1aa47ULL};
+
+static uint64_t svcx__read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static uint64_t svcx__read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+// Multiplies a and b into a 128-bit product, returning the low half in a and
+// the high half in b.
+static void svcx__mum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 svcx__u128;
+    svcx__u128 r = (svcx__u128)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static uint64_t svcx__mix(uint64_t a, uint64_t b) {
+    svcx__mum(&a, &b);
+    return a ^ b;
+}
+
+static uint64_t svcx__hash_seed(uint64_t seed) {
+    return seed ^ svcx__mix(seed ^ svcx__wyp[0], svcx__wyp[1]);
+}
+
+// Loads the two words hashed for keys of at most 16 bytes.
+static void svcx__hash_load_short(
+    const uint8_t *p, size_t len, uint64_t *a, uint64_t *b) {
+    if (len >= 4) {
+        size_t mid = (len >> 3) << 2;
+        *a = (svcx__read32(p) << 32) | svcx__read32(p + mid);
+        *b = (svcx__read32(p + len - 4) << 32) |
+             svcx__read32(p + len - 4 - mid);
+    } else if (len > 0) {
+        *a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+        *b = 0;
+    } else {
+        *a = 0;
+        *b = 0;
+    }
+}
+
+static uint64_t svcx__hash_final(
+    uint64_t a, uint64_t b, uint64_t seed, size_t len) {
+    a ^= svcx__wyp[1];
+    b ^= seed;
+    svcx__mum(&a, &b);
+    return svcx__mix(a ^ svcx__wyp[0] ^ len, b ^ svcx__wyp[1]);
+}
+
+// Consumes one 48-byte stripe of a key longer than 48 bytes.
+static void svcx__hash_stripe(
+    const uint8_t *p, uint64_t *seed, uint64_t *see1, uint64_t *see2) {
+    *seed = svcx__mix(
+        svcx__read64(p) ^ svcx__wyp[1], svcx__read64(p + 8) ^ *seed);
+    *see1 = svcx__mix(
+        svcx__read64(p + 16) ^ svcx__wyp[2], svcx__read64(p + 24) ^ *see1);
+    *see2 = svcx__mix(
+        svcx__read64(p + 32) ^ svcx__wyp[3], svcx__read64(p + 40) ^ *see2);
+}
+
+// Hashes the last rest (1 to 48) bytes of a key longer than 16 bytes. The
+// final block is the last 16 bytes of the key, so it can reach up to 15 bytes
+// before p.
+static uint64_t svcx__hash_tail(
+    const uint8_t *p, size_t rest, uint64_t seed, size_t len) {
+    while (rest > 16) {
+        seed = svcx__mix(
+            svcx__read64(p) ^ svcx__wyp[1], svcx__read64(p + 8) ^ seed);
+        p += 16;
+        rest -= 16;
+    }
+    return svcx__hash_final(
+        svcx__read64(p + rest - 16), svcx__read64(p + rest - 8), seed, len);
+}
+
+SVCXDEF uint64_t svcx_hash_bytes(const void *data, size_t len, uint64_t seed) {
+    SVCX_ASSERT(data || len == 0);
+
+    const uint8_t *p = (const uint8_t *)data;
+    seed = svcx__hash_seed(seed);
+
+    if (len <= 16) {
+        uint64_t a, b;
+        svcx__hash_load_short(p, len, &a, &b);
+        return svcx__hash_final(a, b, seed, len);
+    }
+
+    size_t rest = len;
+    if (rest > 48) {
+        uint64_t see1 = seed, see2 = seed;
+        do {
+            svcx__hash_stripe(p, &seed, &see1, &see2);
+            p += 48;
+            rest -= 48;
+        } while (rest > 48);
+        seed ^= see1 ^ see2;
+    }
+    return svcx__hash_tail(p, rest, seed, len);
+}
+
+SVCXDEF uint64_t svcx_hash_sv(svcx_string_view sv, uint64_t seed) {
+    return svcx_hash_bytes(sv.data, sv.len, seed);
+}
+
+SVCXDEF void svcx_hasher_init(svcx_hasher *h, uint64_t seed) {
+    SVCX_ASSERT(h);
+
+    h->seed = svcx__hash_seed(seed);
+    h->see1 = h->seed;
+    h->see2 = h->seed;
+    h->total = 0;
+    h->buffered = 0;
+    h->striped = false;
+}
+
+// The buffer holds the last 16 processed bytes followed by up to one stripe
+// of pending bytes. A full stripe is only processed once more data arrives,
+// because the last 1 to 48 bytes of the key are hashed differently.
+SVCXDEF void svcx_hasher_update(svcx_hasher *h, const void *data, size_t len) {
+    SVCX_ASSERT(h);
+    SVCX_ASSERT(data || len == 0);
+
+    const uint8_t *p = (const uint8_t *)data;
+    h->total += len;
+
+    if (h->buffered + len <= 48) {
+        memcpy(h->buf + 16 + h->buffered, p, len);
+        h->buffered += len;
+        return;
+    }
+
+    if (h->buffered > 0) {
+        size_t fill = 48 - h->buffered;
+        memcpy(h->buf + 16 + h->buffered, p, fill);
+        p += fill;
+        len -= fill;
+        svcx__hash_stripe(h->buf + 16, &h->seed, &h->see1, &h->see2);
+        h->striped = true;
+        memcpy(h->buf, h->buf + 48, 16);
+        h->buffered = 0;
+    }
+
+    while (len > 48) {
+        svcx__hash_stripe(p, &h->seed, &h->see1, &h->see2);
+        h->striped = true;
+        p += 48;
+        len -= 48;
+    }
+
+    // len is now 1 to 48. Keep it along with the 16 bytes before it, unless
+    // those are the end of the buffered stripe, which is already in place.
+    if (p - (const uint8_t *)data >= 16) {
+        memcpy(h->buf, p - 16, 16);
+    }
+    memcpy(h->buf + 16, p, len);
+    h->buffered = len;
+}
+
+SVCXDEF uint64_t svcx_hasher_final(const svcx_hasher *h) {
+    SVCX_ASSERT(h);
+
+    const uint8_t *p = h->buf + 16;
+    if (h->total <= 16) {
+        uint64_t a, b;
+        svcx__hash_load_short(p, h->total, &a, &b);
+        return svcx__hash_final(a, b, h->seed, h->total);
+    }
+
+    uint64_t seed = h->seed;
+    if (h->striped) {
+        seed ^= h->see1 ^ h->see2;
+    }
+    return svcx__hash_tail(p, h->buffered, seed, h->total);
+}
+
+// How many keys ahead the batch hash prefetches the key data, so that keys
+// scattered over memory are already in cache when they are hashed.
+#define SVCX__HASH_PREFETCH 16
+
+SVCXDEF void svcx_hash_sv_batch(const svcx_string_view *svs,
+    size_t count,
+    uint64_t seed,
+    uint64_t *out) {
+    SVCX_ASSERT(svs || count == 0);
+    SVCX_ASSERT(out || count == 0);
+
+    uint64_t s = svcx__hash_seed(seed);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const svcx_string_view *v = svs + i;
+#if defined(__GNUC__) || defined(__clang__)
+        if (i + SVCX__HASH_PREFETCH + 4 <= count) {
+            for (int k = 0; k < 4; k++) {
+                __builtin_prefetch(v[SVCX__HASH_PREFETCH + k].data);
+            }
+        }
+#endif
+        if (v[0].len > 16 || v[1].len > 16 || v[2].len > 16 ||
+            v[3].len > 16) {
+            for (int k = 0; k < 4; k++) {
+                out[i + k] = svcx_hash_sv(v[k], seed);
+            }
+            continue;
+        }
+
+        uint64_t a[4], b[4];
+        for (int k = 0; k < 4; k++) {
+            svcx__hash_load_short(
+                (const uint8_t *)v[k].data, v[k].len, &a[k], &b[k]);
+        }
+        for (int k = 0; k < 4; k++) {
+            out[i + k] = svcx__hash_final(a[k], b[k], s, v[k].len);
+        }
+    }
+    for (; i < count; i++) {
+        out[i] = svcx_hash_sv(svs[i], seed);
+    }
+}
+
+//
+// Number parsing. Runs of digits are converted eight at a time with SWAR
+// arithmetic on a 64-bit word. Floats take the exact fast path of Clinger for
+// small inputs, then the Eisel-Lemire algorithm, which decides the correctly
+// rounded result from a 128-bit approximation of the power of ten in nearly
+// all cases. The rest is handed to strtod in a locale-independent form.
+//
+static bool svcx__is_digit(char c) { return (unsigned char)(c - '0') < 10; }
+
+// Checks if all 8 bytes of the word are ASCII digits.
+static bool svcx__is_8_digits(uint64_t v) {
+    uint64_t hi = v & 0xf0f0f0f0f0f0f0f0ULL;
+    uint64_t carry = (v + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL;
+    return (hi | (carry >> 4)) == 0x3333333333333333ULL;
+}
+
+// Converts 8 ASCII digits, loaded as a little-endian word, to their value.
+static uint32_t svcx__parse_8_digits(uint64_t v) {
+    const uint64_t mask = 0x000000ff000000ffULL;
+    const uint64_t mul1 = 100 + (1000000ULL << 32);
+    const uint64_t mul2 = 1 + (10000ULL << 32);
+    v -= 0x3030303030303030ULL;
+    v = v * 10 + (v >> 8);
+    v = ((v & mask) * mul1 + ((v >> 16) & mask) * mul2) >> 32;
+    return (uint32_t)v;
+}
+
+// Parses the digits at *p into value, advancing *p past all of them.
+static svcx_result svcx__parse_digits(
+    const char **p, const char *end, uint64_t *value) {
+    const char *s = *p;
+    while (s < end && *s == '0') {
+        s++;
+    }
+
+    // 16 digits always fit, so the first two chunks need no checks.
+    const char *first = s;
+    uint64_t v = 0;
+    while (end - s >= 8 && s - first < 16) {
+        uint64_t chunk = svcx__read64((const uint8_t *)s);
+        if (!svcx__is_8_digits(chunk)) {
+            break;
+        }
+        v = v * 100000000 + svcx__parse_8_digits(chunk);
+        s += 8;
+    }
+    while (s < end && svcx__is_digit(*s) && s - first < 19) {
+        v = v * 10 + (uint64_t)(*s++ - '0');
+    }
+
+    bool overflow = false;
+    if (s < end && svcx__is_digit(*s)) {
+        uint64_t d = (uint64_t)(*s++ - '0');
+        overflow = v > (UINT64_MAX - d) / 10;
+        v = v * 10 + d;
+        while (s < end && svcx__is_digit(*s)) {
+            overflow = true;
+            s++;
+        }
+    }
+
+    if (s == *p) {
+        return SVCX_PARSE_INVALID_ERR;
+    }
+    *p = s;
+    *value = overflow ? UINT64_MAX : v;
+    return overflow ? SVCX_PARSE_RANGE_ERR : SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_sv_parse_u64(
+    svcx_string_view sv, uint64_t *value, size_t *len) {
+    SVCX_ASSERT(value);
+
+    const char *p = sv.data;
+    const char *end = sv.data + sv.len;
+    if (p < end && *p == '+') {
+        p++;
+    }
+
+    svcx_result r = svcx__parse_digits(&p, end, value);
+    if (len) {
+        *len = r == SVCX_PARSE_INVALID_ERR ? 0 : (size_t)(p - sv.data);
+    }
+    return r;
+}
+
+SVCXDEF svcx_result svcx_sv_parse_i64(
+    svcx_string_view sv, int64_t *value, size_t *len) {
+    SVCX_ASSERT(value);
+
+    const char *p = sv.data;
+    const char *end = sv.data + sv.len;
+    bool neg = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) {
+        p++;
+    }
+
+    uint64_t mag;
+    svcx_result r = svcx__parse_digits(&p, end, &mag);
+    if (len) {
+        *len = r == SVCX_PARSE_INVALID_ERR ? 0 : (size_t)(p - sv.data);
+    }
+    if (r == SVCX_PARSE_INVALID_ERR) {
+        return r;
+    }
+
+    uint64_t limit = (uint64_t)INT64_MAX + neg;
+    if (r == SVCX_PARSE_RANGE_ERR || mag > limit) {
+        *value = neg ? INT64_MIN : INT64_MAX;
+        return SVCX_PARSE_RANGE_ERR;
+    }
+    *value = neg ? (int64_t)(0 - mag) : (int64_t)mag;
+    return SVCX_OK;
+}
+
+// The powers of ten from 1e-348 to 1e347, normalized to 128 bits (with the
+// top bit set) and rounded down, as high and low halves.
+static const uint64_t svcx__pow10_128[][2] = {
+    {0xfa8fd5a0081c0288ULL, 0x1732c869cd60e453ULL},
+    {0x9c99e58405118195ULL, 0x0e7fbd42205c8eb4ULL},
+    {0xc3c05ee50655e1faULL, 0x521fac92a873b261ULL},
+    {0xf4b0769e47eb5a78ULL, 0xe6a797b752909ef9ULL},
+    {0x98ee4a22ecf3188bULL, 0x9028bed2939a635cULL},
+    {0xbf29dcaba82fdeaeULL, 0x7432ee873880fc33ULL},
+    {0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL},
+    {0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL},
+    {0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL},
+    {0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL},
+    {0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL},
+    {0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL},
+    {0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL},
+    {0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL},
+    {0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL},
+    {0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL},
+    {0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL},
+    {0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL},
+    {0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL},
+    {0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL},
+    {0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL},
+    {0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL},
+    {0x84a57695fe98746dULL, 0x014bb630f7604b57ULL},
+    {0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL},
+    {0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL},
+    {0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL},
+    {0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL},
+    {0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL},
+    {0xfd00b897478238d0ULL, 0x8920b098955522b4ULL},
+    {0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL},
+    {0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL},
+    {0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL},
+    {0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL},
+    {0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL},
+    {0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL},
+    {0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL},
+    {0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL},
+    {0xeba09271e88d976bULL, 0xf7864a44c633682eULL},
+    {0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL},
+    {0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL},
+    {0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL},
+    {0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL},
+    {0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL},
+    {0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL},
+    {0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL},
+    {0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL},
+    {0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL},
+    {0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL},
+    {0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL},
+    {0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL},
+    {0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL},
+    {0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL},
+    {0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL},
+    {0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL},
+    {0xa37fce126597973cULL, 0xe50ff107bab528a0ULL},
+    {0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL},
+    {0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL},
+    {0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL},
+    {0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL},
+    {0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL},
+    {0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL},
+    {0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL},
+    {0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL},
+    {0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL},
+    {0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL},
+    {0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL},
+    {0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL},
+    {0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL},
+    {0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL},
+    {0x91376c36d99995beULL, 0x23100809b9c21fa1ULL},
+    {0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL},
+    {0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL},
+    {0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL},
+    {0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL},
+    {0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL},
+    {0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL},
+    {0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL},
+    {0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL},
+    {0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL},
+    {0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL},
+    {0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL},
+    {0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL},
+    {0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL},
+    {0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL},
+    {0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL},
+    {0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL},
+    {0xc987434744ac874eULL, 0xa327ffb266b56220ULL},
+    {0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL},
+    {0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL},
+    {0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL},
+    {0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL},
+    {0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL},
+    {0xc0314325637a1939ULL, 0xfa911155fefb5308ULL},
+    {0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL},
+    {0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL},
+    {0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL},
+    {0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL},
+    {0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL},
+    {0xb749faed14125d36ULL, 0xcef980ec671f667bULL},
+    {0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL},
+    {0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL},
+    {0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL},
+    {0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL},
+    {0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL},
+    {0xaecc49914078536dULL, 0x58fae9f773886e18ULL},
+    {0xda7f5bf590966848ULL, 0xaf39a475506a899eULL},
+    {0x888f99797a5e012dULL, 0x6d8406c952429603ULL},
+    {0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL},
+    {0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL},
+    {0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL},
+    {0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL},
+    {0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL},
+    {0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL},
+    {0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL},
+    {0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL},
+    {0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL},
+    {0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL},
+    {0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL},
+    {0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL},
+    {0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL},
+    {0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL},
+    {0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL},
+    {0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL},
+    {0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL},
+    {0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL},
+    {0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL},
+    {0xb913179899f68584ULL, 0x28e2557b59846e3fULL},
+    {0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL},
+    {0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL},
+    {0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL},
+    {0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL},
+    {0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL},
+    {0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL},
+    {0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL},
+    {0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL},
+    {0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL},
+    {0xd77485cb25823ac7ULL, 0x7d633293366b828bULL},
+    {0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL},
+    {0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL},
+    {0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL},
+    {0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL},
+    {0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL},
+    {0xcd795be870516656ULL, 0x67902e276c921f8bULL},
+    {0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL},
+    {0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL},
+    {0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL},
+    {0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL},
+    {0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL},
+    {0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL},
+    {0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL},
+    {0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL},
+    {0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL},
+    {0xef340a98172aace4ULL, 0x86fb897116c87c34ULL},
+    {0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL},
+    {0xbae0a846d2195712ULL, 0x8974836059cca109ULL},
+    {0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL},
+    {0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL},
+    {0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL},
+    {0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL},
+    {0x8e938662882af53eULL, 0x547eb47b7282ee9cULL},
+    {0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL},
+    {0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL},
+    {0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL},
+    {0xae0b158b4738705eULL, 0x9624ab50b148d445ULL},
+    {0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL},
+    {0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL},
+    {0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL},
+    {0xd47487cc8470652bULL, 0x7647c3200069671fULL},
+    {0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL},
+    {0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL},
+    {0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL},
+    {0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL},
+    {0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL},
+    {0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL},
+    {0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL},
+    {0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL},
+    {0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL},
+    {0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL},
+    {0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL},
+    {0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL},
+    {0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL},
+    {0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL},
+    {0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL},
+    {0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL},
+    {0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL},
+    {0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL},
+    {0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL},
+    {0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL},
+    {0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL},
+    {0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL},
+    {0x8c974f7383725573ULL, 0x1e414218c73a13fbULL},
+    {0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL},
+    {0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL},
+    {0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL},
+    {0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL},
+    {0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL},
+    {0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL},
+    {0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL},
+    {0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL},
+    {0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL},
+    {0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL},
+    {0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL},
+    {0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL},
+    {0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL},
+    {0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL},
+    {0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL},
+    {0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL},
+    {0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL},
+    {0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL},
+    {0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL},
+    {0xbe89523386091465ULL, 0xf6bbb397f1135823ULL},
+    {0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL},
+    {0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL},
+    {0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL},
+    {0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL},
+    {0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL},
+    {0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL},
+    {0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL},
+    {0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL},
+    {0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL},
+    {0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL},
+    {0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL},
+    {0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL},
+    {0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL},
+    {0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL},
+    {0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL},
+    {0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL},
+    {0x843610cb4bf160cbULL, 0xcedf722a585139baULL},
+    {0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL},
+    {0xce947a3da6a9273eULL, 0x733d226229feea32ULL},
+    {0x811ccc668829b887ULL, 0x0806357d5a3f525fULL},
+    {0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL},
+    {0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL},
+    {0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL},
+    {0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL},
+    {0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL},
+    {0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL},
+    {0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL},
+    {0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL},
+    {0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL},
+    {0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL},
+    {0xbbe226efb628afeaULL, 0x890489f70a55368bULL},
+    {0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL},
+    {0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL},
+    {0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL},
+    {0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL},
+    {0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL},
+    {0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL},
+    {0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL},
+    {0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL},
+    {0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL},
+    {0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL},
+    {0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL},
+    {0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL},
+    {0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL},
+    {0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL},
+    {0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL},
+    {0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL},
+    {0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL},
+    {0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL},
+    {0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL},
+    {0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL},
+    {0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL},
+    {0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL},
+    {0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL},
+    {0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL},
+    {0xc24452da229b021bULL, 0xfbe85badce996168ULL},
+    {0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL},
+    {0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL},
+    {0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL},
+    {0xed246723473e3813ULL, 0x290123e9aab23b68ULL},
+    {0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL},
+    {0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL},
+    {0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL},
+    {0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL},
+    {0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL},
+    {0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL},
+    {0x8d590723948a535fULL, 0x579c487e5a38ad0eULL},
+    {0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL},
+    {0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL},
+    {0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL},
+    {0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL},
+    {0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL},
+    {0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL},
+    {0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL},
+    {0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL},
+    {0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL},
+    {0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL},
+    {0xcdb02555653131b6ULL, 0x3792f412cb06794dULL},
+    {0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL},
+    {0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL},
+    {0xc8de047564d20a8bULL, 0xf245825a5a445275ULL},
+    {0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL},
+    {0x9ced737bb6c4183dULL, 0x55464dd69685606bULL},
+    {0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL},
+    {0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL},
+    {0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL},
+    {0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL},
+    {0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL},
+    {0x95a8637627989aadULL, 0xdde7001379a44aa8ULL},
+    {0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL},
+    {0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL},
+    {0x9226712162ab070dULL, 0xcab3961304ca70e8ULL},
+    {0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL},
+    {0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL},
+    {0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL},
+    {0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL},
+    {0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL},
+    {0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL},
+    {0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL},
+    {0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL},
+    {0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL},
+    {0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL},
+    {0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL},
+    {0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL},
+    {0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL},
+    {0xcfb11ead453994baULL, 0x67de18eda5814af2ULL},
+    {0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL},
+    {0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL},
+    {0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL},
+    {0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL},
+    {0x9e74d1b791e07e48ULL, 0x775ea264cf55347dULL},
+    {0xc612062576589ddaULL, 0x95364afe032a819dULL},
+    {0xf79687aed3eec551ULL, 0x3a83ddbd83f52204ULL},
+    {0x9abe14cd44753b52ULL, 0xc4926a9672793542ULL},
+    {0xc16d9a0095928a27ULL, 0x75b7053c0f178293ULL},
+    {0xf1c90080baf72cb1ULL, 0x5324c68b12dd6338ULL},
+    {0x971da05074da7beeULL, 0xd3f6fc16ebca5e03ULL},
+    {0xbce5086492111aeaULL, 0x88f4bb1ca6bcf584ULL},
+    {0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e5ULL},
+    {0x9392ee8e921d5d07ULL, 0x3aff322e62439fcfULL},
+    {0xb877aa3236a4b449ULL, 0x09befeb9fad487c2ULL},
+    {0xe69594bec44de15bULL, 0x4c2ebe687989a9b3ULL},
+    {0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a10ULL},
+    {0xb424dc35095cd80fULL, 0x538484c19ef38c94ULL},
+    {0xe12e13424bb40e13ULL, 0x2865a5f206b06fb9ULL},
+    {0x8cbccc096f5088cbULL, 0xf93f87b7442e45d3ULL},
+    {0xafebff0bcb24aafeULL, 0xf78f69a51539d748ULL},
+    {0xdbe6fecebdedd5beULL, 0xb573440e5a884d1bULL},
+    {0x89705f4136b4a597ULL, 0x31680a88f8953030ULL},
+    {0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3dULL},
+    {0xd6bf94d5e57a42bcULL, 0x3d32907604691b4cULL},
+    {0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b10fULL},
+    {0xa7c5ac471b478423ULL, 0x0fcf80dc33721d53ULL},
+    {0xd1b71758e219652bULL, 0xd3c36113404ea4a8ULL},
+    {0x83126e978d4fdf3bULL, 0x645a1cac083126e9ULL},
+    {0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a3ULL},
+    {0xccccccccccccccccULL, 0xccccccccccccccccULL},
+    {0x8000000000000000ULL, 0x0000000000000000ULL},
+    {0xa000000000000000ULL, 0x0000000000000000ULL},
+    {0xc800000000000000ULL, 0x0000000000000000ULL},
+    {0xfa00000000000000ULL, 0x0000000000000000ULL},
+    {0x9c40000000000000ULL, 0x0000000000000000ULL},
+    {0xc350000000000000ULL, 0x0000000000000000ULL},
+    {0xf424000000000000ULL, 0x0000000000000000ULL},
+    {0x9896800000000000ULL, 0x0000000000000000ULL},
+    {0xbebc200000000000ULL, 0x0000000000000000ULL},
+    {0xee6b280000000000ULL, 0x0000000000000000ULL},
+    {0x9502f90000000000ULL, 0x0000000000000000ULL},
+    {0xba43b74000000000ULL, 0x0000000000000000ULL},
+    {0xe8d4a51000000000ULL, 0x0000000000000000ULL},
+    {0x9184e72a00000000ULL, 0x0000000000000000ULL},
+    {0xb5e620f480000000ULL, 0x0000000000000000ULL},
+    {0xe35fa931a0000000ULL, 0x0000000000000000ULL},
+    {0x8e1bc9bf04000000ULL, 0x0000000000000000ULL},
+    {0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL},
+    {0xde0b6b3a76400000ULL, 0x0000000000000000ULL},
+    {0x8ac7230489e80000ULL, 0x0000000000000000ULL},
+    {0xad78ebc5ac620000ULL, 0x0000000000000000ULL},
+    {0xd8d726b7177a8000ULL, 0x0000000000000000ULL},
+    {0x878678326eac9000ULL, 0x0000000000000000ULL},
+    {0xa968163f0a57b400ULL, 0x0000000000000000ULL},
+    {0xd3c21bcecceda100ULL, 0x0000000000000000ULL},
+    {0x84595161401484a0ULL, 0x0000000000000000ULL},
+    {0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL},
+    {0xcecb8f27f4200f3aULL, 0x0000000000000000ULL},
+    {0x813f3978f8940984ULL, 0x4000000000000000ULL},
+    {0xa18f07d736b90be5ULL, 0x5000000000000000ULL},
+    {0xc9f2c9cd04674edeULL, 0xa400000000000000ULL},
+    {0xfc6f7c4045812296ULL, 0x4d00000000000000ULL},
+    {0x9dc5ada82b70b59dULL, 0xf020000000000000ULL},
+    {0xc5371912364ce305ULL, 0x6c28000000000000ULL},
+    {0xf684df56c3e01bc6ULL, 0xc732000000000000ULL},
+    {0x9a130b963a6c115cULL, 0x3c7f400000000000ULL},
+    {0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL},
+    {0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL},
+    {0x96769950b50d88f4ULL, 0x1314448000000000ULL},
+    {0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL},
+    {0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL},
+    {0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL},
+    {0xb7abc627050305adULL, 0xf14a3d9e40000000ULL},
+    {0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL},
+    {0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL},
+    {0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL},
+    {0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL},
+    {0x8c213d9da502de45ULL, 0x4526f422cc340000ULL},
+    {0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL},
+    {0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL},
+    {0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL},
+    {0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL},
+    {0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL},
+    {0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL},
+    {0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL},
+    {0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL},
+    {0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL},
+    {0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL},
+    {0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL},
+    {0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL},
+    {0x9f4f2726179a2245ULL, 0x01d762422c946590ULL},
+    {0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL},
+    {0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL},
+    {0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL},
+    {0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL},
+    {0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL},
+    {0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL},
+    {0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL},
+    {0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL},
+    {0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL},
+    {0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL},
+    {0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL},
+    {0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL},
+    {0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL},
+    {0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL},
+    {0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL},
+    {0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL},
+    {0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL},
+    {0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL},
+    {0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL},
+    {0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL},
+    {0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL},
+    {0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL},
+    {0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL},
+    {0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL},
+    {0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL},
+    {0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL},
+    {0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL},
+    {0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL},
+    {0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL},
+    {0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL},
+    {0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL},
+    {0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL},
+    {0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL},
+    {0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL},
+    {0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL},
+    {0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL},
+    {0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL},
+    {0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL},
+    {0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL},
+    {0x924d692ca61be758ULL, 0x593c2626705f9c56ULL},
+    {0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL},
+    {0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL},
+    {0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL},
+    {0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL},
+    {0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL},
+    {0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL},
+    {0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL},
+    {0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL},
+    {0x884134fe908658b2ULL, 0x3109058d147fdcddULL},
+    {0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL},
+    {0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL},
+    {0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL},
+    {0xa6539930bf6bff45ULL, 0x84db8346b786151cULL},
+    {0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL},
+    {0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL},
+    {0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL},
+    {0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL},
+    {0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL},
+    {0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL},
+    {0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL},
+    {0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL},
+    {0x9ae757596946075fULL, 0x3375788de9b06958ULL},
+    {0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL},
+    {0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL},
+    {0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL},
+    {0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL},
+    {0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL},
+    {0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL},
+    {0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL},
+    {0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL},
+    {0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL},
+    {0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL},
+    {0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL},
+    {0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL},
+    {0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL},
+    {0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL},
+    {0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL},
+    {0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL},
+    {0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL},
+    {0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL},
+    {0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL},
+    {0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL},
+    {0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL},
+    {0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL},
+    {0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL},
+    {0x802221226be55a64ULL, 0xc2494954da2c9789ULL},
+    {0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL},
+    {0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL},
+    {0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL},
+    {0x9c69a97284b578d7ULL, 0xff2a760414536efbULL},
+    {0xc38413cf25e2d70dULL, 0xfef5138519684abaULL},
+    {0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL},
+    {0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL},
+    {0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL},
+    {0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL},
+    {0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL},
+    {0xba756174393d88dfULL, 0x94f971119aeef9e4ULL},
+    {0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL},
+    {0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL},
+    {0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL},
+    {0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL},
+    {0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL},
+    {0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL},
+    {0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL},
+    {0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL},
+    {0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL},
+    {0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL},
+    {0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL},
+    {0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL},
+    {0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL},
+    {0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL},
+    {0xa59bc234db398c25ULL, 0x43fab9837e699095ULL},
+    {0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL},
+    {0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL},
+    {0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL},
+    {0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL},
+    {0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL},
+    {0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL},
+    {0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL},
+    {0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL},
+    {0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL},
+    {0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL},
+    {0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL},
+    {0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL},
+    {0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL},
+    {0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL},
+    {0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL},
+    {0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL},
+    {0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL},
+    {0x8fa475791a569d10ULL, 0xf96e017d694487bcULL},
+    {0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL},
+    {0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL},
+    {0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL},
+    {0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL},
+    {0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL},
+    {0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL},
+    {0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL},
+    {0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL},
+    {0x85c7056562757456ULL, 0xf6872d5667844e49ULL},
+    {0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL},
+    {0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL},
+    {0x82a45b450226b39cULL, 0xecc0024661173473ULL},
+    {0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL},
+    {0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL},
+    {0xff290242c83396ceULL, 0x7e67047175a15271ULL},
+    {0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL},
+    {0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL},
+    {0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL},
+    {0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL},
+    {0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL},
+    {0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL},
+    {0x98165af37b2153deULL, 0xc3727a337a8b704aULL},
+    {0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL},
+    {0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL},
+    {0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL},
+    {0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL},
+    {0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL},
+    {0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL},
+    {0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL},
+    {0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL},
+    {0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL},
+    {0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL},
+    {0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL},
+    {0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL},
+    {0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL},
+    {0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL},
+    {0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL},
+    {0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL},
+    {0xd31045a8341ca07cULL, 0x1ede48111209a050ULL},
+    {0x83ea2b892091e44dULL, 0x934aed0aab460432ULL},
+    {0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL},
+    {0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL},
+    {0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL},
+    {0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL},
+    {0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL},
+    {0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL},
+    {0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL},
+    {0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL},
+    {0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL},
+    {0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL},
+    {0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL},
+    {0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL},
+    {0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL},
+    {0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL},
+    {0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL},
+    {0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL},
+    {0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL},
+    {0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL},
+    {0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL},
+    {0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL},
+    {0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL},
+    {0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL},
+    {0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL},
+    {0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL},
+    {0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL},
+    {0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL},
+    {0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL},
+    {0x8533285c936b35deULL, 0xd53a88958f87275fULL},
+    {0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL},
+    {0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL},
+    {0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL},
+    {0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL},
+    {0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL},
+    {0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL},
+    {0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL},
+    {0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL},
+    {0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL},
+    {0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL},
+    {0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL},
+    {0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL},
+    {0x976e41088617ca01ULL, 0xd5be0503e085d813ULL},
+    {0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL},
+    {0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL},
+    {0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL},
+    {0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL},
+    {0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL},
+    {0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL},
+    {0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL},
+    {0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL},
+    {0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL},
+    {0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL},
+    {0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL},
+    {0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL},
+    {0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL},
+    {0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL},
+    {0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL},
+    {0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL},
+    {0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL},
+    {0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL},
+    {0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL},
+    {0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL},
+    {0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL},
+    {0xa0555e361951c366ULL, 0xd7e105bcc332621fULL},
+    {0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL},
+    {0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL},
+    {0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL},
+    {0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL},
+    {0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL},
+    {0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL},
+    {0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL},
+    {0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL},
+    {0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL},
+    {0xbaa718e68396cffdULL, 0xd30560258f54e6baULL},
+    {0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL},
+    {0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL},
+    {0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL},
+    {0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL},
+    {0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL},
+    {0xb201833b35d63f73ULL, 0x2cd2cc6551e513daULL},
+    {0xde81e40a034bcf4fULL, 0xf8077f7ea65e58d1ULL},
+    {0x8b112e86420f6191ULL, 0xfb04afaf27faf782ULL},
+    {0xadd57a27d29339f6ULL, 0x79c5db9af1f9b563ULL},
+    {0xd94ad8b1c7380874ULL, 0x18375281ae7822bcULL},
+    {0x87cec76f1c830548ULL, 0x8f2293910d0b15b5ULL},
+    {0xa9c2794ae3a3c69aULL, 0xb2eb3875504ddb22ULL},
+    {0xd433179d9c8cb841ULL, 0x5fa60692a46151ebULL},
+    {0x849feec281d7f328ULL, 0xdbc7c41ba6bcd333ULL},
+    {0xa5c7ea73224deff3ULL, 0x12b9b522906c0800ULL},
+    {0xcf39e50feae16befULL, 0xd768226b34870a00ULL},
+    {0x81842f29f2cce375ULL, 0xe6a1158300d46640ULL},
+    {0xa1e53af46f801c53ULL, 0x60495ae3c1097fd0ULL},
+    {0xca5e89b18b602368ULL, 0x385bb19cb14bdfc4ULL},
+    {0xfcf62c1dee382c42ULL, 0x46729e03dd9ed7b5ULL},
+    {0x9e19db92b4e31ba9ULL, 0x6c07a2c26a8346d1ULL},
+    {0xc5a05277621be293ULL, 0xc7098b7305241885ULL},
+    {0xf70867153aa2db38ULL, 0xb8cbee4fc66d1ea7ULL},
+    {0x9a65406d44a5c903ULL, 0x737f74f1dc043328ULL},
+    {0xc0fe908895cf3b44ULL, 0x505f522e53053ff2ULL},
+    {0xf13e34aabb430a15ULL, 0x647726b9e7c68fefULL},
+    {0x96c6e0eab509e64dULL, 0x5eca783430dc19f5ULL},
+    {0xbc789925624c5fe0ULL, 0xb67d16413d132072ULL},
+    {0xeb96bf6ebadf77d8ULL, 0xe41c5bd18c57e88fULL},
+    {0x933e37a534cbaae7ULL, 0x8e91b962f7b6f159ULL},
+    {0xb80dc58e81fe95a1ULL, 0x723627bbb5a4adb0ULL},
+    {0xe61136f2227e3b09ULL, 0xcec3b1aaa30dd91cULL},
+    {0x8fcac257558ee4e6ULL, 0x213a4f0aa5e8a7b1ULL},
+    {0xb3bd72ed2af29e1fULL, 0xa988e2cd4f62d19dULL},
+    {0xe0accfa875af45a7ULL, 0x93eb1b80a33b8605ULL},
+    {0x8c6c01c9498d8b88ULL, 0xbc72f130660533c3ULL},
+    {0xaf87023b9bf0ee6aULL, 0xeb8fad7c7f8680b4ULL},
+    {0xdb68c2ca82ed2a05ULL, 0xa67398db9f6820e1ULL},
+    {0x892179be91d43a43ULL, 0x88083f8943a1148cULL},
+    {0xab69d82e364948d4ULL, 0x6a0a4f6b948959b0ULL},
+    {0xd6444e39c3db9b09ULL, 0x848ce34679abb01cULL},
+    {0x85eab0e41a6940e5ULL, 0xf2d80e0c0c0b4e11ULL},
+    {0xa7655d1d2103911fULL, 0x6f8e118f0f0e2195ULL},
+    {0xd13eb46469447567ULL, 0x4b7195f2d2d1a9fbULL},
+};
+
+static const double svcx__pow10_exact[] = {1e0,
+    1e1,
+    1e2,
+    1e3,
+    1e4,
+    1e5,
+    1e6,
+    1e7,
+    1e8,
+    1e9,
+    1e10,
+    1e11,
+    1e12,
+    1e13,
+    1e14,
+    1e15,
+    1e16,
+    1e17,
+    1e18,
+    1e19,
+    1e20,
+    1e21,
+    1e22};
+
+static double svcx__f64_from_bits(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+// Computes man * 10^exp10 exactly when both factors are exact doubles, so a
+// single rounding gives the correct result.
+static bool svcx__parse_f64_clinger(uint64_t man, int64_t exp10, double *out) {
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    if (man > (1ULL << 53) || exp10 < -22 || exp10 > 22) {
+        return false;
+    }
+    double d = (double)man;
+    *out = exp10 < 0 ? d / svcx__pow10_exact[-exp10]
+                     : d * svcx__pow10_exact[exp10];
+    return true;
+#else
+    SVCX_UNUSED(man);
+    SVCX_UNUSED(exp10);
+    SVCX_UNUSED(out);
+    return false;
+#endif
+}
+
+// Computes the correctly rounded man * 10^exp10 for a non-zero man, or
+// returns false if the result is ambiguous, subnormal or out of range.
+static bool svcx__parse_f64_eisel_lemire(
+    uint64_t man, int64_t exp10, double *out) {
+    if (exp10 < -348 || exp10 > 347) {
+        return false;
+    }
+    const uint64_t *pow = svcx__pow10_128[exp10 + 348];
+
+    // floor(exp10 * log2(10)) for the range of the table.
+    int64_t log2 = 217706 * exp10;
+    log2 = log2 >= 0 ? log2 / 65536 : -((-log2 + 65535) / 65536);
+
+    int clz = svcx__clz64(man);
+    man <<= clz;
+    uint64_t exp2 = (uint64_t)(log2 + 64 + 1023) - (uint64_t)clz;
+
+    uint64_t lo = man;
+    uint64_t hi = pow[0];
+    svcx__mum(&lo, &hi);
+    if ((hi & 0x1ff) == 0x1ff && lo + man < man) {
+        // The truncated power may have cost a carry into the bits that
+        // decide the rounding, so include its low half.
+        uint64_t y_lo = man;
+        uint64_t y_hi = pow[1];
+        svcx__mum(&y_lo, &y_hi);
+        uint64_t merged_lo = lo + y_hi;
+        uint64_t merged_hi = hi + (merged_lo < lo);
+        if ((merged_hi & 0x1ff) == 0x1ff && merged_lo + 1 == 0 &&
+            y_lo + man < man) {
+            return false;
+        }
+        hi = merged_hi;
+        lo = merged_lo;
+    }
+
+    uint64_t msb = hi >> 63;
+    uint64_t mantissa = hi >> (msb + 9);
+    exp2 -= 1 ^ msb;
+    if (lo == 0 && (hi & 0x1ff) == 0 && (mantissa & 3) == 1) {
+        return false;
+    }
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >> 53) {
+        mantissa >>= 1;
+        exp2++;
+    }
+    if (exp2 - 1 >= 0x7ff - 1) {
+        return false;
+    }
+
+    *out = svcx__f64_from_bits(exp2 << 52 | (mantissa & ((1ULL << 52) - 1)));
+    return true;
+}
+
+// Hands the number to strtod as significant digits and an exponent, without
+// a decimal point, so the current locale does not matter. Digits past the
+// 768th only matter for rounding when they are not all zero, so they are
+// replaced by a single 1.
+static double svcx__parse_f64_slow(const char *digits,
+    size_t int_len,
+    const char *frac,
+    size_t frac_len,
+    int64_t exp10) {
+    char buf[800];
+    size_t n = 0;
+    int64_t dropped = 0;
+    bool sticky = false;
+    for (size_t i = 0; i < int_len + frac_len; i++) {
+        char c = i < int_len ? digits[i] : frac[i - int_len];
+        if (n == 0 && c == '0') {
+            continue;
+        }
+        if (n < 768) {
+            buf[n++] = c;
+        } else {
+            dropped++;
+            sticky |= c != '0';
+        }
+    }
+    if (n == 0) {
+        return 0.0;
+    }
+
+    exp10 += dropped - (int64_t)frac_len;
+    if (sticky) {
+        buf[n++] = '1';
+        exp10--;
+    }
+    exp10 = exp10 < -100000 ? -100000 : exp10 > 100000 ? 100000 : exp10;
+
+    buf[n++] = 'e';
+    if (exp10 < 0) {
+        buf[n++] = '-';
+        exp10 = -exp10;
+    }
+    char tmp[8];
+    size_t t = 0;
+    do {
+        tmp[t++] = (char)('0' + exp10 % 10);
+        exp10 /= 10;
+    } while (exp10 > 0);
+    while (t > 0) {
+        buf[n++] = tmp[--t];
+    }
+    buf[n] = '\0';
+    return strtod(buf, NULL);
+}
+
+// Matches a word of lowercase letters case-insensitively.
+static bool svcx__parse_word(const char *p, const char *end, const char *w) {
+    size_t n = strlen(w);
+    if ((size_t)(end - p) < n) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if ((p[i] | 0x20) != w[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SVCXDEF svcx_result svcx_sv_parse_f64(
+    svcx_string_view sv, double *value, size_t *len) {
+    SVCX_ASSERT(value);
+
+    const char *p = sv.data;
+    const char *end = sv.data + sv.len;
+    bool neg = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) {
+        p++;
+    }
+    uint64_t sign = (uint64_t)neg << 63;
+
+    if (svcx__parse_word(p, end, "inf")) {
+        p += svcx__parse_word(p, end, "infinity") ? 8 : 3;
+        *value = svcx__f64_from_bits(sign | 0x7ff0000000000000ULL);
+        if (len) {
+            *len = (size_t)(p - sv.data);
+        }
+        return SVCX_OK;
+    }
+    if (svcx__parse_word(p, end, "nan")) {
+        *value = svcx__f64_from_bits(sign | 0x7ff8000000000000ULL);
+        if (len) {
+            *len = (size_t)(p + 3 - sv.data);
+        }
+        return SVCX_OK;
+    }
+
+    // The first 19 significant digits go into man, and exp10 is adjusted so
+    // that the number is man * 10^exp10 plus whatever was truncated.
+    uint64_t man = 0;
+    int sig = 0;
+    int64_t exp10 = 0;
+    bool truncated = false;
+
+    const char *int_start = p;
+    while (p < end && *p == '0') {
+        p++;
+    }
+    while (end - p >= 8 && sig <= 11 &&
+           svcx__is_8_digits(svcx__read64((const uint8_t *)p))) {
+        man = man * 100000000 +
+              svcx__parse_8_digits(svcx__read64((const uint8_t *)p));
+        sig += 8;
+        p += 8;
+    }
+    for (; p < end && svcx__is_digit(*p); p++) {
+        if (sig < 19) {
+            man = man * 10 + (uint64_t)(*p - '0');
+            sig++;
+        } else {
+            exp10++;
+            truncated |= *p != '0';
+        }
+    }
+    size_t int_len = (size_t)(p - int_start);
+
+    const char *frac_start = p;
+    size_t frac_len = 0;
+    if (p < end && *p == '.') {
+        frac_start = ++p;
+        if (man == 0) {
+            while (p < end && *p == '0') {
+                p++;
+                exp10--;
+            }
+        }
+        while (end - p >= 8 && sig <= 11 &&
+               svcx__is_8_digits(svcx__read64((const uint8_t *)p))) {
+            man = man * 100000000 +
+                  svcx__parse_8_digits(svcx__read64((const uint8_t *)p));
+            sig += 8;
+            exp10 -= 8;
+            p += 8;
+        }
+        for (; p < end && svcx__is_digit(*p); p++) {
+            if (sig < 19) {
+                man = man * 10 + (uint64_t)(*p - '0');
+                sig++;
+                exp10--;
+            } else {
+                truncated |= *p != '0';
+            }
+        }
+        frac_len = (size_t)(p - frac_start);
+    }
+
+    if (int_len + frac_len == 0) {
+        if (len) {
+            *len = 0;
+        }
+        return SVCX_PARSE_INVALID_ERR;
+    }
+
+    // The exponent is only consumed if it has digits, like in strtod.
+    int64_t exp_part = 0;
+    if (p < end && (*p | 0x20) == 'e') {
+        const char *e = p + 1;
+        bool exp_neg = e < end && *e == '-';
+        if (e < end && (*e == '-' || *e == '+')) {
+            e++;
+        }
+        if (e < end && svcx__is_digit(*e)) {
+            for (; e < end && svcx__is_digit(*e); e++) {
+                if (exp_part < 100000) {
+                    exp_part = exp_part * 10 + (*e - '0');
+                }
+            }
+            exp_part = exp_neg ? -exp_part : exp_part;
+            p = e;
+        }
+    }
+    exp10 += exp_part;
+    if (len) {
+        *len = (size_t)(p - sv.data);
+    }
+
+    double d = 0.0;
+    bool done = man == 0;
+    if (!done && !truncated) {
+        done = svcx__parse_f64_clinger(man, exp10, &d) ||
+               svcx__parse_f64_eisel_lemire(man, exp10, &d);
+    } else if (!done) {
+        // The digits lie between man and man + 1, so if both round the same
+        // way, so does the number.
+        double up;
+        done = svcx__parse_f64_eisel_lemire(man, exp10, &d) &&
+               svcx__parse_f64_eisel_lemire(man + 1, exp10, &up) && d == up;
+    }
+    if (!done) {
+        d = svcx__parse_f64_slow(int_start, int_len, frac_start, frac_len,
+            exp_part);
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    *value = svcx__f64_from_bits(bits | sign);
+    if ((bits & 0x7ff0000000000000ULL) == 0x7ff0000000000000ULL) {
+        return SVCX_PARSE_RANGE_ERR;
+    }
+    return SVCX_OK;
+}
+
+//
+// UTF-8. The scalar validator checks the second byte of each sequence
+// against the range its lead byte allows, which rules out overlong forms,
+// surrogates and code points above U+10FFFF, and skips ASCII eight bytes at a
+// time. The AVX2 validator classifies every byte pair by the high nibble of
+// the first byte, its low nibble and the high nibble of the second byte,
+// with three table lookups whose AND is nonzero exactly for the invalid
+// pairs, and checks the third and fourth bytes of long sequences separately.
+// Code points are counted as the bytes that are not continuation bytes
+// (those are 0x80 to 0xBF, the bytes below -64 as signed chars). Transcoding
+// decodes every byte of a block as if it started a sequence of up to three
+// bytes, into 16-bit lanes, and keeps the lanes of the bytes that do.
+//
+
+// Writes the UTF-8 encoding of cp and returns its length.
+static size_t svcx__utf8_encode(char *out, uint32_t cp) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | cp >> 6);
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | cp >> 12);
+        out[1] = (char)(0x80 | (cp >> 6 & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | cp >> 18);
+    out[1] = (char)(0x80 | (cp >> 12 & 0x3F));
+    out[2] = (char)(0x80 | (cp >> 6 & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Returns the offset of the first invalid sequence in p, or len.
+static size_t svcx__utf8_check(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        if (i + 8 <= len) {
+            uint64_t w;
+            memcpy(&w, p + i, sizeof(w));
+            if ((w & 0x8080808080808080ULL) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+
+        unsigned char c = p[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+        size_t n;
+        unsigned char lo = 0x80;
+        unsigned char hi = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            n = 2;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            n = 3;
+            lo = c == 0xE0 ? 0xA0 : 0x80;
+            hi = c == 0xED ? 0x9F : 0xBF;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            n = 4;
+            lo = c == 0xF0 ? 0x90 : 0x80;
+            hi = c == 0xF4 ? 0x8F : 0xBF;
+        } else {
+            return i;
+        }
+        if (len - i < n || p[i + 1] < lo || p[i + 1] > hi) {
+            return i;
+        }
+        for (size_t k = 2; k < n; k++) {
+            if ((p[i + k] & 0xC0) != 0x80) {
+                return i;
+            }
+        }
+        i += n;
+    }
+    return len;
+}
+
+// Decodes the valid sequence at p[*i] and moves *i past it.
+static uint32_t svcx__utf8_decode(const unsigned char *p, size_t *i) {
+    uint32_t c = p[*i];
+    if (c < 0x80) {
+        *i += 1;
+        return c;
+    }
+    if (c < 0xE0) {
+        *i += 2;
+        return (c & 0x1F) << 6 | (p[*i - 1] & 0x3Fu);
+    }
+    if (c < 0xF0) {
+        *i += 3;
+        return (c & 0x0F) << 12 | (p[*i - 2] & 0x3Fu) << 6 |
+               (p[*i - 1] & 0x3Fu);
+    }
+    *i += 4;
+    return (c & 0x07) << 18 | (p[*i - 3] & 0x3Fu) << 12 |
+           (p[*i - 2] & 0x3Fu) << 6 | (p[*i - 1] & 0x3Fu);
+}
+
+#ifdef SVCX__SSE2
+// SSE2 has no byte shuffle for the lookups, so it only skips ASCII.
+static size_t svcx__utf8_validate_sse2(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(p + i)))) {
+            break;
+        }
+    }
+    return i;
+}
+
+static size_t svcx__utf8_count_sse2(
+    const unsigned char *p, size_t len, size_t *count) {
+    const __m128i cont = _mm_set1_epi8(-65);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpgt_epi8(v, cont));
+        *count += (size_t)svcx__popcount64(mask);
+    }
+    return i;
+}
+
+// Decodes 8 sequences of up to three bytes from their first, second and third
+// bytes, in 16-bit lanes.
+static __m128i svcx__utf8_decode8_sse2(__m128i b0, __m128i b1, __m128i b2) {
+    const __m128i low6 = _mm_set1_epi16(0x3F);
+    __m128i two = _mm_or_si128(
+        _mm_slli_epi16(_mm_and_si128(b0, _mm_set1_epi16(0x1F)), 6),
+        _mm_and_si128(b1, low6));
+    // The shift by 12 drops all but the low nibble of the lead byte.
+    __m128i three = _mm_or_si128(_mm_slli_epi16(b0, 12),
+        _mm_or_si128(_mm_slli_epi16(_mm_and_si128(b1, low6), 6),
+            _mm_and_si128(b2, low6)));
+    __m128i is2 = _mm_cmpgt_epi16(b0, _mm_set1_epi16(0xBF));
+    __m128i is3 = _mm_cmpgt_epi16(b0, _mm_set1_epi16(0xDF));
+    __m128i cp =
+        _mm_or_si128(_mm_and_si128(is2, two), _mm_andnot_si128(is2, b0));
+    return _mm_or_si128(_mm_and_si128(is3, three), _mm_andnot_si128(is3, cp));
+}
+
+// Decodes the sequences that start in the 16 bytes at p, which must be
+// followed by two more bytes, into lanes, assuming none of them is longer than
+// three bytes. The lanes of continuation bytes get garbage.
+static void svcx__utf8_decode16_sse2(const unsigned char *p, uint16_t *lanes) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v0 = _mm_loadu_si128((const __m128i *)p);
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(p + 1));
+    __m128i v2 = _mm_loadu_si128((const __m128i *)(p + 2));
+    _mm_storeu_si128((__m128i *)lanes,
+        svcx__utf8_decode8_sse2(_mm_unpacklo_epi8(v0, zero),
+            _mm_unpacklo_epi8(v1, zero),
+            _mm_unpacklo_epi8(v2, zero)));
+    _mm_storeu_si128((__m128i *)(lanes + 8),
+        svcx__utf8_decode8_sse2(_mm_unpackhi_epi8(v0, zero),
+            _mm_unpackhi_epi8(v1, zero),
+            _mm_unpackhi_epi8(v2, zero)));
+}
+
+// Returns the bits of the bytes in v that start sequences, up to the first
+// 4-byte sequence, whose offset goes into stop (16 if there is none).
+static unsigned svcx__utf8_leads_sse2(__m128i v, unsigned *stop) {
+    unsigned leads =
+        (unsigned)_mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8(-65)));
+    unsigned four = (unsigned)_mm_movemask_epi8(v) &
+                    (unsigned)_mm_movemask_epi8(
+                        _mm_cmpgt_epi8(v, _mm_set1_epi8(-17)));
+    *stop = four ? (unsigned)svcx__ctz64(four) : 16;
+    return leads & ((1u << *stop) - 1);
+}
+
+static size_t svcx__utf8_widen16_sse2(
+    const unsigned char *p, size_t len, uint16_t *out, size_t *written) {
+    const __m128i zero = _mm_setzero_si128();
+    uint16_t lanes[16];
+    size_t i = 0;
+    size_t o = 0;
+    while (i + 18 <= len) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        if (!_mm_movemask_epi8(v)) {
+            _mm_storeu_si128((__m128i *)(out + o), _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128(
+                (__m128i *)(out + o + 8), _mm_unpackhi_epi8(v, zero));
+            i += 16;
+            o += 16;
+            continue;
+        }
+        unsigned stop;
+        unsigned leads = svcx__utf8_leads_sse2(v, &stop);
+        svcx__utf8_decode16_sse2(p + i, lanes);
+        for (; leads; leads &= leads - 1) {
+            out[o++] = lanes[svcx__ctz64(leads)];
+        }
+        // A branch rather than i += stop, so the next block does not wait
+        // for this one.
+        if (stop < 16) {
+            i += stop;
+            break;
+        }
+        i += 16;
+    }
+    // The last block may end inside a sequence that it already decoded.
+    while (i < len && (p[i] & 0xC0) == 0x80) {
+        i++;
+    }
+    *written = o;
+    return i;
+}
+
+static size_t svcx__utf8_widen32_sse2(
+    const unsigned char *p, size_t len, uint32_t *out, size_t *written) {
+    const __m128i zero = _mm_setzero_si128();
+    uint16_t lanes[16];
+    size_t i = 0;
+    size_t o = 0;
+    while (i + 18 <= len) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        if (!_mm_movemask_epi8(v)) {
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            __m128i *dst = (__m128i *)(out + o);
+            _mm_storeu_si128(dst, _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(hi, zero));
+            i += 16;
+            o += 16;
+            continue;
+        }
+        unsigned stop;
+        unsigned leads = svcx__utf8_leads_sse2(v, &stop);
+        svcx__utf8_decode16_sse2(p + i, lanes);
+        for (; leads; leads &= leads - 1) {
+            out[o++] = lanes[svcx__ctz64(leads)];
+        }
+        if (stop < 16) {
+            i += stop;
+            break;
+        }
+        i += 16;
+    }
+    while (i < len && (p[i] & 0xC0) == 0x80) {
+        i++;
+    }
+    *written = o;
+    return i;
+}
+#endif // SVCX__SSE2
+
+#ifdef SVCX__AVX2
+// Returns the start of the last sequence that begins before i, if it is not
+// ASCII (it may continue past i), or i otherwise.
+static size_t svcx__utf8_boundary(const unsigned char *p, size_t i) {
+    for (size_t k = 1; k <= 4 && k <= i; k++) {
+        unsigned char c = p[i - k];
+        if ((c & 0xC0) != 0x80) {
+            return c >= 0xC0 ? i - k : i;
+        }
+    }
+    return i;
+}
+
+// The error classes of a byte pair, as bits of the lookup tables.
+#define SVCX__UTF8_TOO_SHORT (1 << 0)  // lead byte, then not a continuation
+#define SVCX__UTF8_TOO_LONG (1 << 1)   // ASCII, then a continuation
+#define SVCX__UTF8_OVERLONG_3 (1 << 2) // E0, then 80 to 9F
+#define SVCX__UTF8_TOO_LARGE (1 << 3)  // F4, then 90 to BF, or F5 to FF
+#define SVCX__UTF8_SURROGATE (1 << 4)  // ED, then A0 to BF
+#define SVCX__UTF8_OVERLONG_2 (1 << 5) // C0 or C1
+#define SVCX__UTF8_TOO_LARGE_1000 (1 << 6)
+#define SVCX__UTF8_OVERLONG_4 (1 << 6) // F0, then 80 to 8F
+#define SVCX__UTF8_TWO_CONTS (1 << 7)  // two continuations
+#define SVCX__UTF8_CARRY                                                       \
+    (SVCX__UTF8_TOO_SHORT | SVCX__UTF8_TOO_LONG | SVCX__UTF8_TWO_CONTS)
+
+// The same 16-entry table in both lanes, since shuffles stay in a lane.
+#define SVCX__UTF8_TABLE(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11,    \
+    a12, a13, a14, a15)                                                        \
+    _mm256_setr_epi8((char)(a0), (char)(a1), (char)(a2), (char)(a3),           \
+        (char)(a4), (char)(a5), (char)(a6), (char)(a7), (char)(a8),            \
+        (char)(a9), (char)(a10), (char)(a11), (char)(a12), (char)(a13),        \
+        (char)(a14), (char)(a15), (char)(a0), (char)(a1), (char)(a2),          \
+        (char)(a3), (char)(a4), (char)(a5), (char)(a6), (char)(a7),            \
+        (char)(a8), (char)(a9), (char)(a10), (char)(a11), (char)(a12),         \
+        (char)(a13), (char)(a14), (char)(a15))
+
+SVCX__AVX2_FN static size_t svcx__utf8_validate_avx2(
+    const unsigned char *p, size_t len) {
+    const __m256i byte_1_high = SVCX__UTF8_TABLE(SVCX__UTF8_TOO_LONG,
+        SVCX__UTF8_TOO_LONG,
+        SVCX__UTF8_TOO_LONG,
+        SVCX__UTF8_TOO_LONG,
+        SVCX__UTF8_TOO_LONG,
+        SVCX__UTF8_TOO_LONG,
+        SVCX__UTF8_TOO_LONG,
+        SVCX__UTF8_TOO_LONG,
+        SVCX__UTF8_TWO_CONTS,
+        SVCX__UTF8_TWO_CONTS,
+        SVCX__UTF8_TWO_CONTS,
+        SVCX__UTF8_TWO_CONTS,
+        SVCX__UTF8_TOO_SHORT | SVCX__UTF8_OVERLONG_2,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT | SVCX__UTF8_OVERLONG_3 | SVCX__UTF8_SURROGATE,
+        SVCX__UTF8_TOO_SHORT | SVCX__UTF8_TOO_LARGE |
+            SVCX__UTF8_TOO_LARGE_1000 | SVCX__UTF8_OVERLONG_4);
+    const __m256i byte_1_low = SVCX__UTF8_TABLE(
+        SVCX__UTF8_CARRY | SVCX__UTF8_OVERLONG_3 | SVCX__UTF8_OVERLONG_2 |
+            SVCX__UTF8_OVERLONG_4,
+        SVCX__UTF8_CARRY | SVCX__UTF8_OVERLONG_2,
+        SVCX__UTF8_CARRY,
+        SVCX__UTF8_CARRY,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000 |
+            SVCX__UTF8_SURROGATE,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000,
+        SVCX__UTF8_CARRY | SVCX__UTF8_TOO_LARGE | SVCX__UTF8_TOO_LARGE_1000);
+    const __m256i byte_2_high = SVCX__UTF8_TABLE(SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_LONG | SVCX__UTF8_OVERLONG_2 | SVCX__UTF8_TWO_CONTS |
+            SVCX__UTF8_OVERLONG_3 | SVCX__UTF8_TOO_LARGE_1000 |
+            SVCX__UTF8_OVERLONG_4,
+        SVCX__UTF8_TOO_LONG | SVCX__UTF8_OVERLONG_2 | SVCX__UTF8_TWO_CONTS |
+            SVCX__UTF8_OVERLONG_3 | SVCX__UTF8_TOO_LARGE,
+        SVCX__UTF8_TOO_LONG | SVCX__UTF8_OVERLONG_2 | SVCX__UTF8_TWO_CONTS |
+            SVCX__UTF8_SURROGATE | SVCX__UTF8_TOO_LARGE,
+        SVCX__UTF8_TOO_LONG | SVCX__UTF8_OVERLONG_2 | SVCX__UTF8_TWO_CONTS |
+            SVCX__UTF8_SURROGATE | SVCX__UTF8_TOO_LARGE,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT,
+        SVCX__UTF8_TOO_SHORT);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i high = _mm256_set1_epi8((char)0x80);
+    // A block may not end inside a sequence: its last three bytes must not
+    // start sequences longer than 4, 3 and 2 bytes respectively.
+    const __m256i incomplete = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, (char)0xEF, (char)0xDF, (char)0xBF);
+
+    __m256i prev = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(p + i));
+        if (!_mm256_movemask_epi8(in)) {
+            __m256i cut = _mm256_subs_epu8(prev, incomplete);
+            if (!_mm256_testz_si256(cut, cut)) {
+                break;
+            }
+            prev = in;
+            continue;
+        }
+
+        // The previous one, two and three bytes of each byte.
+        __m256i shifted = _mm256_permute2x128_si256(prev, in, 0x21);
+        __m256i prev1 = _mm256_alignr_epi8(in, shifted, 15);
+        __m256i prev2 = _mm256_alignr_epi8(in, shifted, 14);
+        __m256i prev3 = _mm256_alignr_epi8(in, shifted, 13);
+
+        __m256i special = _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_shuffle_epi8(byte_1_high,
+                    _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                _mm256_shuffle_epi8(
+                    byte_1_low, _mm256_and_si256(prev1, nibble))),
+            _mm256_shuffle_epi8(byte_2_high,
+                _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble)));
+
+        // Third and fourth bytes must be continuations (TWO_CONTS marks
+        // them), and nothing else may be two continuations in a row.
+        __m256i must23 = _mm256_or_si256(
+            _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)),
+            _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80)));
+        __m256i err = _mm256_xor_si256(_mm256_and_si256(must23, high), special);
+        if (!_mm256_testz_si256(err, err)) {
+            break;
+        }
+        prev = in;
+    }
+    return svcx__utf8_boundary(p, i);
+}
+
+#undef SVCX__UTF8_TABLE
+
+SVCX__AVX2_FN static size_t svcx__utf8_count_avx2(
+    const unsigned char *p, size_t len, size_t *count) {
+    const __m256i cont = _mm256_set1_epi8(-65);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        uint32_t mask =
+            (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, cont));
+        *count += (size_t)_mm_popcnt_u32(mask);
+    }
+    return i;
+}
+
+// Decodes the sequences that start in the 16 bytes at p like
+// svcx__utf8_decode16_sse2, into the 16-bit lanes of the result.
+SVCX__AVX2_FN static inline __m256i svcx__utf8_decode16_avx2(
+    const unsigned char *p) {
+    const __m256i low6 = _mm256_set1_epi16(0x3F);
+    __m256i b0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p));
+    __m256i b1 =
+        _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p + 1)));
+    __m256i b2 =
+        _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p + 2)));
+    __m256i two = _mm256_or_si256(
+        _mm256_slli_epi16(_mm256_and_si256(b0, _mm256_set1_epi16(0x1F)), 6),
+        _mm256_and_si256(b1, low6));
+    // The shift by 12 drops all but the low nibble of the lead byte.
+    __m256i three = _mm256_or_si256(_mm256_slli_epi16(b0, 12),
+        _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(b1, low6), 6),
+            _mm256_and_si256(b2, low6)));
+    __m256i cp = _mm256_blendv_epi8(
+        b0, two, _mm256_cmpgt_epi16(b0, _mm256_set1_epi16(0xBF)));
+    return _mm256_blendv_epi8(
+        cp, three, _mm256_cmpgt_epi16(b0, _mm256_set1_epi16(0xDF)));
+}
+
+// Moves the 16-bit lanes of v whose bits are set in the low byte of mask to
+// the front. PEXT packs the lane indices, which become the shuffle.
+SVCX__AVX2_FN static __m128i svcx__utf8_compact_avx2(__m128i v, unsigned mask) {
+    uint64_t bytes = _pdep_u64(mask, 0x0101010101010101ULL) * 0xFF;
+    uint64_t idx = _pext_u64(0x0706050403020100ULL, bytes);
+    __m128i k = _mm_cvtsi64_si128((long long)idx);
+    k = _mm_unpacklo_epi8(k, k);
+    k = _mm_add_epi8(_mm_add_epi8(k, k), _mm_set1_epi16(0x0100));
+    return _mm_shuffle_epi8(v, k);
+}
+
+// Decodes the sequences that start in the 8 bytes at p, which must be
+// followed by three more bytes, into 32-bit lanes. Unlike
+// svcx__utf8_decode16_avx2, this handles 4-byte sequences.
+SVCX__AVX2_FN static inline __m256i svcx__utf8_decode8_avx2(
+    const unsigned char *p) {
+    const __m256i low6 = _mm256_set1_epi32(0x3F);
+    __m256i b0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p));
+    __m256i b1 = _mm256_and_si256(low6,
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(p + 1))));
+    __m256i b2 = _mm256_and_si256(low6,
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(p + 2))));
+    __m256i b3 = _mm256_and_si256(low6,
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(p + 3))));
+    __m256i two = _mm256_or_si256(
+        _mm256_slli_epi32(_mm256_and_si256(b0, _mm256_set1_epi32(0x1F)), 6),
+        b1);
+    __m256i three = _mm256_or_si256(
+        _mm256_slli_epi32(_mm256_and_si256(b0, _mm256_set1_epi32(0x0F)), 12),
+        _mm256_or_si256(_mm256_slli_epi32(b1, 6), b2));
+    __m256i four = _mm256_or_si256(
+        _mm256_slli_epi32(_mm256_and_si256(b0, _mm256_set1_epi32(0x07)), 18),
+        _mm256_or_si256(_mm256_slli_epi32(b1, 12),
+            _mm256_or_si256(_mm256_slli_epi32(b2, 6), b3)));
+    __m256i cp = _mm256_blendv_epi8(
+        b0, two, _mm256_cmpgt_epi32(b0, _mm256_set1_epi32(0xBF)));
+    cp = _mm256_blendv_epi8(
+        cp, three, _mm256_cmpgt_epi32(b0, _mm256_set1_epi32(0xDF)));
+    return _mm256_blendv_epi8(
+        cp, four, _mm256_cmpgt_epi32(b0, _mm256_set1_epi32(0xEF)));
+}
+
+// Moves the 32-bit lanes of v whose bits are set in the low byte of mask to
+// the front, like svcx__utf8_compact_avx2 with nibbles for lane indices.
+SVCX__AVX2_FN static __m256i svcx__utf8_compact32_avx2(
+    __m256i v, unsigned mask) {
+    uint64_t nibbles = _pdep_u64(mask, 0x11111111ULL) * 0xF;
+    uint32_t idx = (uint32_t)_pext_u64(0x76543210ULL, nibbles);
+    __m256i k = _mm256_srlv_epi32(_mm256_set1_epi32((int)idx),
+        _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28));
+    return _mm256_permutevar8x32_epi32(v, k);
+}
+
+// Stores the code points in the lanes of cp whose bits are set in leads at
+// out as UTF-16, and returns how many units were stored. A code point above
+// U+FFFF becomes a surrogate pair in the two halves of its lane, and the
+// halves are compacted like the lanes of svcx__utf8_decode16_avx2.
+SVCX__AVX2_FN static size_t svcx__utf8_store16_avx2(
+    __m256i cp, unsigned leads, uint16_t *out) {
+    __m256i wide = _mm256_cmpgt_epi32(cp, _mm256_set1_epi32(0xFFFF));
+    __m256i c = _mm256_sub_epi32(cp, _mm256_set1_epi32(0x10000));
+    __m256i high = _mm256_or_si256(
+        _mm256_srli_epi32(c, 10), _mm256_set1_epi32(0xD800));
+    __m256i low = _mm256_or_si256(_mm256_and_si256(c, _mm256_set1_epi32(0x3FF)),
+        _mm256_set1_epi32(0xDC00));
+    __m256i units = _mm256_blendv_epi8(
+        cp, _mm256_or_si256(high, _mm256_slli_epi32(low, 16)), wide);
+    unsigned pairs =
+        (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(wide)) & leads;
+    unsigned mask = (unsigned)(_pdep_u64(leads, 0x5555) |
+                               _pdep_u64(pairs, 0xAAAA));
+    _mm_storeu_si128((__m128i *)out,
+        svcx__utf8_compact_avx2(_mm256_castsi256_si128(units), mask & 0xFF));
+    size_t n = (size_t)_mm_popcnt_u32(mask & 0xFF);
+    _mm_storeu_si128((__m128i *)(out + n),
+        svcx__utf8_compact_avx2(_mm256_extracti128_si256(units, 1), mask >> 8));
+    return n + (size_t)_mm_popcnt_u32(mask >> 8);
+}
+
+// The compacted halves are stored whole, so up to 8 units past the last one
+// written get garbage, which fits in the room the callers reserve. Blocks
+// with 4-byte sequences are decoded 8 bytes at a time in 32-bit lanes, as
+// long as three more bytes follow them.
+SVCX__AVX2_FN static size_t svcx__utf8_widen16_avx2(
+    const unsigned char *p, size_t len, uint16_t *out, size_t *written) {
+    size_t i = 0;
+    size_t o = 0;
+    while (i + 18 <= len) {
+        if (i + 32 <= len) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+            if (!_mm256_movemask_epi8(v)) {
+                __m256i *dst = (__m256i *)(out + o);
+                _mm256_storeu_si256(
+                    dst, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+                _mm256_storeu_si256(dst + 1,
+                    _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+                i += 32;
+                o += 32;
+                continue;
+            }
+        }
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        unsigned stop;
+        unsigned leads = svcx__utf8_leads_sse2(v, &stop);
+        if (stop < 16 && i + 19 <= len) {
+            leads = (unsigned)_mm_movemask_epi8(
+                _mm_cmpgt_epi8(v, _mm_set1_epi8(-65)));
+            o += svcx__utf8_store16_avx2(
+                svcx__utf8_decode8_avx2(p + i), leads & 0xFF, out + o);
+            o += svcx__utf8_store16_avx2(
+                svcx__utf8_decode8_avx2(p + i + 8), leads >> 8, out + o);
+            i += 16;
+            continue;
+        }
+        __m256i cp = svcx__utf8_decode16_avx2(p + i);
+        _mm_storeu_si128((__m128i *)(out + o),
+            svcx__utf8_compact_avx2(_mm256_castsi256_si128(cp), leads));
+        o += (size_t)_mm_popcnt_u32(leads & 0xFF);
+        _mm_storeu_si128((__m128i *)(out + o),
+            svcx__utf8_compact_avx2(
+                _mm256_extracti128_si256(cp, 1), leads >> 8));
+        o += (size_t)_mm_popcnt_u32(leads >> 8);
+        if (stop < 16) {
+            i += stop;
+            break;
+        }
+        i += 16;
+    }
+    while (i < len && (p[i] & 0xC0) == 0x80) {
+        i++;
+    }
+    *written = o;
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__utf8_widen32_avx2(
+    const unsigned char *p, size_t len, uint32_t *out, size_t *written) {
+    size_t i = 0;
+    size_t o = 0;
+    while (i + 18 <= len) {
+        if (i + 32 <= len) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+            if (!_mm256_movemask_epi8(v)) {
+                __m256i *dst = (__m256i *)(out + o);
+                for (int k = 0; k < 4; k++) {
+                    __m128i part = _mm_loadl_epi64(
+                        (const __m128i *)(p + i + 8 * (size_t)k));
+                    _mm256_storeu_si256(dst + k, _mm256_cvtepu8_epi32(part));
+                }
+                i += 32;
+                o += 32;
+                continue;
+            }
+        }
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        unsigned stop;
+        unsigned leads = svcx__utf8_leads_sse2(v, &stop);
+        if (stop < 16 && i + 19 <= len) {
+            leads = (unsigned)_mm_movemask_epi8(
+                _mm_cmpgt_epi8(v, _mm_set1_epi8(-65)));
+            for (unsigned k = 0; k < 2; k++) {
+                unsigned half = leads >> (8 * k) & 0xFF;
+                _mm256_storeu_si256((__m256i *)(out + o),
+                    svcx__utf8_compact32_avx2(
+                        svcx__utf8_decode8_avx2(p + i + 8 * k), half));
+                o += (size_t)_mm_popcnt_u32(half);
+            }
+            i += 16;
+            continue;
+        }
+        __m256i cp = svcx__utf8_decode16_avx2(p + i);
+        _mm256_storeu_si256((__m256i *)(out + o),
+            _mm256_cvtepu16_epi32(
+                svcx__utf8_compact_avx2(_mm256_castsi256_si128(cp), leads)));
+        o += (size_t)_mm_popcnt_u32(leads & 0xFF);
+        _mm256_storeu_si256((__m256i *)(out + o),
+            _mm256_cvtepu16_epi32(svcx__utf8_compact_avx2(
+                _mm256_extracti128_si256(cp, 1), leads >> 8)));
+        o += (size_t)_mm_popcnt_u32(leads >> 8);
+        if (stop < 16) {
+            i += stop;
+            break;
+        }
+        i += 16;
+    }
+    while (i < len && (p[i] & 0xC0) == 0x80) {
+        i++;
+    }
+    *written = o;
+    return i;
+}
+#endif // SVCX__AVX2
+
+SVCXDEF bool svcx_utf8_validate(svcx_string_view sv, size_t *valid_len) {
+    SVCX_ASSERT(sv.data || sv.len == 0);
+
+    const unsigned char *p = (const unsigned char *)sv.data;
+    size_t i = SVCX__SIMD_CALL(svcx__utf8_validate, p, sv.len);
+    i += svcx__utf8_check(p + i, sv.len - i);
+    if (valid_len) {
+        *valid_len = i;
+    }
+    return i == sv.len;
+}
+
+SVCXDEF size_t svcx_utf8_count(svcx_string_view sv) {
+    SVCX_ASSERT(sv.data || sv.len == 0);
+
+    const unsigned char *p = (const unsigned char *)sv.data;
+    size_t count = 0;
+    size_t i = SVCX__SIMD_CALL(svcx__utf8_count, p, sv.len, &count);
+    for (; i < sv.len; i++) {
+        count += (p[i] & 0xC0) != 0x80;
+    }
+    return count;
+}
+
+SVCXDEF size_t svcx_utf8_index(svcx_string_view sv, size_t offset) {
+    SVCX_ASSERT(offset <= sv.len);
+    return svcx_utf8_count(svcx_sv_from_parts(sv.data, offset));
+}
+
+SVCXDEF size_t svcx_utf8_offset(svcx_string_view sv, size_t index) {
+    SVCX_ASSERT(sv.data || sv.len == 0);
+
+    // Whole chunks are counted with SIMD until the code point is in the
+    // next one, which is then walked byte by byte.
+    enum { CHUNK = 256 };
+    const unsigned char *p = (const unsigned char *)sv.data;
+    size_t i = 0;
+    size_t seen = 0;
+    while (sv.len - i > CHUNK) {
+        size_t count = svcx_utf8_count(svcx_sv_from_parts(sv.data + i, CHUNK));
+        if (seen + count > index) {
+            break;
+        }
+        seen += count;
+        i += CHUNK;
+    }
+    for (; i < sv.len; i++) {
+        if ((p[i] & 0xC0) != 0x80 && seen++ == index) {
+            return i;
+        }
+    }
+    return sv.len;
+}
+
+SVCXDEF svcx_result svcx_utf8_to_utf16(svcx_string_view sv, svcx_vector *out) {
+    SVCX_ASSERT(out && out->stride == sizeof(uint16_t));
+
+    if (!svcx_utf8_validate(sv, NULL)) {
+        return SVCX_UTF8_INVALID_ERR;
+    }
+    if (sv.len == 0) {
+        return SVCX_OK;
+    }
+    // A code point never takes more UTF-16 units than UTF-8 bytes, and SIMD
+    // can write up to 8 units of garbage past the last one.
+    if (svcx_vector_reserve(out, out->size + sv.len + 8) != SVCX_OK) {
+        return SVCX_UTF8_ALLOC_ERR;
+    }
+
+    const unsigned char *p = (const unsigned char *)sv.data;
+    uint16_t *dst = (uint16_t *)out->data + out->size;
+    size_t i = 0;
+    size_t o = 0;
+    while (i < sv.len) {
+        // SIMD stops near the end, and without AVX2 at 4-byte sequences,
+        // where one code point is decoded before trying again.
+        size_t n = 0;
+        i += SVCX__SIMD_CALL(
+            svcx__utf8_widen16, p + i, sv.len - i, dst + o, &n);
+        o += n;
+        if (i == sv.len) {
+            break;
+        }
+        uint32_t cp = svcx__utf8_decode(p, &i);
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            dst[o++] = (uint16_t)(0xD800 | cp >> 10);
+            dst[o++] = (uint16_t)(0xDC00 | (cp & 0x3FF));
+        } else {
+            dst[o++] = (uint16_t)cp;
+        }
+    }
+    out->size += o;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_utf8_to_utf32(svcx_string_view sv, svcx_vector *out) {
+    SVCX_ASSERT(out && out->stride == sizeof(uint32_t));
+
+    if (!svcx_utf8_validate(sv, NULL)) {
+        return SVCX_UTF8_INVALID_ERR;
+    }
+    if (sv.len == 0) {
+        return SVCX_OK;
+    }
+    // SIMD can write up to 8 units of garbage past the last one.
+    if (svcx_vector_reserve(out, out->size + svcx_utf8_count(sv) + 8) !=
+        SVCX_OK) {
+        return SVCX_UTF8_ALLOC_ERR;
+    }
+
+    const unsigned char *p = (const unsigned char *)sv.data;
+    uint32_t *dst = (uint32_t *)out->data + out->size;
+    size_t i = 0;
+    size_t o = 0;
+    while (i < sv.len) {
+        size_t n = 0;
+        i += SVCX__SIMD_CALL(
+            svcx__utf8_widen32, p + i, sv.len - i, dst + o, &n);
+        o += n;
+        if (i == sv.len) {
+            break;
+        }
+        dst[o++] = svcx__utf8_decode(p, &i);
+    }
+    out->size += o;
+    return SVCX_OK;
+}
+
+//
+// Map. The control bytes hold SVCX__CTRL_EMPTY, SVCX__CTRL_DELETED or the low
+// 7 bits of the hash of a full slot (so full slots are the non-negative
+// bytes). The first 16 control bytes are mirrored after the last one, so a
+// group of 16 can be loaded starting at any slot.
+//
+#define SVCX__CTRL_EMPTY ((uint8_t)0x80)
+#define SVCX__CTRL_DELETED ((uint8_t)0xFE)
+#define SVCX__GROUP 16
+
+static uint32_t svcx__group_match(const uint8_t *g, uint8_t h2) {
+#ifdef SVCX__SSE2
+    __m128i v = _mm_loadu_si128((const __m128i *)g);
+    return (uint32_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(v, _mm_set1_epi8((char)h2)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < SVCX__GROUP; i++) {
+        mask |= (uint32_t)(g[i] == h2) << i;
+    }
+    return mask;
+#endif
+}
+
+static uint32_t svcx__group_empty(const uint8_t *g) {
+    return svcx__group_match(g, SVCX__CTRL_EMPTY);
+}
+
+// Returns the slots that are empty or deleted.
+static uint32_t svcx__group_free(const uint8_t *g) {
+#ifdef SVCX__SSE2
+    __m128i v = _mm_loadu_si128((const __m128i *)g);
+    return (uint32_t)_mm_movemask_epi8(v);
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < SVCX__GROUP; i++) {
+        mask |= (uint32_t)(g[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
+
+static size_t svcx__align_of_size(size_t size) {
+    size_t align = size & (~size + 1);
+    return align == 0 || align > 16 ? 16 : align;
+}
+
+static uint64_t svcx__map_hash_bytes(
+    const void *key, size_t key_size, uint64_t seed) {
+    return svcx_hash_bytes(key, key_size, seed);
+}
+
+static bool svcx__map_eq_bytes(const void *a, const void *b, size_t key_size) {
+    return memcmp(a, b, key_size) == 0;
+}
+
+static uint64_t svcx__map_hash_sv(
+    const void *key, size_t key_size, uint64_t seed) {
+    SVCX_UNUSED(key_size);
+    return svcx_hash_sv(*(const svcx_string_view *)key, seed);
+}
+
+static bool svcx__map_eq_sv(const void *a, const void *b, size_t key_size) {
+    SVCX_UNUSED(key_size);
+    const svcx_string_view *x = (const svcx_string_view *)a;
+    const svcx_string_view *y = (const svcx_string_view *)b;
+    return x->len == y->len && memcmp(x->data, y->data, x->len) == 0;
+}
+
+SVCXDEF void svcx_map_init_custom(svcx_map *m,
+    size_t key_size,
+    size_t value_size,
+    svcx_map_hash_fn hash,
+    svcx_map_eq_fn eq,
+    svcx_allocator a) {
+    SVCX_ASSERT(m);
+    SVCX_ASSERT(key_size > 0);
+    SVCX_ASSERT(hash && eq);
+
+    size_t value_align = svcx__align_of_size(value_size);
+    size_t slot_align = svcx__align_of_size(key_size);
+    slot_align = value_align > slot_align ? value_align : slot_align;
+
+    m->ctrl = NULL;
+    m->slots = NULL;
+    m->cap = 0;
+    m->size = 0;
+    m->growth_left = 0;
+    m->key_size = key_size;
+    m->value_size = value_size;
+    m->value_offset = (key_size + value_align - 1) & ~(value_align - 1);
+    m->slot_size =
+        (m->value_offset + value_size + slot_align - 1) & ~(slot_align - 1);
+    m->hash = hash;
+    m->eq = eq;
+    m->seed = 0;
+    m->a = a;
+}
+
+SVCXDEF void svcx_map_init(svcx_map *m,
+    size_t key_size,
+    size_t value_size,
+    svcx_allocator a) {
+    svcx_map_init_custom(m,
+        key_size,
+        value_size,
+        svcx__map_hash_bytes,
+        svcx__map_eq_bytes,
+        a);
+}
+
+SVCXDEF void svcx_map_init_sv(
+    svcx_map *m, size_t value_size, svcx_allocator a) {
+    svcx_map_init_custom(m,
+        sizeof(svcx_string_view),
+        value_size,
+        svcx__map_hash_sv,
+        svcx__map_eq_sv,
+        a);
+}
+
+SVCXDEF void svcx_map_free(svcx_map *m) {
+    SVCX_ASSERT(m);
+
+    if (m->ctrl) {
+        svcx_free(&m->a, m->ctrl);
+    }
+    m->ctrl = NULL;
+    m->slots = NULL;
+    m->cap = 0;
+    m->size = 0;
+    m->growth_left = 0;
+}
+
+static void svcx__map_reset_ctrl(svcx_map *m) {
+    memset(m->ctrl, SVCX__CTRL_EMPTY, m->cap + SVCX__GROUP);
+    m->size = 0;
+    m->growth_left = m->cap - m->cap / 8;
+}
+
+SVCXDEF void svcx_map_clear(svcx_map *m) {
+    SVCX_ASSERT(m);
+
+    if (m->ctrl) {
+        svcx__map_reset_ctrl(m);
+    }
+}
+
+static char *svcx__map_slot(const svcx_map *m, size_t i) {
+    return m->slots + i * m->slot_size;
+}
+
+static void svcx__map_set_ctrl(svcx_map *m, size_t i, uint8_t c) {
+    m->ctrl[i] = c;
+    if (i < SVCX__GROUP) {
+        m->ctrl[m->cap + i] = c;
+    }
+}
+
+// Returns the first empty or deleted slot on the probe sequence of the hash.
+// The table always has at least one empty slot, so this terminates.
+static size_t svcx__map_find_free(const svcx_map *m, uint64_t hash) {
+    size_t mask = m->cap - 1;
+    size_t pos = (size_t)(hash >> 7) & mask;
+    for (size_t step = SVCX__GROUP;; step += SVCX__GROUP) {
+        uint32_t free_mask = svcx__group_free(m->ctrl + pos);
+        if (free_mask) {
+            return (pos + (size_t)svcx__ctz64(free_mask)) & mask;
+        }
+        pos = (pos + step) & mask;
+    }
+}
+
+// Returns the slot holding the key, or -1.
+static size_t svcx__map_find(
+    const svcx_map *m, const void *key, uint64_t hash) {
+    if (m->cap == 0) {
+        return (size_t)-1;
+    }
+
+    size_t mask = m->cap - 1;
+    size_t pos = (size_t)(hash >> 7) & mask;
+    uint8_t h2 = (uint8_t)(hash & 0x7F);
+    for (size_t step = SVCX__GROUP;; step += SVCX__GROUP) {
+        const uint8_t *g = m->ctrl + pos;
+        uint32_t match = svcx__group_match(g, h2);
+        while (match) {
+            size_t i = (pos + (size_t)svcx__ctz64(match)) & mask;
+            if (m->eq(key, svcx__map_slot(m, i), m->key_size)) {
+                return i;
+            }
+            match &= match - 1;
+        }
+        if (svcx__group_empty(g)) {
+            return (size_t)-1;
+        }
+        pos = (pos + step) & mask;
+    }
+}
+
+// Moves all entries into a new table with the given capacity (a power of two
+// of at least 16).
+static svcx_result svcx__map_resize(svcx_map *m, size_t cap) {
+    size_t ctrl_bytes = (cap + SVCX__GROUP + 15) & ~(size_t)15;
+    uint8_t *mem =
+        (uint8_t *)svcx_alloc(&m->a, ctrl_bytes + cap * m->slot_size);
+    if (!mem) {
+        return SVCX_MAP_ALLOC_ERR;
+    }
+
+    svcx_map old = *m;
+    m->ctrl = mem;
+    m->slots = (char *)mem + ctrl_bytes;
+    m->cap = cap;
+    svcx__map_reset_ctrl(m);
+
+    for (size_t i = 0; i < old.cap; i++) {
+        if (old.ctrl[i] & 0x80) {
+            continue;
+        }
+        const char *slot = svcx__map_slot(&old, i);
+        uint64_t hash = m->hash(slot, m->key_size, m->seed);
+        size_t j = svcx__map_find_free(m, hash);
+        svcx__map_set_ctrl(m, j, (uint8_t)(hash & 0x7F));
+        memcpy(svcx__map_slot(m, j), slot, m->slot_size);
+    }
+    m->size = old.size;
+    m->growth_left -= old.size;
+
+    if (old.ctrl) {
+        svcx_free(&m->a, old.ctrl);
+    }
+    return SVCX_OK;
+}
+
+// Returns the capacity needed to hold count entries below the load factor.
+static size_t svcx__map_cap_for(size_t count) {
+    size_t cap = SVCX__GROUP;
+    while (cap - cap / 8 < count) {
+        cap *= 2;
+    }
+    return cap;
+}
+
+SVCXDEF svcx_result svcx_map_reserve(svcx_map *m, size_t count) {
+    SVCX_ASSERT(m);
+
+    if (count <= m->size + m->growth_left && m->cap != 0) {
+        return SVCX_OK;
+    }
+    return svcx__map_resize(m, svcx__map_cap_for(count));
+}
+
+SVCXDEF svcx_result svcx_map_rehash(svcx_map *m, size_t count) {
+    SVCX_ASSERT(m);
+
+    if (count < m->size) {
+        count = m->size;
+    }
+    if (count == 0 && m->cap == 0) {
+        return SVCX_OK;
+    }
+    return svcx__map_resize(m, svcx__map_cap_for(count));
+}
+
+SVCXDEF void *svcx_map_get(const svcx_map *m, const void *key) {
+    SVCX_ASSERT(m && key);
+
+    size_t i = svcx__map_find(m, key, m->hash(key, m->key_size, m->seed));
+    if (i == (size_t)-1) {
+        return NULL;
+    }
+    return svcx__map_slot(m, i) + m->value_offset;
+}
+
+SVCXDEF bool svcx_map_contains(const svcx_map *m, const void *key) {
+    return svcx_map_get(m, key) != NULL;
+}
+
+SVCXDEF svcx_result svcx_map_get_or_insert(
+    svcx_map *m, const void *key, void **value, bool *inserted) {
+    SVCX_ASSERT(m && key && value);
+
+    uint64_t hash = m->hash(key, m->key_size, m->seed);
+    size_t i = svcx__map_find(m, key, hash);
+    if (i != (size_t)-1) {
+        *value = svcx__map_slot(m, i) + m->value_offset;
+        if (inserted) {
+            *inserted = false;
+        }
+        return SVCX_OK;
+    }
+
+    if (m->cap == 0) {
+        svcx_result r = svcx__map_resize(m, SVCX__GROUP);
+        if (r != SVCX_OK) {
+            return r;
+        }
+    }
+
+    i = svcx__map_find_free(m, hash);
+    if (m->growth_left == 0 && m->ctrl[i] != SVCX__CTRL_DELETED) {
+        // Out of room. If at least half of the used slots are tombstones,
+        // rebuilding at the same size is enough to make room.
+        size_t used = m->cap - m->cap / 8;
+        size_t cap = m->size * 2 <= used ? m->cap : m->cap * 2;
+        svcx_result r = svcx__map_resize(m, cap);
+        if (r != SVCX_OK) {
+            return r;
+        }
+        i = svcx__map_find_free(m, hash);
+    }
+
+    if (m->ctrl[i] == SVCX__CTRL_EMPTY) {
+        m->growth_left--;
+    }
+    svcx__map_set_ctrl(m, i, (uint8_t)(hash & 0x7F));
+    m->size++;
+
+    char *slot = svcx__map_slot(m, i);
+    memcpy(slot, key, m->key_size);
+    memset(slot + m->value_offset, 0, m->value_size);
+    *value = slot + m->value_offset;
+    if (inserted) {
+        *inserted = true;
+    }
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_map_insert(
+    svcx_map *m, const void *key, const void *value) {
+    SVCX_ASSERT(value || m->value_size == 0);
+
+    void *dst;
+    svcx_result r = svcx_map_get_or_insert(m, key, &dst, NULL);
+    if (r != SVCX_OK) {
+        return r;
+    }
+    if (m->value_size > 0) {
+        memcpy(dst, value, m->value_size);
+    }
+    return SVCX_OK;
+}
+
+SVCXDEF bool svcx_map_remove(svcx_map *m, const void *key) {
+    SVCX_ASSERT(m && key);
+
+    size_t i = svcx__map_find(m, key, m->hash(key, m->key_size, m->seed));
+    if (i == (size_t)-1) {
+        return false;
+    }
+
+    // A lookup can only have probed past this slot if it was inside a run of
+    // 16 or more consecutive non-empty slots. If there is none, the slot can
+    // become empty instead of a tombstone.
+    size_t mask = m->cap - 1;
+    uint32_t empty_after = svcx__group_empty(m->ctrl + i);
+    uint32_t empty_before =
+        svcx__group_empty(m->ctrl + ((i - SVCX__GROUP) & mask));
+    size_t full_after = empty_after ? (size_t)svcx__ctz64(empty_after) : 16;
+    size_t full_before =
+        empty_before ? (size_t)svcx__clz64(empty_before) - 48 : 16;
+
+    if (full_before + full_after < SVCX__GROUP) {
+        svcx__map_set_ctrl(m, i, SVCX__CTRL_EMPTY);
+        m->growth_left++;
+    } else {
+        svcx__map_set_ctrl(m, i, SVCX__CTRL_DELETED);
+    }
+    m->size--;
+    return true;
+}
+
+SVCXDEF size_t svcx_map_size(const svcx_map *m) {
+    SVCX_ASSERT(m);
+    return m->size;
+}
+
+SVCXDEF void svcx_map_iter_init(svcx_map_iter *it, const svcx_map *m) {
+    SVCX_ASSERT(it && m);
+
+    it->m = m;
+    it->index = 0;
+}
+
+SVCXDEF bool svcx_map_iter_next(
+    svcx_map_iter *it, const void **key, void **value) {
+    SVCX_ASSERT(it);
+
+    const svcx_map *m = it->m;
+    while (it->index < m->cap) {
+        size_t base = it->index & ~(size_t)(SVCX__GROUP - 1);
+        uint32_t full = ~svcx__group_free(m->ctrl + base) & 0xFFFF;
+        full &= ~(uint32_t)0 << (it->index - base);
+        if (!full) {
+            it->index = base + SVCX__GROUP;
+            continue;
+        }
+
+        size_t i = base + (size_t)svcx__ctz64(full);
+        it->index = i + 1;
+        char *slot = svcx__map_slot(m, i);
+        if (key) {
+            *key = slot;
+        }
+        if (value) {
+            *value = slot + m->value_offset;
+        }
+        return true;
+    }
+    return false;
+}
+
+//
+// Internal block allocator. Memory is bump allocated from a list of blocks
+// that are only freed all at once, so pointers into it stay valid until then.
+// Large requests get a block of their own so the current block is not wasted.
+// The first block in the list is the one being bump allocated from.
+//
+#define SVCX__BLOCK_SIZE (64 * 1024)
+
+typedef struct svcx__block {
+    struct svcx__block *next;
+    size_t size;
+} svcx__block;
+
+static void *svcx__block_alloc(svcx_allocator *a,
+    svcx__block **blocks,
+    char **bump,
+    size_t *bump_left,
+    size_t size,
+    size_t align) {
+    size_t skip = (size_t)(-(uintptr_t)*bump & (align - 1));
+    if (size + skip > *bump_left || !*blocks) {
+        bool own = size > SVCX__BLOCK_SIZE / 4;
+        size_t block_size = own ? size : SVCX__BLOCK_SIZE;
+        svcx__block *b =
+            (svcx__block *)svcx_alloc(a, sizeof(svcx__block) + block_size);
+        if (!b) {
+            return NULL;
+        }
+        b->size = block_size;
+        if (own && *blocks) {
+            b->next = (*blocks)->next;
+            (*blocks)->next = b;
+            return b + 1;
+        }
+        b->next = *blocks;
+        *blocks = b;
+        *bump = (char *)(b + 1);
+        *bump_left = block_size;
+        skip = 0;
+    }
+
+    void *ptr = *bump + skip;
+    *bump += size + skip;
+    *bump_left -= size + skip;
+    return ptr;
+}
+
+static void svcx__block_free_all(svcx_allocator *a, svcx__block *blocks) {
+    while (blocks) {
+        svcx__block *next = blocks->next;
+        svcx_free(a, blocks);
+        blocks = next;
+    }
+}
+
+//
+// Concurrent map. Each shard holds an open addressing table of pointers to
+// entries with linear probing. Entries and tables are allocated from the
+// blocks of the shard and stay valid until the map is freed.
+//
+#ifdef SVCX__HAS_ATOMICS
+#define SVCX__CMAP_CACHE_LINE 64
+#define SVCX__CMAP_DEFAULT_SHARDS 64
+
+typedef struct svcx__cmap_table {
+    size_t cap;
+    size_t pad;
+    void *_Atomic entries[];
+} svcx__cmap_table;
+
+// The value follows the entry header, and the key characters follow the
+// value.
+typedef struct svcx__cmap_entry {
+    uint64_t hash;
+    size_t len;
+} svcx__cmap_entry;
+
+static char svcx__cmap_tombstone;
+#define SVCX__CMAP_DELETED ((void *)&svcx__cmap_tombstone)
+
+static void svcx__cpu_relax(void) {
+#ifdef SVCX__SSE2
+    _mm_pause();
+#endif
+}
+
+static svcx_cmap_shard *svcx__cmap_shard(const svcx_cmap *cm, uint64_t hash) {
+    size_t i = (size_t)(hash >> 32) & (cm->nshards - 1);
+    return (svcx_cmap_shard *)(cm->shards + i * cm->shard_stride);
+}
+
+static char *svcx__cmap_value(svcx__cmap_entry *e) {
+    return (char *)(e + 1);
+}
+
+static const char *svcx__cmap_key(const svcx_cmap *cm, svcx__cmap_entry *e) {
+    return (const char *)(e + 1) + cm->value_size;
+}
+
+static void svcx__cmap_lock(svcx_cmap_shard *sh) {
+    unsigned seq = atomic_load_explicit(&sh->seq, memory_order_relaxed);
+    for (;;) {
+        if (seq & 1) {
+            svcx__cpu_relax();
+            seq = atomic_load_explicit(&sh->seq, memory_order_relaxed);
+        } else if (atomic_compare_exchange_weak_explicit(&sh->seq,
+                       &seq,
+                       seq + 1,
+                       memory_order_acquire,
+                       memory_order_relaxed)) {
+            break;
+        }
+    }
+    // Readers that see any of the following writes must also see the odd
+    // counter.
+    atomic_thread_fence(memory_order_release);
+}
+
+static void svcx__cmap_unlock(svcx_cmap_shard *sh) {
+    unsigned seq = atomic_load_explicit(&sh->seq, memory_order_relaxed);
+    atomic_store_explicit(&sh->seq, seq + 1, memory_order_release);
+}
+
+static void *svcx__cmap_shard_alloc(
+    svcx_cmap *cm, svcx_cmap_shard *sh, size_t size) {
+    return svcx__block_alloc(
+        &cm->a, &sh->blocks, &sh->bump, &sh->bump_left, size, 16);
+}
+
+SVCXDEF svcx_result svcx_cmap_init(svcx_cmap *cm,
+    size_t nshards,
+    size_t value_size,
+    svcx_allocator a) {
+    SVCX_ASSERT(cm);
+
+    size_t n = 1;
+    while (n < (nshards ? nshards : SVCX__CMAP_DEFAULT_SHARDS)) {
+        n *= 2;
+    }
+    size_t stride = (sizeof(svcx_cmap_shard) + SVCX__CMAP_CACHE_LINE - 1) &
+                    ~(size_t)(SVCX__CMAP_CACHE_LINE - 1);
+
+    cm->shards = NULL;
+    cm->nshards = 0;
+    cm->shard_stride = stride;
+    cm->value_size = value_size;
+    cm->seed = 0;
+    cm->a = a;
+    cm->mem = svcx_alloc(&cm->a, n * stride + SVCX__CMAP_CACHE_LINE - 1);
+    if (!cm->mem) {
+        return SVCX_CMAP_ALLOC_ERR;
+    }
+
+    uintptr_t base = ((uintptr_t)cm->mem + SVCX__CMAP_CACHE_LINE - 1) &
+                     ~(uintptr_t)(SVCX__CMAP_CACHE_LINE - 1);
+    cm->shards = (char *)base;
+    cm->nshards = n;
+    for (size_t i = 0; i < n; i++) {
+        svcx_cmap_shard *sh = (svcx_cmap_shard *)(cm->shards + i * stride);
+        atomic_init(&sh->seq, 0);
+        atomic_init(&sh->table, NULL);
+        atomic_init(&sh->size, 0);
+        sh->used = 0;
+        sh->blocks = NULL;
+        sh->bump = NULL;
+        sh->bump_left = 0;
+    }
+    return SVCX_OK;
+}
+
+SVCXDEF void svcx_cmap_free(svcx_cmap *cm) {
+    SVCX_ASSERT(cm);
+
+    for (size_t i = 0; i < cm->nshards; i++) {
+        svcx_cmap_shard *sh =
+            (svcx_cmap_shard *)(cm->shards + i * cm->shard_stride);
+        svcx__block_free_all(&cm->a, sh->blocks);
+    }
+    if (cm->mem) {
+        svcx_free(&cm->a, cm->mem);
+    }
+    cm->mem = NULL;
+    cm->shards = NULL;
+    cm->nshards = 0;
+}
+
+// Returns the entry of the key in the table, or NULL. The slot index of the
+// entry is stored into index. The probe is bounded by the capacity, so it
+// terminates even on a table that a writer is modifying.
+static svcx__cmap_entry *svcx__cmap_find(const svcx_cmap *cm,
+    svcx__cmap_table *t,
+    svcx_string_view key,
+    uint64_t hash,
+    size_t *index) {
+    if (!t) {
+        return NULL;
+    }
+
+    size_t mask = t->cap - 1;
+    size_t i = (size_t)hash & mask;
+    for (size_t n = 0; n < t->cap; n++, i = (i + 1) & mask) {
+        void *p = atomic_load_explicit(&t->entries[i], memory_order_acquire);
+        if (!p) {
+            return NULL;
+        }
+        svcx__cmap_entry *e = (svcx__cmap_entry *)p;
+        if (p != SVCX__CMAP_DELETED && e->hash == hash && e->len == key.len &&
+            memcmp(svcx__cmap_key(cm, e), key.data, key.len) == 0) {
+            if (index) {
+                *index = i;
+            }
+            return e;
+        }
+    }
+    return NULL;
+}
+
+SVCXDEF bool svcx_cmap_get(
+    const svcx_cmap *cm, svcx_string_view key, void *value) {
+    SVCX_ASSERT(cm);
+
+    uint64_t hash = svcx_hash_sv(key, cm->seed);
+    svcx_cmap_shard *sh = svcx__cmap_shard(cm, hash);
+    for (;;) {
+        unsigned seq = atomic_load_explicit(&sh->seq, memory_order_acquire);
+        if (seq & 1) {
+            svcx__cpu_relax();
+            continue;
+        }
+
+        svcx__cmap_table *t =
+            atomic_load_explicit(&sh->table, memory_order_acquire);
+        svcx__cmap_entry *e = svcx__cmap_find(cm, t, key, hash, NULL);
+        if (e && value) {
+            memcpy(value, svcx__cmap_value(e), cm->value_size);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&sh->seq, memory_order_relaxed) == seq) {
+            return e != NULL;
+        }
+    }
+}
+
+SVCXDEF bool svcx_cmap_contains(const svcx_cmap *cm, svcx_string_view key) {
+    return svcx_cmap_get(cm, key, NULL);
+}
+
+// Moves the live entries into a new table with room for the current ones and
+// at least one more, keeping the table at most 3/4 full. The old table stays
+// allocated for readers that may still be probing it.
+static svcx_result svcx__cmap_grow(svcx_cmap *cm, svcx_cmap_shard *sh) {
+    svcx__cmap_table *old =
+        atomic_load_explicit(&sh->table, memory_order_relaxed);
+    size_t size = atomic_load_explicit(&sh->size, memory_order_relaxed);
+    size_t cap = 16;
+    while ((size + 1) * 2 > cap) {
+        cap *= 2;
+    }
+
+    svcx__cmap_table *t = (svcx__cmap_table *)svcx__cmap_shard_alloc(
+        cm, sh, sizeof(svcx__cmap_table) + cap * sizeof(void *));
+    if (!t) {
+        return SVCX_CMAP_ALLOC_ERR;
+    }
+    t->cap = cap;
+    for (size_t i = 0; i < cap; i++) {
+        atomic_init(&t->entries[i], NULL);
+    }
+
+    for (size_t i = 0; old && i < old->cap; i++) {
+        void *p = atomic_load_explicit(&old->entries[i], memory_order_relaxed);
+        if (!p || p == SVCX__CMAP_DELETED) {
+            continue;
+        }
+        size_t j = (size_t)((svcx__cmap_entry *)p)->hash & (cap - 1);
+        while (atomic_load_explicit(&t->entries[j], memory_order_relaxed)) {
+            j = (j + 1) & (cap - 1);
+        }
+        atomic_init(&t->entries[j], p);
+    }
+
+    sh->used = size;
+    atomic_store_explicit(&sh->table, t, memory_order_release);
+    return SVCX_OK;
+}
+
+// Returns the entry of the key, inserting it with a zeroed value if needed.
+// Must be called with the lock of the shard held.
+static svcx_result svcx__cmap_get_or_insert(svcx_cmap *cm,
+    svcx_cmap_shard *sh,
+    svcx_string_view key,
+    uint64_t hash,
+    svcx__cmap_entry **entry,
+    bool *inserted) {
+    svcx__cmap_table *t =
+        atomic_load_explicit(&sh->table, memory_order_relaxed);
+    *entry = svcx__cmap_find(cm, t, key, hash, NULL);
+    *inserted = *entry == NULL;
+    if (*entry) {
+        return SVCX_OK;
+    }
+
+    if (!t || (sh->used + 1) * 4 > t->cap * 3) {
+        svcx_result r = svcx__cmap_grow(cm, sh);
+        if (r != SVCX_OK) {
+            return r;
+        }
+        t = atomic_load_explicit(&sh->table, memory_order_relaxed);
+    }
+
+    svcx__cmap_entry *e = (svcx__cmap_entry *)svcx__cmap_shard_alloc(
+        cm, sh, sizeof(svcx__cmap_entry) + cm->value_size + key.len);
+    if (!e) {
+        return SVCX_CMAP_ALLOC_ERR;
+    }
+    e->hash = hash;
+    e->len = key.len;
+    memset(svcx__cmap_value(e), 0, cm->value_size);
+    if (key.len > 0) {
+        memcpy((char *)svcx__cmap_key(cm, e), key.data, key.len);
+    }
+
+    size_t i = (size_t)hash & (t->cap - 1);
+    for (;;) {
+        void *p = atomic_load_explicit(&t->entries[i], memory_order_relaxed);
+        if (!p || p == SVCX__CMAP_DELETED) {
+            sh->used += !p;
+            break;
+        }
+        i = (i + 1) & (t->cap - 1);
+    }
+    // The release store publishes the contents of the entry to readers.
+    atomic_store_explicit(&t->entries[i], (void *)e, memory_order_release);
+    atomic_fetch_add_explicit(&sh->size, 1, memory_order_relaxed);
+    *entry = e;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_cmap_upsert(svcx_cmap *cm,
+    svcx_string_view key,
+    svcx_cmap_update_fn update,
+    void *ctx) {
+    SVCX_ASSERT(cm && update);
+
+    uint64_t hash = svcx_hash_sv(key, cm->seed);
+    svcx_cmap_shard *sh = svcx__cmap_shard(cm, hash);
+    svcx__cmap_lock(sh);
+
+    svcx__cmap_entry *e;
+    bool inserted;
+    svcx_result r = svcx__cmap_get_or_insert(cm, sh, key, hash, &e, &inserted);
+    if (r == SVCX_OK) {
+        svcx_string_view stored =
+            svcx_sv_from_parts(svcx__cmap_key(cm, e), e->len);
+        update(stored, svcx__cmap_value(e), inserted, ctx);
+    }
+
+    svcx__cmap_unlock(sh);
+    return r;
+}
+
+SVCXDEF svcx_result svcx_cmap_insert(
+    svcx_cmap *cm, svcx_string_view key, const void *value) {
+    SVCX_ASSERT(cm);
+    SVCX_ASSERT(value || cm->value_size == 0);
+
+    uint64_t hash = svcx_hash_sv(key, cm->seed);
+    svcx_cmap_shard *sh = svcx__cmap_shard(cm, hash);
+    svcx__cmap_lock(sh);
+
+    svcx__cmap_entry *e;
+    bool inserted;
+    svcx_result r = svcx__cmap_get_or_insert(cm, sh, key, hash, &e, &inserted);
+    if (r == SVCX_OK && cm->value_size > 0) {
+        memcpy(svcx__cmap_value(e), value, cm->value_size);
+    }
+
+    svcx__cmap_unlock(sh);
+    return r;
+}
+
+SVCXDEF bool svcx_cmap_remove(svcx_cmap *cm, svcx_string_view key) {
+    SVCX_ASSERT(cm);
+
+    uint64_t hash = svcx_hash_sv(key, cm->seed);
+    svcx_cmap_shard *sh = svcx__cmap_shard(cm, hash);
+    svcx__cmap_lock(sh);
+
+    size_t i;
+    svcx__cmap_table *t =
+        atomic_load_explicit(&sh->table, memory_order_relaxed);
+    svcx__cmap_entry *e = svcx__cmap_find(cm, t, key, hash, &i);
+    if (e) {
+        atomic_store_explicit(
+            &t->entries[i], SVCX__CMAP_DELETED, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&sh->size, 1, memory_order_relaxed);
+    }
+
+    svcx__cmap_unlock(sh);
+    return e != NULL;
+}
+
+SVCXDEF size_t svcx_cmap_size(const svcx_cmap *cm) {
+    SVCX_ASSERT(cm);
+
+    size_t size = 0;
+    for (size_t i = 0; i < cm->nshards; i++) {
+        svcx_cmap_shard *sh =
+            (svcx_cmap_shard *)(cm->shards + i * cm->shard_stride);
+        size += atomic_load_explicit(&sh->size, memory_order_relaxed);
+    }
+    return size;
+}
+#endif // SVCX__HAS_ATOMICS
+
+//
+// Interner. The map stores the interned views as keys and ids as values.
+//
+SVCXDEF void svcx_interner_init(svcx_interner *in, svcx_allocator a) {
+    SVCX_ASSERT(in);
+
+    svcx_map_init_sv(&in->ids, sizeof(uint32_t), a);
+    svcx_vector_init(&in->views, sizeof(svcx_string_view), a);
+    in->blocks = NULL;
+    in->bump = NULL;
+    in->bump_left = 0;
+    in->a = a;
+}
+
+SVCXDEF void svcx_interner_free(svcx_interner *in) {
+    SVCX_ASSERT(in);
+
+    svcx_map_free(&in->ids);
+    svcx_vector_free(&in->views);
+    svcx__block_free_all(&in->a, in->blocks);
+    in->blocks = NULL;
+    in->bump = NULL;
+    in->bump_left = 0;
+}
+
+SVCXDEF svcx_result svcx_interner_intern(
+    svcx_interner *in, svcx_string_view sv, uint32_t *id) {
+    SVCX_ASSERT(in && id);
+    SVCX_ASSERT(svcx_vector_size(&in->views) < UINT32_MAX);
+
+    uint32_t *found = svcx_map_get(&in->ids, &sv);
+    if (found) {
+        *id = *found;
+        return SVCX_OK;
+    }
+
+    char *copy = svcx__block_alloc(
+        &in->a, &in->blocks, &in->bump, &in->bump_left, sv.len, 1);
+    if (!copy) {
+        return SVCX_INTERNER_ALLOC_ERR;
+    }
+    if (sv.len > 0) {
+        memcpy(copy, sv.data, sv.len);
+    }
+
+    // The map key points at our copy, so the caller's string can go away.
+    svcx_string_view stored = svcx_sv_from_parts(copy, sv.len);
+    uint32_t next = (uint32_t)svcx_vector_size(&in->views);
+    if (svcx_vector_push(&in->views, &stored) != SVCX_OK) {
+        return SVCX_INTERNER_ALLOC_ERR;
+    }
+    if (svcx_map_insert(&in->ids, &stored, &next) != SVCX_OK) {
+        svcx_vector_pop(&in->views, NULL);
+        return SVCX_INTERNER_ALLOC_ERR;
+    }
+    *id = next;
+    return SVCX_OK;
+}
+
+SVCXDEF bool svcx_interner_find(
+    const svcx_interner *in, svcx_string_view sv, uint32_t *id) {
+    SVCX_ASSERT(in);
+
+    uint32_t *value = svcx_map_get(&in->ids, &sv);
+    if (value && id) {
+        *id = *value;
+    }
+    return value != NULL;
+}
+
+SVCXDEF svcx_string_view svcx_interner_resolve(
+    const svcx_interner *in, uint32_t id) {
+    SVCX_ASSERT(in && id < in->views.size);
+    return ((const svcx_string_view *)in->views.data)[id];
+}
+
+SVCXDEF size_t svcx_interner_count(const svcx_interner *in) {
+    SVCX_ASSERT(in);
+    return in->views.size;
+}
+
+//
+// Concurrent interner. Id i lives in bucket b at index i + 16 - 2^(b + 4),
+// where bucket b holds 2^(b + 4) views, so 29 buckets cover all 32-bit ids.
+//
+#ifdef SVCX__HAS_ATOMICS
+static size_t svcx__cinterner_bucket(uint32_t id, size_t *index) {
+    uint64_t x = (uint64_t)id + 16;
+    size_t b = (size_t)(63 - svcx__clz64(x)) - 4;
+    *index = (size_t)(x - ((uint64_t)16 << b));
+    return b;
+}
+
+SVCXDEF svcx_result svcx_cinterner_init(
+    svcx_cinterner *ci, svcx_allocator a) {
+    SVCX_ASSERT(ci);
+
+    for (size_t i = 0; i < SVCX__CINTERNER_BUCKETS; i++) {
+        atomic_init(&ci->buckets[i], NULL);
+    }
+    atomic_init(&ci->count, 0);
+    if (svcx_cmap_init(&ci->ids, 0, sizeof(uint32_t), a) != SVCX_OK) {
+        return SVCX_INTERNER_ALLOC_ERR;
+    }
+    return SVCX_OK;
+}
+
+SVCXDEF void svcx_cinterner_free(svcx_cinterner *ci) {
+    SVCX_ASSERT(ci);
+
+    for (size_t i = 0; i < SVCX__CINTERNER_BUCKETS; i++) {
+        svcx_string_view *bucket =
+            atomic_load_explicit(&ci->buckets[i], memory_order_relaxed);
+        if (bucket) {
+            svcx_free(&ci->ids.a, bucket);
+        }
+        atomic_init(&ci->buckets[i], NULL);
+    }
+    svcx_cmap_free(&ci->ids);
+}
+
+typedef struct svcx__cinterner_ctx {
+    svcx_cinterner *ci;
+    uint32_t id;
+    svcx_result r;
+} svcx__cinterner_ctx;
+
+// Makes sure the bucket that holds id exists. Buckets can be needed by several
+// shards at once, so they are published with a compare and swap.
+static bool svcx__cinterner_reserve(svcx_cinterner *ci, uint32_t id) {
+    size_t index;
+    size_t b = svcx__cinterner_bucket(id, &index);
+    svcx_string_view *bucket =
+        atomic_load_explicit(&ci->buckets[b], memory_order_acquire);
+    if (bucket) {
+        return true;
+    }
+    svcx_string_view *fresh = (svcx_string_view *)svcx_alloc(
+        &ci->ids.a, ((size_t)16 << b) * sizeof(svcx_string_view));
+    if (!fresh) {
+        return false;
+    }
+    if (!atomic_compare_exchange_strong_explicit(&ci->buckets[b],
+            &bucket,
+            fresh,
+            memory_order_acq_rel,
+            memory_order_acquire)) {
+        svcx_free(&ci->ids.a, fresh);
+    }
+    return true;
+}
+
+// Runs under the lock of the shard of the string, so only one thread assigns
+// its id. The map stores the id plus one, leaving 0 for strings whose id could
+// not be assigned. The bucket of an id is reserved before the id is claimed,
+// so a failed allocation leaves the count and the ids unchanged.
+static void svcx__cinterner_assign(
+    svcx_string_view key, void *value, bool inserted, void *ctx) {
+    SVCX_UNUSED(inserted);
+    svcx__cinterner_ctx *c = (svcx__cinterner_ctx *)ctx;
+    uint32_t stored;
+    memcpy(&stored, value, sizeof(stored));
+    if (stored != 0) {
+        c->id = stored - 1;
+        return;
+    }
+
+    uint32_t id = atomic_load_explicit(&c->ci->count, memory_order_relaxed);
+    do {
+        if (!svcx__cinterner_reserve(c->ci, id)) {
+            c->r = SVCX_INTERNER_ALLOC_ERR;
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&c->ci->count,
+        &id,
+        id + 1,
+        memory_order_relaxed,
+        memory_order_relaxed));
+
+    size_t index;
+    size_t b = svcx__cinterner_bucket(id, &index);
+    svcx_string_view *bucket =
+        atomic_load_explicit(&c->ci->buckets[b], memory_order_acquire);
+    bucket[index] = key;
+    stored = id + 1;
+    memcpy(value, &stored, sizeof(stored));
+    c->id = id;
+}
+
+SVCXDEF svcx_result svcx_cinterner_intern(
+    svcx_cinterner *ci, svcx_string_view sv, uint32_t *id) {
+    SVCX_ASSERT(ci && id);
+
+    uint32_t stored;
+    if (svcx_cmap_get(&ci->ids, sv, &stored) && stored != 0) {
+        *id = stored - 1;
+        return SVCX_OK;
+    }
+
+    svcx__cinterner_ctx c = {ci, 0, SVCX_OK};
+    svcx_result r =
+        svcx_cmap_upsert(&ci->ids, sv, svcx__cinterner_assign, &c);
+    if (r != SVCX_OK || c.r != SVCX_OK) {
+        return SVCX_INTERNER_ALLOC_ERR;
+    }
+    *id = c.id;
+    return SVCX_OK;
+}
+
+SVCXDEF bool svcx_cinterner_find(
+    const svcx_cinterner *ci, svcx_string_view sv, uint32_t *id) {
+    SVCX_ASSERT(ci);
+
+    uint32_t stored;
+    if (!svcx_cmap_get(&ci->ids, sv, &stored) || stored == 0) {
+        return false;
+    }
+    if (id) {
+        *id = stored - 1;
+    }
+    return true;
+}
+
+SVCXDEF svcx_string_view svcx_cinterner_resolve(
+    const svcx_cinterner *ci, uint32_t id) {
+    SVCX_ASSERT(ci);
+
+    size_t index;
+    size_t b = svcx__cinterner_bucket(id, &index);
+    svcx_string_view *bucket =
+        atomic_load_explicit(&ci->buckets[b], memory_order_acquire);
+    SVCX_ASSERT(bucket);
+    return bucket[index];
+}
+
+SVCXDEF size_t svcx_cinterner_count(const svcx_cinterner *ci) {
+    SVCX_ASSERT(ci);
+    return atomic_load_explicit(&ci->count, memory_order_relaxed);
+}
+#endif // SVCX__HAS_ATOMICS
+
+SVCXDEF void svcx_sb_init(svcx_string_builder *sb, svcx_allocator a) {
+    svcx_vector_init(&sb->buf, sizeof(char), a);
+    sb->fmt_hint = 0;
+    sb->write = NULL;
+    sb->write_ctx = NULL;
+    sb->flush_at = SIZE_MAX;
+}
+
+SVCXDEF void svcx_sb_init_sink(svcx_string_builder *sb,
+    svcx_allocator a,
+    svcx_sb_write_fn write,
+    void *ctx,
+    size_t flush_at) {
+    SVCX_ASSERT(write);
+    svcx_sb_init(sb, a);
+    sb->write = write;
+    sb->write_ctx = ctx;
+    sb->flush_at = flush_at ? flush_at : SVCX_SB_DEFAULT_FLUSH_AT;
+}
+
+static ptrdiff_t svcx__sb_fd_write(void *ctx, const void *data, size_t len) {
+    int fd = (int)(intptr_t)ctx;
+#ifdef _WIN32
+    return _write(fd, data, len > INT_MAX ? INT_MAX : (unsigned)len);
+#else
+    for (;;) {
+        ssize_t n = write(fd, data, len);
+        if (n >= 0 || errno != EINTR) {
+            return n;
+        }
+    }
+#endif
+}
+
+SVCXDEF void svcx_sb_init_fd(
+    svcx_string_builder *sb, svcx_allocator a, int fd, size_t flush_at) {
+    svcx_sb_init_sink(sb, a, svcx__sb_fd_write, (void *)(intptr_t)fd, flush_at);
+}
+
+static ptrdiff_t svcx__sb_file_write(
+    void *ctx, const void *data, size_t len) {
+    size_t n = fwrite(data, 1, len, (FILE *)ctx);
+    return n > 0 ? (ptrdiff_t)n : -1;
+}
+
+SVCXDEF void svcx_sb_init_file(
+    svcx_string_builder *sb, svcx_allocator a, FILE *f, size_t flush_at) {
+    SVCX_ASSERT(f);
+    svcx_sb_init_sink(sb, a, svcx__sb_file_write, f, flush_at);
+}
+
+// Writes data to the sink until all of it is written or a write fails, and
+// stores how much was written in done either way.
+static svcx_result svcx__sb_drain(
+    svcx_string_builder *sb, const char *data, size_t len, size_t *done) {
+    *done = 0;
+    while (*done < len) {
+        ptrdiff_t n = sb->write(sb->write_ctx, data + *done, len - *done);
+        if (n <= 0) {
+            return SVCX_SB_FLUSH_ERR;
+        }
+        *done += (size_t)n;
+    }
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_sb_flush(svcx_string_builder *sb) {
+    if (!sb->write || sb->buf.size == 0) {
+        return SVCX_OK;
+    }
+
+    char *data = (char *)sb->buf.data;
+    size_t done;
+    svcx_result r = svcx__sb_drain(sb, data, sb->buf.size, &done);
+    if (done > 0) {
+        memmove(data, data + done, sb->buf.size - done);
+        sb->buf.size -= done;
+    }
+    return r;
+}
+
+// Called at the end of every append. flush_at is SIZE_MAX without a sink, so
+// plain string builders only pay for the comparison.
+static svcx_result svcx__sb_appended(svcx_string_builder *sb) {
+    if (sb->buf.size >= sb->flush_at) {
+        return svcx_sb_flush(sb);
+    }
+    return SVCX_OK;
+}
+
+// Writes an append too large to be worth buffering straight to the sink,
+// after whatever is buffered already. The bytes that could not be written
+// are buffered instead, so a later flush can retry them, and if there is no
+// room for them the append fails rather than losing them quietly.
+static svcx_result svcx__sb_write_through(
+    svcx_string_builder *sb, const char *data, size_t len) {
+    size_t done = 0;
+    svcx_result r = svcx_sb_flush(sb);
+    if (r == SVCX_OK) {
+        r = svcx__sb_drain(sb, data, len, &done);
+        if (r == SVCX_OK) {
+            return SVCX_OK;
+        }
+    }
+    size_t rest = len - done;
+    if (svcx_vector_reserve(&sb->buf, sb->buf.size + rest) != SVCX_OK) {
+        return SVCX_SB_APPEND_ERR;
+    }
+    memcpy((char *)sb->buf.data + sb->buf.size, data + done, rest);
+    sb->buf.size += rest;
+    return r;
+}
+
+SVCXDEF void svcx_sb_clear(svcx_string_builder *sb) {
+    svcx_vector_clear(&sb->buf);
+}
+
+SVCXDEF void svcx_sb_free(svcx_string_builder *sb) {
+    svcx_vector_free(&sb->buf);
+}
+
+SVCXDEF svcx_result svcx_sb_push_char(svcx_string_builder *sb, char c) {
+    if (svcx_vector_push(&sb->buf, &c) != SVCX_OK) {
+        return SVCX_SB_PUSHC_ERR;
+    }
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF svcx_result svcx_sb_append(
+    svcx_string_builder *sb, const char *str, size_t len) {
+    SVCX_ASSERT(str || len == 0);
+
+    if (len == 0) {
+        return SVCX_OK;
+    }
+    if (len >= sb->flush_at) {
+        return svcx__sb_write_through(sb, str, len);
+    }
+
+    size_t old_size = sb->buf.size;
+
+    svcx_result r = svcx_vector_reserve(&sb->buf, old_size + len);
+
+    if (r != SVCX_OK) {
+        return SVCX_SB_APPEND_ERR;
+    }
+
+    memcpy((char *)sb->buf.data + old_size, str, len);
+    sb->buf.size += len;
+
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF svcx_result svcx_sb_append_cstr(
+    svcx_string_builder *sb, const char *cstr) {
+    return svcx_sb_append(sb, cstr, strlen(cstr));
+}
+
+SVCXDEF svcx_result svcx_sb_append_sv(
+    svcx_string_builder *sb, svcx_string_view sv) {
+    if (sv.len == 0) {
+        return SVCX_OK;
+    }
+    if (sv.len >= sb->flush_at) {
+        return svcx__sb_write_through(sb, sv.data, sv.len);
+    }
+
+    size_t new_size = sb->buf.size + sv.len;
+
+    svcx_result r = svcx_vector_reserve(&sb->buf, new_size);
+    if (r != SVCX_OK) {
+        return SVCX_SB_APPEND_SV_ERR;
+    }
+
+    memcpy((char *)sb->buf.data + sb->buf.size, sv.data, sv.len);
+
+    sb->buf.size = new_size;
+
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF svcx_result svcx_sb_append_fmt(
+    svcx_string_builder *sb, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    svcx_result r = svcx_sb_append_vfmt(sb, fmt, args);
+    va_end(args);
+    return r;
+}
+
+SVCXDEF svcx_result svcx_sb_append_vfmt(
+    svcx_string_builder *sb, const char *fmt, va_list args) {
+    size_t old_size = sb->buf.size;
+
+    // vsnprintf always writes the terminating zero, so it needs one byte
+    // more than the output.
+    if (sb->buf.cap - old_size < sb->fmt_hint + 1 &&
+        svcx_vector_reserve(&sb->buf, old_size + sb->fmt_hint + 1) !=
+            SVCX_OK) {
+        return SVCX_SB_FMT_RESERVE_ERR;
+    }
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+    size_t spare = sb->buf.cap - old_size;
+    int needed =
+        vsnprintf((char *)sb->buf.data + old_size, spare, fmt, args_copy);
+    va_end(args_copy);
+
+    if (needed < 0) {
+        return SVCX_SB_FMT_INVALID_ARG_ERR;
+    }
+
+    if ((size_t)needed >= spare) {
+        if (svcx_vector_reserve(&sb->buf, old_size + (size_t)needed + 1) !=
+            SVCX_OK) {
+            return SVCX_SB_FMT_RESERVE_ERR;
+        }
+        va_copy(args_copy, args);
+        vsnprintf((char *)sb->buf.data + old_size,
+            (size_t)needed + 1,
+            fmt,
+            args_copy);
+        va_end(args_copy);
+    }
+
+    sb->buf.size += (size_t)needed;
+    sb->fmt_hint = (size_t)needed;
+    return svcx__sb_appended(sb);
+}
+
+//
+// Number formatting. Integers are written backwards two digits at a time
+// from a table of digit pairs, straight into the reserved buffer. Doubles use
+// the Schubfach algorithm of Raffaello Giulietti, which finds the shortest
+// decimal that rounds back to the double from three 126-bit products with a
+// power of ten, taken from the table of the float parser.
+//
+static const char svcx__digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static int svcx__count_digits(uint64_t v) {
+    int n = 1;
+    while (v >= 10000) {
+        v /= 10000;
+        n += 4;
+    }
+    return n + (v >= 10) + (v >= 100) + (v >= 1000);
+}
+
+// Writes the digits of v ending just before end, and returns their start.
+static char *svcx__write_u64(char *end, uint64_t v) {
+    while (v >= 100) {
+        const char *pair = svcx__digit_pairs + (v % 100) * 2;
+        v /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    if (v >= 10) {
+        *--end = svcx__digit_pairs[v * 2 + 1];
+        *--end = svcx__digit_pairs[v * 2];
+    } else {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+// Reserves room for max more bytes and returns where they start.
+static char *svcx__sb_reserve_tail(svcx_string_builder *sb, size_t max) {
+    if (svcx_vector_reserve(&sb->buf, sb->buf.size + max) != SVCX_OK) {
+        return NULL;
+    }
+    return (char *)sb->buf.data + sb->buf.size;
+}
+
+SVCXDEF svcx_result svcx_sb_append_u64(svcx_string_builder *sb, uint64_t v) {
+    char *p = svcx__sb_reserve_tail(sb, 20);
+    if (!p) {
+        return SVCX_SB_APPEND_NUM_ERR;
+    }
+    int n = svcx__count_digits(v);
+    svcx__write_u64(p + n, v);
+    sb->buf.size += (size_t)n;
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF svcx_result svcx_sb_append_i64(svcx_string_builder *sb, int64_t v) {
+    char *p = svcx__sb_reserve_tail(sb, 20);
+    if (!p) {
+        return SVCX_SB_APPEND_NUM_ERR;
+    }
+    uint64_t mag = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    int n = svcx__count_digits(mag) + (v < 0);
+    svcx__write_u64(p + n, mag);
+    if (v < 0) {
+        *p = '-';
+    }
+    sb->buf.size += (size_t)n;
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF svcx_result svcx_sb_append_hex(svcx_string_builder *sb, uint64_t v) {
+    char *p = svcx__sb_reserve_tail(sb, 16);
+    if (!p) {
+        return SVCX_SB_APPEND_NUM_ERR;
+    }
+    int n = v ? (67 - svcx__clz64(v)) / 4 : 1;
+    for (int i = n - 1; i >= 0; i--) {
+        p[i] = "0123456789abcdef"[v & 15];
+        v >>= 4;
+    }
+    sb->buf.size += (size_t)n;
+    return svcx__sb_appended(sb);
+}
+
+// floor(x / 2^s), also for negative x.
+static int64_t svcx__floor_shift(int64_t x, int s) {
+    return x >= 0 ? x >> s : -((-x + ((int64_t)1 << s) - 1) >> s);
+}
+
+static uint64_t svcx__mul_high(uint64_t a, uint64_t b) {
+    svcx__mum(&a, &b);
+    return b;
+}
+
+// Rounds g * cp / 2^127 to odd, where g = g1 * 2^63 + g0.
+static uint64_t svcx__schubfach_rop(uint64_t g1, uint64_t g0, uint64_t cp) {
+    uint64_t x1 = svcx__mul_high(g0, cp);
+    uint64_t y0 = g1 * cp;
+    uint64_t y1 = svcx__mul_high(g1, cp);
+    uint64_t z = (y0 >> 1) + x1;
+    uint64_t vbp = y1 + (z >> 63);
+    uint64_t mask = ((uint64_t)1 << 63) - 1;
+    return vbp | (((z & mask) + mask) >> 63);
+}
+
+// Finds the shortest decimal f * 10^e in the rounding interval of c * 2^q.
+static void svcx__schubfach(int64_t q, uint64_t c, uint64_t *f, int64_t *e) {
+    uint64_t out = c & 1;
+    uint64_t cb = c << 2;
+    uint64_t cbr = cb + 2;
+    uint64_t cbl;
+    int64_t k;
+    if (c != (1ULL << 52) || q == -1074) {
+        cbl = cb - 2;
+        k = svcx__floor_shift(q * 661971961083LL, 41);
+    } else {
+        // The interval below a power of two is half as wide.
+        cbl = cb - 1;
+        k = svcx__floor_shift(q * 661971961083LL - 274743187321LL, 41);
+    }
+    int h = (int)(q + svcx__floor_shift(-k * 913124641741LL, 38) + 2);
+
+    // g is the power 10^-k normalized to 126 bits and rounded up.
+    const uint64_t *pow = svcx__pow10_128[-k + 348];
+    uint64_t g_hi = pow[0] >> 2;
+    uint64_t g_lo = (pow[0] << 62 | pow[1] >> 2) + 1;
+    g_hi += g_lo == 0;
+    uint64_t g1 = g_hi << 1 | g_lo >> 63;
+    uint64_t g0 = g_lo & (((uint64_t)1 << 63) - 1);
+
+    uint64_t vb = svcx__schubfach_rop(g1, g0, cb << h);
+    uint64_t vbl = svcx__schubfach_rop(g1, g0, cbl << h);
+    uint64_t vbr = svcx__schubfach_rop(g1, g0, cbr << h);
+
+    uint64_t s = vb >> 2;
+    if (s >= 100) {
+        uint64_t sp10 = 10 * svcx__mul_high(s, 115292150460684698ULL << 4);
+        uint64_t tp10 = sp10 + 10;
+        bool upin = vbl + out <= sp10 << 2;
+        bool wpin = (tp10 << 2) + out <= vbr;
+        if (upin != wpin) {
+            *f = upin ? sp10 : tp10;
+            *e = k;
+            return;
+        }
+    }
+
+    uint64_t t = s + 1;
+    bool uin = vbl + out <= s << 2;
+    bool win = (t << 2) + out <= vbr;
+    if (uin != win) {
+        *f = uin ? s : t;
+        *e = k;
+        return;
+    }
+    int64_t cmp = (int64_t)(vb - ((s + t) << 1));
+    *f = cmp < 0 || (cmp == 0 && (s & 1) == 0) ? s : t;
+    *e = k;
+}
+
+SVCXDEF svcx_result svcx_sb_append_f64(svcx_string_builder *sb, double v) {
+    char *p = svcx__sb_reserve_tail(sb, 32);
+    if (!p) {
+        return SVCX_SB_APPEND_NUM_ERR;
+    }
+    char *start = p;
+
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    uint64_t frac = bits & ((1ULL << 52) - 1);
+    int64_t biased = (int64_t)(bits >> 52 & 0x7ff);
+    if (biased == 0x7ff) {
+        const char *s = frac ? "nan" : bits >> 63 ? "-inf" : "inf";
+        size_t n = strlen(s);
+        memcpy(p, s, n);
+        sb->buf.size += n;
+        return svcx__sb_appended(sb);
+    }
+    if (bits >> 63) {
+        *p++ = '-';
+    }
+    if (biased == 0 && frac == 0) {
+        *p++ = '0';
+        sb->buf.size += (size_t)(p - start);
+        return svcx__sb_appended(sb);
+    }
+
+    uint64_t f;
+    int64_t e;
+    if (biased != 0) {
+        uint64_t c = frac | (1ULL << 52);
+        int64_t mq = 1075 - biased;
+        if (mq > 0 && mq < 53 && (c >> mq) << mq == c) {
+            f = c >> mq;
+            e = 0;
+        } else {
+            svcx__schubfach(-mq, c, &f, &e);
+        }
+    } else if (frac < 3) {
+        // The algorithm needs more digits than the two smallest subnormals
+        // have, and both have a one-digit shortest form.
+        f = frac == 1 ? 5 : 1;
+        e = frac == 1 ? -324 : -323;
+    } else {
+        svcx__schubfach(-1074, frac, &f, &e);
+    }
+    while (f % 10 == 0) {
+        f /= 10;
+        e++;
+    }
+
+    // The layout of JavaScript: the value is 0.ddd * 10^point, written in
+    // fixed notation when -6 < point <= 21 and in exponent notation
+    // otherwise.
+    char digits[20];
+    int n = svcx__count_digits(f);
+    svcx__write_u64(digits + n, f);
+    int64_t point = e + n;
+    if (point > 21 || point <= -6) {
+        *p++ = digits[0];
+        if (n > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, (size_t)n - 1);
+            p += n - 1;
+        }
+        *p++ = 'e';
+        *p++ = point - 1 < 0 ? '-' : '+';
+        uint64_t x = (uint64_t)(point - 1 < 0 ? 1 - point : point - 1);
+        int xn = svcx__count_digits(x);
+        p = svcx__write_u64(p + xn, x) + xn;
+    } else if (point >= n) {
+        memcpy(p, digits, (size_t)n);
+        memset(p + n, '0', (size_t)(point - n));
+        p += point;
+    } else if (point > 0) {
+        memcpy(p, digits, (size_t)point);
+        p[point] = '.';
+        memcpy(p + point + 1, digits + point, (size_t)(n - point));
+        p += n + 1;
+    } else {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', (size_t)-point);
+        p += -point;
+        memcpy(p, digits, (size_t)n);
+        p += n;
+    }
+
+    sb->buf.size += (size_t)(p - start);
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF const char *svcx_sb_cstr(svcx_string_builder *sb) {
+    char zero = '\0';
+
+    if (sb->buf.size == sb->buf.cap ||
+        ((char *)sb->buf.data)[sb->buf.size] != '\0') {
+        svcx_vector_push(&sb->buf, &zero);
+        sb->buf.size--;
+    }
+
+    return (const char *)sb->buf.data;
+}
+
+SVCXDEF char *svcx_sb_build(svcx_string_builder *sb) {
+    char zero = '\0';
+    svcx_vector_push(&sb->buf, &zero);
+    return (char *)sb->buf.data;
+}
+
+SVCXDEF svcx_string_view svcx_sb_view(svcx_string_builder *sb) {
+    return (svcx_string_view){
+        .data = (const char *)sb->buf.data, .len = sb->buf.size};
+}
+
+//
+// Escaping. Each format has a SIMD scan for the first byte that needs work,
+// with the same contract as the byte scanning helpers, and the runs between
+// those bytes are copied with memcpy. JSON escapes quotes, backslashes and
+// bytes below 0x20 (found with an unsigned min, as x == min(x, 0x1F) only for
+// those), and CSV quotes fields with the delimiter, quotes or line breaks.
+//
+#ifdef SVCX__SSE2
+static size_t svcx__find_json_sse2(const char *p, size_t len) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) {
+            return i + (size_t)svcx__ctz64(mask);
+        }
+    }
+    return i;
+}
+
+static size_t svcx__find_csv_sse2(const char *p, size_t len, char delim) {
+    const __m128i sep = _mm_set1_epi8(delim);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, sep), _mm_cmpeq_epi8(v, quote)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) {
+            return i + (size_t)svcx__ctz64(mask);
+        }
+    }
+    return i;
+}
+#endif // SVCX__SSE2
+
+#ifdef SVCX__AVX2
+SVCX__AVX2_FN static size_t svcx__find_json_avx2(const char *p, size_t len) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i bslash = _mm256_set1_epi8('\\');
+    const __m256i ctrl = _mm256_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, bslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctrl), v));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+        if (mask) {
+            return i + (size_t)_tzcnt_u32(mask);
+        }
+    }
+    return i;
+}
+
+SVCX__AVX2_FN static size_t svcx__find_csv_avx2(
+    const char *p, size_t len, char delim) {
+    const __m256i sep = _mm256_set1_epi8(delim);
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, sep), _mm256_cmpeq_epi8(v, quote)),
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+        if (mask) {
+            return i + (size_t)_tzcnt_u32(mask);
+        }
+    }
+    return i;
+}
+#endif // SVCX__AVX2
+
+static size_t svcx__find_json(const char *p, size_t len) {
+    size_t i = SVCX__SIMD_CALL(svcx__find_json, p, len);
+    while (i < len) {
+        unsigned char c = (unsigned char)p[i];
+        if (c < 0x20 || c == '"' || c == '\\') {
+            break;
+        }
+        i++;
+    }
+    return i;
+}
+
+static size_t svcx__find_csv(const char *p, size_t len, char delim) {
+    size_t i = SVCX__SIMD_CALL(svcx__find_csv, p, len, delim);
+    while (i < len && p[i] != delim && p[i] != '"' && p[i] != '\r' &&
+           p[i] != '\n') {
+        i++;
+    }
+    return i;
+}
+
+// Returns the index of the first byte c in p, or len.
+static size_t svcx__find_char(const char *p, size_t len, char c) {
+    const char *hit = len ? (const char *)memchr(p, c, len) : NULL;
+    return hit ? (size_t)(hit - p) : len;
+}
+
+static int svcx__hex_value(unsigned char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// Reads the four hex digits of a \u escape.
+static bool svcx__parse_hex4(const char *p, size_t len, uint32_t *v) {
+    if (len < 4) {
+        return false;
+    }
+    *v = 0;
+    for (int i = 0; i < 4; i++) {
+        int d = svcx__hex_value((unsigned char)p[i]);
+        if (d < 0) {
+            return false;
+        }
+        *v = *v << 4 | (uint32_t)d;
+    }
+    return true;
+}
+
+SVCXDEF svcx_result svcx_sb_append_json_escaped(
+    svcx_string_builder *sb, svcx_string_view sv) {
+    SVCX_ASSERT(sb);
+    SVCX_ASSERT(sv.data || sv.len == 0);
+    static const char shorts[0x20] = {
+        ['\b'] = 'b', ['\t'] = 't', ['\n'] = 'n', ['\f'] = 'f', ['\r'] = 'r'};
+
+    size_t i = 0;
+    while (i < sv.len) {
+        size_t run = svcx__find_json(sv.data + i, sv.len - i);
+
+        // Room for the rest of the input and one escape, so the buffer only
+        // grows again once the escapes have used up the slack.
+        size_t need = sb->buf.size + (sv.len - i) + 6;
+        if (need > sb->buf.cap &&
+            svcx_vector_reserve(&sb->buf, need) != SVCX_OK) {
+            return SVCX_SB_ESCAPE_RESERVE_ERR;
+        }
+
+        char *out = (char *)sb->buf.data + sb->buf.size;
+        memcpy(out, sv.data + i, run);
+        out += run;
+        i += run;
+        if (i < sv.len) {
+            unsigned char c = (unsigned char)sv.data[i++];
+            *out++ = '\\';
+            if (c == '"' || c == '\\') {
+                *out++ = (char)c;
+            } else if (shorts[c]) {
+                *out++ = shorts[c];
+            } else {
+                memcpy(out, "u00", 3);
+                out[3] = "0123456789abcdef"[c >> 4];
+                out[4] = "0123456789abcdef"[c & 15];
+                out += 5;
+            }
+        }
+        sb->buf.size = (size_t)(out - (char *)sb->buf.data);
+    }
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF svcx_result svcx_sb_append_json_unescaped(
+    svcx_string_builder *sb, svcx_string_view sv) {
+    SVCX_ASSERT(sb);
+    SVCX_ASSERT(sv.data || sv.len == 0);
+
+    // Every escape is at least as long as what it stands for, so the output
+    // fits in sv.len bytes and is only committed once all of it is valid.
+    if (svcx_vector_reserve(&sb->buf, sb->buf.size + sv.len) != SVCX_OK) {
+        return SVCX_SB_ESCAPE_RESERVE_ERR;
+    }
+    char *start = (char *)sb->buf.data + sb->buf.size;
+    char *out = start;
+
+    const char *p = sv.data;
+    size_t len = sv.len;
+    size_t i = 0;
+    while (i < len) {
+        size_t run = svcx__find_char(p + i, len - i, '\\');
+        memcpy(out, p + i, run);
+        out += run;
+        i += run;
+        if (i == len) {
+            break;
+        }
+        if (i + 1 == len) {
+            return SVCX_SB_UNESCAPE_INVALID_ERR;
+        }
+
+        char c = p[i + 1];
+        i += 2;
+        switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+            *out++ = c;
+            break;
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u': {
+            uint32_t cp;
+            if (!svcx__parse_hex4(p + i, len - i, &cp)) {
+                return SVCX_SB_UNESCAPE_INVALID_ERR;
+            }
+            i += 4;
+            if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                return SVCX_SB_UNESCAPE_INVALID_ERR;
+            }
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                uint32_t lo;
+                if (len - i < 6 || p[i] != '\\' || p[i + 1] != 'u' ||
+                    !svcx__parse_hex4(p + i + 2, 4, &lo) || lo < 0xDC00 ||
+                    lo > 0xDFFF) {
+                    return SVCX_SB_UNESCAPE_INVALID_ERR;
+                }
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                i += 6;
+            }
+            out += svcx__utf8_encode(out, cp);
+            break;
+        }
+        default:
+            return SVCX_SB_UNESCAPE_INVALID_ERR;
+        }
+    }
+
+    sb->buf.size += (size_t)(out - start);
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF svcx_result svcx_sb_append_csv_quoted(
+    svcx_string_builder *sb, svcx_string_view sv, char delim) {
+    SVCX_ASSERT(sb);
+    SVCX_ASSERT(sv.data || sv.len == 0);
+
+    if (svcx__find_csv(sv.data, sv.len, delim) == sv.len) {
+        return svcx_sb_append_sv(sb, sv);
+    }
+
+    size_t pos = sb->buf.size;
+    if (svcx_vector_reserve(&sb->buf, pos + sv.len + 2) != SVCX_OK) {
+        return SVCX_SB_ESCAPE_RESERVE_ERR;
+    }
+    ((char *)sb->buf.data)[pos++] = '"';
+
+    size_t i = 0;
+    for (;;) {
+        size_t run = svcx__find_char(sv.data + i, sv.len - i, '"');
+
+        // Room for the rest of the input, a doubled quote and the closing
+        // quote.
+        size_t need = pos + (sv.len - i) + 2;
+        if (need > sb->buf.cap &&
+            svcx_vector_reserve(&sb->buf, need) != SVCX_OK) {
+            return SVCX_SB_ESCAPE_RESERVE_ERR;
+        }
+
+        char *data = (char *)sb->buf.data;
+        memcpy(data + pos, sv.data + i, run);
+        pos += run;
+        i += run;
+        if (i == sv.len) {
+            data[pos++] = '"';
+            break;
+        }
+        data[pos++] = '"';
+        data[pos++] = '"';
+        i++;
+    }
+
+    sb->buf.size = pos;
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF svcx_result svcx_sb_append_csv_unquoted(
+    svcx_string_builder *sb, svcx_string_view sv) {
+    SVCX_ASSERT(sb);
+    SVCX_ASSERT(sv.data || sv.len == 0);
+
+    if (sv.len == 0 || sv.data[0] != '"') {
+        return svcx_sb_append_sv(sb, sv);
+    }
+    if (sv.len < 2 || sv.data[sv.len - 1] != '"') {
+        return SVCX_SB_UNESCAPE_INVALID_ERR;
+    }
+
+    const char *p = sv.data + 1;
+    size_t len = sv.len - 2;
+    if (svcx_vector_reserve(&sb->buf, sb->buf.size + len) != SVCX_OK) {
+        return SVCX_SB_ESCAPE_RESERVE_ERR;
+    }
+    char *start = (char *)sb->buf.data + sb->buf.size;
+    char *out = start;
+
+    size_t i = 0;
+    while (i < len) {
+        size_t run = svcx__find_char(p + i, len - i, '"');
+        memcpy(out, p + i, run);
+        out += run;
+        i += run;
+        if (i == len) {
+            break;
+        }
+        if (i + 1 == len || p[i + 1] != '"') {
+            return SVCX_SB_UNESCAPE_INVALID_ERR;
+        }
+        *out++ = '"';
+        i += 2;
+    }
+
+    sb->buf.size += (size_t)(out - start);
+    return svcx__sb_appended(sb);
+}
+
+//
+// Hex and base64. The SIMD variants follow the usual contract and return how
+// much of the input they handled, always whole blocks. Hex digits are made
+// with a compare and an add (SSE2 has no byte shuffle) or a table shuffle,
+// and checked with unsigned range tests. Base64 uses the AVX2 algorithms of
+// Wojciech Mula and Daniel Lemire: multiplies move the 6-bit fields into
+// bytes, and nibble-indexed shuffles turn them into characters and back
+// while flagging invalid ones. SSE2 can not do that without a byte shuffle,
+// so base64 only has AVX2 variants, and is scalar on CPUs without AVX2.
+//
+static const char svcx__base64_alphabets[2][65] = {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_",
+};
+
+// The value of each ASCII character in both alphabets, or 0xFF.
+static const uint8_t svcx__base64_values[2][128] = {
+    {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+        0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+        0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12,
+        0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24,
+        0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30,
+        0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    },
+    {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF,
+        0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+        0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12,
+        0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F,
+        0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24,
+        0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30,
+        0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    },
+};
+
+#ifdef SVCX__SSE2
+static __m128i svcx__hex_digits_sse2(__m128i n) {
+    __m128i letter = _mm_cmpgt_epi8(n, _mm_set1_epi8(9));
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')),
+        _mm_and_si128(letter, _mm_set1_epi8('a' - '0' - 10)));
+}
+
+static size_t svcx__hex_encode_sse2(const uint8_t *src, size_t len, char *dst) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i hi = svcx__hex_digits_sse2(
+            _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        __m128i lo = svcx__hex_digits_sse2(_mm_and_si128(v, mask));
+        _mm_storeu_si128(
+            (__m128i *)(dst + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(
+            (__m128i *)(dst + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+// Turns 16 hex digits into their values, and 8 pairs of values into bytes
+// in the low halves of the 16-bit lanes. ok is cleared for invalid digits.
+static __m128i svcx__hex_pairs_sse2(__m128i c, __m128i *ok) {
+    __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i l = _mm_sub_epi8(
+        _mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_d = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    __m128i is_l = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+    *ok = _mm_and_si128(*ok, _mm_or_si128(is_d, is_l));
+    __m128i v = _mm_or_si128(_mm_and_si128(is_d, d),
+        _mm_and_si128(is_l, _mm_add_epi8(l, _mm_set1_epi8(10))));
+    return _mm_or_si128(
+        _mm_and_si128(_mm_slli_epi16(v, 4), _mm_set1_epi16(0xF0)),
+        _mm_srli_epi16(v, 8));
+}
+
+static size_t svcx__hex_decode_sse2(const char *src, size_t len, uint8_t *dst) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m128i ok = _mm_set1_epi8(-1);
+        __m128i a = svcx__hex_pairs_sse2(
+            _mm_loadu_si128((const __m128i *)(src + i)), &ok);
+        __m128i b = svcx__hex_pairs_sse2(
+            _mm_loadu_si128((const __m128i *)(src + i + 16)), &ok);
+        if (_mm_movemask_epi8(ok) != 0xFFFF) {
+            break;
+        }
+        _mm_storeu_si128((__m128i *)(dst + i / 2), _mm_packus_epi16(a, b));
+    }
+    return i;
+}
+#endif // SVCX__SSE2
+
+#ifdef SVCX__AVX2
+SVCX__AVX2_FN static size_t svcx__hex_encode_avx2(
+    const uint8_t *src, size_t len, char *dst) {
+    const __m256i digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5',
+        '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f', '0', '1', '2', '3',
+        '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i hi = _mm256_shuffle_epi8(
+            digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+        __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, mask));
+        // The unpacks work within 128-bit lanes, so the halves are swapped
+        // back into order before storing.
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(
+            (__m256i *)(dst + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + 2 * i + 32),
+            _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return i;
+}
+
+SVCX__AVX2_FN static __m256i svcx__hex_pairs_avx2(__m256i c, __m256i *ok) {
+    __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i l = _mm256_sub_epi8(
+        _mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i is_d =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+    __m256i is_l =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+    *ok = _mm256_and_si256(*ok, _mm256_or_si256(is_d, is_l));
+    __m256i v = _mm256_or_si256(_mm256_and_si256(is_d, d),
+        _mm256_and_si256(is_l, _mm256_add_epi8(l, _mm256_set1_epi8(10))));
+    return _mm256_or_si256(
+        _mm256_and_si256(_mm256_slli_epi16(v, 4), _mm256_set1_epi16(0xF0)),
+        _mm256_srli_epi16(v, 8));
+}
+
+SVCX__AVX2_FN static size_t svcx__hex_decode_avx2(
+    const char *src, size_t len, uint8_t *dst) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i ok = _mm256_set1_epi8(-1);
+        __m256i a = svcx__hex_pairs_avx2(
+            _mm256_loadu_si256((const __m256i *)(src + i)), &ok);
+        __m256i b = svcx__hex_pairs_avx2(
+            _mm256_loadu_si256((const __m256i *)(src + i + 32)), &ok);
+        if ((uint32_t)_mm256_movemask_epi8(ok) != 0xFFFFFFFF) {
+            break;
+        }
+        __m256i packed = _mm256_permute4x64_epi64(
+            _mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i *)(dst + i / 2), packed);
+    }
+    return i;
+}
+
+// Encodes 24 bytes into 32 characters per iteration. Each lane loads 16
+// bytes and uses the first 12, so the loop needs 28 readable bytes.
+SVCX__AVX2_FN static size_t svcx__base64_encode_avx2(
+    const uint8_t *src, size_t len, char *dst, bool url) {
+    const __m256i spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8,
+        7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const char c62 = url ? '-' : '+';
+    const char c63 = url ? '_' : '/';
+    // Offsets from a 6-bit value to its character, indexed by a class that
+    // is 13 for A-Z, 0 for a-z, 1 to 10 for digits and 11 and 12 for the
+    // last two characters.
+    const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, (char)(c62 - 62), (char)(c63 - 63), 'A', 0, 0, 'a' - 26,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, (char)(c62 - 62), (char)(c63 - 63), 'A',
+        0, 0);
+    size_t i = 0;
+    size_t o = 0;
+    for (; i + 28 <= len; i += 24, o += 32) {
+        __m256i in = _mm256_setr_m128i(
+            _mm_loadu_si128((const __m128i *)(src + i)),
+            _mm_loadu_si128((const __m128i *)(src + i + 12)));
+        in = _mm256_shuffle_epi8(in, spread);
+        __m256i ac = _mm256_mulhi_epu16(
+            _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)),
+            _mm256_set1_epi32(0x04000040));
+        __m256i bd = _mm256_mullo_epi16(
+            _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)),
+            _mm256_set1_epi32(0x01000010));
+        __m256i values = _mm256_or_si256(ac, bd);
+
+        __m256i cls = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+        __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), values);
+        cls = _mm256_or_si256(
+            cls, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+        __m256i chars =
+            _mm256_add_epi8(_mm256_shuffle_epi8(offsets, cls), values);
+        _mm256_storeu_si256((__m256i *)(dst + o), chars);
+    }
+    return i;
+}
+
+// Decodes 32 characters into 24 bytes per iteration, storing 32 bytes, so
+// the loop also needs 32 bytes of room in the output. URL-safe input is
+// mapped to the standard alphabet first, after ruling out '+' and '/'.
+SVCX__AVX2_FN static size_t svcx__base64_decode_avx2(
+    const char *src, size_t len, uint8_t *dst, size_t cap, bool url) {
+    const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A, 0x15,
+        0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B,
+        0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04,
+        0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71,
+        -71, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0,
+        0, 0, 0, 0, 0);
+    const __m256i slash = _mm256_set1_epi8('/');
+    const __m256i gather = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+        13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+        -1, -1);
+    size_t i = 0;
+    size_t o = 0;
+    for (; i + 32 <= len && o + 32 <= cap; i += 32, o += 24) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(src + i));
+        if (url) {
+            __m256i std = _mm256_or_si256(
+                _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+')),
+                _mm256_cmpeq_epi8(in, slash));
+            if (!_mm256_testz_si256(std, std)) {
+                break;
+            }
+            in = _mm256_blendv_epi8(in,
+                _mm256_set1_epi8('+'),
+                _mm256_cmpeq_epi8(in, _mm256_set1_epi8('-')));
+            in = _mm256_blendv_epi8(
+                in, slash, _mm256_cmpeq_epi8(in, _mm256_set1_epi8('_')));
+        }
+
+        __m256i hi_nibbles =
+            _mm256_and_si256(_mm256_srli_epi32(in, 4), slash);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(in, slash));
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        if (!_mm256_testz_si256(lo, hi)) {
+            break;
+        }
+        __m256i roll = _mm256_shuffle_epi8(lut_roll,
+            _mm256_add_epi8(_mm256_cmpeq_epi8(in, slash), hi_nibbles));
+        __m256i values = _mm256_add_epi8(in, roll);
+
+        __m256i merged = _mm256_madd_epi16(
+            _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)),
+            _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, gather);
+        merged = _mm256_permutevar8x32_epi32(
+            merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256((__m256i *)(dst + o), merged);
+    }
+    return i;
+}
+#endif // SVCX__AVX2
+
+SVCXDEF svcx_result svcx_sb_append_hex_encoded(
+    svcx_string_builder *sb, const void *data, size_t len) {
+    SVCX_ASSERT(sb);
+    SVCX_ASSERT(data || len == 0);
+
+    char *dst = svcx__sb_reserve_tail(sb, 2 * len);
+    if (!dst) {
+        return SVCX_SB_ENCODE_RESERVE_ERR;
+    }
+    const uint8_t *src = (const uint8_t *)data;
+    size_t i = SVCX__SIMD_CALL(svcx__hex_encode, src, len, dst);
+    for (; i < len; i++) {
+        dst[2 * i] = "0123456789abcdef"[src[i] >> 4];
+        dst[2 * i + 1] = "0123456789abcdef"[src[i] & 15];
+    }
+    sb->buf.size += 2 * len;
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF svcx_result svcx_hex_decode(
+    svcx_string_view sv, void *out, size_t cap, size_t *len) {
+    SVCX_ASSERT(sv.data || sv.len == 0);
+    SVCX_ASSERT(out || cap == 0);
+    SVCX_ASSERT(len);
+
+    if (sv.len % 2 != 0) {
+        return SVCX_DECODE_INVALID_ERR;
+    }
+    size_t n = sv.len / 2;
+    if (n > cap) {
+        return SVCX_DECODE_SPACE_ERR;
+    }
+
+    uint8_t *dst = (uint8_t *)out;
+    size_t i = SVCX__SIMD_CALL(svcx__hex_decode, sv.data, sv.len, dst);
+    for (; i < sv.len; i += 2) {
+        int hi = svcx__hex_value((unsigned char)sv.data[i]);
+        int lo = svcx__hex_value((unsigned char)sv.data[i + 1]);
+        if (hi < 0 || lo < 0) {
+            return SVCX_DECODE_INVALID_ERR;
+        }
+        dst[i / 2] = (uint8_t)(hi << 4 | lo);
+    }
+    *len = n;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_hex_decode_vec(
+    svcx_string_view sv, svcx_vector *out) {
+    SVCX_ASSERT(out && out->stride == 1);
+
+    if (svcx_vector_reserve(out, out->size + sv.len / 2) != SVCX_OK) {
+        return SVCX_DECODE_ALLOC_ERR;
+    }
+    size_t n;
+    svcx_result r =
+        svcx_hex_decode(sv, (char *)out->data + out->size, sv.len / 2, &n);
+    if (r == SVCX_OK) {
+        out->size += n;
+    }
+    return r;
+}
+
+SVCXDEF svcx_result svcx_sb_append_base64(svcx_string_builder *sb,
+    const void *data,
+    size_t len,
+    svcx_base64_alphabet alphabet) {
+    SVCX_ASSERT(sb);
+    SVCX_ASSERT(data || len == 0);
+
+    bool url = alphabet == SVCX_BASE64_URL;
+    const char *chars = svcx__base64_alphabets[url];
+    size_t full = len / 3 * 3;
+    size_t rem = len - full;
+    size_t out_len = full / 3 * 4 + (rem == 0 ? 0 : url ? rem + 1 : 4);
+
+    char *dst = svcx__sb_reserve_tail(sb, out_len);
+    if (!dst) {
+        return SVCX_SB_ENCODE_RESERVE_ERR;
+    }
+    const uint8_t *src = (const uint8_t *)data;
+    size_t i = SVCX__AVX2_CALL(svcx__base64_encode, src, full, dst, url);
+    char *p = dst + i / 3 * 4;
+    for (; i < full; i += 3) {
+        uint32_t v = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 |
+                     src[i + 2];
+        p[0] = chars[v >> 18];
+        p[1] = chars[v >> 12 & 63];
+        p[2] = chars[v >> 6 & 63];
+        p[3] = chars[v & 63];
+        p += 4;
+    }
+    if (rem > 0) {
+        uint32_t v = (uint32_t)src[i] << 16 |
+                     (rem == 2 ? (uint32_t)src[i + 1] << 8 : 0);
+        *p++ = chars[v >> 18];
+        *p++ = chars[v >> 12 & 63];
+        if (rem == 2) {
+            *p++ = chars[v >> 6 & 63];
+        }
+        if (!url) {
+            *p++ = '=';
+            if (rem == 1) {
+                *p++ = '=';
+            }
+        }
+    }
+
+    sb->buf.size += out_len;
+    return svcx__sb_appended(sb);
+}
+
+// Finds the number of characters before the padding, rejecting lengths that
+// can not come out of the encoder.
+static bool svcx__base64_data_len(
+    svcx_string_view sv, svcx_base64_alphabet alphabet, size_t *chars) {
+    size_t n = sv.len;
+    if (alphabet == SVCX_BASE64_STD) {
+        if (n % 4 != 0) {
+            return false;
+        }
+        if (n > 0 && sv.data[n - 1] == '=') {
+            n -= 1 + (sv.data[n - 2] == '=');
+        }
+    }
+    *chars = n;
+    return n % 4 != 1;
+}
+
+SVCXDEF size_t svcx_base64_decoded_len(
+    svcx_string_view sv, svcx_base64_alphabet alphabet) {
+    size_t chars;
+    if (!svcx__base64_data_len(sv, alphabet, &chars)) {
+        return 0;
+    }
+    return chars / 4 * 3 + (chars % 4 ? chars % 4 - 1 : 0);
+}
+
+SVCXDEF svcx_result svcx_base64_decode(svcx_string_view sv,
+    svcx_base64_alphabet alphabet,
+    void *out,
+    size_t cap,
+    size_t *len) {
+    SVCX_ASSERT(sv.data || sv.len == 0);
+    SVCX_ASSERT(out || cap == 0);
+    SVCX_ASSERT(len);
+
+    size_t chars;
+    if (!svcx__base64_data_len(sv, alphabet, &chars)) {
+        return SVCX_DECODE_INVALID_ERR;
+    }
+    size_t n = chars / 4 * 3 + (chars % 4 ? chars % 4 - 1 : 0);
+    if (n > cap) {
+        return SVCX_DECODE_SPACE_ERR;
+    }
+
+    bool url = alphabet == SVCX_BASE64_URL;
+    const uint8_t *values = svcx__base64_values[url];
+    const unsigned char *src = (const unsigned char *)sv.data;
+    uint8_t *dst = (uint8_t *)out;
+    size_t full = chars / 4 * 4;
+
+    size_t i = SVCX__AVX2_CALL(svcx__base64_decode, sv.data, full, dst, n, url);
+    uint8_t *p = dst + i / 4 * 3;
+    for (; i < full; i += 4) {
+        uint32_t a = src[i] < 128 ? values[src[i]] : 0xFF;
+        uint32_t b = src[i + 1] < 128 ? values[src[i + 1]] : 0xFF;
+        uint32_t c = src[i + 2] < 128 ? values[src[i + 2]] : 0xFF;
+        uint32_t d = src[i + 3] < 128 ? values[src[i + 3]] : 0xFF;
+        if ((a | b | c | d) & 0x80) {
+            return SVCX_DECODE_INVALID_ERR;
+        }
+        uint32_t w = a << 18 | b << 12 | c << 6 | d;
+        p[0] = (uint8_t)(w >> 16);
+        p[1] = (uint8_t)(w >> 8);
+        p[2] = (uint8_t)w;
+        p += 3;
+    }
+
+    // A short final group must leave the unused low bits zero, so that every
+    // byte string has exactly one encoding.
+    size_t k = chars - full;
+    if (k > 0) {
+        uint32_t v[3] = {0, 0, 0};
+        uint32_t bad = 0;
+        for (size_t j = 0; j < k; j++) {
+            v[j] = src[i + j] < 128 ? values[src[i + j]] : 0xFF;
+            bad |= v[j];
+        }
+        if ((bad & 0x80) || (k == 2 && (v[1] & 0x0F)) ||
+            (k == 3 && (v[2] & 0x03))) {
+            return SVCX_DECODE_INVALID_ERR;
+        }
+        *p++ = (uint8_t)(v[0] << 2 | v[1] >> 4);
+        if (k == 3) {
+            *p = (uint8_t)(v[1] << 4 | v[2] >> 2);
+        }
+    }
+    *len = n;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_base64_decode_vec(svcx_string_view sv,
+    svcx_base64_alphabet alphabet,
+    svcx_vector *out) {
+    SVCX_ASSERT(out && out->stride == 1);
+
+    size_t cap = svcx_base64_decoded_len(sv, alphabet);
+    if (svcx_vector_reserve(out, out->size + cap) != SVCX_OK) {
+        return SVCX_DECODE_ALLOC_ERR;
+    }
+    size_t n;
+    svcx_result r = svcx_base64_decode(
+        sv, alphabet, (char *)out->data + out->size, cap, &n);
+    if (r == SVCX_OK) {
+        out->size += n;
+    }
+    return r;
 }
 
-SVCXDEF void *svcx__realloc(void *ctx, void *ptr, size_t size) {
-    SVCX_UNUSED(ctx);
-    return realloc(ptr, size);
+//
+// ASCII case. A byte is in the letter range [lo, lo + 25] when a signed
+// compare puts it above lo - 1 and below lo + 26, which bytes above 0x7F
+// never are, and converting or folding it flips (or sets) bit 0x20. The
+// scalar code does the same eight bytes at a time: adding to the low seven
+// bits of each byte carries into its top bit exactly when the byte is past
+// a bound, and never into the next byte.
+//
+
+// Returns the bit 0x20 of every ASCII byte of w in [lo, lo + 25].
+static uint64_t svcx__case_mask64(uint64_t w, unsigned char lo) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    uint64_t low7 = w & (0x7F * ones);
+    uint64_t ge = low7 + (uint64_t)(0x80 - lo) * ones;
+    uint64_t gt = low7 + (uint64_t)(0x7F - (lo + 25)) * ones;
+    return (ge & ~gt & ~w & (0x80 * ones)) >> 2;
 }
 
-SVCXDEF void svcx__free(void *ctx, void *ptr) {
-    SVCX_UNUSED(ctx);
-    free(ptr);
+static unsigned char svcx__lower(unsigned char c) {
+    return (unsigned)(c - 'A') < 26 ? (unsigned char)(c | 0x20) : c;
 }
 
-SVCXDEF svcx_allocator svcx_default_allocator(void) {
-    svcx_allocator a = {
-        .alloc = svcx__malloc,
-        .realloc = svcx__realloc,
-        .free = svcx__free,
-        .ctx = NULL,
-    };
-    return a;
+#ifdef SVCX__SSE2
+static __m128i svcx__case_mask_sse2(__m128i v, char lo) {
+    __m128i in = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((char)(lo - 1))),
+        _mm_cmplt_epi8(v, _mm_set1_epi8((char)(lo + 26))));
+    return _mm_and_si128(in, _mm_set1_epi8(0x20));
 }
 
-SVCXDEF void *svcx_alloc(svcx_allocator *a, size_t size) {
-    return a->alloc(a->ctx, size);
+static size_t svcx__eq_icase_sse2(const char *a, const char *b, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        x = _mm_or_si128(x, svcx__case_mask_sse2(x, 'A'));
+        y = _mm_or_si128(y, svcx__case_mask_sse2(y, 'A'));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) {
+            break;
+        }
+    }
+    return i;
 }
 
-SVCXDEF void *svcx_realloc(svcx_allocator *a, void *ptr, size_t size) {
-    return a->realloc(a->ctx, ptr, size);
+static size_t svcx__flip_case_sse2(
+    const char *src, char *dst, size_t len, char lo) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        v = _mm_xor_si128(v, svcx__case_mask_sse2(v, lo));
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+    return i;
+}
+#endif // SVCX__SSE2
+
+#ifdef SVCX__AVX2
+SVCX__AVX2_FN static __m256i svcx__case_mask_avx2(__m256i v, char lo) {
+    __m256i in = _mm256_andnot_si256(
+        _mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)(lo + 25))),
+        _mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)(lo - 1))));
+    return _mm256_and_si256(in, _mm256_set1_epi8(0x20));
 }
 
-SVCXDEF void svcx_free(svcx_allocator *a, void *ptr) { a->free(a->ctx, ptr); }
+SVCX__AVX2_FN static size_t svcx__eq_icase_avx2(
+    const char *a, const char *b, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        x = _mm256_or_si256(x, svcx__case_mask_avx2(x, 'A'));
+        y = _mm256_or_si256(y, svcx__case_mask_avx2(y, 'A'));
+        if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) !=
+            0xFFFFFFFF) {
+            break;
+        }
+    }
+    return i;
+}
 
-SVCXDEF bool svcx_allocator_is_valid(const svcx_allocator *a) {
-    return a && a->alloc && a->free;
+SVCX__AVX2_FN static size_t svcx__flip_case_avx2(
+    const char *src, char *dst, size_t len, char lo) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        v = _mm256_xor_si256(v, svcx__case_mask_avx2(v, lo));
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+    }
+    return i;
+}
+#endif // SVCX__AVX2
+
+static bool svcx__eq_icase(const char *a, const char *b, size_t len) {
+    size_t i = SVCX__SIMD_CALL(svcx__eq_icase, a, b, len);
+    for (; i + 8 <= len; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, sizeof(x));
+        memcpy(&y, b + i, sizeof(y));
+        if ((x | svcx__case_mask64(x, 'A')) !=
+            (y | svcx__case_mask64(y, 'A'))) {
+            return false;
+        }
+    }
+    for (; i < len; i++) {
+        if (svcx__lower((unsigned char)a[i]) !=
+            svcx__lower((unsigned char)b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Flips the case of the bytes of src in [lo, lo + 25] into dst, which may be
+// src itself.
+static void svcx__flip_case(
+    const char *src, char *dst, size_t len, unsigned char lo) {
+    size_t i = SVCX__SIMD_CALL(svcx__flip_case, src, dst, len, (char)lo);
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, src + i, sizeof(w));
+        w ^= svcx__case_mask64(w, lo);
+        memcpy(dst + i, &w, sizeof(w));
+    }
+    for (; i < len; i++) {
+        unsigned char c = (unsigned char)src[i];
+        dst[i] = (char)((unsigned)(c - lo) < 26 ? c ^ 0x20 : c);
+    }
+}
+
+#ifdef SVCX__SSE2
+static size_t svcx__sv_find_icase_sse2(
+    const char *h, size_t hlen, const char *n, size_t m) {
+    char f = (char)svcx__lower((unsigned char)n[0]);
+    char l = (char)svcx__lower((unsigned char)n[m - 1]);
+    const __m128i first = _mm_set1_epi8(f);
+    const __m128i last = _mm_set1_epi8(l);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= hlen; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(h + i + m - 1));
+        a = _mm_or_si128(a, svcx__case_mask_sse2(a, 'A'));
+        b = _mm_or_si128(b, svcx__case_mask_sse2(b, 'A'));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            size_t j = i + (size_t)svcx__ctz64(mask);
+            if (svcx__eq_icase(h + j, n, m)) {
+                return j;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return i;
+}
+#endif // SVCX__SSE2
+
+#ifdef SVCX__AVX2
+SVCX__AVX2_FN static size_t svcx__sv_find_icase_avx2(
+    const char *h, size_t hlen, const char *n, size_t m) {
+    char f = (char)svcx__lower((unsigned char)n[0]);
+    char l = (char)svcx__lower((unsigned char)n[m - 1]);
+    const __m256i first = _mm256_set1_epi8(f);
+    const __m256i last = _mm256_set1_epi8(l);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= hlen; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(h + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(h + i + m - 1));
+        a = _mm256_or_si256(a, svcx__case_mask_avx2(a, 'A'));
+        b = _mm256_or_si256(b, svcx__case_mask_avx2(b, 'A'));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask) {
+            size_t j = i + (size_t)_tzcnt_u32(mask);
+            if (svcx__eq_icase(h + j, n, m)) {
+                return j;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return i;
+}
+#endif // SVCX__AVX2
+
+SVCXDEF bool svcx_sv_eq_icase(svcx_string_view a, svcx_string_view b) {
+    return a.len == b.len && svcx__eq_icase(a.data, b.data, a.len);
+}
+
+SVCXDEF bool svcx_sv_starts_with_icase(
+    svcx_string_view sv, svcx_string_view prefix) {
+    return prefix.len <= sv.len &&
+           svcx__eq_icase(sv.data, prefix.data, prefix.len);
+}
+
+SVCXDEF bool svcx_sv_ends_with_icase(
+    svcx_string_view sv, svcx_string_view suffix) {
+    return suffix.len <= sv.len &&
+           svcx__eq_icase(
+               sv.data + (sv.len - suffix.len), suffix.data, suffix.len);
+}
+
+SVCXDEF size_t svcx_sv_find_icase(
+    svcx_string_view haystack, svcx_string_view needle) {
+    if (needle.len > haystack.len) {
+        return -1;
+    }
+    if (needle.len == 0) {
+        return 0;
+    }
+
+    const char *h = haystack.data;
+    const char *n = needle.data;
+    size_t m = needle.len;
+    unsigned char first = svcx__lower((unsigned char)n[0]);
+
+    size_t i = SVCX__SIMD_CALL(svcx__sv_find_icase, h, haystack.len, n, m);
+    for (; i <= haystack.len - m; i++) {
+        if (svcx__lower((unsigned char)h[i]) == first &&
+            svcx__eq_icase(h + i, n, m)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+SVCXDEF void svcx_ascii_lower(char *data, size_t len) {
+    SVCX_ASSERT(data || len == 0);
+    svcx__flip_case(data, data, len, 'A');
+}
+
+SVCXDEF void svcx_ascii_upper(char *data, size_t len) {
+    SVCX_ASSERT(data || len == 0);
+    svcx__flip_case(data, data, len, 'a');
+}
+
+static svcx_result svcx__sb_append_case(
+    svcx_string_builder *sb, svcx_string_view sv, unsigned char lo) {
+    SVCX_ASSERT(sb);
+    SVCX_ASSERT(sv.data || sv.len == 0);
+
+    char *dst = svcx__sb_reserve_tail(sb, sv.len);
+    if (!dst) {
+        return SVCX_SB_CASE_RESERVE_ERR;
+    }
+    svcx__flip_case(sv.data, dst, sv.len, lo);
+    sb->buf.size += sv.len;
+    return svcx__sb_appended(sb);
+}
+
+SVCXDEF svcx_result svcx_sb_append_lower(
+    svcx_string_builder *sb, svcx_string_view sv) {
+    return svcx__sb_append_case(sb, sv, 'A');
+}
+
+SVCXDEF svcx_result svcx_sb_append_upper(
+    svcx_string_builder *sb, svcx_string_view sv) {
+    return svcx__sb_append_case(sb, sv, 'a');
+}
+
+//
+// Templates. Literal operations point into the copy of the format text, and
+// the names vector holds the name of each named slot at its index.
+//
+static svcx_result svcx__tmpl_push(svcx_template *t,
+    svcx_tmpl_type type,
+    size_t slot,
+    size_t offset,
+    size_t len) {
+    if (type == SVCX_TMPL_LIT && len == 0) {
+        return SVCX_OK;
+    }
+    svcx_tmpl_op op = {type, (uint32_t)slot, (uint32_t)offset, (uint32_t)len};
+    if (svcx_vector_push(&t->ops, &op) != SVCX_OK) {
+        return SVCX_TMPL_ALLOC_ERR;
+    }
+    if (type == SVCX_TMPL_LIT) {
+        t->literal_len += len;
+    }
+    return SVCX_OK;
+}
+
+// Parses the hole that starts after the '{' at i, and pushes its operation.
+// Stores the index after the closing '}' into next.
+static svcx_result svcx__tmpl_hole(svcx_template *t,
+    size_t i,
+    size_t len,
+    bool *named,
+    bool *positional,
+    size_t *next) {
+    const char *text = t->text;
+    size_t start = i;
+    while (i < len && text[i] != '}' && text[i] != ':' && text[i] != '{') {
+        i++;
+    }
+    svcx_string_view name = svcx_sv_from_parts(text + start, i - start);
+
+    svcx_tmpl_type type = SVCX_TMPL_STR;
+    if (i < len && text[i] == ':') {
+        if (i + 2 >= len || text[i + 2] != '}') {
+            return SVCX_TMPL_SYNTAX_ERR;
+        }
+        switch (text[i + 1]) {
+        case 's':
+            type = SVCX_TMPL_STR;
+            break;
+        case 'i':
+            type = SVCX_TMPL_I64;
+            break;
+        case 'u':
+            type = SVCX_TMPL_U64;
+            break;
+        case 'x':
+            type = SVCX_TMPL_HEX;
+            break;
+        case 'f':
+            type = SVCX_TMPL_F64;
+            break;
+        default:
+            return SVCX_TMPL_SYNTAX_ERR;
+        }
+        i += 2;
+    }
+    if (i >= len || text[i] != '}') {
+        return SVCX_TMPL_SYNTAX_ERR;
+    }
+    *next = i + 1;
+
+    size_t slot;
+    bool is_index = name.len > 0;
+    for (size_t k = 0; k < name.len; k++) {
+        is_index &= svcx__is_digit(name.data[k]);
+    }
+    if (name.len == 0 || is_index) {
+        size_t n = 0;
+        for (size_t k = 0; k < name.len && n < UINT32_MAX; k++) {
+            n = n * 10 + (size_t)(name.data[k] - '0');
+        }
+        slot = name.len == 0 ? t->nslots : n;
+        if (*named || slot >= UINT32_MAX) {
+            return SVCX_TMPL_SYNTAX_ERR;
+        }
+        *positional = true;
+    } else {
+        slot = svcx_tmpl_slot(t, name);
+        if (*positional) {
+            return SVCX_TMPL_SYNTAX_ERR;
+        }
+        if (slot == (size_t)-1) {
+            slot = svcx_vector_size(&t->names);
+            if (svcx_vector_push(&t->names, &name) != SVCX_OK) {
+                return SVCX_TMPL_ALLOC_ERR;
+            }
+        }
+        *named = true;
+    }
+
+    if (slot + 1 > t->nslots) {
+        t->nslots = slot + 1;
+    }
+    return svcx__tmpl_push(t, type, slot, 0, 0);
+}
+
+SVCXDEF svcx_result svcx_tmpl_compile(
+    svcx_template *t, svcx_string_view fmt, svcx_allocator a) {
+    SVCX_ASSERT(t);
+    SVCX_ASSERT(fmt.data || fmt.len == 0);
+
+    t->a = a;
+    t->nslots = 0;
+    t->literal_len = 0;
+    svcx_vector_init(&t->ops, sizeof(svcx_tmpl_op), a);
+    svcx_vector_init(&t->names, sizeof(svcx_string_view), a);
+    t->text = NULL;
+    if (fmt.len >= UINT32_MAX) {
+        return SVCX_TMPL_SYNTAX_ERR;
+    }
+    t->text = (char *)svcx_alloc(&t->a, fmt.len + 1);
+    if (!t->text) {
+        return SVCX_TMPL_ALLOC_ERR;
+    }
+    if (fmt.len > 0) {
+        memcpy(t->text, fmt.data, fmt.len);
+    }
+
+    bool named = false;
+    bool positional = false;
+    size_t lit = 0;
+    size_t i = 0;
+    svcx_result r = SVCX_OK;
+    while (r == SVCX_OK && i < fmt.len) {
+        char c = t->text[i];
+        if (c != '{' && c != '}') {
+            i++;
+            continue;
+        }
+
+        bool escaped = i + 1 < fmt.len && t->text[i + 1] == c;
+        if (c == '}' && !escaped) {
+            r = SVCX_TMPL_SYNTAX_ERR;
+            break;
+        }
+        // An escaped brace ends the literal with one of the two braces.
+        r = svcx__tmpl_push(t, SVCX_TMPL_LIT, 0, lit, i - lit + escaped);
+        if (r == SVCX_OK && escaped) {
+            i += 2;
+        } else if (r == SVCX_OK) {
+            r = svcx__tmpl_hole(t, i + 1, fmt.len, &named, &positional, &i);
+        }
+        lit = i;
+    }
+    if (r == SVCX_OK) {
+        r = svcx__tmpl_push(t, SVCX_TMPL_LIT, 0, lit, fmt.len - lit);
+    }
+
+    if (r != SVCX_OK) {
+        svcx_tmpl_free(t);
+    }
+    return r;
+}
+
+SVCXDEF void svcx_tmpl_free(svcx_template *t) {
+    SVCX_ASSERT(t);
+
+    svcx_vector_free(&t->ops);
+    svcx_vector_free(&t->names);
+    if (t->text) {
+        svcx_free(&t->a, t->text);
+    }
+    t->text = NULL;
+    t->nslots = 0;
+    t->literal_len = 0;
+}
+
+SVCXDEF size_t svcx_tmpl_slot(const svcx_template *t, svcx_string_view name) {
+    SVCX_ASSERT(t);
+
+    const svcx_string_view *names = (const svcx_string_view *)t->names.data;
+    for (size_t i = 0; i < t->names.size; i++) {
+        if (names[i].len == name.len &&
+            memcmp(names[i].data, name.data, name.len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+SVCXDEF svcx_result svcx_tmpl_render(const svcx_template *t,
+    svcx_string_builder *sb,
+    const svcx_tmpl_arg *args) {
+    SVCX_ASSERT(t && sb);
+    SVCX_ASSERT(args || t->nslots == 0);
+
+    const svcx_tmpl_op *ops = (const svcx_tmpl_op *)t->ops.data;
+    size_t nops = t->ops.size;
+
+    // Strings have known lengths and numbers a known maximum, so one reserve
+    // covers the whole output and the loop below never grows the buffer.
+    size_t max = t->literal_len;
+    for (size_t i = 0; i < nops; i++) {
+        switch (ops[i].type) {
+        case SVCX_TMPL_LIT:
+            break;
+        case SVCX_TMPL_STR:
+            max += args[ops[i].slot].s.len;
+            break;
+        case SVCX_TMPL_F64:
+            max += 32;
+            break;
+        default:
+            max += 20;
+            break;
+        }
+    }
+    if (svcx_vector_reserve(&sb->buf, sb->buf.size + max) != SVCX_OK) {
+        return SVCX_TMPL_RENDER_ERR;
+    }
+
+    for (size_t i = 0; i < nops; i++) {
+        // Only holes have a slot, and args can be NULL without any.
+        char *p = (char *)sb->buf.data + sb->buf.size;
+        size_t slot = ops[i].slot;
+        switch (ops[i].type) {
+        case SVCX_TMPL_LIT:
+            memcpy(p, t->text + ops[i].offset, ops[i].len);
+            sb->buf.size += ops[i].len;
+            break;
+        case SVCX_TMPL_STR:
+            if (args[slot].s.len > 0) {
+                memcpy(p, args[slot].s.data, args[slot].s.len);
+                sb->buf.size += args[slot].s.len;
+            }
+            break;
+        case SVCX_TMPL_I64:
+            svcx_sb_append_i64(sb, args[slot].i);
+            break;
+        case SVCX_TMPL_U64:
+            svcx_sb_append_u64(sb, args[slot].u);
+            break;
+        case SVCX_TMPL_HEX:
+            svcx_sb_append_hex(sb, args[slot].u);
+            break;
+        case SVCX_TMPL_F64:
+            svcx_sb_append_f64(sb, args[slot].f);
+            break;
+        }
+    }
+    return svcx__sb_appended(sb);
+}
+
+//
+// Gather builder. Copies are bump allocated from the scratch blocks, so a
+// copy can be merged into the last slice whenever that slice ends exactly
+// where the next copy starts.
+//
+#define SVCX__GB_IOV_BATCH 64
+
+SVCXDEF void svcx_gb_init(svcx_gather_builder *gb, svcx_allocator a) {
+    SVCX_ASSERT(gb);
+    svcx_vector_init(&gb->parts, sizeof(svcx_string_view), a);
+    gb->blocks = NULL;
+    gb->bump = NULL;
+    gb->bump_left = 0;
+    gb->len = 0;
+    gb->copy_below = SVCX_GB_DEFAULT_COPY_BELOW;
+    gb->a = a;
+}
+
+SVCXDEF void svcx_gb_free(svcx_gather_builder *gb) {
+    SVCX_ASSERT(gb);
+    svcx_vector_free(&gb->parts);
+    svcx__block_free_all(&gb->a, gb->blocks);
+    gb->blocks = NULL;
+    gb->bump = NULL;
+    gb->bump_left = 0;
+    gb->len = 0;
+}
+
+SVCXDEF void svcx_gb_clear(svcx_gather_builder *gb) {
+    SVCX_ASSERT(gb);
+    svcx_vector_clear(&gb->parts);
+    // The current scratch block is kept and copied into from its start
+    // again, so a builder that is cleared and refilled does not allocate.
+    if (gb->blocks) {
+        svcx__block_free_all(&gb->a, gb->blocks->next);
+        gb->blocks->next = NULL;
+        gb->bump = (char *)(gb->blocks + 1);
+        gb->bump_left = gb->blocks->size;
+    }
+    gb->len = 0;
+}
+
+static svcx_result svcx__gb_push(
+    svcx_gather_builder *gb, const char *data, size_t len) {
+    svcx_string_view part = {.data = data, .len = len};
+    if (svcx_vector_push(&gb->parts, &part) != SVCX_OK) {
+        return SVCX_GB_ALLOC_ERR;
+    }
+    gb->len += len;
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_gb_append_copy(
+    svcx_gather_builder *gb, svcx_string_view sv) {
+    SVCX_ASSERT(gb);
+    if (sv.len == 0) {
+        return SVCX_OK;
+    }
+
+    if (gb->parts.size > 0 && sv.len <= gb->bump_left) {
+        svcx_string_view *last =
+            (svcx_string_view *)gb->parts.data + gb->parts.size - 1;
+        if (last->data + last->len == gb->bump) {
+            memcpy(gb->bump, sv.data, sv.len);
+            gb->bump += sv.len;
+            gb->bump_left -= sv.len;
+            last->len += sv.len;
+            gb->len += sv.len;
+            return SVCX_OK;
+        }
+    }
+
+    char *copy = (char *)svcx__block_alloc(
+        &gb->a, &gb->blocks, &gb->bump, &gb->bump_left, sv.len, 1);
+    if (!copy) {
+        return SVCX_GB_ALLOC_ERR;
+    }
+    memcpy(copy, sv.data, sv.len);
+    return svcx__gb_push(gb, copy, sv.len);
+}
+
+SVCXDEF svcx_result svcx_gb_append_sv(
+    svcx_gather_builder *gb, svcx_string_view sv) {
+    SVCX_ASSERT(gb);
+    // Empty slices are dropped even with a copy_below of 0, since a writev
+    // of nothing but empty slices would look like a failed write.
+    if (sv.len == 0) {
+        return SVCX_OK;
+    }
+    if (sv.len < gb->copy_below) {
+        return svcx_gb_append_copy(gb, sv);
+    }
+    return svcx__gb_push(gb, sv.data, sv.len);
+}
+
+SVCXDEF size_t svcx_gb_len(const svcx_gather_builder *gb) {
+    SVCX_ASSERT(gb);
+    return gb->len;
+}
+
+SVCXDEF svcx_result svcx_gb_flatten(
+    const svcx_gather_builder *gb, svcx_string_builder *sb) {
+    SVCX_ASSERT(gb && sb);
+    if (!sb->write &&
+        svcx_vector_reserve(&sb->buf, sb->buf.size + gb->len) != SVCX_OK) {
+        return SVCX_GB_ALLOC_ERR;
+    }
+
+    const svcx_string_view *parts = (const svcx_string_view *)gb->parts.data;
+    for (size_t i = 0; i < gb->parts.size; i++) {
+        svcx_result r = svcx_sb_append(sb, parts[i].data, parts[i].len);
+        if (r != SVCX_OK) {
+            return r;
+        }
+    }
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_gb_write(
+    const svcx_gather_builder *gb, svcx_sb_write_fn write, void *ctx) {
+    SVCX_ASSERT(gb && write);
+    const svcx_string_view *parts = (const svcx_string_view *)gb->parts.data;
+    for (size_t i = 0; i < gb->parts.size; i++) {
+        size_t done = 0;
+        while (done < parts[i].len) {
+            ptrdiff_t n =
+                write(ctx, parts[i].data + done, parts[i].len - done);
+            if (n <= 0) {
+                return SVCX_GB_WRITE_ERR;
+            }
+            done += (size_t)n;
+        }
+    }
+    return SVCX_OK;
+}
+
+SVCXDEF svcx_result svcx_gb_writev(const svcx_gather_builder *gb, int fd) {
+    SVCX_ASSERT(gb);
+#ifdef _WIN32
+    return svcx_gb_write(gb, svcx__sb_fd_write, (void *)(intptr_t)fd);
+#else
+    const svcx_string_view *parts = (const svcx_string_view *)gb->parts.data;
+    size_t nparts = gb->parts.size;
+    struct iovec iov[SVCX__GB_IOV_BATCH];
+
+    // Slice i is the first one not fully written, and skip is how much of it
+    // was written already.
+    size_t i = 0;
+    size_t skip = 0;
+    while (i < nparts) {
+        int n = 0;
+        for (size_t j = i; j < nparts && n < SVCX__GB_IOV_BATCH; j++, n++) {
+            size_t off = j == i ? skip : 0;
+            iov[n].iov_base = (void *)(parts[j].data + off);
+            iov[n].iov_len = parts[j].len - off;
+        }
+
+        ssize_t written = writev(fd, iov, n);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return SVCX_GB_WRITE_ERR;
+        }
+
+        size_t left = (size_t)written;
+        while (left > 0) {
+            size_t rest = parts[i].len - skip;
+            if (left < rest) {
+                skip += left;
+                break;
+            }
+            left -= rest;
+            skip = 0;
+            i++;
+        }
+    }
+    return SVCX_OK;
+#endif
+}
+
+//
+// Whole files. Sizes come from fstat, so a mapping or a read of a regular
+// file covers the file as it was when it was opened. Reads start from the
+// beginning of the file whatever the offset of the descriptor, as a mapping
+// does, and leave the offset at the end. Input of unknown size is gathered
+// in a scratch vector from the default allocator and copied into the final
+// allocation once its size is known, since allocators need not support
+// realloc.
+//
+#define SVCX__FILE_READ_CHUNK (64 * 1024)
+
+static ptrdiff_t svcx__fd_read(int fd, void *data, size_t len) {
+#ifdef _WIN32
+    return _read(fd, data, len > INT_MAX ? INT_MAX : (unsigned)len);
+#else
+    for (;;) {
+        ssize_t n = read(fd, data, len);
+        if (n >= 0 || errno != EINTR) {
+            return n;
+        }
+    }
+#endif
+}
+
+// Moves the offset of the descriptor back to the start of the file, which
+// fails for pipes and terminals.
+static bool svcx__fd_rewind(int fd) {
+#ifdef _WIN32
+    return _lseeki64(fd, 0, SEEK_SET) == 0;
+#else
+    return lseek(fd, 0, SEEK_SET) == 0;
+#endif
+}
+
+// Reads up to len bytes, stopping early only at the end of the file, and
+// returns how many were read, or -1.
+static ptrdiff_t svcx__fd_read_full(int fd, char *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ptrdiff_t n = svcx__fd_read(fd, data + done, len - done);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += (size_t)n;
+    }
+    return (ptrdiff_t)done;
+}
+
+static svcx_result svcx__file_read_sized(
+    svcx_mapped_file *f, int fd, size_t size) {
+    if (!svcx__fd_rewind(fd)) {
+        return SVCX_FILE_READ_ERR;
+    }
+    char *data = (char *)svcx_alloc(&f->a, size);
+    if (!data) {
+        return SVCX_FILE_ALLOC_ERR;
+    }
+    ptrdiff_t n = svcx__fd_read_full(fd, data, size);
+    if (n < 0) {
+        svcx_free(&f->a, data);
+        return SVCX_FILE_READ_ERR;
+    }
+    f->view = svcx_sv_from_parts(data, (size_t)n);
+    return SVCX_OK;
+}
+
+static svcx_result svcx__file_read_stream(svcx_mapped_file *f, int fd) {
+    // Input that cannot seek is read from where it is.
+    svcx__fd_rewind(fd);
+    svcx_vector scratch;
+    svcx_vector_init(&scratch, 1, svcx_default_allocator());
+    svcx_result r = SVCX_OK;
+    for (;;) {
+        size_t want = scratch.size + SVCX__FILE_READ_CHUNK;
+        if (svcx_vector_reserve(&scratch, want) != SVCX_OK) {
+            r = SVCX_FILE_ALLOC_ERR;
+            break;
+        }
+        ptrdiff_t n = svcx__fd_read(fd,
+            (char *)scratch.data + scratch.size,
+            scratch.cap - scratch.size);
+        if (n <= 0) {
+            r = n < 0 ? SVCX_FILE_READ_ERR : SVCX_OK;
+            break;
+        }
+        scratch.size += (size_t)n;
+    }
+
+    if (r == SVCX_OK && scratch.size > 0) {
+        char *data = (char *)svcx_alloc(&f->a, scratch.size);
+        if (data) {
+            memcpy(data, scratch.data, scratch.size);
+            f->view = svcx_sv_from_parts(data, scratch.size);
+        } else {
+            r = SVCX_FILE_ALLOC_ERR;
+        }
+    }
+    svcx_vector_free(&scratch);
+    return r;
+}
+
+SVCXDEF svcx_result svcx_file_map_fd(
+    svcx_mapped_file *f, int fd, svcx_allocator a) {
+    SVCX_ASSERT(f);
+
+    f->view = svcx_sv_from_parts(NULL, 0);
+    f->mapped = false;
+    f->a = a;
+
+#ifdef _WIN32
+    long long size = _filelengthi64(fd);
+    if (size > 0 && (unsigned long long)size <= SIZE_MAX) {
+        return svcx__file_read_sized(f, fd, (size_t)size);
+    }
+#else
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return SVCX_FILE_READ_ERR;
+    }
+    if (S_ISREG(st.st_mode) && st.st_size > 0 &&
+        (uint64_t)st.st_size <= SIZE_MAX) {
+        size_t size = (size_t)st.st_size;
+        void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            // The hints are only declared in POSIX modes of the C library,
+            // and the mapping works without them.
+#if defined(POSIX_MADV_SEQUENTIAL) && defined(POSIX_MADV_WILLNEED)
+            posix_madvise(addr, size, POSIX_MADV_SEQUENTIAL);
+            posix_madvise(addr, size, POSIX_MADV_WILLNEED);
+#endif
+            f->view = svcx_sv_from_parts((const char *)addr, size);
+            f->mapped = true;
+            return SVCX_OK;
+        }
+        return svcx__file_read_sized(f, fd, size);
+    }
+#endif
+    return svcx__file_read_stream(f, fd);
+}
+
+SVCXDEF svcx_result svcx_file_map(
+    svcx_mapped_file *f, const char *path, svcx_allocator a) {
+    SVCX_ASSERT(f);
+    SVCX_ASSERT(path);
+
+#ifdef _WIN32
+    int fd = _open(path, _O_RDONLY | _O_BINARY);
+#else
+    int fd = open(path, O_RDONLY);
+#endif
+    if (fd < 0) {
+        f->view = svcx_sv_from_parts(NULL, 0);
+        f->mapped = false;
+        f->a = a;
+        return SVCX_FILE_OPEN_ERR;
+    }
+    // A mapping stays valid after the descriptor is closed.
+    svcx_result r = svcx_file_map_fd(f, fd, a);
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+    return r;
 }
 
-SVCXDEF void *svcx_alloc_zero(svcx_allocator *a, size_t size) {
-    void *p = svcx_alloc(a, size);
-    if (p) {
-        memset(p, 0, size);
+SVCXDEF void svcx_file_unmap(svcx_mapped_file *f) {
+    SVCX_ASSERT(f);
+
+    if (f->mapped) {
+#ifndef _WIN32
+        munmap((void *)f->view.data, f->view.len);
+#endif
+    } else if (f->view.data) {
+        svcx_free(&f->a, (void *)f->view.data);
     }
-    return p;
+    f->view = svcx_sv_from_parts(NULL, 0);
+    f->mapped = false;
 }
 
-SVCXDEF svcx_allocator svcx_arena_allocator(svcx_arena *arena) {
-    svcx_allocator a = {.alloc = svcx_arena_alloc,
-        .realloc = svcx_arena_realloc,
-        .free = svcx_arena_free,
-        .ctx = arena};
-    return a;
-}
+//
+// Line reader. The bytes [start, end) of the buffer are unread, and there is
+// no '\n' in [start, scan), so a line that spans several reads is only
+// scanned once.
+//
 
-SVCXDEF void svcx_arena_init(svcx_arena *arena, size_t size) {
-    arena->base = malloc(size);
-    arena->size = size;
-    arena->used = 0;
+SVCXDEF svcx_result svcx_lr_init(
+    svcx_line_reader *lr, int fd, size_t buf_size, svcx_allocator a) {
+    SVCX_ASSERT(lr);
+
+    lr->cap = buf_size ? buf_size : SVCX_LR_DEFAULT_BUF_SIZE;
+    lr->start = 0;
+    lr->end = 0;
+    lr->scan = 0;
+    lr->fd = fd;
+    lr->eof = false;
+    lr->err = SVCX_OK;
+    lr->a = a;
+    lr->buf = (char *)svcx_alloc(&lr->a, lr->cap);
+    if (!lr->buf) {
+        lr->cap = 0;
+        lr->eof = true;
+        lr->err = SVCX_LR_ALLOC_ERR;
+        return SVCX_LR_ALLOC_ERR;
+    }
+    return SVCX_OK;
 }
 
-SVCXDEF void *svcx_arena_alloc(void *ctx, size_t size) {
-    svcx_arena *arena = (svcx_arena *)ctx;
+SVCXDEF void svcx_lr_free(svcx_line_reader *lr) {
+    SVCX_ASSERT(lr);
 
-    size = (size + 7) & ~7; // Align to 8 bytes
+    if (lr->buf) {
+        svcx_free(&lr->a, lr->buf);
+    }
+    lr->buf = NULL;
+    lr->cap = 0;
+    lr->start = 0;
+    lr->end = 0;
+    lr->scan = 0;
+}
 
-    if (arena->used + size > arena->size) {
-        return NULL;
+SVCXDEF bool svcx_lr_next(svcx_line_reader *lr, svcx_string_view *line) {
+    SVCX_ASSERT(lr);
+    SVCX_ASSERT(line);
+
+    if (lr->err != SVCX_OK) {
+        return false;
     }
+    for (;;) {
+        char *buf = lr->buf;
+        size_t scan = lr->scan;
+        size_t nl = scan + svcx__find_char(buf + scan, lr->end - scan, '\n');
+        if (nl < lr->end) {
+            size_t len = nl - lr->start;
+            if (len > 0 && buf[nl - 1] == '\r') {
+                len--;
+            }
+            *line = svcx_sv_from_parts(buf + lr->start, len);
+            lr->start = nl + 1;
+            lr->scan = lr->start;
+            return true;
+        }
+        lr->scan = lr->end;
 
-    void *ptr = arena->base + arena->used;
-    arena->used += size;
-    return ptr;
-}
+        if (lr->eof) {
+            if (lr->start == lr->end) {
+                return false;
+            }
+            *line = svcx_sv_from_parts(buf + lr->start, lr->end - lr->start);
+            lr->start = lr->end;
+            return true;
+        }
 
-SVCXDEF void *svcx_arena_realloc(void *ctx, void *ptr, size_t size) {
-    SVCX_UNSUPPORTED("Reallocation is not supported in arenas.");
-    SVCX_UNUSED(ctx);
-    SVCX_UNUSED(ptr);
-    SVCX_UNUSED(size);
-    return NULL;
+        if (lr->start > 0) {
+            size_t rest = lr->end - lr->start;
+            memmove(buf, buf + lr->start, rest);
+            lr->start = 0;
+            lr->end = rest;
+            lr->scan = rest;
+        }
+        if (lr->end == lr->cap) {
+            lr->err = SVCX_LR_LINE_TOO_LONG_ERR;
+            return false;
+        }
+        ptrdiff_t n = svcx__fd_read(lr->fd, buf + lr->end, lr->cap - lr->end);
+        if (n < 0) {
+            lr->err = SVCX_LR_READ_ERR;
+            return false;
+        }
+        lr->eof = n == 0;
+        lr->end += (size_t)n;
+    }
 }
 
-SVCXDEF void svcx_arena_free(void *ctx, void *ptr) {
-    SVCX_UNUSED(ctx);
-    SVCX_UNUSED(ptr);
-    // A free in an arena is a no-op
-}
+//
+// Aho-Corasick automaton. State 0 is the root, and since empty patterns are
+// not allowed it never has an output, so 0 doubles as the "no state" value
+// of the dict links. The out array holds the first pattern ending in each
+// state and pattern_next chains duplicates of it.
+//
+#define SVCX__AC_NONE UINT32_MAX
+
+SVCXDEF svcx_result svcx_ac_init(
+    svcx_aho_corasick *ac, const svcx_vector *patterns, svcx_allocator a) {
+    SVCX_ASSERT(ac);
+    SVCX_ASSERT(patterns && patterns->stride == sizeof(svcx_string_view));
+
+    memset(ac, 0, sizeof(*ac));
+    ac->a = a;
+
+    const svcx_string_view *pats = (const svcx_string_view *)patterns->data;
+    size_t npatterns = patterns->size;
+    size_t max_states = 1;
+    bool used[256] = {false};
+    bool starts[256] = {false};
+    for (size_t i = 0; i < npatterns; i++) {
+        if (pats[i].len == 0) {
+            return SVCX_AC_EMPTY_PATTERN_ERR;
+        }
+        if (pats[i].len >= UINT32_MAX - max_states) {
+            return SVCX_AC_ALLOC_ERR;
+        }
+        max_states += pats[i].len;
+        starts[(unsigned char)pats[i].data[0]] = true;
+        for (size_t j = 0; j < pats[i].len; j++) {
+            used[(unsigned char)pats[i].data[j]] = true;
+        }
+    }
 
-SVCXDEF void svcx_arena_reset(svcx_arena *arena) { arena->used = 0; }
+    size_t nclasses = 1;
+    for (int c = 0; c < 256; c++) {
+        ac->classes[c] = used[c] ? (uint16_t)nclasses++ : 0;
+        if (starts[c]) {
+            if (ac->nstart < 3) {
+                ac->start_bytes[ac->nstart] = (unsigned char)c;
+            }
+            ac->nstart++;
+        }
+    }
+    if (ac->nstart > 3) {
+        ac->nstart = 0;
+    }
 
-SVCXDEF void svcx_arena_free_all(svcx_arena *arena) {
-    free(arena->base);
-    arena->size = 0;
-    arena->used = 0;
-}
+    size_t words = max_states * (nclasses + 2) + 2 * npatterns;
+    uint32_t *mem =
+        (uint32_t *)svcx_alloc_zero(&ac->a, words * sizeof(uint32_t));
+    uint32_t *queue = (uint32_t *)svcx_alloc(
+        &ac->a, 2 * max_states * sizeof(uint32_t));
+    if (!mem || !queue) {
+        if (mem) {
+            svcx_free(&ac->a, mem);
+        }
+        if (queue) {
+            svcx_free(&ac->a, queue);
+        }
+        return SVCX_AC_ALLOC_ERR;
+    }
 
-SVCXDEF svcx_result _svcx_vector_grow(svcx_vector *v, size_t min_cap) {
-    size_t new_cap = v->cap ? v->cap * 2 : 8;
-    if (new_cap < min_cap) {
-        new_cap = min_cap;
+    ac->trans = mem;
+    ac->out = ac->trans + max_states * nclasses;
+    ac->dict = ac->out + max_states;
+    ac->pattern_next = ac->dict + max_states;
+    ac->pattern_len = ac->pattern_next + npatterns;
+    ac->nclasses = nclasses;
+    ac->npatterns = npatterns;
+
+    // Build the trie. Transitions to state 0 mean "no child" for now.
+    size_t nstates = 1;
+    for (size_t s = 0; s < max_states; s++) {
+        ac->out[s] = SVCX__AC_NONE;
+    }
+    for (size_t i = 0; i < npatterns; i++) {
+        uint32_t s = 0;
+        for (size_t j = 0; j < pats[i].len; j++) {
+            uint16_t c = ac->classes[(unsigned char)pats[i].data[j]];
+            uint32_t *t = &ac->trans[s * nclasses + c];
+            if (*t == 0) {
+                *t = (uint32_t)nstates++;
+            }
+            s = *t;
+        }
+        ac->pattern_len[i] = (uint32_t)pats[i].len;
+        ac->pattern_next[i] = ac->out[s];
+        ac->out[s] = (uint32_t)i;
+    }
+    ac->nstates = nstates;
+
+    // Compute the failure links breadth first and fill the missing
+    // transitions from them, turning the trie into a complete automaton.
+    uint32_t *fail = queue + max_states;
+    size_t head = 0, tail = 0;
+    for (size_t c = 0; c < nclasses; c++) {
+        uint32_t t = ac->trans[c];
+        if (t) {
+            fail[t] = 0;
+            ac->dict[t] = 0;
+            queue[tail++] = t;
+        }
+    }
+    while (head < tail) {
+        uint32_t s = queue[head++];
+        uint32_t *row = &ac->trans[s * nclasses];
+        const uint32_t *fail_row = &ac->trans[fail[s] * nclasses];
+        for (size_t c = 0; c < nclasses; c++) {
+            uint32_t t = row[c];
+            if (!t) {
+                row[c] = fail_row[c];
+                continue;
+            }
+            uint32_t f = fail_row[c];
+            fail[t] = f;
+            ac->dict[t] = ac->out[f] != SVCX__AC_NONE ? f : ac->dict[f];
+            queue[tail++] = t;
+        }
     }
 
-    // We cannot use svcx_realloc here in case the user uses an allocator
-    // that does not support realloc (like arena).
-    // void *new_data = svcx_realloc(&v->a, v->data, new_cap * v->stride);
+    svcx_free(&ac->a, queue);
+    return SVCX_OK;
+}
 
-    size_t new_size = new_cap * v->stride;
-    void *new_data;
-    if (v->data) {
-        new_data = svcx_alloc(&v->a, new_size);
-        if (!new_data) {
-            return SVCX_VEC_GROW_MEM_ERR;
+// Runs the automaton from the given state and position until the next state
+// with an output, which is returned along with the position after the byte
+// that led to it. Returns 0 at the end of the text.
+static uint32_t svcx__ac_step(
+    const svcx_aho_corasick *ac, svcx_string_view text, uint32_t s, size_t *i) {
+    const unsigned char *p = (const unsigned char *)text.data;
+    size_t pos = *i;
+    while (pos < text.len) {
+        if (s == 0 && ac->nstart) {
+            pos += SVCX__SIMD_CALL(svcx__find_byte3,
+                text.data + pos,
+                text.len - pos,
+                ac->start_bytes,
+                ac->nstart);
+            if (pos == text.len) {
+                break;
+            }
         }
 
-        memcpy(new_data, v->data, v->size * v->stride);
-    } else {
-        new_data = svcx_alloc(&v->a, new_size);
-        if (!new_data) {
-            return SVCX_VEC_GROW_MEM_ERR;
+        s = ac->trans[s * ac->nclasses + ac->classes[p[pos++]]];
+        if (ac->out[s] != SVCX__AC_NONE || ac->dict[s]) {
+            *i = pos;
+            return s;
         }
     }
+    *i = text.len;
+    return 0;
+}
+
+SVCXDEF bool svcx_ac_find_first(const svcx_aho_corasick *ac,
+    svcx_string_view text,
+    svcx_ac_match *match) {
+    SVCX_ASSERT(ac);
+
+    size_t end = 0;
+    uint32_t s = svcx__ac_step(ac, text, 0, &end);
+    if (s == 0) {
+        return false;
+    }
 
-    v->data = new_data;
-    v->cap = new_cap;
+    if (match) {
+        uint32_t r = ac->out[s] != SVCX__AC_NONE ? s : ac->dict[s];
+        match->pattern = ac->out[r];
+        match->end = end;
+        match->start = end - ac->pattern_len[match->pattern];
+    }
+    return true;
+}
+
+SVCXDEF svcx_result svcx_ac_find_all(
+    const svcx_aho_corasick *ac, svcx_string_view text, svcx_vector *out) {
+    SVCX_ASSERT(ac);
+    SVCX_ASSERT(out && out->stride == sizeof(svcx_ac_match));
+
+    size_t end = 0;
+    uint32_t s = 0;
+    while ((s = svcx__ac_step(ac, text, s, &end)) != 0) {
+        uint32_t r = ac->out[s] != SVCX__AC_NONE ? s : ac->dict[s];
+        for (; r != 0; r = ac->dict[r]) {
+            for (uint32_t id = ac->out[r]; id != SVCX__AC_NONE;
+                 id = ac->pattern_next[id]) {
+                svcx_ac_match m = {id, end - ac->pattern_len[id], end};
+                if (svcx_vector_push(out, &m) != SVCX_OK) {
+                    return SVCX_AC_PUSH_ERR;
+                }
+            }
+        }
+    }
     return SVCX_OK;
 }
 
-SVCXDEF void svcx_vector_init(svcx_vector *v, size_t stride, svcx_allocator a) {
-    v->data = NULL;
-    v->size = 0;
-    v->cap = 0;
-    v->stride = stride;
-    v->a = a;
+SVCXDEF void svcx_ac_free(svcx_aho_corasick *ac) {
+    SVCX_ASSERT(ac);
+
+    if (ac->trans) {
+        svcx_free(&ac->a, ac->trans);
+    }
+    ac->trans = NULL;
+    ac->out = NULL;
+    ac->dict = NULL;
+    ac->pattern_next = NULL;
+    ac->pattern_len = NULL;
+    ac->nstates = 0;
+    ac->npatterns = 0;
 }
 
-SVCXDEF void svcx_vector_clear(svcx_vector *v) {
-    SVCX_ASSERT(v);
-    v->size = 0;
+#define SVCX__ROARING_ARRAY_MAX 4096
+#define SVCX__ROARING_WORDS 1024
+
+static svcx_roaring_container *svcx__roaring_at(
+    const svcx_roaring *r, size_t index) {
+    return (svcx_roaring_container *)r->containers.data + index;
 }
 
-SVCXDEF svcx_result svcx_vector_reserve(svcx_vector *v, size_t min_cap) {
-    if (min_cap <= v->cap) {
-        return SVCX_OK;
+// Binary searches for the container with the given key. Returns true if it
+// exists, and stores either its index or the index to insert it at.
+static bool svcx__roaring_find(
+    const svcx_roaring *r, uint16_t key, size_t *index) {
+    size_t lo = 0;
+    size_t hi = r->containers.size;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (svcx__roaring_at(r, mid)->key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
+    *index = lo;
+    return lo < r->containers.size && svcx__roaring_at(r, lo)->key == key;
+}
 
-    size_t new_cap = v->cap ? v->cap : 8;
+static size_t svcx__u16_lower_bound(
+    const uint16_t *values, size_t n, uint16_t value) {
+    size_t lo = 0;
+    size_t hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (values[mid] < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
 
-    while (new_cap < min_cap) {
-        new_cap *= 2;
+// Sets the bits [first, last] of a container bitmap.
+static void svcx__bitmap_set_range(
+    uint64_t *words, uint32_t first, uint32_t last) {
+    size_t fw = first / 64;
+    size_t lw = last / 64;
+    uint64_t fmask = ~(uint64_t)0 << (first % 64);
+    uint64_t lmask = ~(uint64_t)0 >> (63 - last % 64);
+
+    if (fw == lw) {
+        words[fw] |= fmask & lmask;
+        return;
+    }
+    words[fw] |= fmask;
+    for (size_t w = fw + 1; w < lw; w++) {
+        words[w] = ~(uint64_t)0;
     }
+    words[lw] |= lmask;
+}
 
-    size_t new_size_bytes = new_cap * v->stride;
+static void svcx__roaring_container_free(
+    svcx_allocator *a, svcx_roaring_container *c) {
+    if (c->data) {
+        svcx_free(a, c->data);
+    }
+    c->data = NULL;
+    c->card = 0;
+    c->len = 0;
+    c->cap = 0;
+}
 
-    void *new_data = svcx_alloc(&v->a, new_size_bytes);
-    if (!new_data) {
-        return SVCX_VEC_ERR_OOM;
+static bool svcx__roaring_container_contains(
+    const svcx_roaring_container *c, uint16_t low) {
+    switch (c->kind) {
+    case SVCX_ROARING_ARRAY: {
+        const uint16_t *values = (const uint16_t *)c->data;
+        size_t i = svcx__u16_lower_bound(values, c->len, low);
+        return i < c->len && values[i] == low;
+    }
+    case SVCX_ROARING_BITMAP:
+        return (((const uint64_t *)c->data)[low / 64] >> (low % 64)) & 1;
+    default: {
+        // Find the last run starting at or before low.
+        const svcx_roaring_run *runs = (const svcx_roaring_run *)c->data;
+        size_t lo = 0;
+        size_t hi = c->len;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (runs[mid].start <= low) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo > 0 && (uint32_t)(low - runs[lo - 1].start) <=
+                             (uint32_t)runs[lo - 1].length;
     }
+    }
+}
 
-    if (v->data && v->size > 0) {
-        memcpy(new_data, v->data, v->size * v->stride);
+static svcx_result svcx__roaring_array_to_bitmap(
+    svcx_allocator *a, svcx_roaring_container *c) {
+    uint64_t *words =
+        (uint64_t *)svcx_alloc_zero(a, SVCX__ROARING_WORDS * sizeof(uint64_t));
+    if (!words) {
+        return SVCX_ROARING_ALLOC_ERR;
     }
 
-    if (v->data) {
-        svcx_free(&v->a, v->data);
+    const uint16_t *values = (const uint16_t *)c->data;
+    for (uint32_t i = 0; i < c->len; i++) {
+        words[values[i] / 64] |= (uint64_t)1 << (values[i] % 64);
     }
 
-    v->data = new_data;
-    v->cap = new_cap;
+    uint32_t card = c->card;
+    svcx__roaring_container_free(a, c);
+    c->data = words;
+    c->kind = SVCX_ROARING_BITMAP;
+    c->card = card;
+    c->len = SVCX__ROARING_WORDS;
+    c->cap = SVCX__ROARING_WORDS;
     return SVCX_OK;
 }
 
-SVCXDEF svcx_result svcx_vector_push(svcx_vector *v, const void *elem) {
-    SVCX_ASSERT(v);
+static svcx_result svcx__roaring_bitmap_to_array(
+    svcx_allocator *a, svcx_roaring_container *c) {
+    uint16_t *values = (uint16_t *)svcx_alloc(
+        a, (c->card ? c->card : 1) * sizeof(uint16_t));
+    if (!values) {
+        return SVCX_ROARING_ALLOC_ERR;
+    }
 
-    if (v->size == v->cap) {
-        int err = _svcx_vector_grow(v, v->size + 1);
-        if (err != 0) {
-            return SVCX_VEC_PUSH_GROW_ERR;
+    const uint64_t *words = (const uint64_t *)c->data;
+    uint32_t n = 0;
+    for (uint32_t w = 0; w < SVCX__ROARING_WORDS; w++) {
+        uint64_t word = words[w];
+        while (word) {
+            values[n++] = (uint16_t)(w * 64 + (uint32_t)svcx__ctz64(word));
+            word &= word - 1;
         }
     }
 
-    void *dst = (char *)v->data + v->size * v->stride;
-    memcpy(dst, elem, v->stride);
-    v->size++;
+    svcx__roaring_container_free(a, c);
+    c->data = values;
+    c->kind = SVCX_ROARING_ARRAY;
+    c->card = n;
+    c->len = n;
+    c->cap = n ? n : 1;
     return SVCX_OK;
 }
 
-SVCXDEF svcx_result svcx_vector_pop(svcx_vector *v, void *out_elem) {
-    SVCX_ASSERT(v);
+// Expands a run container into an array or bitmap container, whichever fits
+// its cardinality.
+static svcx_result svcx__roaring_run_expand(
+    svcx_allocator *a, svcx_roaring_container *c) {
+    const svcx_roaring_run *runs = (const svcx_roaring_run *)c->data;
+    void *data;
 
-    if (v->size == 0) {
-        return SVCX_VEC_POP_EMPTY_ERR;
+    if (c->card <= SVCX__ROARING_ARRAY_MAX) {
+        uint16_t *values = (uint16_t *)svcx_alloc(
+            a, (c->card ? c->card : 1) * sizeof(uint16_t));
+        if (!values) {
+            return SVCX_ROARING_ALLOC_ERR;
+        }
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < c->len; i++) {
+            for (uint32_t v = 0; v <= runs[i].length; v++) {
+                values[n++] = (uint16_t)(runs[i].start + v);
+            }
+        }
+        data = values;
+    } else {
+        uint64_t *words = (uint64_t *)svcx_alloc_zero(
+            a, SVCX__ROARING_WORDS * sizeof(uint64_t));
+        if (!words) {
+            return SVCX_ROARING_ALLOC_ERR;
+        }
+        for (uint32_t i = 0; i < c->len; i++) {
+            svcx__bitmap_set_range(words,
+                runs[i].start,
+                (uint32_t)runs[i].start + runs[i].length);
+        }
+        data = words;
     }
 
-    v->size--;
-
-    if (out_elem) {
-        void *src = (char *)v->data + v->size * v->stride;
-        memcpy(out_elem, src, v->stride);
+    uint32_t card = c->card;
+    svcx__roaring_container_free(a, c);
+    c->data = data;
+    c->card = card;
+    if (card <= SVCX__ROARING_ARRAY_MAX) {
+        c->kind = SVCX_ROARING_ARRAY;
+        c->len = card;
+        c->cap = card ? card : 1;
+    } else {
+        c->kind = SVCX_ROARING_BITMAP;
+        c->len = SVCX__ROARING_WORDS;
+        c->cap = SVCX__ROARING_WORDS;
     }
-
     return SVCX_OK;
 }
 
-SVCXDEF void *svcx_vector_at(svcx_vector *v, size_t index) {
-    SVCX_ASSERT(v);
-
-    if (index >= v->size) {
-        return NULL;
-    }
+static void svcx__roaring_remove_at(svcx_roaring *r, size_t index) {
+    svcx__roaring_container_free(
+        &r->containers.a, svcx__roaring_at(r, index));
+    memmove(svcx__roaring_at(r, index),
+        svcx__roaring_at(r, index + 1),
+        (r->containers.size - index - 1) * sizeof(svcx_roaring_container));
+    r->containers.size--;
+}
 
-    return (char *)v->data + index * v->stride;
+SVCXDEF void svcx_roaring_init(svcx_roaring *r, svcx_allocator a) {
+    svcx_vector_init(&r->containers, sizeof(svcx_roaring_container), a);
 }
 
-SVCXDEF svcx_result svcx_vector_insert(
-    svcx_vector *v, size_t index, const void *elem) {
-    SVCX_ASSERT(v);
-    if (index > v->size) {
-        return SVCX_VEC_INSERT_OOB;
+SVCXDEF void svcx_roaring_clear(svcx_roaring *r) {
+    SVCX_ASSERT(r);
+
+    for (size_t i = 0; i < r->containers.size; i++) {
+        svcx__roaring_container_free(
+            &r->containers.a, svcx__roaring_at(r, i));
     }
+    svcx_vector_clear(&r->containers);
+}
 
-    if (v->size == v->cap) {
-        int err = _svcx_vector_grow(v, v->size + 1);
-        if (err != 0) {
-            return SVCX_VEC_INSERT_GROW_ERR;
+SVCXDEF void svcx_roaring_free(svcx_roaring *r) {
+    svcx_roaring_clear(r);
+    svcx_vector_free(&r->containers);
+}
+
+SVCXDEF svcx_result svcx_roaring_add(svcx_roaring *r, uint32_t value) {
+    SVCX_ASSERT(r);
+
+    uint16_t key = (uint16_t)(value >> 16);
+    uint16_t low = (uint16_t)value;
+    svcx_allocator *a = &r->containers.a;
+
+    size_t index;
+    if (!svcx__roaring_find(r, key, &index)) {
+        svcx_roaring_container c = {0};
+        c.key = key;
+        c.kind = SVCX_ROARING_ARRAY;
+        c.cap = 4;
+        c.data = svcx_alloc(a, c.cap * sizeof(uint16_t));
+        if (!c.data) {
+            return SVCX_ROARING_ALLOC_ERR;
+        }
+        if (svcx_vector_insert(&r->containers, index, &c) != SVCX_OK) {
+            svcx_free(a, c.data);
+            return SVCX_ROARING_ALLOC_ERR;
         }
     }
 
-    void *dst = (char *)v->data + index * v->stride;
-    memmove((char *)dst + v->stride, dst, (v->size - index) * v->stride);
+    svcx_roaring_container *c = svcx__roaring_at(r, index);
 
-    memcpy(dst, elem, v->stride);
-    v->size++;
-    return SVCX_OK;
-}
+    if (c->kind == SVCX_ROARING_RUN) {
+        if (svcx__roaring_container_contains(c, low)) {
+            return SVCX_OK;
+        }
+        svcx_result res = svcx__roaring_run_expand(a, c);
+        if (res != SVCX_OK) {
+            return res;
+        }
+    }
 
-SVCXDEF svcx_result svcx_vector_append(
-    svcx_vector *dst, const svcx_vector *src) {
-    SVCX_ASSERT(dst);
-    SVCX_ASSERT(src);
+    if (c->kind == SVCX_ROARING_ARRAY) {
+        uint16_t *values = (uint16_t *)c->data;
+        size_t pos = svcx__u16_lower_bound(values, c->len, low);
+        if (pos < c->len && values[pos] == low) {
+            return SVCX_OK;
+        }
 
-    if (dst->stride != src->stride) {
-        return SVCX_VEC_APPEND_STRIDE_ERR;
-    }
+        if (c->len < SVCX__ROARING_ARRAY_MAX) {
+            if (c->len == c->cap) {
+                uint32_t new_cap = c->cap * 2;
+                if (new_cap > SVCX__ROARING_ARRAY_MAX) {
+                    new_cap = SVCX__ROARING_ARRAY_MAX;
+                }
+                uint16_t *grown =
+                    (uint16_t *)svcx_alloc(a, new_cap * sizeof(uint16_t));
+                if (!grown) {
+                    return SVCX_ROARING_ALLOC_ERR;
+                }
+                memcpy(grown, values, c->len * sizeof(uint16_t));
+                svcx_free(a, values);
+                c->data = values = grown;
+                c->cap = new_cap;
+            }
 
-    size_t new_size = dst->size + src->size;
+            memmove(values + pos + 1,
+                values + pos,
+                (c->len - pos) * sizeof(uint16_t));
+            values[pos] = low;
+            c->len++;
+            c->card++;
+            return SVCX_OK;
+        }
 
-    if (new_size > dst->cap) {
-        int err = _svcx_vector_grow(dst, new_size);
-        if (err != 0) {
-            return SVCX_VEC_APPEND_GROW_ERR;
+        svcx_result res = svcx__roaring_array_to_bitmap(a, c);
+        if (res != SVCX_OK) {
+            return res;
         }
     }
 
-    memcpy((char *)dst->data + dst->size * dst->stride,
-        src->data,
-        src->size * src->stride);
-    dst->size = new_size;
+    uint64_t *words = (uint64_t *)c->data;
+    uint64_t bit = (uint64_t)1 << (low % 64);
+    if (!(words[low / 64] & bit)) {
+        words[low / 64] |= bit;
+        c->card++;
+    }
     return SVCX_OK;
 }
 
-SVCXDEF svcx_result svcx_vector_from_array(svcx_vector *v,
-    const void *array,
-    size_t count,
-    size_t stride,
-    svcx_allocator a) {
-    svcx_vector_init(v, stride, a);
+SVCXDEF svcx_result svcx_roaring_remove(svcx_roaring *r, uint32_t value) {
+    SVCX_ASSERT(r);
 
-    if (count == 0) {
-        return 0;
+    uint16_t low = (uint16_t)value;
+    svcx_allocator *a = &r->containers.a;
+
+    size_t index;
+    if (!svcx__roaring_find(r, (uint16_t)(value >> 16), &index)) {
+        return SVCX_OK;
     }
 
-    v->data = (void *)svcx_alloc(&v->a, count * stride);
-    if (!v->data) {
-        return SVCX_VEC_FROM_ARR_MALLOC_ERR;
+    svcx_roaring_container *c = svcx__roaring_at(r, index);
+    if (!svcx__roaring_container_contains(c, low)) {
+        return SVCX_OK;
+    }
+
+    if (c->kind == SVCX_ROARING_RUN) {
+        svcx_result res = svcx__roaring_run_expand(a, c);
+        if (res != SVCX_OK) {
+            return res;
+        }
+    }
+
+    if (c->kind == SVCX_ROARING_ARRAY) {
+        uint16_t *values = (uint16_t *)c->data;
+        size_t pos = svcx__u16_lower_bound(values, c->len, low);
+        memmove(values + pos,
+            values + pos + 1,
+            (c->len - pos - 1) * sizeof(uint16_t));
+        c->len--;
+        c->card--;
+    } else {
+        ((uint64_t *)c->data)[low / 64] &= ~((uint64_t)1 << (low % 64));
+        c->card--;
+        if (c->card <= SVCX__ROARING_ARRAY_MAX) {
+            // A failed conversion leaves a valid (if oversized) bitmap.
+            svcx__roaring_bitmap_to_array(a, c);
+        }
     }
 
-    memcpy(v->data, array, count * stride);
-    v->size = count;
-    v->cap = count;
+    if (c->card == 0) {
+        svcx__roaring_remove_at(r, index);
+    }
     return SVCX_OK;
 }
 
-SVCXDEF void svcx_vector_free(svcx_vector *v) {
-    SVCX_ASSERT(v);
+SVCXDEF bool svcx_roaring_contains(const svcx_roaring *r, uint32_t value) {
+    SVCX_ASSERT(r);
 
-    if (v->data) {
-        svcx_free(&v->a, v->data);
+    size_t index;
+    if (!svcx__roaring_find(r, (uint16_t)(value >> 16), &index)) {
+        return false;
     }
-
-    v->data = NULL;
-    v->size = 0;
-    v->cap = 0;
+    return svcx__roaring_container_contains(
+        svcx__roaring_at(r, index), (uint16_t)value);
 }
 
-SVCXDEF size_t svcx_vector_size(svcx_vector *v) {
-    SVCX_ASSERT(v);
-    return v->size;
+SVCXDEF uint64_t svcx_roaring_cardinality(const svcx_roaring *r) {
+    SVCX_ASSERT(r);
+
+    uint64_t card = 0;
+    for (size_t i = 0; i < r->containers.size; i++) {
+        card += svcx__roaring_at(r, i)->card;
+    }
+    return card;
 }
 
-SVCXDEF svcx_string_view svcx_sv_from_parts(const char *data, size_t size) {
-    svcx_string_view sv;
-    sv.data = data;
-    sv.len = size;
-    return sv;
+//
+// Internal container set operations. Run containers are materialized into a
+// scratch bitmap first, so only the array and bitmap combinations need
+// dedicated code. The results are normalized, meaning bitmaps with a
+// cardinality of at most 4096 are converted to arrays, and empty results
+// have a cardinality of 0 and no data.
+//
+typedef struct svcx__roaring_view {
+    const uint16_t *array;
+    const uint64_t *bitmap;
+    uint32_t n;
+} svcx__roaring_view;
+
+static svcx__roaring_view svcx__roaring_view_of(
+    const svcx_roaring_container *c, uint64_t *scratch) {
+    svcx__roaring_view v = {0};
+
+    switch (c->kind) {
+    case SVCX_ROARING_ARRAY:
+        v.array = (const uint16_t *)c->data;
+        v.n = c->len;
+        break;
+    case SVCX_ROARING_BITMAP:
+        v.bitmap = (const uint64_t *)c->data;
+        break;
+    default: {
+        const svcx_roaring_run *runs = (const svcx_roaring_run *)c->data;
+        memset(scratch, 0, SVCX__ROARING_WORDS * sizeof(uint64_t));
+        for (uint32_t i = 0; i < c->len; i++) {
+            svcx__bitmap_set_range(scratch,
+                runs[i].start,
+                (uint32_t)runs[i].start + runs[i].length);
+        }
+        v.bitmap = scratch;
+        break;
+    }
+    }
+    return v;
 }
 
-SVCXDEF svcx_string_view svcx_sv_from_cstr(const char *data) {
-    return (svcx_string_view){data, strlen(data)};
+static bool svcx__bitmap_test(const uint64_t *words, uint16_t low) {
+    return (words[low / 64] >> (low % 64)) & 1;
 }
 
-SVCXDEF bool svcx_sv_contains(
-    svcx_string_view haystack, svcx_string_view needle) {
-    if (needle.len == 0) {
-        return true;
-    }
-    if (needle.len > haystack.len) {
-        return false;
+// Merges two sorted arrays, out must have room for the result.
+static uint32_t svcx__u16_merge(const uint16_t *x,
+    uint32_t nx,
+    const uint16_t *y,
+    uint32_t ny,
+    svcx__bitop op,
+    uint16_t *out) {
+    uint32_t i = 0;
+    uint32_t j = 0;
+    uint32_t n = 0;
+
+    while (i < nx && j < ny) {
+        if (x[i] < y[j]) {
+            if (op != SVCX__BITOP_AND) {
+                out[n++] = x[i];
+            }
+            i++;
+        } else if (y[j] < x[i]) {
+            if (op == SVCX__BITOP_OR || op == SVCX__BITOP_XOR) {
+                out[n++] = y[j];
+            }
+            j++;
+        } else {
+            if (op == SVCX__BITOP_AND || op == SVCX__BITOP_OR) {
+                out[n++] = x[i];
+            }
+            i++;
+            j++;
+        }
     }
 
-    for (size_t i = 0; i <= haystack.len - needle.len; i++) {
-        if (memcmp(haystack.data + i, needle.data, needle.len) == 0) {
-            return true;
+    if (op != SVCX__BITOP_AND) {
+        for (; i < nx; i++) {
+            out[n++] = x[i];
         }
     }
-    return false;
+    if (op == SVCX__BITOP_OR || op == SVCX__BITOP_XOR) {
+        for (; j < ny; j++) {
+            out[n++] = y[j];
+        }
+    }
+    return n;
 }
 
-SVCXDEF size_t svcx_sv_find(
-    svcx_string_view haystack, svcx_string_view needle) {
-    if (needle.len == 0) {
-        return 0;
-    }
-    if (needle.len > haystack.len) {
-        return -1;
+static svcx_result svcx__roaring_container_op(svcx_allocator *a,
+    const svcx_roaring_container *x,
+    const svcx_roaring_container *y,
+    svcx__bitop op,
+    svcx_roaring_container *out) {
+    uint64_t scratch[2][SVCX__ROARING_WORDS];
+    svcx__roaring_view vx = svcx__roaring_view_of(x, scratch[0]);
+    svcx__roaring_view vy = svcx__roaring_view_of(y, scratch[1]);
+
+    out->key = x->key;
+    out->data = NULL;
+    out->card = 0;
+    out->len = 0;
+    out->cap = 0;
+
+    bool array_result = false;
+    uint32_t bound = 0;
+
+    if (vx.array && vy.array) {
+        switch (op) {
+        case SVCX__BITOP_AND:
+            bound = vx.n < vy.n ? vx.n : vy.n;
+            break;
+        case SVCX__BITOP_ANDNOT:
+            bound = vx.n;
+            break;
+        default:
+            bound = vx.n + vy.n;
+            break;
+        }
+        array_result = bound <= SVCX__ROARING_ARRAY_MAX;
+    } else if (op == SVCX__BITOP_AND && (vx.array || vy.array)) {
+        array_result = true;
+        bound = vx.array ? vx.n : vy.n;
+    } else if (op == SVCX__BITOP_ANDNOT && vx.array) {
+        array_result = true;
+        bound = vx.n;
     }
 
-    for (size_t i = 0; i <= haystack.len - needle.len; i++) {
-        if (memcmp(haystack.data + i, needle.data, needle.len) == 0) {
-            return i;
+    if (array_result) {
+        if (bound == 0) {
+            return SVCX_OK;
         }
+        uint16_t *values = (uint16_t *)svcx_alloc(a, bound * sizeof(uint16_t));
+        if (!values) {
+            return SVCX_ROARING_ALLOC_ERR;
+        }
+
+        uint32_t n = 0;
+        if (vx.array && vy.array) {
+            n = svcx__u16_merge(vx.array, vx.n, vy.array, vy.n, op, values);
+        } else {
+            // Filter the array operand through the bitmap operand.
+            const uint16_t *arr = vx.array ? vx.array : vy.array;
+            const uint64_t *bm = vx.array ? vy.bitmap : vx.bitmap;
+            bool keep_if_set = op == SVCX__BITOP_AND;
+            for (uint32_t i = 0; i < bound; i++) {
+                if (svcx__bitmap_test(bm, arr[i]) == keep_if_set) {
+                    values[n++] = arr[i];
+                }
+            }
+        }
+
+        if (n == 0) {
+            svcx_free(a, values);
+            return SVCX_OK;
+        }
+        out->data = values;
+        out->kind = SVCX_ROARING_ARRAY;
+        out->card = n;
+        out->len = n;
+        out->cap = bound;
+        return SVCX_OK;
     }
-    return -1;
-}
 
-SVCXDEF bool svcx_sv_starts_with(svcx_string_view sv, svcx_string_view prefix) {
-    if (prefix.len > sv.len) {
-        return false;
+    // Bitmap result: start from x and apply y to it.
+    uint64_t *words =
+        (uint64_t *)svcx_alloc(a, SVCX__ROARING_WORDS * sizeof(uint64_t));
+    if (!words) {
+        return SVCX_ROARING_ALLOC_ERR;
     }
-    return memcmp(sv.data, prefix.data, prefix.len) == 0;
-}
 
-SVCXDEF bool svcx_sv_ends_with(svcx_string_view sv, svcx_string_view suffix) {
-    if (suffix.len > sv.len) {
-        return false;
+    if (vx.bitmap) {
+        memcpy(words, vx.bitmap, SVCX__ROARING_WORDS * sizeof(uint64_t));
+    } else {
+        memset(words, 0, SVCX__ROARING_WORDS * sizeof(uint64_t));
+        for (uint32_t i = 0; i < vx.n; i++) {
+            words[vx.array[i] / 64] |= (uint64_t)1 << (vx.array[i] % 64);
+        }
     }
 
-    const char *start = sv.data + (sv.len - suffix.len);
-    return memcmp(start, suffix.data, suffix.len) == 0;
-}
+    if (vy.bitmap) {
+        svcx__words_op(words, vy.bitmap, SVCX__ROARING_WORDS, op);
+    } else {
+        for (uint32_t i = 0; i < vy.n; i++) {
+            uint64_t bit = (uint64_t)1 << (vy.array[i] % 64);
+            switch (op) {
+            case SVCX__BITOP_OR:
+                words[vy.array[i] / 64] |= bit;
+                break;
+            case SVCX__BITOP_XOR:
+                words[vy.array[i] / 64] ^= bit;
+                break;
+            default:
+                words[vy.array[i] / 64] &= ~bit;
+                break;
+            }
+        }
+    }
 
-SVCXDEF svcx_string_view svcx_sv_trim_start(svcx_string_view sv) {
-    size_t start = 0;
-    size_t end = sv.len;
+    out->data = words;
+    out->kind = SVCX_ROARING_BITMAP;
+    out->card =
+        (uint32_t)svcx__popcount_words(words, SVCX__ROARING_WORDS);
+    out->len = SVCX__ROARING_WORDS;
+    out->cap = SVCX__ROARING_WORDS;
 
-    while (start < end && isspace((unsigned char)sv.data[start])) {
-        start++;
+    if (out->card == 0) {
+        svcx__roaring_container_free(a, out);
+        return SVCX_OK;
     }
-
-    return (svcx_string_view){.data = sv.data + start, .len = end - start};
+    if (out->card <= SVCX__ROARING_ARRAY_MAX) {
+        // Like in svcx_roaring_remove, a failed conversion leaves a valid
+        // (if oversized) bitmap, which is kept rather than leaked.
+        svcx__roaring_bitmap_to_array(a, out);
+    }
+    return SVCX_OK;
 }
 
-SVCXDEF svcx_string_view svcx_sv_trim_end(svcx_string_view sv) {
-    size_t start = 0;
-    size_t end = sv.len;
-
-    while (end > start && isspace((unsigned char)sv.data[end - 1])) {
-        end--;
+static svcx_result svcx__roaring_container_clone(svcx_allocator *a,
+    const svcx_roaring_container *c,
+    svcx_roaring_container *out) {
+    size_t elem = c->kind == SVCX_ROARING_ARRAY    ? sizeof(uint16_t)
+                  : c->kind == SVCX_ROARING_BITMAP ? sizeof(uint64_t)
+                                                   : sizeof(svcx_roaring_run);
+    *out = *c;
+    out->cap = c->len;
+    out->data = svcx_alloc(a, c->len * elem);
+    if (!out->data) {
+        return SVCX_ROARING_ALLOC_ERR;
     }
-
-    return (svcx_string_view){
-        .data = sv.data,
-        .len = end,
-    };
+    memcpy(out->data, c->data, c->len * elem);
+    return SVCX_OK;
 }
 
-SVCXDEF svcx_string_view svcx_sv_trim(svcx_string_view sv) {
-    svcx_string_view tmp = svcx_sv_trim_start(sv);
-    return svcx_sv_trim_end(tmp);
+static svcx_result svcx__roaring_push(
+    svcx_roaring *out, svcx_roaring_container *c) {
+    if (c->card == 0) {
+        return SVCX_OK;
+    }
+    if (svcx_vector_push(&out->containers, c) != SVCX_OK) {
+        svcx__roaring_container_free(&out->containers.a, c);
+        return SVCX_ROARING_ALLOC_ERR;
+    }
+    return SVCX_OK;
 }
 
-SVCXDEF svcx_result svcx_sv_split(
-    svcx_string_view sv, char delimiter, svcx_vector *out) {
-    size_t start = 0;
-
-    for (size_t i = 0; i <= sv.len; i++) {
-        if (i == sv.len || sv.data[i] == delimiter) {
-            svcx_string_view part = {
-                .data = sv.data + start,
-                .len = i - start,
-            };
-
-            svcx_result r = svcx_vector_push(out, &part);
-            if (r != SVCX_OK) {
-                return SVCX_SV_SPLIT_ERR;
+static svcx_result svcx__roaring_op(svcx_roaring *out,
+    const svcx_roaring *x,
+    const svcx_roaring *y,
+    svcx__bitop op) {
+    SVCX_ASSERT(out != x && out != y);
+    svcx_roaring_clear(out);
+
+    svcx_allocator *a = &out->containers.a;
+    bool keep_x_only = op != SVCX__BITOP_AND;
+    bool keep_y_only = op == SVCX__BITOP_OR || op == SVCX__BITOP_XOR;
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < x->containers.size || j < y->containers.size) {
+        const svcx_roaring_container *cx =
+            i < x->containers.size ? svcx__roaring_at(x, i) : NULL;
+        const svcx_roaring_container *cy =
+            j < y->containers.size ? svcx__roaring_at(y, j) : NULL;
+
+        svcx_roaring_container c = {0};
+        svcx_result res = SVCX_OK;
+
+        if (cx && (!cy || cx->key < cy->key)) {
+            if (keep_x_only) {
+                res = svcx__roaring_container_clone(a, cx, &c);
             }
+            i++;
+        } else if (cy && (!cx || cy->key < cx->key)) {
+            if (keep_y_only) {
+                res = svcx__roaring_container_clone(a, cy, &c);
+            }
+            j++;
+        } else {
+            res = svcx__roaring_container_op(a, cx, cy, op, &c);
+            i++;
+            j++;
+        }
 
-            start = i + 1;
+        if (res == SVCX_OK) {
+            res = svcx__roaring_push(out, &c);
+        }
+        if (res != SVCX_OK) {
+            return res;
         }
     }
-
     return SVCX_OK;
 }
 
-SVCXDEF svcx_string_view svcx_sv_substring(
-    svcx_string_view sv, size_t start, size_t end) {
-    SVCX_ASSERT(start <= end);
-    SVCX_ASSERT(end <= sv.len);
-
-    if (start > end) {
-        start = end;
-    }
-    if (end > sv.len) {
-        end = sv.len;
-    }
-
-    return svcx_sv_from_parts(sv.data + start, end - start);
+SVCXDEF svcx_result svcx_roaring_and(
+    svcx_roaring *out, const svcx_roaring *a, const svcx_roaring *b) {
+    return svcx__roaring_op(out, a, b, SVCX__BITOP_AND);
 }
 
-SVCXDEF void svcx_sb_init(svcx_string_builder *sb, svcx_allocator a) {
-    svcx_vector_init(&sb->buf, sizeof(char), a);
+SVCXDEF svcx_result svcx_roaring_or(
+    svcx_roaring *out, const svcx_roaring *a, const svcx_roaring *b) {
+    return svcx__roaring_op(out, a, b, SVCX__BITOP_OR);
 }
 
-SVCXDEF void svcx_sb_clear(svcx_string_builder *sb) {
-    svcx_vector_clear(&sb->buf);
+SVCXDEF svcx_result svcx_roaring_xor(
+    svcx_roaring *out, const svcx_roaring *a, const svcx_roaring *b) {
+    return svcx__roaring_op(out, a, b, SVCX__BITOP_XOR);
 }
 
-SVCXDEF void svcx_sb_free(svcx_string_builder *sb) {
-    svcx_vector_free(&sb->buf);
+SVCXDEF svcx_result svcx_roaring_andnot(
+    svcx_roaring *out, const svcx_roaring *a, const svcx_roaring *b) {
+    return svcx__roaring_op(out, a, b, SVCX__BITOP_ANDNOT);
 }
 
-SVCXDEF svcx_result svcx_sb_push_char(svcx_string_builder *sb, char c) {
-    if (svcx_vector_push(&sb->buf, &c) != SVCX_OK) {
-        return SVCX_SB_PUSHC_ERR;
+static void svcx__roaring_extend_runs(
+    svcx_roaring_run *runs, uint32_t *n, uint16_t low) {
+    if (*n > 0 &&
+        low == (uint32_t)runs[*n - 1].start + runs[*n - 1].length + 1) {
+        runs[*n - 1].length++;
+    } else {
+        runs[*n].start = low;
+        runs[*n].length = 0;
+        (*n)++;
     }
-    return SVCX_OK;
 }
 
-SVCXDEF svcx_result svcx_sb_append(
-    svcx_string_builder *sb, const char *str, size_t len) {
-    SVCX_ASSERT(str || len == 0);
+// Fills runs with the runs of an array or bitmap container, in order.
+static void svcx__roaring_collect_runs(
+    const svcx_roaring_container *c, svcx_roaring_run *runs) {
+    uint32_t n = 0;
 
-    if (len == 0) {
-        return SVCX_OK;
+    if (c->kind == SVCX_ROARING_ARRAY) {
+        const uint16_t *values = (const uint16_t *)c->data;
+        for (uint32_t k = 0; k < c->len; k++) {
+            svcx__roaring_extend_runs(runs, &n, values[k]);
+        }
+        return;
     }
 
-    size_t old_size = sb->buf.size;
+    const uint64_t *words = (const uint64_t *)c->data;
+    for (uint32_t w = 0; w < SVCX__ROARING_WORDS; w++) {
+        uint64_t word = words[w];
+        while (word) {
+            uint32_t low = w * 64 + (uint32_t)svcx__ctz64(word);
+            svcx__roaring_extend_runs(runs, &n, (uint16_t)low);
+            word &= word - 1;
+        }
+    }
+}
 
-    svcx_result r = svcx_vector_reserve(&sb->buf, old_size + len);
+SVCXDEF svcx_result svcx_roaring_run_optimize(svcx_roaring *r) {
+    SVCX_ASSERT(r);
+    svcx_allocator *a = &r->containers.a;
 
-    if (r != SVCX_OK) {
-        return SVCX_SB_APPEND_ERR;
-    }
+    for (size_t i = 0; i < r->containers.size; i++) {
+        svcx_roaring_container *c = svcx__roaring_at(r, i);
+        uint32_t nruns = 0;
+        size_t size;
 
-    memcpy((char *)sb->buf.data + old_size, str, len);
-    sb->buf.size += len;
+        if (c->kind == SVCX_ROARING_ARRAY) {
+            const uint16_t *values = (const uint16_t *)c->data;
+            for (uint32_t k = 0; k < c->len; k++) {
+                nruns += k == 0 || values[k] != values[k - 1] + 1;
+            }
+            size = c->len * sizeof(uint16_t);
+        } else if (c->kind == SVCX_ROARING_BITMAP) {
+            // A run starts at every set bit whose lower neighbour is clear.
+            const uint64_t *words = (const uint64_t *)c->data;
+            uint64_t carry = 0;
+            for (uint32_t w = 0; w < SVCX__ROARING_WORDS; w++) {
+                uint64_t starts = words[w] & ~((words[w] << 1) | carry);
+                nruns += (uint32_t)svcx__popcount64(starts);
+                carry = words[w] >> 63;
+            }
+            size = SVCX__ROARING_WORDS * sizeof(uint64_t);
+        } else {
+            continue;
+        }
+
+        if (nruns * sizeof(svcx_roaring_run) >= size) {
+            continue;
+        }
+
+        svcx_roaring_run *runs =
+            (svcx_roaring_run *)svcx_alloc(a, nruns * sizeof(svcx_roaring_run));
+        if (!runs) {
+            return SVCX_ROARING_ALLOC_ERR;
+        }
+
+        svcx__roaring_collect_runs(c, runs);
 
+        uint32_t card = c->card;
+        svcx__roaring_container_free(a, c);
+        c->data = runs;
+        c->kind = SVCX_ROARING_RUN;
+        c->card = card;
+        c->len = nruns;
+        c->cap = nruns;
+    }
     return SVCX_OK;
 }
 
-SVCXDEF svcx_result svcx_sb_append_cstr(
-    svcx_string_builder *sb, const char *cstr) {
-    return svcx_sb_append(sb, cstr, strlen(cstr));
+static void svcx__roaring_iter_enter(svcx_roaring_iter *it) {
+    it->index = 0;
+    it->offset = 0;
+    it->word = 0;
+    if (it->container < it->r->containers.size) {
+        const svcx_roaring_container *c =
+            svcx__roaring_at(it->r, it->container);
+        if (c->kind == SVCX_ROARING_BITMAP) {
+            it->word = ((const uint64_t *)c->data)[0];
+        }
+    }
 }
 
-SVCXDEF svcx_result svcx_sb_append_sv(
-    svcx_string_builder *sb, svcx_string_view sv) {
-    if (sv.len == 0) {
-        return SVCX_OK;
+SVCXDEF void svcx_roaring_iter_init(
+    svcx_roaring_iter *it, const svcx_roaring *r) {
+    it->r = r;
+    it->container = 0;
+    svcx__roaring_iter_enter(it);
+}
+
+SVCXDEF bool svcx_roaring_iter_next(svcx_roaring_iter *it, uint32_t *value) {
+    while (it->container < it->r->containers.size) {
+        const svcx_roaring_container *c =
+            svcx__roaring_at(it->r, it->container);
+        uint32_t high = (uint32_t)c->key << 16;
+
+        if (c->kind == SVCX_ROARING_ARRAY) {
+            if (it->index < c->len) {
+                *value = high | ((const uint16_t *)c->data)[it->index++];
+                return true;
+            }
+        } else if (c->kind == SVCX_ROARING_BITMAP) {
+            const uint64_t *words = (const uint64_t *)c->data;
+            while (it->word == 0 && it->index + 1 < SVCX__ROARING_WORDS) {
+                it->word = words[++it->index];
+            }
+            if (it->word) {
+                uint32_t bit = (uint32_t)svcx__ctz64(it->word);
+                *value = high | (it->index * 64 + bit);
+                it->word &= it->word - 1;
+                return true;
+            }
+        } else if (it->index < c->len) {
+            const svcx_roaring_run *run =
+                (const svcx_roaring_run *)c->data + it->index;
+            *value = high | (run->start + it->offset);
+            if (it->offset == run->length) {
+                it->index++;
+                it->offset = 0;
+            } else {
+                it->offset++;
+            }
+            return true;
+        }
+
+        it->container++;
+        svcx__roaring_iter_enter(it);
     }
+    return false;
+}
 
-    size_t new_size = sb->buf.size + sv.len;
+//
+// The serialized format is little-endian:
+//   "SVRB" magic, u32 container count, and for every container
+//   u16 key, u8 kind, u8 zero, u32 cardinality, u32 length
+// followed by length u16 values (array), u64 words (bitmap) or u16
+// start/length pairs (run).
+//
+static unsigned char *svcx__put_le(unsigned char *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        *p++ = (unsigned char)(v >> (8 * i));
+    }
+    return p;
+}
 
-    svcx_result r = svcx_vector_reserve(&sb->buf, new_size);
-    if (r != SVCX_OK) {
-        return SVCX_SB_APPEND_SV_ERR;
+static uint64_t svcx__get_le(const unsigned char *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) {
+        v |= (uint64_t)p[i] << (8 * i);
+    }
+    return v;
+}
+
+SVCXDEF svcx_result svcx_roaring_serialize(
+    const svcx_roaring *r, svcx_string_builder *sb) {
+    SVCX_ASSERT(r);
+    SVCX_ASSERT(sb);
+
+    size_t total = 8;
+    for (size_t i = 0; i < r->containers.size; i++) {
+        const svcx_roaring_container *c = svcx__roaring_at(r, i);
+        total += 12;
+        total += c->kind == SVCX_ROARING_BITMAP ? c->len * 8
+                 : c->kind == SVCX_ROARING_RUN  ? c->len * 4
+                                                : c->len * 2;
     }
 
-    memcpy((char *)sb->buf.data + sb->buf.size, sv.data, sv.len);
+    if (svcx_vector_reserve(&sb->buf, sb->buf.size + total) != SVCX_OK) {
+        return SVCX_ROARING_SERIALIZE_ERR;
+    }
 
-    sb->buf.size = new_size;
+    unsigned char *p = (unsigned char *)sb->buf.data + sb->buf.size;
+    memcpy(p, "SVRB", 4);
+    p = svcx__put_le(p + 4, r->containers.size, 4);
+
+    for (size_t i = 0; i < r->containers.size; i++) {
+        const svcx_roaring_container *c = svcx__roaring_at(r, i);
+        p = svcx__put_le(p, c->key, 2);
+        p = svcx__put_le(p, c->kind, 1);
+        p = svcx__put_le(p, 0, 1);
+        p = svcx__put_le(p, c->card, 4);
+        p = svcx__put_le(p, c->len, 4);
+
+        if (c->kind == SVCX_ROARING_BITMAP) {
+            const uint64_t *words = (const uint64_t *)c->data;
+            for (uint32_t k = 0; k < c->len; k++) {
+                p = svcx__put_le(p, words[k], 8);
+            }
+        } else if (c->kind == SVCX_ROARING_RUN) {
+            const svcx_roaring_run *runs = (const svcx_roaring_run *)c->data;
+            for (uint32_t k = 0; k < c->len; k++) {
+                p = svcx__put_le(p, runs[k].start, 2);
+                p = svcx__put_le(p, runs[k].length, 2);
+            }
+        } else {
+            const uint16_t *values = (const uint16_t *)c->data;
+            for (uint32_t k = 0; k < c->len; k++) {
+                p = svcx__put_le(p, values[k], 2);
+            }
+        }
+    }
 
+    sb->buf.size += total;
     return SVCX_OK;
 }
 
-SVCXDEF svcx_result svcx_sb_append_fmt(
-    svcx_string_builder *sb, const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-
-    va_list args_copy;
-    va_copy(args_copy, args);
+// Reads and validates a single container, checking that its contents are
+// sorted and consistent with the stored cardinality.
+static svcx_result svcx__roaring_read_container(svcx_allocator *a,
+    const unsigned char **cursor,
+    const unsigned char *end,
+    svcx_roaring_container *c) {
+    const unsigned char *p = *cursor;
+    if (end - p < 12) {
+        return SVCX_ROARING_DESERIALIZE_ERR;
+    }
 
-    int needed = vsnprintf(NULL, 0, fmt, args);
-    va_end(args);
+    c->key = (uint16_t)svcx__get_le(p, 2);
+    c->kind = p[2];
+    c->card = (uint32_t)svcx__get_le(p + 4, 4);
+    c->len = (uint32_t)svcx__get_le(p + 8, 4);
+    c->data = NULL;
+    p += 12;
+
+    size_t elem;
+    switch (c->kind) {
+    case SVCX_ROARING_ARRAY:
+        elem = 2;
+        if (c->len != c->card || c->card > SVCX__ROARING_ARRAY_MAX) {
+            return SVCX_ROARING_DESERIALIZE_ERR;
+        }
+        break;
+    case SVCX_ROARING_BITMAP:
+        elem = 8;
+        if (c->len != SVCX__ROARING_WORDS || c->card > 65536) {
+            return SVCX_ROARING_DESERIALIZE_ERR;
+        }
+        break;
+    case SVCX_ROARING_RUN:
+        elem = 4;
+        if (c->len > 32768) {
+            return SVCX_ROARING_DESERIALIZE_ERR;
+        }
+        break;
+    default:
+        return SVCX_ROARING_DESERIALIZE_ERR;
+    }
 
-    if (needed < 0) {
-        va_end(args_copy);
-        return SVCX_SB_FMT_INVALID_ARG_ERR;
+    if (c->card == 0 || (size_t)(end - p) / elem < c->len) {
+        return SVCX_ROARING_DESERIALIZE_ERR;
     }
 
-    size_t old_size = sb->buf.size;
+    c->cap = c->len;
+    c->data = svcx_alloc(a, c->len * elem);
+    if (!c->data) {
+        return SVCX_ROARING_ALLOC_ERR;
+    }
 
-    svcx_result r = svcx_vector_reserve(&sb->buf, old_size + (size_t)needed);
+    uint64_t card = 0;
+    bool ok = true;
+    if (c->kind == SVCX_ROARING_ARRAY) {
+        uint16_t *values = (uint16_t *)c->data;
+        for (uint32_t k = 0; k < c->len; k++, p += 2) {
+            values[k] = (uint16_t)svcx__get_le(p, 2);
+            ok = ok && (k == 0 || values[k] > values[k - 1]);
+        }
+        card = c->len;
+    } else if (c->kind == SVCX_ROARING_BITMAP) {
+        uint64_t *words = (uint64_t *)c->data;
+        for (uint32_t k = 0; k < c->len; k++, p += 8) {
+            words[k] = svcx__get_le(p, 8);
+        }
+        card = svcx__popcount_words(words, c->len);
+    } else {
+        svcx_roaring_run *runs = (svcx_roaring_run *)c->data;
+        for (uint32_t k = 0; k < c->len; k++, p += 4) {
+            runs[k].start = (uint16_t)svcx__get_le(p, 2);
+            runs[k].length = (uint16_t)svcx__get_le(p + 2, 2);
+            uint32_t last = (uint32_t)runs[k].start + runs[k].length;
+            ok = ok && last <= 0xFFFF;
+            ok = ok && (k == 0 || runs[k].start >
+                                      (uint32_t)runs[k - 1].start +
+                                          runs[k - 1].length + 1);
+            card += (uint64_t)runs[k].length + 1;
+        }
+    }
 
-    if (r != SVCX_OK) {
-        va_end(args_copy);
-        return SVCX_SB_FMT_RESERVE_ERR;
+    if (!ok || card != c->card) {
+        svcx__roaring_container_free(a, c);
+        return SVCX_ROARING_DESERIALIZE_ERR;
     }
 
-    vsnprintf(
-        (char *)sb->buf.data + old_size, (size_t)needed + 1, fmt, args_copy);
-    va_end(args_copy);
-    sb->buf.size += (size_t)needed;
+    *cursor = p;
     return SVCX_OK;
 }
 
-SVCXDEF const char *svcx_sb_cstr(svcx_string_builder *sb) {
-    char zero = '\0';
-
-    if (sb->buf.size == sb->buf.cap ||
-        ((char *)sb->buf.data)[sb->buf.size] != '\0') {
-        svcx_vector_push(&sb->buf, &zero);
-        sb->buf.size--;
-    }
-
-    return (const char *)sb->buf.data;
-}
+SVCXDEF svcx_result svcx_roaring_deserialize(
+    svcx_roaring *r, svcx_string_view sv) {
+    SVCX_ASSERT(r);
 
-SVCXDEF char *svcx_sb_build(svcx_string_builder *sb) {
-    char zero = '\0';
-    svcx_vector_push(&sb->buf, &zero);
-    return (char *)sb->buf.data;
-}
+    const unsigned char *p = (const unsigned char *)sv.data;
+    const unsigned char *end = p + sv.len;
+    svcx_roaring_clear(r);
 
-SVCXDEF svcx_string_view svcx_sb_view(svcx_string_builder *sb) {
-    return (svcx_string_view){
-        .data = (const char *)sb->buf.data, .len = sb->buf.size};
+    if (sv.len < 8 || memcmp(p, "SVRB", 4) != 0) {
+        return SVCX_ROARING_DESERIALIZE_ERR;
+    }
+    size_t count = (size_t)svcx__get_le(p + 4, 4);
+    p += 8;
+
+    for (size_t i = 0; i < count; i++) {
+        svcx_roaring_container c;
+        svcx_result res =
+            svcx__roaring_read_container(&r->containers.a, &p, end, &c);
+        if (res == SVCX_OK && i > 0 &&
+            c.key <= svcx__roaring_at(r, i - 1)->key) {
+            svcx__roaring_container_free(&r->containers.a, &c);
+            res = SVCX_ROARING_DESERIALIZE_ERR;
+        }
+        if (res == SVCX_OK) {
+            res = svcx__roaring_push(r, &c);
+        }
+        if (res != SVCX_OK) {
+            svcx_roaring_clear(r);
+            return res;
+        }
+    }
+    return SVCX_OK;
 }
 
 #endif // SVCX_IMPLEMENTATION